@@ -0,0 +1,235 @@
+#include "stdafx.h"
+#include "_D3D9LightDevice.h"
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		// 16 bit index. quads are drawn by base vertex so index buffer has this quads at most
+		constexpr size_t maxQuadCount = 0x10000 / _LightDevice::verticesPerQuad;
+	}
+
+	_D3D9LightDevice::~_D3D9LightDevice()
+	{
+		Invalidate();
+
+		for ( auto& page : m_pages ) {
+			if ( !page.isShared ) {
+				SAFE_RELEASE( page.pTexture );
+			}
+		}
+	}
+
+	bool _D3D9LightDevice::CreatePage( size_t& outPage, uint32_t width, uint32_t height )
+	{
+		LPDIRECT3DTEXTURE9 pTexture{};
+
+		if ( FAILED( m_pDevice->CreateTexture( width, height, 1, 0, D3DFMT_DXT5, D3DPOOL_MANAGED, &pTexture, NULL ) ) ) {
+			ASSERT( FALSE );
+			return false;
+		}
+
+		outPage = m_pages.size();
+		m_pages.push_back( { pTexture, false } );
+
+		return true;
+	}
+
+	size_t _D3D9LightDevice::CreateSharedPage()
+	{
+		m_pages.push_back( { nullptr, true } );
+
+		return m_pages.size() - 1;
+	}
+
+	void _D3D9LightDevice::SetSharedPage( size_t page, LPDIRECT3DTEXTURE9 pTexture )
+	{
+		ASSERT( page < m_pages.size() && m_pages[page].isShared );
+
+		m_pages[page].pTexture = pTexture;
+	}
+
+	bool _D3D9LightDevice::UploadBlocks( size_t page, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pBlocks, uint32_t pitch )
+	{
+		ASSERT( page < m_pages.size() && !m_pages[page].isShared );
+		ASSERT( !( x % 4 ) && !( y % 4 ) && !( width % 4 ) && !( height % 4 ) );
+
+		const RECT rect{ static_cast<LONG>( x ), static_cast<LONG>( y ), static_cast<LONG>( x + width ), static_cast<LONG>( y + height ) };
+		D3DLOCKED_RECT lockedRect{};
+
+		if ( FAILED( m_pages[page].pTexture->LockRect( 0, &lockedRect, &rect, 0 ) ) ) {
+			ASSERT( FALSE );
+			return false;
+		}
+
+		// locked rect points first block. pitch is bytes per row of blocks
+		auto* pDest = static_cast<LPBYTE>( lockedRect.pBits );
+		auto rowSize = ( width / 4 ) * 16;
+
+		for ( UINT row{}; row < height / 4; ++row ) {
+			memcpy( pDest + row * lockedRect.Pitch, pBlocks + row * pitch, rowSize );
+		}
+
+		return SUCCEEDED( m_pages[page].pTexture->UnlockRect( 0 ) );
+	}
+
+	bool _D3D9LightDevice::UploadVertices( const Vertex* pVertices, size_t count )
+	{
+		ASSERT( count );
+
+		auto size = static_cast<UINT>( sizeof( Vertex ) * count );
+
+		if ( m_vertexCapacity < count ) {
+			SAFE_RELEASE( m_pVertexBuffer );
+
+			if ( FAILED( m_pDevice->CreateVertexBuffer( size, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, m_fvf, D3DPOOL_DEFAULT, &m_pVertexBuffer, NULL ) ) ) {
+				ASSERT( FALSE );
+				m_vertexCapacity = 0;
+				return false;
+			}
+
+			m_vertexCapacity = count;
+		}
+
+		LPVOID pLocked{};
+
+		if ( FAILED( m_pVertexBuffer->Lock( 0, size, &pLocked, D3DLOCK_DISCARD ) ) ) {
+			ASSERT( FALSE );
+			return false;
+		}
+
+		memcpy( pLocked, pVertices, size );
+		m_pVertexBuffer->Unlock();
+
+		return SUCCEEDED( UpdateIndexBuffer( count / verticesPerQuad ) );
+	}
+
+	bool _D3D9LightDevice::Begin( _RenderStateCache& stateCache )
+	{
+		ASSERT( !m_pStateCache );
+
+		if ( !m_pVertexBuffer || !m_pIndexBuffer ) {
+			return false;
+		}
+		else if ( FAILED( m_pDevice->BeginScene() ) ) {
+			return false;
+		}
+
+		// vertices are in world coordinate and uv is in page already
+		D3DXMATRIX identity{};
+		D3DXMatrixIdentity( &identity );
+		stateCache.SetTransform( D3DTS_WORLD, identity );
+		stateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE );
+		stateCache.SetFVF( m_fvf );
+		m_pDevice->SetStreamSource( 0, m_pVertexBuffer, 0, sizeof( Vertex ) );
+		m_pDevice->SetIndices( m_pIndexBuffer );
+
+		m_pStateCache = &stateCache;
+
+		return true;
+	}
+
+	bool _D3D9LightDevice::DrawQuads( size_t page, size_t firstQuad, size_t quadCount )
+	{
+		ASSERT( m_pStateCache );
+		ASSERT( page < m_pages.size() );
+
+		if ( !m_pages[page].pTexture ) {
+			ASSERT( FALSE );
+			return false;
+		}
+
+		m_pStateCache->SetTexture( 0, m_pages[page].pTexture );
+
+		// too many quads are divided by size of index buffer
+		while ( quadCount ) {
+			auto count = min( quadCount, maxQuadCount );
+			auto baseVertex = static_cast<INT>( firstQuad * verticesPerQuad );
+
+			if ( FAILED( m_pDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, baseVertex, 0, static_cast<UINT>( count * verticesPerQuad ), 0, static_cast<UINT>( count * 2 ) ) ) ) {
+				ASSERT( FALSE );
+				return false;
+			}
+
+			firstQuad += count;
+			quadCount -= count;
+		}
+
+		return true;
+	}
+
+	void _D3D9LightDevice::End()
+	{
+		ASSERT( m_pStateCache );
+
+		// states are restored by owner of the cache
+		m_pDevice->EndScene();
+
+		m_pStateCache = nullptr;
+	}
+
+	void _D3D9LightDevice::Invalidate()
+	{
+		SAFE_RELEASE( m_pVertexBuffer );
+		SAFE_RELEASE( m_pIndexBuffer );
+
+		m_vertexCapacity = 0;
+		m_indexedQuadCount = 0;
+
+		// shared texture could be in default pool. it must not be used after reset
+		for ( auto& page : m_pages ) {
+			if ( page.isShared ) {
+				page.pTexture = nullptr;
+			}
+		}
+	}
+
+	bool _D3D9LightDevice::RestoreDevice()
+	{
+		ASSERT( !m_pVertexBuffer );
+		ASSERT( !m_pIndexBuffer );
+
+		// buffers are made again at UploadVertices()
+		return true;
+	}
+
+	HRESULT _D3D9LightDevice::UpdateIndexBuffer( size_t quadCount )
+	{
+		quadCount = min( quadCount, maxQuadCount );
+
+		if ( m_pIndexBuffer && m_indexedQuadCount >= quadCount ) {
+			return S_OK;
+		}
+
+		SAFE_RELEASE( m_pIndexBuffer );
+
+		auto size = static_cast<UINT>( sizeof( WORD ) * indicesPerQuad * quadCount );
+
+		if ( FAILED( m_pDevice->CreateIndexBuffer( size, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_DEFAULT, &m_pIndexBuffer, NULL ) ) ) {
+			ASSERT( FALSE );
+			return E_FAIL;
+		}
+
+		LPVOID pLocked{};
+
+		if ( FAILED( m_pIndexBuffer->Lock( 0, size, &pLocked, 0 ) ) ) {
+			ASSERT( FALSE );
+			return E_FAIL;
+		}
+
+		// two triangles of LT, LB, RB, RT
+		auto* pIndices = static_cast<LPWORD>( pLocked );
+
+		for ( size_t i{}; i < quadCount; ++i ) {
+			auto base = static_cast<WORD>( i * verticesPerQuad );
+			const WORD indices[] = { base, static_cast<WORD>( base + 1 ), static_cast<WORD>( base + 2 ), base, static_cast<WORD>( base + 2 ), static_cast<WORD>( base + 3 ) };
+			memcpy( pIndices + i * indicesPerQuad, indices, sizeof( indices ) );
+		}
+
+		m_pIndexBuffer->Unlock();
+		m_indexedQuadCount = quadCount;
+
+		return S_OK;
+	}
+}
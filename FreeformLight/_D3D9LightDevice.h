@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <d3dx9.h>
+#include "_LightDevice.h"
+#include "_RenderStateCache.h"
+
+
+namespace FreeformLight
+{
+	class _D3D9LightDevice : public _LightDevice
+	{
+	public:
+		explicit _D3D9LightDevice( LPDIRECT3DDEVICE9 pDevice ) : m_pDevice{ pDevice }
+		{}
+
+		virtual ~_D3D9LightDevice();
+
+		virtual bool CreatePage( size_t& outPage, uint32_t width, uint32_t height ) override;
+		// page of texture which is owned by other. e.g. render target of _MaskAtlasTexture
+		// texture isn't referenced and it is cleared at Invalidate(). so owner sets it before each draw
+		size_t CreateSharedPage();
+		void SetSharedPage( size_t page, LPDIRECT3DTEXTURE9 );
+		virtual bool UploadBlocks( size_t page, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pBlocks, uint32_t pitch ) override;
+		virtual bool UploadVertices( const Vertex*, size_t count ) override;
+
+		virtual bool Begin( _RenderStateCache& ) override;
+		virtual bool DrawQuads( size_t page, size_t firstQuad, size_t quadCount ) override;
+		virtual void End() override;
+
+		virtual void Invalidate() override;
+		virtual bool RestoreDevice() override;
+
+	private:
+		HRESULT UpdateIndexBuffer( size_t quadCount );
+
+	private:
+		static constexpr DWORD m_fvf = D3DFVF_XYZ | D3DFVF_TEX1;
+
+		LPDIRECT3DDEVICE9 m_pDevice{};
+
+		// owned pages are in managed pool. they aren't released at Invalidate()
+		struct Page
+		{
+			LPDIRECT3DTEXTURE9 pTexture;
+			bool isShared;
+		};
+		std::vector<Page> m_pages;
+
+		LPDIRECT3DVERTEXBUFFER9 m_pVertexBuffer{};
+		LPDIRECT3DINDEXBUFFER9 m_pIndexBuffer{};
+		size_t m_vertexCapacity{};
+		size_t m_indexedQuadCount{};
+
+		// it is set between Begin() and End()
+		_RenderStateCache* m_pStateCache{};
+	};
+}
@@ -0,0 +1,101 @@
+#include "stdafx.h"
+#include "_D3D9RenderStateDevice.h"
+
+
+namespace FreeformLight
+{
+	_D3D9RenderStateDevice::Value _D3D9RenderStateDevice::GetState( Kind kind, DWORD stage, DWORD type )
+	{
+		Value value{};
+
+		switch ( kind ) {
+		case Kind::renderState:
+			{
+				DWORD state{};
+				m_pDevice->GetRenderState( static_cast<D3DRENDERSTATETYPE>( type ), &state );
+				value = state;
+				break;
+			}
+		case Kind::samplerState:
+			{
+				DWORD state{};
+				m_pDevice->GetSamplerState( stage, static_cast<D3DSAMPLERSTATETYPE>( type ), &state );
+				value = state;
+				break;
+			}
+		case Kind::textureStageState:
+			{
+				DWORD state{};
+				m_pDevice->GetTextureStageState( stage, static_cast<D3DTEXTURESTAGESTATETYPE>( type ), &state );
+				value = state;
+				break;
+			}
+		case Kind::fvf:
+			{
+				DWORD fvf{};
+				m_pDevice->GetFVF( &fvf );
+				value = fvf;
+				break;
+			}
+		// device adds reference. it is owned by the one who set it
+		case Kind::texture:
+			{
+				LPDIRECT3DBASETEXTURE9 pTexture{};
+				m_pDevice->GetTexture( stage, &pTexture );
+				value = reinterpret_cast<Value>( pTexture );
+				SAFE_RELEASE( pTexture );
+				break;
+			}
+		case Kind::pixelShader:
+			{
+				LPDIRECT3DPIXELSHADER9 pShader{};
+				m_pDevice->GetPixelShader( &pShader );
+				value = reinterpret_cast<Value>( pShader );
+				SAFE_RELEASE( pShader );
+				break;
+			}
+		default:
+			ASSERT( FALSE );
+			break;
+		}
+
+		return value;
+	}
+
+	void _D3D9RenderStateDevice::SetState( Kind kind, DWORD stage, DWORD type, Value value )
+	{
+		switch ( kind ) {
+		case Kind::renderState:
+			m_pDevice->SetRenderState( static_cast<D3DRENDERSTATETYPE>( type ), static_cast<DWORD>( value ) );
+			break;
+		case Kind::samplerState:
+			m_pDevice->SetSamplerState( stage, static_cast<D3DSAMPLERSTATETYPE>( type ), static_cast<DWORD>( value ) );
+			break;
+		case Kind::textureStageState:
+			m_pDevice->SetTextureStageState( stage, static_cast<D3DTEXTURESTAGESTATETYPE>( type ), static_cast<DWORD>( value ) );
+			break;
+		case Kind::fvf:
+			m_pDevice->SetFVF( static_cast<DWORD>( value ) );
+			break;
+		case Kind::texture:
+			m_pDevice->SetTexture( stage, reinterpret_cast<LPDIRECT3DBASETEXTURE9>( value ) );
+			break;
+		case Kind::pixelShader:
+			m_pDevice->SetPixelShader( reinterpret_cast<LPDIRECT3DPIXELSHADER9>( value ) );
+			break;
+		default:
+			ASSERT( FALSE );
+			break;
+		}
+	}
+
+	void _D3D9RenderStateDevice::GetTransform( D3DTRANSFORMSTATETYPE type, D3DMATRIX& matrix )
+	{
+		m_pDevice->GetTransform( type, &matrix );
+	}
+
+	void _D3D9RenderStateDevice::SetTransform( D3DTRANSFORMSTATETYPE type, const D3DMATRIX& matrix )
+	{
+		m_pDevice->SetTransform( type, &matrix );
+	}
+}
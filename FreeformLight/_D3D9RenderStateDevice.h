@@ -0,0 +1,22 @@
+#pragma once
+#include <d3dx9.h>
+#include "_RenderStateDevice.h"
+
+
+namespace FreeformLight
+{
+	class _D3D9RenderStateDevice : public _RenderStateDevice
+	{
+	public:
+		explicit _D3D9RenderStateDevice( LPDIRECT3DDEVICE9 pDevice ) : m_pDevice{ pDevice }
+		{}
+
+		virtual Value GetState( Kind, DWORD stage, DWORD type ) override;
+		virtual void SetState( Kind, DWORD stage, DWORD type, Value ) override;
+		virtual void GetTransform( D3DTRANSFORMSTATETYPE, D3DMATRIX& ) override;
+		virtual void SetTransform( D3DTRANSFORMSTATETYPE, const D3DMATRIX& ) override;
+
+	private:
+		LPDIRECT3DDEVICE9 m_pDevice{};
+	};
+}
@@ -1,11 +1,16 @@
 #pragma once
+#include <memory>
 #include <d3dx9.h>
+#include "_D3D9LightDevice.h"
+#include "_LightBatch.h"
+#include "_RenderStateCache.h"
 
 
 /*
  * common implementation for light container
  * 
  * make a light in the container and then draw it
+ * quads of visible lights are drawn by _LightBatch. lights of a texture are drawn by a call
 */
 namespace FreeformLight
 {
@@ -21,8 +26,8 @@ namespace FreeformLight
 		HRESULT Draw( LPDIRECT3DDEVICE9 pDevice, float x, float y )
 		{
 			if ( m_lightImpls.size() ) {
-				D3DMATRIX curVm{};
-				pDevice->GetTransform( D3DTS_VIEW, &curVm );
+				// states changed by lights are restored at once when it is destroyed
+				_RenderStateCache stateCache{ pDevice };
 
 				// change view matrix to default. because game screen is magnified by user
 				{
@@ -33,44 +38,18 @@ namespace FreeformLight
 					D3DXMATRIX view{};
 					D3DXMatrixLookAtLH( &view, &eye, &at, &up );
 
-					pDevice->SetTransform( D3DTS_VIEW, &view );
+					stateCache.SetTransform( D3DTS_VIEW, view );
 				}
 
-				DWORD curBlendOp = {};
-				DWORD curSrcBlend = {};
-				DWORD curDestBlend = {};
-				pDevice->GetRenderState( D3DRS_BLENDOP, &curBlendOp );
-				pDevice->GetRenderState( D3DRS_DESTBLEND, &curDestBlend );
-				pDevice->GetRenderState( D3DRS_SRCBLEND, &curSrcBlend );
-				DWORD fillMode{};
-				pDevice->GetRenderState( D3DRS_FILLMODE, &fillMode );
+				stateCache.SetRenderState( D3DRS_BLENDOP, D3DBLENDOP_ADD );
+				stateCache.SetRenderState( D3DRS_SRCBLEND, D3DBLEND_SRCALPHA );
+				stateCache.SetRenderState( D3DRS_DESTBLEND, D3DBLEND_DESTALPHA );
 
-				DWORD oldFVF{};
-				pDevice->GetFVF( &oldFVF );
-
-				{
-					pDevice->SetRenderState( D3DRS_BLENDOP, D3DBLENDOP_ADD );
-					pDevice->SetRenderState( D3DRS_SRCBLEND, D3DBLEND_SRCALPHA );
-					pDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_DESTALPHA );
-
-					for ( auto&& lightImpl : m_lightImpls ) {
-						if ( FAILED( lightImpl->Draw( pDevice ) ) ) {
-							ASSERT( FALSE );
+				if ( FAILED( DrawLights( pDevice, stateCache ) ) ) {
+					ASSERT( FALSE );
 
-							return E_FAIL;
-						}
-					}
+					return E_FAIL;
 				}
-
-				pDevice->SetRenderState( D3DRS_BLENDOP, curBlendOp );
-				pDevice->SetRenderState( D3DRS_DESTBLEND, curDestBlend );
-				pDevice->SetRenderState( D3DRS_SRCBLEND, curSrcBlend );
-				pDevice->SetRenderState( D3DRS_FILLMODE, fillMode );
-
-				pDevice->SetFVF( oldFVF );
-
-				// restore view matrix
-				pDevice->SetTransform( D3DTS_VIEW, &curVm );
 			}
 
 			return S_OK;
@@ -79,6 +58,12 @@ namespace FreeformLight
 		// it'll call when device is restored
 		virtual HRESULT RestoreDevice( LPDIRECT3DDEVICE9 pDevice, D3DDISPLAYMODE const& )
 		{
+			if ( m_pLightBatch && !m_pLightBatch->RestoreDevice() ) {
+				ASSERT( FALSE );
+
+				return E_FAIL;
+			}
+
 			for ( auto&& lightImpl : m_lightImpls ) {
 				if ( FAILED( lightImpl->RestoreDevice( pDevice ) ) ) {
 					ASSERT( FALSE );
@@ -91,8 +76,12 @@ namespace FreeformLight
 		}
 
 		// it'll call when device is invalidated
-		void Invalidate()
+		virtual void Invalidate()
 		{
+			if ( m_pLightBatch ) {
+				m_pLightBatch->Invalidate();
+			}
+
 			for ( auto&& lightImpl : m_lightImpls ) {
 				lightImpl->Invalidate();
 			}
@@ -102,8 +91,36 @@ namespace FreeformLight
 		explicit _FreeformImpl( LPDIRECT3DPIXELSHADER9 pBlurShader ) : m_pBlurPixelShader{ pBlurShader }
 		{}
 
+		// add quads of visible lights to m_pLightBatch by their order and draw it. view and blend states are set already
+		virtual HRESULT DrawLights( LPDIRECT3DDEVICE9, _RenderStateCache& ) = 0;
+
+		// area of screen in world coordinate. it is made of current view and projection
+		static typename LIGHT_IMPL::Bounds GetViewBounds( LPDIRECT3DDEVICE9 pDevice )
+		{
+			D3DXMATRIX view{};
+			pDevice->GetTransform( D3DTS_VIEW, &view );
+			D3DXMATRIX projection{};
+			pDevice->GetTransform( D3DTS_PROJECTION, &projection );
+
+			auto viewProjection = view * projection;
+			D3DXMATRIX inverse{};
+
+			if ( !D3DXMatrixInverse( &inverse, nullptr, &viewProjection ) ) {
+				return { -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX };
+			}
+
+			D3DXVECTOR3 corners[] = { { -1.f, -1.f, 0.f }, { 1.f, 1.f, 0.f } };
+			D3DXVec3TransformCoordArray( corners, sizeof( *corners ), corners, sizeof( *corners ), &inverse, _countof( corners ) );
+
+			return { min( corners[0].x, corners[1].x ), min( corners[0].y, corners[1].y ), max( corners[0].x, corners[1].x ), max( corners[0].y, corners[1].y ) };
+		}
+
 	protected:
 		std::vector<std::shared_ptr<LIGHT_IMPL>> m_lightImpls;
 		LPDIRECT3DPIXELSHADER9 m_pBlurPixelShader{};
+
+		// batch refers device. so it is released first
+		std::unique_ptr<_D3D9LightDevice> m_pLightDevice;
+		std::unique_ptr<_LightBatch> m_pLightBatch;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "_GradientTextureCache.h"
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		// alpha of every row. it is same for all colors
+		struct AlphaRamp
+		{
+			DWORD alphas[_GradientTextureCache::size];
+
+			AlphaRamp()
+			{
+				for ( UINT y{}; y < _GradientTextureCache::size; ++y ) {
+					auto a = static_cast<DWORD>( y / static_cast<float>( _GradientTextureCache::size ) * 255 );
+					alphas[y] = a << 24;
+				}
+			}
+		};
+	}
+
+	_GradientTextureCache::~_GradientTextureCache()
+	{
+		ASSERT( m_entries.empty() );
+
+		for ( auto& pair : m_entries ) {
+			SAFE_RELEASE( pair.second.pTexture );
+		}
+	}
+
+	HRESULT _GradientTextureCache::Acquire( LPDIRECT3DDEVICE9 pDevice, D3DXCOLOR const& color, float intensity, Key* pOutKey )
+	{
+		ASSERT( pOutKey );
+
+		auto key = GetKey( color, intensity );
+		auto iterator = m_entries.find( key );
+
+		if ( iterator == m_entries.end() ) {
+			LPDIRECT3DTEXTURE9 pTexture{};
+
+			if ( FAILED( CreateTexture( pDevice, key, &pTexture ) ) ) {
+				return E_FAIL;
+			}
+
+			iterator = m_entries.emplace( key, Entry{ pTexture, 0 } ).first;
+		}
+
+		++iterator->second.refCount;
+		*pOutKey = key;
+
+		return S_OK;
+	}
+
+	void _GradientTextureCache::Release( Key key )
+	{
+		auto iterator = m_entries.find( key );
+
+		if ( iterator == m_entries.end() ) {
+			ASSERT( FALSE );
+			return;
+		}
+
+		if ( !--iterator->second.refCount ) {
+			SAFE_RELEASE( iterator->second.pTexture );
+			m_entries.erase( iterator );
+		}
+	}
+
+	LPDIRECT3DTEXTURE9 _GradientTextureCache::GetTexture( Key key ) const
+	{
+		auto iterator = m_entries.find( key );
+
+		return iterator == m_entries.end() ? nullptr : iterator->second.pTexture;
+	}
+
+	_GradientTextureCache::Key _GradientTextureCache::GetKey( D3DXCOLOR const& color, float intensity )
+	{
+		// same as old texture which is filled by LockRect()
+		intensity *= 255.f;
+		auto r = static_cast<int>( color.r * intensity );
+		auto g = static_cast<int>( color.g * intensity );
+		auto b = static_cast<int>( color.b * intensity );
+
+		return D3DCOLOR_ARGB( 0, r, g, b );
+	}
+
+	HRESULT _GradientTextureCache::CreateTexture( LPDIRECT3DDEVICE9 pDevice, Key key, LPDIRECT3DTEXTURE9* pOutTexture )
+	{
+		ASSERT( !*pOutTexture );
+
+		static const AlphaRamp ramp;
+		LPDIRECT3DTEXTURE9 pTexture{};
+
+		// u is clamped. so a column is enough
+		if ( FAILED( pDevice->CreateTexture( 1, size, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &pTexture, NULL ) ) ) {
+			ASSERT( FALSE );
+			return E_FAIL;
+		}
+
+		D3DLOCKED_RECT lockedRect{};
+
+		if ( FAILED( pTexture->LockRect( 0, &lockedRect, NULL, 0 ) ) ) {
+			SAFE_RELEASE( pTexture );
+			return E_FAIL;
+		}
+
+		auto* pBits = static_cast<LPBYTE>( lockedRect.pBits );
+
+		for ( UINT y{}; y < size; ++y ) {
+			*reinterpret_cast<LPDWORD>( pBits + y * lockedRect.Pitch ) = ramp.alphas[y] | key;
+		}
+
+		pTexture->UnlockRect( 0 );
+
+		*pOutTexture = pTexture;
+		return S_OK;
+	}
+}
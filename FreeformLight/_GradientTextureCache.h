@@ -0,0 +1,48 @@
+#pragma once
+#include <unordered_map>
+#include <d3dx9.h>
+
+
+/*
+ * gradient textures of lights
+ *
+ * a texture is shared by lights which have same color. it is made of a column because only alpha changes along v
+ * it is in managed pool. so it is kept when device is lost
+*/
+namespace FreeformLight
+{
+	class _GradientTextureCache
+	{
+	public:
+		// color of texel. it's made of light color and intensity
+		using Key = D3DCOLOR;
+
+		static constexpr UINT size = 256;
+
+		_GradientTextureCache() = default;
+		_GradientTextureCache( const _GradientTextureCache& ) = delete;
+		~_GradientTextureCache();
+
+		// reference count is increased. texture is made if no one uses it
+		HRESULT Acquire( LPDIRECT3DDEVICE9, D3DXCOLOR const&, float intensity, Key* pOutKey );
+		// texture is released when reference count is zero
+		void Release( Key );
+
+		LPDIRECT3DTEXTURE9 GetTexture( Key ) const;
+		inline size_t GetTextureCount() const { return m_entries.size(); }
+
+		static Key GetKey( D3DXCOLOR const&, float intensity );
+
+	private:
+		static HRESULT CreateTexture( LPDIRECT3DDEVICE9, Key, LPDIRECT3DTEXTURE9* );
+
+	private:
+		struct Entry
+		{
+			LPDIRECT3DTEXTURE9 pTexture;
+			size_t refCount;
+		};
+
+		std::unordered_map<Key, Entry> m_entries;
+	};
+}
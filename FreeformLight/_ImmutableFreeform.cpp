@@ -0,0 +1,72 @@
+#include "stdafx.h"
+#include "_ImmutableFreeform.h"
+#include "_LightSetFile.h"
+
+
+namespace FreeformLight
+{
+	_ImmutableFreeform::_ImmutableFreeform( LPDIRECT3DPIXELSHADER9 pBlurShader ) : _FreeformImpl<_ImmutableLightImpl>{ pBlurShader }
+	{}
+
+	_ImmutableFreeform::~_ImmutableFreeform()
+	{}
+
+	HRESULT _ImmutableFreeform::Load( LPDIRECT3DDEVICE9 pDevice, const char* path )
+	{
+		_LightSetFile file;
+
+		if ( !file.Open( path ) ) {
+			return E_FAIL;
+		}
+
+		decltype( m_lightImpls ) lightImpls;
+		lightImpls.reserve( file.GetLightCount() );
+
+		for ( size_t i{}; i < file.GetLightCount(); ++i ) {
+			try {
+				lightImpls.emplace_back( new _ImmutableLightImpl( m_pBlurPixelShader, file, i ) );
+			}
+			catch ( std::exception& ) {
+				ASSERT( FALSE );
+
+				return E_FAIL;
+			}
+		}
+
+		std::unique_ptr<_D3D9LightDevice> pLightDevice{ new _D3D9LightDevice( pDevice ) };
+		std::unique_ptr<_LightBatch> pLightBatch{ new _LightBatch( *pLightDevice ) };
+
+		if ( !pLightBatch->Build( file ) ) {
+			ASSERT( FALSE );
+
+			return E_FAIL;
+		}
+
+		// batch refers device. so it is released first
+		m_pLightBatch.reset();
+		m_pLightDevice = std::move( pLightDevice );
+		m_pLightBatch = std::move( pLightBatch );
+		m_lightImpls = std::move( lightImpls );
+
+		return S_OK;
+	}
+
+	HRESULT _ImmutableFreeform::DrawLights( LPDIRECT3DDEVICE9 pDevice, _RenderStateCache& stateCache )
+	{
+		ASSERT( m_pLightBatch );
+
+		auto viewBounds = GetViewBounds( pDevice );
+		m_pLightBatch->Clear();
+
+		for ( size_t i{}; i < m_lightImpls.size(); ++i ) {
+			// it's out of screen
+			if ( !m_lightImpls[i]->IsVisible( viewBounds ) ) {
+				continue;
+			}
+
+			m_pLightBatch->Add( m_pLightBatch->GetItemPage( i ), m_pLightBatch->GetItemQuad( i ) );
+		}
+
+		return m_pLightBatch->Draw( stateCache ) ? S_OK : E_FAIL;
+	}
+}
@@ -1,13 +1,27 @@
 #pragma once
+#include <memory>
 #include "_FreeformImpl.h"
 #include "_ImmutableLightImpl.h"
 
 
 /*
 it's unchangable light
+
+lights are loaded from baked light set. see _LightSetFile
+masks are packed into pages of _LightBatch. light of an index is item of same index
 */
 namespace FreeformLight
 {
 	class _ImmutableFreeform : public _FreeformImpl<_ImmutableLightImpl>
-	{};
+	{
+	public:
+		explicit _ImmutableFreeform( LPDIRECT3DPIXELSHADER9 pBlurShader );
+		virtual ~_ImmutableFreeform();
+
+		// replace all lights. file is closed after uploading masks
+		HRESULT Load( LPDIRECT3DDEVICE9, const char* path );
+
+	protected:
+		virtual HRESULT DrawLights( LPDIRECT3DDEVICE9, _RenderStateCache& ) override final;
+	};
 }
\ No newline at end of file
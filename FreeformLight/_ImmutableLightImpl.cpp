@@ -1,24 +1,49 @@
 #include "stdafx.h"
 #include "_ImmutableLightImpl.h"
+#include "_LightSetFile.h"
 
 //#define DEBUG_SURFACE
 
 
 namespace FreeformLight
 {
-	_ImmutableLightImpl::_ImmutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, Points const& points, Setting const& setting ) :
-		m_points{ points }, m_setting{ setting }, m_pBlurPixelShader( pBlurShader )
+	_ImmutableLightImpl::_ImmutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, std::shared_ptr<_MaskAtlasTexture> pMaskAtlas, std::shared_ptr<_GradientTextureCache> pGradientTextures, Points const& points, Setting const& setting ) :
+		m_points{ points }, m_setting{ setting }, m_pBlurPixelShader( pBlurShader ), m_pMaskAtlas{ std::move( pMaskAtlas ) }, m_pGradientTextures{ std::move( pGradientTextures ) }
 	{
 		ASSERT( pDevice );
+		ASSERT( m_pMaskAtlas );
+		ASSERT( m_pGradientTextures );
 
 		if ( FAILED( ReadyToRender( pDevice ) ) ) {
 			throw std::exception( "ReadyToRender() failed" );
 		}
 	}
 
+	_ImmutableLightImpl::_ImmutableLightImpl( LPDIRECT3DPIXELSHADER9 pBlurShader, _LightSetFile const& file, size_t index ) :
+		m_setting{ GetBakedSetting( file, index ) }, m_points{ GetBakedPoints( file, index ) }, m_pBlurPixelShader( pBlurShader ), m_isBaked{ true }
+	{
+		// same transform of UpdateBlurMask(). size is padded already
+		auto& light = file.GetLight( index );
+
+		D3DXMATRIX sm{};
+		D3DXMatrixScaling( &sm, light.meshWidth, light.meshHeight, 1 );
+		D3DXMATRIX tm{};
+		D3DXMatrixTranslation( &tm, light.cx, light.cy, 0 );
+
+		m_blurMask.m_worldTransform = sm * tm;
+	}
+
 	_ImmutableLightImpl::~_ImmutableLightImpl()
 	{
 		Invalidate();
+
+		if ( m_pMaskAtlas && m_blurMask.m_handle ) {
+			m_pMaskAtlas->Free( m_blurMask.m_handle );
+		}
+
+		if ( m_pLightTexture ) {
+			m_pGradientTextures->Release( m_lightTextureKey );
+		}
 	}
 
 	HRESULT _ImmutableLightImpl::CreateLightTextureByRenderer( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DTEXTURE9* pOutTexture ) const
@@ -106,54 +131,26 @@ namespace FreeformLight
 		return S_OK;
 	}
 
-	// it's really slow. but it is using until function above. i made an effort no resource into source folder
-	HRESULT _ImmutableLightImpl::CreateLightTextureByLockRect( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DTEXTURE9* pOutTexture, const Setting& setting ) const
+	HRESULT _ImmutableLightImpl::UpdateLightTexture( LPDIRECT3DDEVICE9 pDevice, const Setting& setting )
 	{
-		ASSERT( !*pOutTexture );
+		if ( m_pLightTexture && _GradientTextureCache::GetKey( setting.lightColor, setting.intensity ) == m_lightTextureKey ) {
+			return S_FALSE;
+		}
 
-		constexpr auto size = 256;
-		ASSERT( ceil( log2( size ) ) == floor( log2( size ) ) );
-		LPDIRECT3DTEXTURE9 pTexture = {};
+		_GradientTextureCache::Key key{};
 
-		if ( FAILED( D3DXCreateTexture( pDevice, size, size, 0, D3DUSAGE_DYNAMIC, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &pTexture ) ) ) {
+		if ( FAILED( m_pGradientTextures->Acquire( pDevice, setting.lightColor, setting.intensity, &key ) ) ) {
 			ASSERT( FALSE );
 			return E_FAIL;
 		}
 
-		// draw gradation
-		{
-			D3DLOCKED_RECT lockedRect = {};
-			pTexture->LockRect( 0, &lockedRect, NULL, D3DLOCK_NO_DIRTY_UPDATE );
-			auto* const colors = static_cast<LPDWORD>( lockedRect.pBits );
-			auto intensity = setting.intensity * 255.f;
-			auto& color = setting.lightColor;
-			auto r = static_cast<int>( color.r * intensity );
-			auto g = static_cast<int>( color.g * intensity );
-			auto b = static_cast<int>( color.b * intensity );
-
-			for ( auto y = 0; y < size; ++y ) {
-				auto a = y / static_cast<float>( size ) * 255;
-
-				for ( auto x = 0; x < size; ++x ) {
-					auto index = y * size + x;
-					colors[index] = D3DCOLOR_ARGB( static_cast<int>( a ), r, g, b );
-				}
-			}
-
-			if ( FAILED( pTexture->AddDirtyRect( NULL ) ) ) {
-				return E_FAIL;
-			}
-
-			if ( FAILED( pTexture->UnlockRect( 0 ) ) ) {
-				return E_FAIL;
-			}
+		if ( m_pLightTexture ) {
+			m_pGradientTextures->Release( m_lightTextureKey );
 		}
 
-#ifdef DEBUG_SURFACE
-		D3DXSaveTextureToFile( TEXT( "D:\\lightTex.png" ), D3DXIFF_PNG, pTexture, NULL );
-#endif
+		m_lightTextureKey = key;
+		m_pLightTexture = m_pGradientTextures->GetTexture( key );
 
-		*pOutTexture = pTexture;
 		return S_OK;
 	}
 
@@ -174,43 +171,49 @@ namespace FreeformLight
 		return S_OK;
 	}
 
-	HRESULT _ImmutableLightImpl::UpdateLightIndexBuffer( LPDIRECT3DINDEXBUFFER9* pOut, Indices& indices, LPDIRECT3DDEVICE9 pDevice, size_t vertexSize ) const
+	HRESULT _ImmutableLightImpl::UpdateLightIndexBuffer( LPDIRECT3DINDEXBUFFER9* pOut, Indices& indices, LPDIRECT3DDEVICE9 pDevice, const Indices& newIndices ) const
 	{
-		// make index
-		// https://en.cppreference.com/w/cpp/algorithm/generate
-		auto increaseNumber = [n = 0]() mutable { return n++; };
+		auto indicesSize = static_cast<UINT>( sizeof( Indices::value_type ) * newIndices.size() );
+		size_t changedBegin{};
 
-		indices.resize( vertexSize );
-		std::generate( indices.begin(), indices.end(), increaseNumber );
+		D3DINDEXBUFFER_DESC desc{};
 
-		// it always must be finish at LT
-		indices.push_back( 1 );
-		auto indicesSize = sizeof( Indices::value_type ) * indices.size();
+		if ( *pOut ) {
+			( *pOut )->GetDesc( &desc );
+		}
 
-		LPDIRECT3DINDEXBUFFER9 pIndexBuffer{};
+		// new buffer has room for twice of indices. so adding vertex doesn't make it again for a while
+		if ( desc.Size < indicesSize ) {
+			LPDIRECT3DINDEXBUFFER9 pIndexBuffer{};
 
-		// change index buffer
-		{
-			if ( FAILED( pDevice->CreateIndexBuffer( static_cast<UINT>( indicesSize ), D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_DEFAULT, &pIndexBuffer, NULL ) ) ) {
+			if ( FAILED( pDevice->CreateIndexBuffer( indicesSize * 2, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_DEFAULT, &pIndexBuffer, NULL ) ) ) {
 				ASSERT( FALSE );
 				return E_FAIL;
 			}
 
+			SAFE_RELEASE( *pOut );
+			*pOut = pIndexBuffer;
+		}
+		// triangles before changed one are same
+		else {
+			changedBegin = std::mismatch( newIndices.begin(), newIndices.end(), indices.begin(), indices.end() ).first - newIndices.begin();
+		}
+
+		indices = newIndices;
+
+		if ( changedBegin < indices.size() ) {
+			auto offset = static_cast<UINT>( sizeof( Indices::value_type ) * changedBegin );
 			LPVOID pIndices{};
 
-			if ( pIndexBuffer->Lock( 0, static_cast<UINT>( indicesSize ), &pIndices, 0 ) ) {
+			if ( FAILED( ( *pOut )->Lock( offset, indicesSize - offset, &pIndices, 0 ) ) ) {
 				ASSERT( FALSE );
 				return E_FAIL;
 			}
 
-			memcpy( pIndices, indices.data(), indicesSize );
-			pIndexBuffer->Unlock();
+			memcpy( pIndices, indices.data() + changedBegin, indicesSize - offset );
+			( *pOut )->Unlock();
 		}
 
-
-		SAFE_RELEASE( *pOut );
-		*pOut = pIndexBuffer;
-
 		return S_OK;
 	}
 
@@ -229,34 +232,41 @@ namespace FreeformLight
 		std::transform( std::cbegin( points ), std::cend( points ), std::back_inserter( vertices ), updateVertex );
 		vertices[0].uv = { falloff, falloff };
 
-		auto verticesSize = sizeof( Vertices::value_type ) * vertices.size();
-		LPDIRECT3DVERTEXBUFFER9 pVertexBuffer{};
+		auto verticesSize = static_cast<UINT>( sizeof( Vertices::value_type ) * vertices.size() );
 
-		// change vertex buffer
-		{
-			if ( FAILED( pDevice->CreateVertexBuffer( static_cast<UINT>( verticesSize ), 0, m_lightVertexFvf, D3DPOOL_DEFAULT, &pVertexBuffer, NULL ) ) ) {
+		D3DVERTEXBUFFER_DESC desc{};
+
+		if ( *pOut ) {
+			( *pOut )->GetDesc( &desc );
+		}
+
+		// change vertex buffer. it has room for twice of vertices
+		if ( desc.Size < verticesSize ) {
+			LPDIRECT3DVERTEXBUFFER9 pVertexBuffer{};
+
+			if ( FAILED( pDevice->CreateVertexBuffer( verticesSize * 2, 0, m_lightVertexFvf, D3DPOOL_DEFAULT, &pVertexBuffer, NULL ) ) ) {
 				ASSERT( FALSE );
 				return E_FAIL;
 			}
 
-			CopyToMemory( pVertexBuffer, vertices.data(), static_cast<UINT>( verticesSize ) );
+			SAFE_RELEASE( *pOut );
+			*pOut = pVertexBuffer;
 		}
 
+		return CopyToMemory( *pOut, vertices.data(), verticesSize );
+	}
 
-		SAFE_RELEASE( *pOut );
-		*pOut = pVertexBuffer;
+	// TODO: use async
+	HRESULT _ImmutableLightImpl::UpdateBlurMask( LPDIRECT3DDEVICE9 pDevice, const Vertices& vertices, const Bounds* pDirtyBounds )
+	{
+		_RenderStateCache stateCache{ pDevice };
 
-		return S_OK;
+		return UpdateBlurMask( stateCache, vertices, pDirtyBounds );
 	}
 
-	// TODO: use async
-	HRESULT _ImmutableLightImpl::UpdateBlurMask( LPDIRECT3DDEVICE9 pDevice, const Vertices& vertices )
+	HRESULT _ImmutableLightImpl::UpdateBlurMask( _RenderStateCache& parentStateCache, const Vertices& vertices, const Bounds* pDirtyBounds )
 	{
-		if ( !m_blurMask.m_pMesh ) {
-			if ( FAILED( CreateMesh( pDevice, &m_blurMask.m_pMesh, 1, 1 ) ) ) {
-				return E_FAIL;
-			}
-		}
+		auto pDevice = parentStateCache.GetDevice();
 
 		float width{};
 		float height{};
@@ -266,27 +276,19 @@ namespace FreeformLight
 		// upscale to apply blur to border
 		constexpr auto meshScaling = 1.5f;
 
+		auto bounds = GetBounds( vertices );
+
+		// dirty area is enough if mask is at the same place
+		auto isPartial = pDirtyBounds && m_blurMask.m_handle && !memcmp( &bounds, &m_blurMask.m_bounds, sizeof( bounds ) );
+		m_blurMask.m_bounds = bounds;
+
 		// setting position of mash mesh
 		{
-			float left{ FLT_MAX };
-			float right{ FLT_MIN };
-			float top{ FLT_MAX };
-			float bottom{ FLT_MIN };
-
-			// get LT, RT, LB, RB of vertexes
-			for ( auto& vertice : vertices ) {
-				auto& p = vertice.position;
-				left = min( left, p.x );
-				top = min( top, p.y );
-				right = max( right, p.x );
-				bottom = max( bottom, p.y );
-			}
-
 			// get w, h
-			width = right - left;
-			height = bottom - top;
-			cx = left + width / 2;
-			cy = top + height / 2;
+			width = bounds.right - bounds.left;
+			height = bounds.bottom - bounds.top;
+			cx = bounds.left + width / 2;
+			cy = bounds.top + height / 2;
 
 			// size matrix
 			D3DXMATRIX sm{};
@@ -303,55 +305,67 @@ namespace FreeformLight
 
 		// copy mask
 		{
-			auto& pTexture = m_blurMask.m_pTexture;
 			auto maskWidth = static_cast<UINT>( width * textureScaling );
 			auto maskHeight = static_cast<UINT>( height * textureScaling );
 
-			// if size of textures are different, make it again
-			if ( pTexture ) {
-				LPDIRECT3DSURFACE9 pSurface{};
-				pTexture->GetSurfaceLevel( 0, &pSurface );
+			// region is moved if size is different. other masks in the atlas are kept
+			if ( !isPartial ) {
+				if ( FAILED( m_pMaskAtlas->Allocate( pDevice, &m_blurMask.m_handle, maskWidth, maskHeight ) ) ) {
+					return E_FAIL;
+				}
+			}
 
-				D3DSURFACE_DESC desc{};
-				pSurface->GetDesc( &desc );
+			auto& rect = m_pMaskAtlas->GetRect( m_blurMask.m_handle );
+			RECT dirtyRect{ 0, 0, static_cast<LONG>( rect.width ), static_cast<LONG>( rect.height ) };
 
-				SAFE_RELEASE( pSurface );
+			// same mapping of view matrix below. a texel is added at each side for rounding of rasterizer
+			if ( isPartial ) {
+				constexpr auto pixelScaling = textureScaling / meshScaling;
+				auto toX = [&rect, cx, pixelScaling]( float x ) { return static_cast<LONG>( rect.width / 2.f + ( x - cx ) * pixelScaling ); };
+				auto toY = [&rect, cy, pixelScaling]( float y ) { return static_cast<LONG>( rect.height / 2.f + ( y - cy ) * pixelScaling ); };
 
-				if ( desc.Width != maskWidth || desc.Height != maskHeight ) {
-					SAFE_RELEASE( pTexture );
-				}
-			}
+				RECT area{ toX( pDirtyBounds->left ) - 1, toY( pDirtyBounds->top ) - 1, toX( pDirtyBounds->right ) + 2, toY( pDirtyBounds->bottom ) + 2 };
 
-			if ( !pTexture ) {
-				if ( FAILED( CreateTexture( pDevice, &pTexture, maskWidth, maskHeight ) ) ) {
-					return E_FAIL;
+				if ( !IntersectRect( &dirtyRect, &dirtyRect, &area ) ) {
+					return S_OK;
 				}
 			}
 
+			OffsetRect( &dirtyRect, static_cast<int>( rect.x ), static_cast<int>( rect.y ) );
+
 			// copy mask at center
 			if ( SUCCEEDED( pDevice->BeginScene() ) ) {
+				// states are restored when it is destroyed
+				_RenderStateCache stateCache{ parentStateCache };
+
 				LPDIRECT3DSURFACE9 pCurrrentSurface{};
 				pDevice->GetRenderTarget( 0, &pCurrrentSurface );
 
+				D3DVIEWPORT9 oldViewport{};
+				pDevice->GetViewport( &oldViewport );
+
 				LPDIRECT3DSURFACE9 pMaskSurface{};
-				m_blurMask.m_pTexture->GetSurfaceLevel( 0, &pMaskSurface );
+				m_pMaskAtlas->GetTexture()->GetSurfaceLevel( 0, &pMaskSurface );
 				pDevice->SetRenderTarget( 0, pMaskSurface );
-				pDevice->Clear( 0, NULL, D3DCLEAR_TARGET, D3DCOLOR_ARGB( 0, 0, 0, 0 ), 1.0f, 0 );
 
-				D3DXMATRIX oldVm{};
-				pDevice->GetTransform( D3DTS_VIEW, &oldVm );
+				// draw in the region only. SetRenderTarget() resets viewport so it comes after
+				D3DVIEWPORT9 viewport{ rect.x, rect.y, rect.width, rect.height, 0.f, 1.f };
+				pDevice->SetViewport( &viewport );
 
-				D3DXMATRIX oldWm{};
-				pDevice->GetTransform( D3DTS_WORLD, &oldWm );
+				// the rest of mask is kept
+				RECT oldScissorRect{};
+				pDevice->GetScissorRect( &oldScissorRect );
+
+				const D3DRECT clearRect{ dirtyRect.left, dirtyRect.top, dirtyRect.right, dirtyRect.bottom };
+				pDevice->Clear( 1, &clearRect, D3DCLEAR_TARGET, D3DCOLOR_ARGB( 0, 0, 0, 0 ), 1.0f, 0 );
+				pDevice->SetScissorRect( &dirtyRect );
+				stateCache.SetRenderState( D3DRS_SCISSORTESTENABLE, TRUE );
 
-				D3DXMATRIX oldPm{};
-				pDevice->GetTransform( D3DTS_PROJECTION, &oldPm );
-				
 				// setting matrix newly
 				{
 					D3DXMATRIX pm{};
 					D3DXMatrixOrthoLH( &pm, width, height, -1, 1 );
-					pDevice->SetTransform( D3DTS_PROJECTION, &pm );
+					stateCache.SetTransform( D3DTS_PROJECTION, pm );
 
 					auto x = width / 2.f;
 					auto y = height / 2.f;
@@ -362,33 +376,37 @@ namespace FreeformLight
 					D3DXMATRIX vm{};
 					D3DXMatrixLookAtLH( &vm, &eye, &at, &up );
 
-					D3DSURFACE_DESC desc{};
-					pMaskSurface->GetDesc( &desc );
-
 					D3DXMATRIX sm{};
-					D3DXMatrixScaling( &sm, width / desc.Width / meshScaling * textureScaling, height / desc.Height / meshScaling * textureScaling, 1.f );
+					D3DXMatrixScaling( &sm, width / rect.width / meshScaling * textureScaling, height / rect.height / meshScaling * textureScaling, 1.f );
 					vm *= sm;
-					pDevice->SetTransform( D3DTS_VIEW, &vm );
+					stateCache.SetTransform( D3DTS_VIEW, vm );
 
 					D3DXMATRIX tm{};
 					D3DXMatrixTranslation( &tm, x - cx, y - cy, 0 );
-					pDevice->SetTransform( D3DTS_WORLD, &tm );
+					stateCache.SetTransform( D3DTS_WORLD, tm );
 				}
 
 				D3DVERTEXBUFFER_DESC vertexBufferDesc = {};
 				m_pLightVertexBuffer->GetDesc( &vertexBufferDesc );
 
-				auto primitiveCount = m_lightIndices.size() - 2;
+				auto primitiveCount = m_lightIndices.size() / 3;
+
+				stateCache.SetFVF( vertexBufferDesc.FVF );
+				stateCache.SetTexture( 0, m_pLightTexture );
+
+				// light texture is mapped as it is. transform could be left by others
+				{
+					D3DXMATRIX im{};
+					D3DXMatrixIdentity( &im );
+					stateCache.SetTransform( D3DTS_TEXTURE0, im );
+					stateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE );
+				}
 
-				DWORD oldFVF = {};
-				pDevice->GetFVF( &oldFVF );
-				pDevice->SetFVF( vertexBufferDesc.FVF );
-				pDevice->SetTexture( 0, m_pLightTexture );
-				pDevice->SetSamplerState( 0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP );
-				pDevice->SetSamplerState( 0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP );
+				stateCache.SetSamplerState( 0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP );
+				stateCache.SetSamplerState( 0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP );
 				pDevice->SetStreamSource( 0, m_pLightVertexBuffer, 0, sizeof( Vertices::value_type ) );
 				pDevice->SetIndices( m_pLightIndexBuffer );
-				pDevice->SetPixelShader( m_pBlurPixelShader );
+				stateCache.SetPixelShader( m_pBlurPixelShader );
 
 				const D3DXVECTOR4 blurDatas[] = {
 					{ 0.f, width, 0.f, 0.f },
@@ -396,24 +414,25 @@ namespace FreeformLight
 				};
 
 				for ( auto& blurData : blurDatas ) {
+					if ( !primitiveCount ) {
+						break;
+					}
+
 					pDevice->SetPixelShaderConstantF( 0, blurData, 1 );
-					pDevice->DrawIndexedPrimitive( D3DPT_TRIANGLEFAN, 0, 0, static_cast<UINT>( m_lightVertices.size() ), 0, static_cast<UINT>( primitiveCount ) );
+					pDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, 0, 0, static_cast<UINT>( m_lightVertices.size() ), 0, static_cast<UINT>( primitiveCount ) );
 				}
 
-				pDevice->SetPixelShader( nullptr );
-				pDevice->SetFVF( oldFVF );
+				pDevice->SetScissorRect( &oldScissorRect );
 
 				pDevice->EndScene();
 				pDevice->SetRenderTarget( 0, pCurrrentSurface );
-				pDevice->SetTransform( D3DTS_VIEW, &oldVm );
-				pDevice->SetTransform( D3DTS_PROJECTION, &oldPm );
-				pDevice->SetTransform( D3DTS_WORLD, &oldWm );
+				pDevice->SetViewport( &oldViewport );
 
 				SAFE_RELEASE( pCurrrentSurface );
 				SAFE_RELEASE( pMaskSurface );
 
 #ifdef DEBUG_SURFACE
-				D3DXSaveTextureToFile( TEXT( "D:\\lightTex.png" ), D3DXIFF_PNG, m_blurMask.m_pTexture, NULL );
+				D3DXSaveTextureToFile( TEXT( "D:\\lightTex.png" ), D3DXIFF_PNG, m_pMaskAtlas->GetTexture(), NULL );
 #endif
 			}
 		}
@@ -421,6 +440,43 @@ namespace FreeformLight
 		return S_OK;
 	}
 
+	void _ImmutableLightImpl::MoveBlurMask( float dx, float dy )
+	{
+		m_blurMask.m_worldTransform._41 += dx;
+		m_blurMask.m_worldTransform._42 += dy;
+
+		auto& bounds = m_blurMask.m_bounds;
+		bounds = { bounds.left + dx, bounds.top + dy, bounds.right + dx, bounds.bottom + dy };
+	}
+
+	_ImmutableLightImpl::Bounds _ImmutableLightImpl::GetBounds( const Vertices& vertices )
+	{
+		Bounds bounds{ FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		// get LT, RT, LB, RB of vertexes
+		for ( auto& vertice : vertices ) {
+			auto& p = vertice.position;
+			bounds.left = min( bounds.left, p.x );
+			bounds.top = min( bounds.top, p.y );
+			bounds.right = max( bounds.right, p.x );
+			bounds.bottom = max( bounds.bottom, p.y );
+		}
+
+		return bounds;
+	}
+
+	_PolygonTriangulator::Points _ImmutableLightImpl::GetTriangulatorPoints( const Vertices& vertices )
+	{
+		_PolygonTriangulator::Points points;
+		points.reserve( vertices.size() );
+
+		for ( auto& vertex : vertices ) {
+			points.push_back( { vertex.position.x, vertex.position.y } );
+		}
+
+		return points;
+	}
+
 	HRESULT _ImmutableLightImpl::CreateTexture( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DTEXTURE9* pOutTexture, UINT width, UINT height )
 	{
 		ASSERT( !*pOutTexture );
@@ -488,41 +544,51 @@ namespace FreeformLight
 		return S_OK;
 	}
 
-	HRESULT _ImmutableLightImpl::Draw( LPDIRECT3DDEVICE9 pDevice )
+	_LightBatch::Quad _ImmutableLightImpl::GetQuad() const
 	{
-		// draw mask mesh
-		if ( SUCCEEDED( pDevice->BeginScene() ) ) {
-			D3DMATRIX wm{};
-			pDevice->GetTransform( D3DTS_WORLD, &wm );
-			pDevice->SetTransform( D3DTS_WORLD, &m_blurMask.m_worldTransform );
-			pDevice->SetTexture( 0, m_blurMask.m_pTexture );
-
-			pDevice->SetTexture( 0, m_blurMask.m_pTexture );
-			pDevice->SetFVF( m_blurMask.m_pMesh->GetFVF() );
-			m_blurMask.m_pMesh->DrawSubset( 0 );
-
-			pDevice->SetTransform( D3DTS_WORLD, &wm );
-			pDevice->EndScene();
-		}
+		// mask is in page of _LightBatch
+		ASSERT( !m_isBaked );
 
-		return S_OK;
+		// unit quad of CreateMesh() is transformed by it
+		auto& wm = m_blurMask.m_worldTransform;
+		auto halfWidth = wm._11 / 2.f;
+		auto halfHeight = wm._22 / 2.f;
+
+		auto& r = m_pMaskAtlas->GetRect( m_blurMask.m_handle );
+		auto& atlas = m_pMaskAtlas->GetAtlas();
+		auto width = static_cast<float>( atlas.GetWidth() );
+		auto height = static_cast<float>( atlas.GetHeight() );
+
+		return{ wm._41 - halfWidth, wm._42 - halfHeight, wm._41 + halfWidth, wm._42 + halfHeight, r.x / width, r.y / height, ( r.x + r.width ) / width, ( r.y + r.height ) / height };
+	}
+
+	bool _ImmutableLightImpl::IsVisible( const Bounds& viewBounds ) const
+	{
+		// mesh is a unit quad at center. so the transform has size and position of mask
+		auto& wm = m_blurMask.m_worldTransform;
+		auto halfWidth = fabs( wm._11 ) / 2.f;
+		auto halfHeight = fabs( wm._22 ) / 2.f;
+
+		return wm._41 + halfWidth >= viewBounds.left && wm._41 - halfWidth <= viewBounds.right && wm._42 + halfHeight >= viewBounds.top && wm._42 - halfHeight <= viewBounds.bottom;
 	}
 
 	HRESULT _ImmutableLightImpl::RestoreDevice( LPDIRECT3DDEVICE9 pDevice )
 	{
-		ASSERT( !m_pLightTexture );
 		ASSERT( !m_pLightIndexBuffer );
 		ASSERT( !m_pLightVertexBuffer );
-		ASSERT( !m_blurMask.m_pTexture );
-		ASSERT( !m_blurMask.m_pMesh );
 
 		return ReadyToRender( pDevice );
 	}
 
 	HRESULT _ImmutableLightImpl::ReadyToRender( LPDIRECT3DDEVICE9 pDevice )
 	{
-		// initialization
-		if ( FAILED( CreateLightTextureByLockRect( pDevice, &m_pLightTexture, m_setting ) ) ) {
+		// nothing to make. mask is in atlas
+		if ( m_isBaked ) {
+			return S_OK;
+		}
+
+		// initialization. light texture is kept when device is lost
+		if ( FAILED( UpdateLightTexture( pDevice, m_setting ) ) ) {
 			ASSERT( FALSE );
 
 			return E_FAIL;
@@ -532,7 +598,10 @@ namespace FreeformLight
 
 			return E_FAIL;
 		}
-		else if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_points.size() ) ) ) {
+
+		m_triangulator.Build( GetTriangulatorPoints( m_lightVertices ) );
+
+		if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
 			ASSERT( FALSE );
 
 			return E_FAIL;
@@ -548,11 +617,26 @@ namespace FreeformLight
 
 	void _ImmutableLightImpl::Invalidate()
 	{
-		SAFE_RELEASE( m_pLightTexture );
 		SAFE_RELEASE( m_pLightIndexBuffer );
 		SAFE_RELEASE( m_pLightVertexBuffer );
+	}
+
+	_ImmutableLightImpl::Points _ImmutableLightImpl::GetBakedPoints( _LightSetFile const& file, size_t index )
+	{
+		auto* pPoints = file.GetPoints( index );
+		Points points;
+
+		for ( size_t i{}; i < file.GetLight( index ).pointCount; ++i ) {
+			points.emplace_back( pPoints[i].x, pPoints[i].y, 0.f );
+		}
+
+		return points;
+	}
+
+	_ImmutableLightImpl::Setting _ImmutableLightImpl::GetBakedSetting( _LightSetFile const& file, size_t index )
+	{
+		auto& light = file.GetLight( index );
 
-		SAFE_RELEASE( m_blurMask.m_pTexture );
-		SAFE_RELEASE( m_blurMask.m_pMesh );
+		return{ D3DXCOLOR{ light.r, light.g, light.b, light.a }, light.intensity, light.falloff };
 	}
 }
\ No newline at end of file
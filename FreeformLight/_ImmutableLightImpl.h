@@ -1,11 +1,18 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <d3dx9.h>
+#include "_GradientTextureCache.h"
+#include "_LightBatch.h"
+#include "_MaskAtlasTexture.h"
+#include "_PolygonTriangulator.h"
+#include "_RenderStateCache.h"
 
 
 namespace FreeformLight
 {
 	template<typename T> class _FreeformImpl;
+	class _LightSetFile;
 
 	class _ImmutableLightImpl
 	{
@@ -28,10 +35,25 @@ namespace FreeformLight
 		};
 
 	public:
-		_ImmutableLightImpl( LPDIRECT3DDEVICE9, LPDIRECT3DPIXELSHADER9 pBlurShader, Points const&, Setting const& );
+		// area in world coordinate
+		struct Bounds
+		{
+			float left;
+			float top;
+			float right;
+			float bottom;
+		};
+
+		// mask is drawn in region of the atlas. gradient texture is shared with other lights of same color
+		_ImmutableLightImpl( LPDIRECT3DDEVICE9, LPDIRECT3DPIXELSHADER9 pBlurShader, std::shared_ptr<_MaskAtlasTexture>, std::shared_ptr<_GradientTextureCache>, Points const&, Setting const& );
+		// it uses mask baked already. mask is in atlas of _LightBatch. it makes no resource so device isn't needed
+		_ImmutableLightImpl( LPDIRECT3DPIXELSHADER9 pBlurShader, _LightSetFile const&, size_t index );
 		virtual ~_ImmutableLightImpl();
 		
-		virtual HRESULT Draw( LPDIRECT3DDEVICE9 );
+		// mask in world coordinate. uv is in region of the atlas. baked one is item of _LightBatch instead
+		_LightBatch::Quad GetQuad() const;
+		// it is false if mask is out of the bounds
+		bool IsVisible( const Bounds& viewBounds ) const;
 		
 		static HRESULT CreateMesh( LPDIRECT3DDEVICE9, LPD3DXMESH*, UINT width, UINT height );
 		
@@ -43,16 +65,31 @@ namespace FreeformLight
 
 	protected:
 		HRESULT CreateLightTextureByRenderer( LPDIRECT3DDEVICE9, LPDIRECT3DTEXTURE9* pTexture ) const;
-		HRESULT CreateLightTextureByLockRect( LPDIRECT3DDEVICE9, LPDIRECT3DTEXTURE9* pTexture, const Setting& ) const;
+		// it returns S_FALSE if texture is same
+		HRESULT UpdateLightTexture( LPDIRECT3DDEVICE9, const Setting& );
+		// buffers are made with headroom. they're kept while vertices are in it
 		HRESULT UpdateLightVertexBuffer( LPDIRECT3DVERTEXBUFFER9* pOut, Vertices& vertices, LPDIRECT3DDEVICE9 pDevice, const Points& points, float falloff );
-		HRESULT UpdateLightIndexBuffer( LPDIRECT3DINDEXBUFFER9* pOut, Indices& indices, LPDIRECT3DDEVICE9, size_t vertexSize ) const;
+		// triangle list of m_triangulator. changed part is copied only
+		HRESULT UpdateLightIndexBuffer( LPDIRECT3DINDEXBUFFER9* pOut, Indices& indices, LPDIRECT3DDEVICE9, const Indices& newIndices ) const;
 		HRESULT CopyToMemory( LPDIRECT3DVERTEXBUFFER9 pDest, LPVOID pSrc, UINT size ) const;
-		HRESULT UpdateBlurMask( LPDIRECT3DDEVICE9, const Vertices& );
+		// if bounds is given, only the area is drawn again. it works when mask isn't moved or resized. or it is drawn entirely
+		HRESULT UpdateBlurMask( LPDIRECT3DDEVICE9, const Vertices&, const Bounds* pDirtyBounds = nullptr );
+		// states known by the cache are reused. changed ones are restored before it returns
+		HRESULT UpdateBlurMask( _RenderStateCache&, const Vertices&, const Bounds* pDirtyBounds = nullptr );
+		// mask is same when all vertices are moved together. so it is drawn at other position only
+		void MoveBlurMask( float dx, float dy );
+
+		static Bounds GetBounds( const Vertices& );
+		static _PolygonTriangulator::Points GetTriangulatorPoints( const Vertices& );
 
 	private:
 		HRESULT ReadyToRender( LPDIRECT3DDEVICE9 );
 
+		static Points GetBakedPoints( _LightSetFile const&, size_t index );
+		static Setting GetBakedSetting( _LightSetFile const&, size_t index );
+
 	protected:
+		// it is owned by m_pGradientTextures
 		LPDIRECT3DTEXTURE9 m_pLightTexture{};
 		LPDIRECT3DINDEXBUFFER9 m_pLightIndexBuffer{};
 		LPDIRECT3DVERTEXBUFFER9 m_pLightVertexBuffer{};
@@ -60,6 +97,8 @@ namespace FreeformLight
 		Indices m_lightIndices;
 		Vertices m_lightVertices;
 		Setting m_setting;
+		// it has vertices as well. it is updated with m_lightVertices
+		_PolygonTriangulator m_triangulator;
 
 	private:
 		const int m_lightVertexFvf = D3DFVF_XYZ | D3DFVF_TEX1;
@@ -69,11 +108,20 @@ namespace FreeformLight
 		struct Mask
 		{
 			D3DXMATRIX m_worldTransform{};
-			LPDIRECT3DTEXTURE9 m_pTexture{};
-			LPD3DXMESH m_pMesh{};
+			// bounds of vertices when mask is drawn
+			Bounds m_bounds{};
+			// region of m_pMaskAtlas. it is kept while device is lost
+			_MaskAtlasTexture::Handle m_handle{};
 		}
 		m_blurMask;
 
 		LPDIRECT3DPIXELSHADER9 m_pBlurPixelShader{};
+		// it is null if light is baked
+		std::shared_ptr<_MaskAtlasTexture> m_pMaskAtlas;
+		std::shared_ptr<_GradientTextureCache> m_pGradientTextures;
+		_GradientTextureCache::Key m_lightTextureKey{};
+
+		// it has no resource. _ImmutableFreeform draws it
+		bool m_isBaked{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "_LightBatch.h"
+#include <algorithm>
+#include <cstring>
+#include "_LightMaskAtlas.h"
+#include "_LightSetFile.h"
+#include "_RenderStateCache.h"
+
+
+namespace FreeformLight
+{
+	bool _LightBatch::Build( const std::vector<Item>& items )
+	{
+		m_pages.clear();
+		m_items.clear();
+		Clear();
+
+		std::vector<Placement> placements;
+		std::vector<PageSize> pageSizes;
+		Pack( placements, pageSizes, items );
+
+		for ( auto& pageSize : pageSizes ) {
+			size_t page{};
+
+			if ( !m_device.CreatePage( page, pageSize.width, pageSize.height ) ) {
+				return false;
+			}
+
+			m_pages.push_back( page );
+		}
+
+		m_items.reserve( items.size() );
+
+		for ( size_t i = 0; i < items.size(); ++i ) {
+			auto& item = items[i];
+			auto& placement = placements[i];
+			auto& pageSize = pageSizes[placement.page];
+
+			if ( !m_device.UploadBlocks( m_pages[placement.page], placement.x, placement.y, item.maskWidth, item.maskHeight, item.pBlocks, item.pitch ) ) {
+				return false;
+			}
+
+			// same quad of _ImmutableLightImpl::CreateMesh() which is transformed by mask
+			const Quad quad{
+				item.cx - item.meshWidth / 2,
+				item.cy - item.meshHeight / 2,
+				item.cx + item.meshWidth / 2,
+				item.cy + item.meshHeight / 2,
+				static_cast<float>( placement.x ) / pageSize.width,
+				static_cast<float>( placement.y ) / pageSize.height,
+				static_cast<float>( placement.x + item.maskWidth ) / pageSize.width,
+				static_cast<float>( placement.y + item.maskHeight ) / pageSize.height,
+			};
+
+			m_items.push_back( { m_pages[placement.page], quad } );
+		}
+
+		return true;
+	}
+
+	bool _LightBatch::Build( _LightSetFile const& file )
+	{
+		std::vector<Item> items;
+		items.reserve( file.GetLightCount() );
+
+		for ( size_t i = 0; i < file.GetLightCount(); ++i ) {
+			auto& light = file.GetLight( i );
+
+			items.push_back( { light.cx, light.cy, light.meshWidth, light.meshHeight, light.maskWidth, light.maskHeight, file.GetMask( i ), _LightSetFile::GetMaskPitch( light ) } );
+		}
+
+		return Build( items );
+	}
+
+	void _LightBatch::Clear()
+	{
+		m_quadCount = 0;
+		m_runs.clear();
+	}
+
+	void _LightBatch::Add( size_t page, const Quad& quad )
+	{
+		// LT, LB, RB, RT
+		const _LightDevice::Vertex vertices[] = {
+			{ quad.left, quad.top, 0, quad.u0, quad.v0 },
+			{ quad.left, quad.bottom, 0, quad.u0, quad.v1 },
+			{ quad.right, quad.bottom, 0, quad.u1, quad.v1 },
+			{ quad.right, quad.top, 0, quad.u1, quad.v0 },
+		};
+		static_assert( sizeof( vertices ) / sizeof( *vertices ) == _LightDevice::verticesPerQuad, "invalid size" );
+
+		auto offset = m_quadCount * _LightDevice::verticesPerQuad;
+
+		if ( offset < m_vertices.size() ) {
+			if ( memcmp( m_vertices.data() + offset, vertices, sizeof( vertices ) ) ) {
+				std::copy( std::begin( vertices ), std::end( vertices ), m_vertices.begin() + offset );
+				m_isDirty = true;
+			}
+		}
+		else {
+			m_vertices.insert( m_vertices.end(), std::begin( vertices ), std::end( vertices ) );
+			m_isDirty = true;
+		}
+
+		if ( !m_runs.empty() && m_runs.back().page == page ) {
+			++m_runs.back().quadCount;
+		}
+		else {
+			m_runs.push_back( { page, m_quadCount, 1 } );
+		}
+
+		++m_quadCount;
+	}
+
+	bool _LightBatch::Draw( _RenderStateCache& parentStateCache )
+	{
+		if ( !m_quadCount ) {
+			return true;
+		}
+
+		// quads after m_quadCount are left in buffer. they aren't drawn
+		if ( m_isDirty ) {
+			m_vertices.resize( m_quadCount * _LightDevice::verticesPerQuad );
+
+			if ( !m_device.UploadVertices( m_vertices.data(), m_vertices.size() ) ) {
+				return false;
+			}
+
+			m_isDirty = false;
+		}
+
+		// states are restored when it is destroyed
+		_RenderStateCache stateCache{ parentStateCache };
+
+		if ( !m_device.Begin( stateCache ) ) {
+			return false;
+		}
+
+		auto succeeded = true;
+
+		for ( auto& run : m_runs ) {
+			if ( !m_device.DrawQuads( run.page, run.firstQuad, run.quadCount ) ) {
+				succeeded = false;
+				break;
+			}
+		}
+
+		m_device.End();
+
+		return succeeded;
+	}
+
+	void _LightBatch::Invalidate()
+	{
+		m_device.Invalidate();
+		m_isDirty = true;
+	}
+
+	bool _LightBatch::RestoreDevice()
+	{
+		// vertices are uploaded at next Draw()
+		m_isDirty = true;
+
+		return m_device.RestoreDevice();
+	}
+
+	// items are put into a page by their order. next page is made if one doesn't fit, and former pages aren't used again
+	// so lights of a page are consecutive in drawing order
+	void _LightBatch::Pack( std::vector<Placement>& placements, std::vector<PageSize>& pageSizes, const std::vector<Item>& items )
+	{
+		placements.assign( items.size(), {} );
+		pageSizes.clear();
+
+		_LightMaskAtlas atlas{ pageSize, pageSize, gutter };
+		auto isPageOpened = false;
+
+		for ( size_t i = 0; i < items.size(); ++i ) {
+			auto& item = items[i];
+
+			// too big one has its own page
+			if ( item.maskWidth + gutter > pageSize || item.maskHeight + gutter > pageSize ) {
+				pageSizes.push_back( { item.maskWidth, item.maskHeight } );
+				placements[i] = { pageSizes.size() - 1, 0, 0 };
+				isPageOpened = false;
+				continue;
+			}
+
+			auto handle = isPageOpened ? atlas.Insert( item.maskWidth, item.maskHeight ) : _LightMaskAtlas::invalidHandle;
+
+			if ( handle == _LightMaskAtlas::invalidHandle ) {
+				atlas = _LightMaskAtlas{ pageSize, pageSize, gutter };
+				isPageOpened = true;
+				pageSizes.push_back( { 0, 0 } );
+
+				handle = atlas.Insert( item.maskWidth, item.maskHeight );
+			}
+
+			// page is cut to used area
+			auto& rect = atlas.GetRect( handle );
+			auto& page = pageSizes.back();
+			placements[i] = { pageSizes.size() - 1, rect.x, rect.y };
+			page.width = std::max( page.width, rect.x + rect.width );
+			page.height = std::max( page.height, rect.y + rect.height );
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include "_LightDevice.h"
+
+
+/*
+ * draw quads of lights by a call per run of same page
+ *
+ * baked masks are packed into pages by _LightMaskAtlas. quads of visible lights are added by drawing order at each frame
+ * lights are blended by order. so only consecutive quads of same page are drawn together
+*/
+namespace FreeformLight
+{
+	class _LightSetFile;
+	class _RenderStateCache;
+
+	class _LightBatch
+	{
+	public:
+		// mask of light. blocks are DXT5
+		struct Item
+		{
+			float cx;
+			float cy;
+			float meshWidth;
+			float meshHeight;
+			uint32_t maskWidth;
+			uint32_t maskHeight;
+			const uint8_t* pBlocks;
+			uint32_t pitch;
+		};
+
+		// mask in world coordinate. uv is in page
+		struct Quad
+		{
+			float left;
+			float top;
+			float right;
+			float bottom;
+			float u0;
+			float v0;
+			float u1;
+			float v1;
+		};
+
+		static constexpr uint32_t pageSize = 2048;
+		// blank texels between masks. it prevents bleeding by filtering
+		static constexpr uint32_t gutter = 4;
+
+		explicit _LightBatch( _LightDevice& device ) : m_device( device )
+		{}
+
+		_LightBatch( const _LightBatch& ) = delete;
+
+		// pack and upload masks. items fill pages by their order. so all of them are drawn by a call per page
+		bool Build( const std::vector<Item>& );
+		bool Build( _LightSetFile const& );
+
+		// page of device and quad of built item
+		inline size_t GetItemPage( size_t item ) const { return m_items[item].page; }
+		inline const Quad& GetItemQuad( size_t item ) const { return m_items[item].quad; }
+
+		// quads of a frame. they are drawn by order of Add()
+		void Clear();
+		void Add( size_t page, const Quad& );
+
+		// vertices are uploaded only if quads are changed. states set by device are restored before it returns
+		bool Draw( _RenderStateCache& );
+
+		inline size_t GetQuadCount() const { return m_quadCount; }
+		inline size_t GetPageCount() const { return m_pages.size(); }
+		// draw calls of Draw()
+		inline size_t GetRunCount() const { return m_runs.size(); }
+
+		void Invalidate();
+		bool RestoreDevice();
+
+	private:
+		struct Placement
+		{
+			size_t page;
+			uint32_t x;
+			uint32_t y;
+		};
+
+		struct PageSize
+		{
+			uint32_t width;
+			uint32_t height;
+		};
+
+		static void Pack( std::vector<Placement>&, std::vector<PageSize>&, const std::vector<Item>& );
+
+	private:
+		_LightDevice& m_device;
+
+		std::vector<size_t> m_pages;
+
+		struct BuiltItem
+		{
+			size_t page;
+			Quad quad;
+		};
+		std::vector<BuiltItem> m_items;
+
+		// they're same as vertex buffer of device. so unchanged quads aren't uploaded again
+		std::vector<_LightDevice::Vertex> m_vertices;
+		size_t m_quadCount{};
+		bool m_isDirty{};
+
+		// consecutive quads of a page
+		struct Run
+		{
+			size_t page;
+			size_t firstQuad;
+			size_t quadCount;
+		};
+		std::vector<Run> m_runs;
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ * device which is used by _LightBatch
+ *
+ * _D3D9LightDevice draws by d3d9. _RecordingLightDevice only records calls. so batch could be checked without device
+*/
+namespace FreeformLight
+{
+	class _RenderStateCache;
+
+	class _LightDevice
+	{
+	public:
+		// same layout of D3DFVF_XYZ | D3DFVF_TEX1
+		struct Vertex
+		{
+			float x;
+			float y;
+			float z;
+			float u;
+			float v;
+		};
+
+		static constexpr size_t verticesPerQuad = 4;
+		static constexpr size_t indicesPerQuad = 6;
+
+		virtual ~_LightDevice() {}
+
+		// page is DXT5 texture of atlas. it returns index of page
+		virtual bool CreatePage( size_t& outPage, uint32_t width, uint32_t height ) = 0;
+		// position and size must be multiple of 4. pitch is bytes per row of blocks
+		virtual bool UploadBlocks( size_t page, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pBlocks, uint32_t pitch ) = 0;
+		// quads of a frame. every 4 vertices make a quad: LT, LB, RB, RT
+		virtual bool UploadVertices( const Vertex*, size_t count ) = 0;
+
+		// quads are in world coordinate. states are set by the cache until End(). owner of it restores them
+		virtual bool Begin( _RenderStateCache& ) = 0;
+		virtual bool DrawQuads( size_t page, size_t firstQuad, size_t quadCount ) = 0;
+		virtual void End() = 0;
+
+		// it'll call when device is invalidated or restored
+		virtual void Invalidate() {}
+		virtual bool RestoreDevice() { return true; }
+	};
+}
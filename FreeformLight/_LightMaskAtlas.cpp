@@ -0,0 +1,317 @@
+#include "_LightMaskAtlas.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		inline bool Contains( const _LightMaskAtlas::Rect& outer, const _LightMaskAtlas::Rect& inner )
+		{
+			return outer.x <= inner.x && outer.y <= inner.y && inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+		}
+
+		inline void AddRect( std::vector<_LightMaskAtlas::Rect>& rects, uint32_t x, uint32_t y, uint32_t width, uint32_t height )
+		{
+			if ( width && height ) {
+				rects.push_back( { x, y, width, height } );
+			}
+		}
+
+		// two rects make a rect if they share a whole side
+		bool Merge( _LightMaskAtlas::Rect& lhs, const _LightMaskAtlas::Rect& rhs )
+		{
+			if ( lhs.y == rhs.y && lhs.height == rhs.height ) {
+				if ( lhs.x + lhs.width == rhs.x ) {
+					lhs.width += rhs.width;
+					return true;
+				}
+				else if ( rhs.x + rhs.width == lhs.x ) {
+					lhs.x = rhs.x;
+					lhs.width += rhs.width;
+					return true;
+				}
+			}
+			else if ( lhs.x == rhs.x && lhs.width == rhs.width ) {
+				if ( lhs.y + lhs.height == rhs.y ) {
+					lhs.height += rhs.height;
+					return true;
+				}
+				else if ( rhs.y + rhs.height == lhs.y ) {
+					lhs.y = rhs.y;
+					lhs.height += rhs.height;
+					return true;
+				}
+			}
+
+			return false;
+		}
+	}
+
+	_LightMaskAtlas::_LightMaskAtlas( uint32_t width, uint32_t height, uint32_t padding ) : m_width{ width }, m_height{ height }, m_padding{ padding }
+	{
+		AddRect( m_freeRects, 0, 0, width, height );
+	}
+
+	_LightMaskAtlas::Handle _LightMaskAtlas::Insert( uint32_t width, uint32_t height )
+	{
+		if ( !width || !height ) {
+			return invalidHandle;
+		}
+
+		Region region{};
+
+		if ( !Place( m_freeRects, region.reserved, width + m_padding, height + m_padding ) ) {
+			return invalidHandle;
+		}
+
+		region.rect = { region.reserved.x, region.reserved.y, width, height };
+
+		auto handle = m_nextHandle++;
+		m_regions.emplace( handle, region );
+
+		return handle;
+	}
+
+	bool _LightMaskAtlas::Remove( Handle handle )
+	{
+		auto iterator = m_regions.find( handle );
+
+		if ( iterator == m_regions.end() ) {
+			return false;
+		}
+
+		Release( m_freeRects, iterator->second.reserved );
+		m_regions.erase( iterator );
+
+		// merging can't find every split. so it starts over at empty
+		if ( m_regions.empty() ) {
+			m_freeRects.clear();
+			AddRect( m_freeRects, 0, 0, m_width, m_height );
+		}
+
+		return true;
+	}
+
+	bool _LightMaskAtlas::Resize( Handle handle, uint32_t width, uint32_t height, bool& outChanged )
+	{
+		outChanged = false;
+
+		auto iterator = m_regions.find( handle );
+
+		if ( iterator == m_regions.end() || !width || !height ) {
+			return false;
+		}
+
+		auto& region = iterator->second;
+		auto reservedWidth = width + m_padding;
+		auto reservedHeight = height + m_padding;
+
+		if ( region.rect.width == width && region.rect.height == height ) {
+			return true;
+		}
+
+		outChanged = true;
+
+		// shrink in place. rest of it is released
+		if ( reservedWidth <= region.reserved.width && reservedHeight <= region.reserved.height ) {
+			auto& r = region.reserved;
+			std::vector<Rect> rests;
+			AddRect( rests, r.x + reservedWidth, r.y, r.width - reservedWidth, r.height );
+			AddRect( rests, r.x, r.y + reservedHeight, reservedWidth, r.height - reservedHeight );
+
+			for ( auto& rest : rests ) {
+				Release( m_freeRects, rest );
+			}
+
+			region.reserved = { r.x, r.y, reservedWidth, reservedHeight };
+			region.rect = { r.x, r.y, width, height };
+
+			return true;
+		}
+
+		// place again. old region is taken back if it fails
+		auto old = region.reserved;
+		Release( m_freeRects, old );
+
+		Rect reserved{};
+
+		if ( !Place( m_freeRects, reserved, reservedWidth, reservedHeight ) ) {
+			Reserve( m_freeRects, old );
+			outChanged = false;
+
+			return false;
+		}
+
+		region.reserved = reserved;
+		region.rect = { reserved.x, reserved.y, width, height };
+
+		return true;
+	}
+
+	bool _LightMaskAtlas::Defragment( std::vector<Move>& outMoves )
+	{
+		outMoves.clear();
+
+		std::vector<Handle> handles;
+		handles.reserve( m_regions.size() );
+
+		for ( auto& pair : m_regions ) {
+			handles.push_back( pair.first );
+		}
+
+		// taller and older one goes first. so result doesn't depend on order of hash map
+		std::sort( handles.begin(), handles.end(), [this]( Handle lhs, Handle rhs ) {
+			auto& l = m_regions.at( lhs ).reserved;
+			auto& r = m_regions.at( rhs ).reserved;
+
+			return l.height != r.height ? l.height > r.height : lhs < rhs;
+		} );
+
+		std::vector<Rect> freeRects;
+		AddRect( freeRects, 0, 0, m_width, m_height );
+
+		std::vector<Move> moves;
+		moves.reserve( handles.size() );
+
+		for ( auto handle : handles ) {
+			auto& region = m_regions.at( handle );
+			Rect reserved{};
+
+			if ( !Place( freeRects, reserved, region.reserved.width, region.reserved.height ) ) {
+				return false;
+			}
+
+			moves.push_back( { handle, region.rect, { reserved.x, reserved.y, region.rect.width, region.rect.height } } );
+		}
+
+		for ( auto& move : moves ) {
+			auto& region = m_regions.at( move.handle );
+			region.reserved.x = move.to.x;
+			region.reserved.y = move.to.y;
+			region.rect = move.to;
+		}
+
+		m_freeRects = std::move( freeRects );
+		outMoves = std::move( moves );
+
+		return true;
+	}
+
+	bool _LightMaskAtlas::Grow( uint32_t width, uint32_t height )
+	{
+		if ( width < m_width || height < m_height ) {
+			return false;
+		}
+
+		std::vector<Rect> rests;
+		AddRect( rests, m_width, 0, width - m_width, height );
+		AddRect( rests, 0, m_height, m_width, height - m_height );
+
+		for ( auto& rest : rests ) {
+			Release( m_freeRects, rest );
+		}
+
+		m_width = width;
+		m_height = height;
+
+		return true;
+	}
+
+	float _LightMaskAtlas::GetOccupancy() const
+	{
+		uint64_t area{};
+
+		for ( auto& pair : m_regions ) {
+			area += static_cast<uint64_t>( pair.second.reserved.width ) * pair.second.reserved.height;
+		}
+
+		return m_width && m_height ? static_cast<float>( area ) / ( static_cast<uint64_t>( m_width ) * m_height ) : 0.f;
+	}
+
+	// best short side fit. rest of free rect is split along shorter one
+	bool _LightMaskAtlas::Place( std::vector<Rect>& freeRects, Rect& outRect, uint32_t width, uint32_t height )
+	{
+		auto best = freeRects.size();
+		auto bestShortSide = std::numeric_limits<uint32_t>::max();
+		auto bestLongSide = std::numeric_limits<uint32_t>::max();
+
+		for ( size_t i = 0; i < freeRects.size(); ++i ) {
+			auto& f = freeRects[i];
+
+			if ( f.width < width || f.height < height ) {
+				continue;
+			}
+
+			auto shortSide = std::min( f.width - width, f.height - height );
+			auto longSide = std::max( f.width - width, f.height - height );
+
+			if ( shortSide < bestShortSide || ( shortSide == bestShortSide && longSide < bestLongSide ) ) {
+				best = i;
+				bestShortSide = shortSide;
+				bestLongSide = longSide;
+			}
+		}
+
+		if ( best == freeRects.size() ) {
+			return false;
+		}
+
+		auto f = freeRects[best];
+		freeRects.erase( freeRects.begin() + best );
+
+		if ( f.width - width < f.height - height ) {
+			AddRect( freeRects, f.x + width, f.y, f.width - width, height );
+			AddRect( freeRects, f.x, f.y + height, f.width, f.height - height );
+		}
+		else {
+			AddRect( freeRects, f.x + width, f.y, f.width - width, f.height );
+			AddRect( freeRects, f.x, f.y + height, width, f.height - height );
+		}
+
+		outRect = { f.x, f.y, width, height };
+
+		return true;
+	}
+
+	// take the rect from free one which contains it
+	bool _LightMaskAtlas::Reserve( std::vector<Rect>& freeRects, const Rect& r )
+	{
+		auto iterator = std::find_if( freeRects.begin(), freeRects.end(), [&r]( const Rect& f ) { return FreeformLight::Contains( f, r ); } );
+
+		if ( iterator == freeRects.end() ) {
+			return false;
+		}
+
+		auto f = *iterator;
+		freeRects.erase( iterator );
+
+		AddRect( freeRects, f.x, f.y, f.width, r.y - f.y );
+		AddRect( freeRects, f.x, r.y + r.height, f.width, f.y + f.height - ( r.y + r.height ) );
+		AddRect( freeRects, f.x, r.y, r.x - f.x, r.height );
+		AddRect( freeRects, r.x + r.width, r.y, f.x + f.width - ( r.x + r.width ), r.height );
+
+		return true;
+	}
+
+	void _LightMaskAtlas::Release( std::vector<Rect>& freeRects, const Rect& rect )
+	{
+		freeRects.push_back( rect );
+
+		// merge until nothing is merged
+		for ( auto merged = true; merged; ) {
+			merged = false;
+
+			for ( size_t i = 0; i < freeRects.size() && !merged; ++i ) {
+				for ( size_t j = i + 1; j < freeRects.size(); ++j ) {
+					if ( Merge( freeRects[i], freeRects[j] ) ) {
+						freeRects.erase( freeRects.begin() + j );
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+ * rectangle packer for atlas of light masks
+ *
+ * it is guillotine packer. free rectangles are split by placed one, and merged again when a region is removed
+ * it has no dependency to d3d
+*/
+namespace FreeformLight
+{
+	class _LightMaskAtlas
+	{
+	public:
+		using Handle = uint32_t;
+		static constexpr Handle invalidHandle = 0;
+
+		struct Rect
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		// region is moved from a rect to other one. content should be copied
+		struct Move
+		{
+			Handle handle;
+			Rect from;
+			Rect to;
+		};
+
+		// padding is blank texels at right and bottom of each region
+		_LightMaskAtlas( uint32_t width, uint32_t height, uint32_t padding = 0 );
+
+		// it returns invalidHandle if there's no space
+		Handle Insert( uint32_t width, uint32_t height );
+		bool Remove( Handle );
+
+		// it keeps place if new size fits in current region. else region is placed again and content is not kept
+		// it keeps old region if there's no space. changed is true if position or size of region is changed
+		bool Resize( Handle, uint32_t width, uint32_t height, bool& outChanged );
+
+		// place all regions again from empty atlas. taller one goes first
+		// nothing is changed if they can't be placed
+		bool Defragment( std::vector<Move>& outMoves );
+
+		// make atlas bigger. regions stay
+		bool Grow( uint32_t width, uint32_t height );
+
+		inline bool Contains( Handle handle ) const { return m_regions.count( handle ) > 0; }
+		inline const Rect& GetRect( Handle handle ) const { return m_regions.at( handle ).rect; }
+		// rect with padding
+		inline const Rect& GetReservedRect( Handle handle ) const { return m_regions.at( handle ).reserved; }
+
+		inline uint32_t GetWidth() const { return m_width; }
+		inline uint32_t GetHeight() const { return m_height; }
+		inline size_t GetRegionCount() const { return m_regions.size(); }
+		inline size_t GetFreeRectCount() const { return m_freeRects.size(); }
+		// used area with padding / area of atlas
+		float GetOccupancy() const;
+
+	private:
+		struct Region
+		{
+			Rect rect;
+			Rect reserved;
+		};
+
+		static bool Place( std::vector<Rect>& freeRects, Rect& outRect, uint32_t width, uint32_t height );
+		static bool Reserve( std::vector<Rect>& freeRects, const Rect& );
+		static void Release( std::vector<Rect>& freeRects, const Rect& );
+
+	private:
+		uint32_t m_width{};
+		uint32_t m_height{};
+		uint32_t m_padding{};
+		Handle m_nextHandle{ 1 };
+
+		std::vector<Rect> m_freeRects;
+		std::unordered_map<Handle, Region> m_regions;
+	};
+}
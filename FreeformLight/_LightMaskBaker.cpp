@@ -0,0 +1,296 @@
+#include "_LightMaskBaker.h"
+#include "_PolygonTriangulator.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+
+namespace FreeformLight
+{
+	const float _LightMaskBaker::blurWeights[] = {
+		0.002216f,
+		0.008764f,
+		0.026995f,
+		0.064759f,
+		0.120985f,
+		0.176033f,
+		0.199471f,
+		0.176033f,
+		0.120985f,
+		0.064759f,
+		0.026995f,
+		0.008764f,
+		0.002216f,
+	};
+
+	namespace
+	{
+		constexpr float blurOffsets[] = { -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6 };
+		static_assert( sizeof( blurOffsets ) / sizeof( *blurOffsets ) == _LightMaskBaker::blurTapCount, "invalid size" );
+
+		// light texture is constant along u. so only v is needed
+		struct Vertex
+		{
+			float x;
+			float y;
+			float v;
+		};
+
+		struct Texel
+		{
+			float r;
+			float g;
+			float b;
+			float a;
+		};
+
+		// float to unorm of A8R8G8B8 render target
+		inline float Quantize( float value )
+		{
+			value = std::min( std::max( value, 0.f ), 1.f );
+
+			return std::floor( value * 255.f + 0.5f ) / 255.f;
+		}
+
+		inline uint32_t ToColor( const Texel& t )
+		{
+			auto c = []( float value ) { return static_cast<uint32_t>( value * 255.f + 0.5f ); };
+
+			return c( t.a ) << 24 | c( t.r ) << 16 | c( t.g ) << 8 | c( t.b );
+		}
+
+		inline float Edge( const Vertex& a, const Vertex& b, float x, float y )
+		{
+			return ( b.x - a.x ) * ( y - a.y ) - ( b.y - a.y ) * ( x - a.x );
+		}
+
+		// top-left fill rule for clock wise triangle on screen
+		inline bool IsTopLeft( const Vertex& a, const Vertex& b )
+		{
+			auto dx = b.x - a.x;
+			auto dy = b.y - a.y;
+
+			return ( dy == 0 && dx > 0 ) || dy < 0;
+		}
+
+		inline bool IsInside( float w, bool topLeft )
+		{
+			return w > 0 || ( w == 0 && topLeft );
+		}
+
+		// d3d9 puts pixel center at integer coordinate
+		void RasterizeTriangle( std::vector<float>& coords, std::vector<uint8_t>& coverages, uint32_t width, uint32_t height, Vertex v0, Vertex v1, Vertex v2 )
+		{
+			auto area = Edge( v0, v1, v2.x, v2.y );
+
+			if ( area == 0 ) {
+				return;
+			}
+			else if ( area < 0 ) {
+				std::swap( v1, v2 );
+				area = -area;
+			}
+
+			auto left = std::max( 0, static_cast<int>( std::ceil( std::min( { v0.x, v1.x, v2.x } ) ) ) );
+			auto top = std::max( 0, static_cast<int>( std::ceil( std::min( { v0.y, v1.y, v2.y } ) ) ) );
+			auto right = std::min( static_cast<int>( width ) - 1, static_cast<int>( std::floor( std::max( { v0.x, v1.x, v2.x } ) ) ) );
+			auto bottom = std::min( static_cast<int>( height ) - 1, static_cast<int>( std::floor( std::max( { v0.y, v1.y, v2.y } ) ) ) );
+
+			auto topLeft0 = IsTopLeft( v1, v2 );
+			auto topLeft1 = IsTopLeft( v2, v0 );
+			auto topLeft2 = IsTopLeft( v0, v1 );
+
+			for ( auto y = top; y <= bottom; ++y ) {
+				for ( auto x = left; x <= right; ++x ) {
+					auto px = static_cast<float>( x );
+					auto py = static_cast<float>( y );
+					auto w0 = Edge( v1, v2, px, py );
+					auto w1 = Edge( v2, v0, px, py );
+					auto w2 = Edge( v0, v1, px, py );
+
+					if ( IsInside( w0, topLeft0 ) && IsInside( w1, topLeft1 ) && IsInside( w2, topLeft2 ) ) {
+						auto index = static_cast<size_t>( y ) * width + x;
+						coords[index] = ( w0 * v0.v + w1 * v1.v + w2 * v2.v ) / area;
+						coverages[index] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	bool _LightMaskBaker::Bake( Mask& mask, Light const& light )
+	{
+		auto& points = light.points;
+
+		if ( points.size() < 3 ) {
+			return false;
+		}
+
+		float left{ FLT_MAX };
+		float right{ -FLT_MAX };
+		float top{ FLT_MAX };
+		float bottom{ -FLT_MAX };
+
+		for ( auto& p : points ) {
+			left = std::min( left, p.x );
+			top = std::min( top, p.y );
+			right = std::max( right, p.x );
+			bottom = std::max( bottom, p.y );
+		}
+
+		auto width = right - left;
+		auto height = bottom - top;
+		auto cx = left + width / 2;
+		auto cy = top + height / 2;
+
+		mask.width = static_cast<uint32_t>( width * textureScaling );
+		mask.height = static_cast<uint32_t>( height * textureScaling );
+		mask.cx = cx;
+		mask.cy = cy;
+		mask.meshWidth = width * meshScaling;
+		mask.meshHeight = height * meshScaling;
+		mask.texels.assign( static_cast<size_t>( mask.width ) * mask.height, 0 );
+
+		if ( mask.texels.empty() ) {
+			return false;
+		}
+
+		// rasterize triangles. center has { falloff, falloff } and the others have v = 0
+		std::vector<float> coords( mask.texels.size() );
+		std::vector<uint8_t> coverages( mask.texels.size() );
+		{
+			constexpr auto pixelScaling = textureScaling / meshScaling;
+			auto halfWidth = mask.width / 2.f;
+			auto halfHeight = mask.height / 2.f;
+
+			std::vector<Vertex> vertices;
+			vertices.reserve( points.size() );
+
+			for ( auto& p : points ) {
+				vertices.push_back( { halfWidth + ( p.x - cx ) * pixelScaling, halfHeight + ( p.y - cy ) * pixelScaling, 0 } );
+			}
+
+			vertices[0].v = light.falloff;
+
+			// same triangles of index buffer
+			_PolygonTriangulator::Points triangulatorPoints;
+			triangulatorPoints.reserve( points.size() );
+
+			for ( auto& p : points ) {
+				triangulatorPoints.push_back( { p.x, p.y } );
+			}
+
+			_PolygonTriangulator triangulator;
+			triangulator.Build( triangulatorPoints );
+
+			auto& indices = triangulator.GetIndices();
+
+			for ( size_t i = 0; i + 2 < indices.size(); i += 3 ) {
+				RasterizeTriangle( coords, coverages, mask.width, mask.height, vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]] );
+			}
+		}
+
+		// light texture of _GradientTextureCache
+		float alphas[gradientSize]{};
+		Texel color{};
+		{
+			auto intensity = light.intensity * 255.f;
+			color.r = ( static_cast<int>( light.r * intensity ) & 0xff ) / 255.f;
+			color.g = ( static_cast<int>( light.g * intensity ) & 0xff ) / 255.f;
+			color.b = ( static_cast<int>( light.b * intensity ) & 0xff ) / 255.f;
+
+			for ( auto y = 0; y < gradientSize; ++y ) {
+				alphas[y] = static_cast<int>( y / static_cast<float>( gradientSize ) * 255 ) / 255.f;
+			}
+		}
+
+		// point sampling with clamp address
+		auto sample = [&alphas]( float v ) {
+			auto y = static_cast<int>( std::floor( v * gradientSize ) );
+
+			return alphas[std::min( std::max( y, 0 ), gradientSize - 1 )];
+		};
+
+		float weightSum{};
+
+		for ( auto weight : blurWeights ) {
+			weightSum += weight;
+		}
+
+		// blur passes. x blur moves u only so it keeps the texel. y blur moves v by pixel width of the light
+		// both are drawn with D3DBLEND_SRCALPHA and D3DBLEND_DESTALPHA onto cleared target
+		auto pixelWidth = 1.f / width;
+
+		for ( size_t i = 0; i < mask.texels.size(); ++i ) {
+			if ( !coverages[i] ) {
+				continue;
+			}
+
+			auto v = coords[i];
+
+			Texel xBlur{ color.r * weightSum, color.g * weightSum, color.b * weightSum, sample( v ) * weightSum };
+			Texel target{
+				Quantize( xBlur.r * xBlur.a ),
+				Quantize( xBlur.g * xBlur.a ),
+				Quantize( xBlur.b * xBlur.a ),
+				Quantize( xBlur.a * xBlur.a ),
+			};
+
+			Texel yBlur{ color.r * weightSum, color.g * weightSum, color.b * weightSum, 0 };
+
+			for ( size_t tap = 0; tap < blurTapCount; ++tap ) {
+				yBlur.a += sample( v + blurOffsets[tap] * pixelWidth ) * blurWeights[tap];
+			}
+
+			target = {
+				Quantize( yBlur.r * yBlur.a + target.r * target.a ),
+				Quantize( yBlur.g * yBlur.a + target.g * target.a ),
+				Quantize( yBlur.b * yBlur.a + target.b * target.a ),
+				Quantize( yBlur.a * yBlur.a + target.a * target.a ),
+			};
+
+			mask.texels[i] = ToColor( target );
+		}
+
+		return true;
+	}
+
+	bool _LightMaskBaker::Bake( std::vector<Mask>& masks, std::vector<Light> const& lights, unsigned threadCount )
+	{
+		masks.clear();
+		masks.resize( lights.size() );
+
+		if ( !threadCount ) {
+			threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+		}
+
+		threadCount = static_cast<unsigned>( std::min<size_t>( threadCount, lights.size() ) );
+
+		std::atomic<size_t> nextIndex{};
+		std::atomic<bool> failed{};
+
+		auto bake = [&]() {
+			for ( auto i = nextIndex++; i < lights.size(); i = nextIndex++ ) {
+				if ( !Bake( masks[i], lights[i] ) ) {
+					failed = true;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+
+		for ( unsigned i = 1; i < threadCount; ++i ) {
+			threads.emplace_back( bake );
+		}
+
+		bake();
+
+		for ( auto& thread : threads ) {
+			thread.join();
+		}
+
+		return !failed;
+	}
+}
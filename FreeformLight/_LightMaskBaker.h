@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*
+ * cpu version of _ImmutableLightImpl::UpdateBlurMask()
+ *
+ * it rasterizes the light triangles and applies ps_gaussianblur.fx the same way as device does.
+ * it has no dependency to d3d. so masks could be baked at a machine without device
+*/
+namespace FreeformLight
+{
+	class _LightMaskBaker
+	{
+	public:
+		struct Point
+		{
+			float x;
+			float y;
+		};
+		using Points = std::vector<Point>;
+
+		// same as _ImmutableLightImpl::Setting. first point is center of the fan
+		struct Light
+		{
+			Points points;
+			float r;
+			float g;
+			float b;
+			float intensity;
+			float falloff;
+		};
+
+		// A8R8G8B8 texels. the mask mesh is placed at center with mesh size
+		struct Mask
+		{
+			uint32_t width{};
+			uint32_t height{};
+			float cx{};
+			float cy{};
+			float meshWidth{};
+			float meshHeight{};
+			std::vector<uint32_t> texels;
+		};
+
+		// same values of UpdateBlurMask() and ps_gaussianblur.fx
+		static constexpr int gradientSize = 256;
+		static constexpr float meshScaling = 1.5f;
+		static constexpr float textureScaling = 0.5f;
+		static constexpr size_t blurTapCount = 13;
+		static const float blurWeights[blurTapCount];
+
+		static bool Bake( Mask&, Light const& );
+
+		// lights are shared by threads. zero means thread count of hardware
+		static bool Bake( std::vector<Mask>&, std::vector<Light> const&, unsigned threadCount = 0 );
+	};
+}
@@ -0,0 +1,421 @@
+#include "_LightSetFile.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		struct Color
+		{
+			int r;
+			int g;
+			int b;
+		};
+
+		inline int GetDistance( const Color& lhs, const Color& rhs )
+		{
+			auto r = lhs.r - rhs.r;
+			auto g = lhs.g - rhs.g;
+			auto b = lhs.b - rhs.b;
+
+			return r * r + g * g + b * b;
+		}
+
+		inline uint16_t To565( const Color& c )
+		{
+			return static_cast<uint16_t>( ( c.r >> 3 ) << 11 | ( c.g >> 2 ) << 5 | c.b >> 3 );
+		}
+
+		inline Color From565( uint16_t value )
+		{
+			auto r = value >> 11 & 0x1f;
+			auto g = value >> 5 & 0x3f;
+			auto b = value & 0x1f;
+
+			return{ r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2 };
+		}
+
+		// alpha part of DXT5. it uses mode of 8 alphas
+		void EncodeAlphaBlock( uint8_t* pOut, const uint32_t* texels )
+		{
+			int alphas[16]{};
+			int a0{};
+			int a1{ 255 };
+
+			for ( auto i = 0; i < 16; ++i ) {
+				alphas[i] = texels[i] >> 24;
+				a0 = std::max( a0, alphas[i] );
+				a1 = std::min( a1, alphas[i] );
+			}
+
+			pOut[0] = static_cast<uint8_t>( a0 );
+			pOut[1] = static_cast<uint8_t>( a1 );
+
+			uint64_t bits{};
+
+			if ( a0 != a1 ) {
+				int palette[8]{ a0, a1 };
+
+				for ( auto i = 2; i < 8; ++i ) {
+					palette[i] = ( ( 8 - i ) * a0 + ( i - 1 ) * a1 ) / 7;
+				}
+
+				for ( auto i = 0; i < 16; ++i ) {
+					auto best = 0;
+
+					for ( auto j = 1; j < 8; ++j ) {
+						if ( abs( palette[j] - alphas[i] ) < abs( palette[best] - alphas[i] ) ) {
+							best = j;
+						}
+					}
+
+					bits |= static_cast<uint64_t>( best ) << ( 3 * i );
+				}
+			}
+
+			for ( auto i = 0; i < 6; ++i ) {
+				pOut[2 + i] = static_cast<uint8_t>( bits >> ( 8 * i ) );
+			}
+		}
+
+		// color part of DXT5. mask colors are along one line so endpoints come from bounding box
+		void EncodeColorBlock( uint8_t* pOut, const uint32_t* texels )
+		{
+			Color colors[16]{};
+			Color high{ 0, 0, 0 };
+			Color low{ 255, 255, 255 };
+
+			for ( auto i = 0; i < 16; ++i ) {
+				auto& c = colors[i];
+				c = { static_cast<int>( texels[i] >> 16 & 0xff ), static_cast<int>( texels[i] >> 8 & 0xff ), static_cast<int>( texels[i] & 0xff ) };
+
+				high = { std::max( high.r, c.r ), std::max( high.g, c.g ), std::max( high.b, c.b ) };
+				low = { std::min( low.r, c.r ), std::min( low.g, c.g ), std::min( low.b, c.b ) };
+			}
+
+			auto c0 = To565( high );
+			auto c1 = To565( low );
+
+			// c0 > c1 means mode of 4 colors
+			if ( c0 < c1 ) {
+				std::swap( c0, c1 );
+			}
+
+			uint32_t bits{};
+
+			if ( c0 != c1 ) {
+				auto p0 = From565( c0 );
+				auto p1 = From565( c1 );
+				Color palette[4]{
+					p0,
+					p1,
+					{ ( 2 * p0.r + p1.r ) / 3, ( 2 * p0.g + p1.g ) / 3, ( 2 * p0.b + p1.b ) / 3 },
+					{ ( p0.r + 2 * p1.r ) / 3, ( p0.g + 2 * p1.g ) / 3, ( p0.b + 2 * p1.b ) / 3 },
+				};
+
+				for ( auto i = 0; i < 16; ++i ) {
+					auto best = 0;
+
+					for ( auto j = 1; j < 4; ++j ) {
+						if ( GetDistance( palette[j], colors[i] ) < GetDistance( palette[best], colors[i] ) ) {
+							best = j;
+						}
+					}
+
+					bits |= static_cast<uint32_t>( best ) << ( 2 * i );
+				}
+			}
+
+			pOut[0] = static_cast<uint8_t>( c0 );
+			pOut[1] = static_cast<uint8_t>( c0 >> 8 );
+			pOut[2] = static_cast<uint8_t>( c1 );
+			pOut[3] = static_cast<uint8_t>( c1 >> 8 );
+
+			for ( auto i = 0; i < 4; ++i ) {
+				pOut[4 + i] = static_cast<uint8_t>( bits >> ( 8 * i ) );
+			}
+		}
+
+		// texels outside of the mask are zero
+		void EncodeMask( uint8_t* pOut, const _LightMaskBaker::Mask& mask, uint32_t width, uint32_t height )
+		{
+			for ( uint32_t by = 0; by < height; by += 4 ) {
+				for ( uint32_t bx = 0; bx < width; bx += 4 ) {
+					uint32_t texels[16]{};
+
+					for ( uint32_t y = 0; y < 4; ++y ) {
+						for ( uint32_t x = 0; x < 4; ++x ) {
+							if ( bx + x < mask.width && by + y < mask.height ) {
+								texels[y * 4 + x] = mask.texels[static_cast<size_t>( by + y ) * mask.width + bx + x];
+							}
+						}
+					}
+
+					EncodeAlphaBlock( pOut, texels );
+					EncodeColorBlock( pOut + 8, texels );
+					pOut += _LightSetFile::blockSize;
+				}
+			}
+		}
+
+		inline uint64_t Align( uint64_t value, uint64_t alignment )
+		{
+			return ( value + alignment - 1 ) / alignment * alignment;
+		}
+	}
+
+	bool _LightSetFile::Write( std::vector<uint8_t>& out, std::vector<_LightMaskBaker::Light> const& lights, unsigned threadCount )
+	{
+		std::vector<_LightMaskBaker::Mask> masks;
+
+		if ( !_LightMaskBaker::Bake( masks, lights, threadCount ) ) {
+			return false;
+		}
+
+		std::vector<Light> entries( lights.size() );
+		uint64_t offset = sizeof( Header ) + sizeof( Light ) * entries.size();
+
+		for ( size_t i = 0; i < lights.size(); ++i ) {
+			auto& entry = entries[i];
+			entry.pointOffset = static_cast<uint32_t>( offset );
+			entry.pointCount = static_cast<uint32_t>( lights[i].points.size() );
+			offset += sizeof( Point ) * lights[i].points.size();
+		}
+
+		for ( size_t i = 0; i < lights.size(); ++i ) {
+			auto& light = lights[i];
+			auto& mask = masks[i];
+			auto& entry = entries[i];
+			entry.r = light.r;
+			entry.g = light.g;
+			entry.b = light.b;
+			entry.a = 1.f;
+			entry.intensity = light.intensity;
+			entry.falloff = light.falloff;
+
+			// padding is placed at right and bottom. so center is moved by half of it
+			entry.maskWidth = std::max( 4u, ( mask.width + 3 ) / 4 * 4 );
+			entry.maskHeight = std::max( 4u, ( mask.height + 3 ) / 4 * 4 );
+
+			auto texelWidth = mask.meshWidth / mask.width;
+			auto texelHeight = mask.meshHeight / mask.height;
+			entry.meshWidth = texelWidth * entry.maskWidth;
+			entry.meshHeight = texelHeight * entry.maskHeight;
+			entry.cx = mask.cx + texelWidth * ( entry.maskWidth - mask.width ) / 2;
+			entry.cy = mask.cy + texelHeight * ( entry.maskHeight - mask.height ) / 2;
+
+			offset = Align( offset, blockSize );
+			entry.maskOffset = static_cast<uint32_t>( offset );
+			entry.maskSize = ( entry.maskWidth / 4 ) * ( entry.maskHeight / 4 ) * blockSize;
+			offset += entry.maskSize;
+		}
+
+		if ( offset > UINT32_MAX ) {
+			return false;
+		}
+
+		out.assign( static_cast<size_t>( offset ), 0 );
+
+		const Header header{ signature, version, static_cast<uint32_t>( lights.size() ), static_cast<uint32_t>( offset ) };
+		memcpy( out.data(), &header, sizeof( header ) );
+
+		if ( !entries.empty() ) {
+			memcpy( out.data() + sizeof( header ), entries.data(), sizeof( Light ) * entries.size() );
+		}
+
+		for ( size_t i = 0; i < lights.size(); ++i ) {
+			auto& entry = entries[i];
+
+			if ( entry.pointCount ) {
+				memcpy( out.data() + entry.pointOffset, lights[i].points.data(), sizeof( Point ) * entry.pointCount );
+			}
+
+			EncodeMask( out.data() + entry.maskOffset, masks[i], entry.maskWidth, entry.maskHeight );
+		}
+
+		return true;
+	}
+
+	bool _LightSetFile::Save( const char* path, std::vector<_LightMaskBaker::Light> const& lights, unsigned threadCount )
+	{
+		std::vector<uint8_t> data;
+
+		if ( !Write( data, lights, threadCount ) ) {
+			return false;
+		}
+
+		FILE* pFile{};
+
+#ifdef _WIN32
+		if ( fopen_s( &pFile, path, "wb" ) ) {
+			return false;
+		}
+#else
+		pFile = fopen( path, "wb" );
+#endif
+
+		if ( !pFile ) {
+			return false;
+		}
+
+		auto written = fwrite( data.data(), 1, data.size(), pFile );
+
+		return !fclose( pFile ) && written == data.size();
+	}
+
+	bool _LightSetFile::Open( const char* path )
+	{
+		Close();
+
+#ifdef _WIN32
+		auto hFile = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+
+		if ( hFile == INVALID_HANDLE_VALUE ) {
+			return false;
+		}
+
+		LARGE_INTEGER fileSize{};
+
+		if ( !GetFileSizeEx( hFile, &fileSize ) || !fileSize.QuadPart || fileSize.HighPart ) {
+			CloseHandle( hFile );
+			return false;
+		}
+
+		auto hMapping = CreateFileMappingA( hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		CloseHandle( hFile );
+
+		if ( !hMapping ) {
+			return false;
+		}
+
+		// view keeps mapping alive
+		auto pView = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+		CloseHandle( hMapping );
+
+		if ( !pView ) {
+			return false;
+		}
+
+		m_pBase = static_cast<const uint8_t*>( pView );
+		m_size = static_cast<size_t>( fileSize.QuadPart );
+#else
+		auto file = open( path, O_RDONLY );
+
+		if ( file < 0 ) {
+			return false;
+		}
+
+		struct stat status{};
+
+		if ( fstat( file, &status ) || !status.st_size ) {
+			close( file );
+			return false;
+		}
+
+		auto pView = mmap( nullptr, static_cast<size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+		close( file );
+
+		if ( pView == MAP_FAILED ) {
+			return false;
+		}
+
+		m_pBase = static_cast<const uint8_t*>( pView );
+		m_size = static_cast<size_t>( status.st_size );
+#endif
+
+		m_pHeader = reinterpret_cast<const Header*>( m_pBase );
+		m_pLights = reinterpret_cast<const Light*>( m_pBase + sizeof( Header ) );
+
+		if ( !Validate() ) {
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void _LightSetFile::Close()
+	{
+		if ( m_pBase ) {
+#ifdef _WIN32
+			UnmapViewOfFile( m_pBase );
+#else
+			munmap( const_cast<uint8_t*>( m_pBase ), m_size );
+#endif
+		}
+
+		m_pBase = {};
+		m_size = {};
+		m_pHeader = {};
+		m_pLights = {};
+	}
+
+	const _LightSetFile::Light& _LightSetFile::GetLight( size_t index ) const
+	{
+		assert( index < GetLightCount() );
+
+		return m_pLights[index];
+	}
+
+	const _LightSetFile::Point* _LightSetFile::GetPoints( size_t index ) const
+	{
+		return reinterpret_cast<const Point*>( m_pBase + GetLight( index ).pointOffset );
+	}
+
+	const uint8_t* _LightSetFile::GetMask( size_t index ) const
+	{
+		return m_pBase + GetLight( index ).maskOffset;
+	}
+
+	bool _LightSetFile::Validate() const
+	{
+		if ( m_size < sizeof( Header ) ) {
+			return false;
+		}
+		else if ( m_pHeader->signature != signature || m_pHeader->version != version || m_pHeader->fileSize != m_size ) {
+			return false;
+		}
+		else if ( sizeof( Header ) + sizeof( Light ) * static_cast<uint64_t>( m_pHeader->lightCount ) > m_size ) {
+			return false;
+		}
+
+		for ( uint32_t i = 0; i < m_pHeader->lightCount; ++i ) {
+			auto& light = m_pLights[i];
+
+			if ( light.pointCount < 3 || light.pointOffset % alignof( Point ) ) {
+				return false;
+			}
+			else if ( light.pointOffset + sizeof( Point ) * static_cast<uint64_t>( light.pointCount ) > m_size ) {
+				return false;
+			}
+			else if ( !light.maskWidth || !light.maskHeight || light.maskWidth % 4 || light.maskHeight % 4 ) {
+				return false;
+			}
+			else if ( light.maskSize != GetMaskPitch( light ) * static_cast<uint64_t>( light.maskHeight / 4 ) ) {
+				return false;
+			}
+			else if ( light.maskOffset % blockSize || light.maskOffset + static_cast<uint64_t>( light.maskSize ) > m_size ) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "_LightMaskBaker.h"
+
+
+/*
+ * baked light set. it is used by _ImmutableFreeform
+ *
+ * file is made to be used in place after mapping. so there's no parsing at loading
+ *
+ *	Header
+ *	Light[lightCount]
+ *	Point[] of every light
+ *	DXT5 blocks of every mask. each one is aligned by 16 bytes
+ *
+ * all values are little endian
+*/
+namespace FreeformLight
+{
+	class _LightSetFile
+	{
+	public:
+		static constexpr uint32_t signature = 0x534c4646; // "FFLS"
+		static constexpr uint32_t version = 1;
+		static constexpr uint32_t blockSize = 16;
+
+		struct Header
+		{
+			uint32_t signature;
+			uint32_t version;
+			uint32_t lightCount;
+			uint32_t fileSize;
+		};
+
+		struct Light
+		{
+			float r;
+			float g;
+			float b;
+			float a;
+			float intensity;
+			float falloff;
+
+			uint32_t pointOffset;
+			uint32_t pointCount;
+
+			// mask is padded to multiple of 4 for block compression. mesh size is padded as well
+			uint32_t maskWidth;
+			uint32_t maskHeight;
+			float cx;
+			float cy;
+			float meshWidth;
+			float meshHeight;
+			uint32_t maskOffset;
+			uint32_t maskSize;
+		};
+
+		using Point = _LightMaskBaker::Point;
+
+		static_assert( sizeof( Header ) == 16, "invalid size" );
+		static_assert( sizeof( Light ) == 64, "invalid size" );
+
+	public:
+		_LightSetFile() = default;
+		_LightSetFile( const _LightSetFile& ) = delete;
+		_LightSetFile& operator=( const _LightSetFile& ) = delete;
+		~_LightSetFile() { Close(); }
+
+		// bake masks and write file. it doesn't need device
+		static bool Write( std::vector<uint8_t>& out, std::vector<_LightMaskBaker::Light> const&, unsigned threadCount = 0 );
+		static bool Save( const char* path, std::vector<_LightMaskBaker::Light> const&, unsigned threadCount = 0 );
+
+		// map file and validate it. pointers are valid until Close()
+		bool Open( const char* path );
+		void Close();
+
+		inline size_t GetLightCount() const { return m_pHeader ? m_pHeader->lightCount : 0; }
+		const Light& GetLight( size_t index ) const;
+		const Point* GetPoints( size_t index ) const;
+		const uint8_t* GetMask( size_t index ) const;
+
+		// row pitch of DXT5 blocks
+		static inline uint32_t GetMaskPitch( const Light& light ) { return ( light.maskWidth / 4 ) * blockSize; }
+
+	private:
+		bool Validate() const;
+
+	private:
+		const uint8_t* m_pBase{};
+		size_t m_size{};
+		const Header* m_pHeader{};
+		const Light* m_pLights{};
+	};
+}
@@ -0,0 +1,176 @@
+#include "stdafx.h"
+#include "_MaskAtlasTexture.h"
+
+
+namespace FreeformLight
+{
+	HRESULT _MaskAtlasTexture::Allocate( LPDIRECT3DDEVICE9 pDevice, Handle* pInOutHandle, UINT width, UINT height )
+	{
+		ASSERT( pInOutHandle );
+
+		if ( !width || !height ) {
+			ASSERT( FALSE );
+			return E_FAIL;
+		}
+
+		if ( !m_pTexture ) {
+			if ( FAILED( RestoreDevice( pDevice ) ) ) {
+				return E_FAIL;
+			}
+		}
+
+		auto place = [this, pInOutHandle, width, height]() {
+			if ( *pInOutHandle == _LightMaskAtlas::invalidHandle ) {
+				*pInOutHandle = m_atlas.Insert( width, height );
+
+				return *pInOutHandle != _LightMaskAtlas::invalidHandle;
+			}
+
+			bool changed{};
+
+			return m_atlas.Resize( *pInOutHandle, width, height, changed );
+		};
+
+		// compact at first. if it isn't enough, make it bigger until maximum size
+		if ( !place() ) {
+			if ( FAILED( Defragment( pDevice ) ) ) {
+				return E_FAIL;
+			}
+
+			while ( !place() ) {
+				if ( FAILED( Grow( pDevice ) ) ) {
+					return E_FAIL;
+				}
+			}
+		}
+
+		// clear padding too. it'd have content of removed one
+		auto& r = m_atlas.GetReservedRect( *pInOutHandle );
+		const RECT rect{ static_cast<LONG>( r.x ), static_cast<LONG>( r.y ), static_cast<LONG>( r.x + r.width ), static_cast<LONG>( r.y + r.height ) };
+
+		LPDIRECT3DSURFACE9 pSurface{};
+		m_pTexture->GetSurfaceLevel( 0, &pSurface );
+		auto result = pDevice->ColorFill( pSurface, &rect, D3DCOLOR_ARGB( 0, 0, 0, 0 ) );
+		SAFE_RELEASE( pSurface );
+
+		return result;
+	}
+
+	void _MaskAtlasTexture::Free( Handle handle )
+	{
+		m_atlas.Remove( handle );
+	}
+
+	void _MaskAtlasTexture::Invalidate()
+	{
+		SAFE_RELEASE( m_pTexture );
+	}
+
+	HRESULT _MaskAtlasTexture::RestoreDevice( LPDIRECT3DDEVICE9 pDevice )
+	{
+		ASSERT( !m_pTexture );
+
+		return CreateTexture( pDevice, &m_pTexture, m_atlas.GetWidth(), m_atlas.GetHeight() );
+	}
+
+	HRESULT _MaskAtlasTexture::Defragment( LPDIRECT3DDEVICE9 pDevice )
+	{
+		std::vector<_LightMaskAtlas::Move> moves;
+
+		// it's ok. there's no space anyway
+		if ( !m_atlas.Defragment( moves ) ) {
+			return S_OK;
+		}
+
+		// regions could be overlapped each other. so they're copied to new one
+		LPDIRECT3DTEXTURE9 pTexture{};
+
+		if ( FAILED( CreateTexture( pDevice, &pTexture, m_atlas.GetWidth(), m_atlas.GetHeight() ) ) ) {
+			return E_FAIL;
+		}
+
+		for ( auto& move : moves ) {
+			if ( FAILED( Copy( pDevice, pTexture, move.to, move.from ) ) ) {
+				SAFE_RELEASE( pTexture );
+				return E_FAIL;
+			}
+		}
+
+		SAFE_RELEASE( m_pTexture );
+		m_pTexture = pTexture;
+
+		return S_OK;
+	}
+
+	HRESULT _MaskAtlasTexture::Grow( LPDIRECT3DDEVICE9 pDevice )
+	{
+		D3DCAPS9 caps{};
+		pDevice->GetDeviceCaps( &caps );
+
+		auto limit = min( maxSize, min( caps.MaxTextureWidth, caps.MaxTextureHeight ) );
+		auto width = m_atlas.GetWidth();
+		auto height = m_atlas.GetHeight();
+
+		if ( width >= limit && height >= limit ) {
+			return E_FAIL;
+		}
+
+		const Rect old{ 0, 0, width, height };
+		width = min( width * 2, limit );
+		height = min( height * 2, limit );
+
+		LPDIRECT3DTEXTURE9 pTexture{};
+
+		if ( FAILED( CreateTexture( pDevice, &pTexture, width, height ) ) ) {
+			return E_FAIL;
+		}
+		else if ( FAILED( Copy( pDevice, pTexture, old, old ) ) ) {
+			SAFE_RELEASE( pTexture );
+			return E_FAIL;
+		}
+
+		m_atlas.Grow( width, height );
+
+		SAFE_RELEASE( m_pTexture );
+		m_pTexture = pTexture;
+
+		return S_OK;
+	}
+
+	HRESULT _MaskAtlasTexture::CreateTexture( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DTEXTURE9* pOutTexture, UINT width, UINT height ) const
+	{
+		ASSERT( !*pOutTexture );
+
+		if ( FAILED( pDevice->CreateTexture( width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, pOutTexture, NULL ) ) ) {
+			ASSERT( FALSE );
+			return E_FAIL;
+		}
+
+		LPDIRECT3DSURFACE9 pSurface{};
+		( *pOutTexture )->GetSurfaceLevel( 0, &pSurface );
+		auto result = pDevice->ColorFill( pSurface, NULL, D3DCOLOR_ARGB( 0, 0, 0, 0 ) );
+		SAFE_RELEASE( pSurface );
+
+		return result;
+	}
+
+	HRESULT _MaskAtlasTexture::Copy( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DTEXTURE9 pDest, const Rect& dest, const Rect& src ) const
+	{
+		ASSERT( dest.width == src.width && dest.height == src.height );
+
+		LPDIRECT3DSURFACE9 pSrcSurface{};
+		m_pTexture->GetSurfaceLevel( 0, &pSrcSurface );
+
+		LPDIRECT3DSURFACE9 pDestSurface{};
+		pDest->GetSurfaceLevel( 0, &pDestSurface );
+
+		const RECT srcRect{ static_cast<LONG>( src.x ), static_cast<LONG>( src.y ), static_cast<LONG>( src.x + src.width ), static_cast<LONG>( src.y + src.height ) };
+		const RECT destRect{ static_cast<LONG>( dest.x ), static_cast<LONG>( dest.y ), static_cast<LONG>( dest.x + dest.width ), static_cast<LONG>( dest.y + dest.height ) };
+		auto result = pDevice->StretchRect( pSrcSurface, &srcRect, pDestSurface, &destRect, D3DTEXF_NONE );
+
+		SAFE_RELEASE( pDestSurface );
+		SAFE_RELEASE( pSrcSurface );
+
+		return result;
+	}
+}
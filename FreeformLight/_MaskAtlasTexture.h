@@ -0,0 +1,54 @@
+#pragma once
+#include <d3dx9.h>
+#include "_LightMaskAtlas.h"
+
+
+/*
+ * render target shared by blur masks of lights
+ *
+ * each light owns a region of it instead of a texture. region is found by _LightMaskAtlas
+ * if there's no space, regions are compacted and then the texture grows
+*/
+namespace FreeformLight
+{
+	class _MaskAtlasTexture
+	{
+	public:
+		using Handle = _LightMaskAtlas::Handle;
+		using Rect = _LightMaskAtlas::Rect;
+
+		static constexpr UINT defaultSize = 1024;
+		static constexpr UINT maxSize = 4096;
+		// blank texels around a region. it prevents bleeding when it is sampled
+		static constexpr UINT padding = 2;
+
+		_MaskAtlasTexture() : m_atlas{ defaultSize, defaultSize, padding }
+		{}
+
+		_MaskAtlasTexture( const _MaskAtlasTexture& ) = delete;
+		~_MaskAtlasTexture() { Invalidate(); }
+
+		// region is made if handle is invalid. else it is resized
+		// content of region should be drawn again after it. contents of other regions are kept
+		HRESULT Allocate( LPDIRECT3DDEVICE9, Handle* pInOutHandle, UINT width, UINT height );
+		void Free( Handle );
+
+		inline const Rect& GetRect( Handle handle ) const { return m_atlas.GetRect( handle ); }
+		inline LPDIRECT3DTEXTURE9 GetTexture() const { return m_pTexture; }
+		inline const _LightMaskAtlas& GetAtlas() const { return m_atlas; }
+
+		// regions are kept. lights draw their masks again after RestoreDevice()
+		void Invalidate();
+		HRESULT RestoreDevice( LPDIRECT3DDEVICE9 );
+
+	private:
+		HRESULT Defragment( LPDIRECT3DDEVICE9 );
+		HRESULT Grow( LPDIRECT3DDEVICE9 );
+		HRESULT CreateTexture( LPDIRECT3DDEVICE9, LPDIRECT3DTEXTURE9*, UINT width, UINT height ) const;
+		HRESULT Copy( LPDIRECT3DDEVICE9, LPDIRECT3DTEXTURE9 pDest, const Rect& dest, const Rect& src ) const;
+
+	private:
+		_LightMaskAtlas m_atlas;
+		LPDIRECT3DTEXTURE9 m_pTexture{};
+	};
+}
@@ -2,6 +2,8 @@
 #include <string>
 #include "_MutableFreeform.h"
 
+//#define DEBUG_BLUR_MASK
+
 
 namespace FreeformLight
 {
@@ -20,7 +22,9 @@ namespace FreeformLight
 		io.WantCaptureMouse = true;
 
 		if ( isAmbientMode ) {
-			ImGui::ColorEdit3( u8"Ambient", m_setting.ambient );
+			if ( ImGui::ColorEdit3( u8"Ambient", m_setting.ambient ) ) {
+				m_isChanged = true;
+			}
 		}
 		else {
 			ImGui::TextWrapped( u8"Check the flag to change ambient" );
@@ -78,6 +82,13 @@ namespace FreeformLight
 			}
 		}
 
+		// device calls of last frame. see _RenderStateCache
+		{
+			auto& statistics = _RenderStateCache::GetStatistics();
+
+			ImGui::Text( u8"State calls: %zu, skipped: %zu", statistics.getCount + statistics.setCount, statistics.avoidedGetCount + statistics.avoidedSetCount );
+		}
+
 		ImGui::End();
 
 		auto freeformLightVisible = !m_lightImpls.empty();
@@ -94,7 +105,7 @@ namespace FreeformLight
 	HRESULT _MutableFreeform::AddLight( LPDIRECT3DDEVICE9 pDevice, LONG x, LONG y )
 	{
 		auto points = GetDefaultPoints( m_displayMode, x, y );
-		auto lightImpl = new _MutableLightImpl( pDevice, m_pBlurPixelShader, points );
+		auto lightImpl = new _MutableLightImpl( pDevice, m_pBlurPixelShader, m_pMaskAtlas, m_pGradientTextures, points );
 
 		m_lightImpls.emplace_back( std::move( lightImpl ) );
 
@@ -103,6 +114,8 @@ namespace FreeformLight
 
 		ASSERT( m_lightImpls.size() == m_tabs.size() );
 
+		m_isChanged = true;
+
 		return S_OK;
 	}
 
@@ -119,6 +132,8 @@ namespace FreeformLight
 				m_tabs.erase( iterator );
 			}
 
+			m_isChanged = true;
+
 			return S_OK;
 		}
 		else {
@@ -153,10 +168,83 @@ namespace FreeformLight
 		return points;
 	}
 
+	HRESULT _MutableFreeform::Draw( LPDIRECT3DDEVICE9 pDevice, float x, float y )
+	{
+		m_isChanged = false;
+
+		return __super::Draw( pDevice, x, y );
+	}
+
+	HRESULT _MutableFreeform::DrawLights( LPDIRECT3DDEVICE9 pDevice, _RenderStateCache& stateCache )
+	{
+		auto viewBounds = GetViewBounds( pDevice );
+		std::vector<_MutableLightImpl*> visibleLightImpls;
+
+		// atlas could be compacted or grown by a mask. so quads are made after all masks are updated
+		for ( auto&& lightImpl : m_lightImpls ) {
+			// it's out of screen
+			if ( !lightImpl->IsVisible( viewBounds ) ) {
+				continue;
+			}
+
+			if ( FAILED( lightImpl->Update( pDevice, stateCache ) ) ) {
+				return E_FAIL;
+			}
+
+			visibleLightImpls.push_back( lightImpl.get() );
+		}
+
+		if ( !m_pLightBatch ) {
+			m_pLightDevice.reset( new _D3D9LightDevice( pDevice ) );
+			m_pLightBatch.reset( new _LightBatch( *m_pLightDevice ) );
+			m_maskPage = m_pLightDevice->CreateSharedPage();
+		}
+
+		// texture of atlas is made again when it grows or device is restored
+		m_pLightDevice->SetSharedPage( m_maskPage, m_pMaskAtlas->GetTexture() );
+		m_pLightBatch->Clear();
+
+		for ( auto* pLightImpl : visibleLightImpls ) {
+			m_pLightBatch->Add( m_maskPage, pLightImpl->GetQuad() );
+		}
+
+#ifdef DEBUG_BLUR_MASK
+		// blend states are restored when it is destroyed
+		_RenderStateCache debugStateCache{ stateCache };
+		debugStateCache.SetRenderState( D3DRS_BLENDOP, D3DBLENDOP_ADD );
+		debugStateCache.SetRenderState( D3DRS_SRCBLEND, D3DBLEND_ONE );
+		debugStateCache.SetRenderState( D3DRS_DESTBLEND, D3DBLEND_ZERO );
+
+		return m_pLightBatch->Draw( debugStateCache ) ? S_OK : E_FAIL;
+#else
+		return m_pLightBatch->Draw( stateCache ) ? S_OK : E_FAIL;
+#endif
+	}
+
+	bool _MutableFreeform::IsChanged() const
+	{
+		return m_isChanged || std::any_of( std::cbegin( m_lightImpls ), std::cend( m_lightImpls ), []( auto& lightImpl ) { return lightImpl->IsChanged(); } );
+	}
+
 	HRESULT _MutableFreeform::RestoreDevice( LPDIRECT3DDEVICE9 pDevice, D3DDISPLAYMODE const& displayMode )
 	{
 		m_displayMode = displayMode;
+		m_isChanged = true;
+
+		// lights draw their masks into it
+		if ( FAILED( m_pMaskAtlas->RestoreDevice( pDevice ) ) ) {
+			ASSERT( FALSE );
+
+			return E_FAIL;
+		}
 
 		return __super::RestoreDevice( pDevice, displayMode );
 	}
+
+	void _MutableFreeform::Invalidate()
+	{
+		__super::Invalidate();
+
+		m_pMaskAtlas->Invalidate();
+	}
 }
\ No newline at end of file
@@ -8,18 +8,27 @@ namespace FreeformLight
 	class _MutableFreeform : public _FreeformImpl<_MutableLightImpl>
 	{
 	public:
-		_MutableFreeform( LPDIRECT3DPIXELSHADER9 pBlurShader, D3DDISPLAYMODE const& displayMode ) : _FreeformImpl<_MutableLightImpl>{ pBlurShader }
+		_MutableFreeform( LPDIRECT3DPIXELSHADER9 pBlurShader, D3DDISPLAYMODE const& displayMode ) : _FreeformImpl<_MutableLightImpl>{ pBlurShader }, m_pMaskAtlas{ std::make_shared<_MaskAtlasTexture>() }, m_pGradientTextures{ std::make_shared<_GradientTextureCache>() }
 		{
 			m_displayMode = displayMode;
 		}
 
 		HRESULT DrawImgui( LPDIRECT3DDEVICE9, LONG xCenter, LONG yCenter, bool isAmbientMode, bool* pIsVisible );
+		// it draws lights and marks them unchanged
+		HRESULT Draw( LPDIRECT3DDEVICE9, float x, float y );
+		// light buffer should be drawn again if it is true
+		bool IsChanged() const;
+		HRESULT AddLight( LPDIRECT3DDEVICE9, LONG x, LONG y );
 		inline bool IsMaskInvisible() const { return !m_setting.maskVisible; }
 		inline D3DXCOLOR GetAmbientColor() const { return m_setting.ambient; }
 		virtual HRESULT RestoreDevice( LPDIRECT3DDEVICE9 pDevice, D3DDISPLAYMODE const& displayMode ) override final;
+		virtual void Invalidate() override final;
+
+	protected:
+		// masks are updated first. then all lights are drawn by a call because their masks are in a texture
+		virtual HRESULT DrawLights( LPDIRECT3DDEVICE9, _RenderStateCache& ) override final;
 
 	private:
-		HRESULT AddLight( LPDIRECT3DDEVICE9, LONG x, LONG y );
 		HRESULT RemoveLight( size_t index );
 		_MutableLightImpl::Points GetDefaultPoints( D3DDISPLAYMODE const&, LONG x, LONG y ) const;
 
@@ -50,5 +59,15 @@ namespace FreeformLight
 
 		std::vector<Tab> m_tabs;
 		D3DDISPLAYMODE m_displayMode{};
+
+		// blur masks of all lights are in it
+		std::shared_ptr<_MaskAtlasTexture> m_pMaskAtlas;
+		// shared page of m_pLightDevice. it refers texture of m_pMaskAtlas
+		size_t m_maskPage{};
+		// lights of same color share a gradient texture
+		std::shared_ptr<_GradientTextureCache> m_pGradientTextures;
+
+		// light is added or removed, or ambient is changed
+		bool m_isChanged = true;
 	};
 }
\ No newline at end of file
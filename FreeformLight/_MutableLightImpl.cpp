@@ -3,12 +3,11 @@
 #include "_MutableLightImpl.h"
 
 //#define DEBUG_LINE
-//#define DEBUG_BLUR_MASK
 
 
 namespace FreeformLight
 {
-	_MutableLightImpl::_MutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, Points const& points ) : _ImmutableLightImpl{ pDevice, pBlurShader, points, GetDefaultSetting() }, m_setting{ GetDefaultSetting() }
+	_MutableLightImpl::_MutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, std::shared_ptr<_MaskAtlasTexture> pMaskAtlas, std::shared_ptr<_GradientTextureCache> pGradientTextures, Points const& points ) : _ImmutableLightImpl{ pDevice, pBlurShader, std::move( pMaskAtlas ), std::move( pGradientTextures ), points, GetDefaultSetting() }, m_setting{ GetDefaultSetting() }
 	{
 		ClearEditingStates( points.size() );
 	}
@@ -19,42 +18,57 @@ namespace FreeformLight
 			UpdateLight( pDevice, setting );
 
 			m_setting = setting;
+			m_isChanged = true;
 		}
 
 		return S_OK;
 	}
 
-	HRESULT _MutableLightImpl::UpdateLightVertex( LPDIRECT3DDEVICE9 pDevice, WORD updatingIndex, const D3DXVECTOR3& position )
+	HRESULT _MutableLightImpl::UpdateLightVertex( LPDIRECT3DDEVICE9 pDevice, WORD index, const D3DXVECTOR3& position )
 	{
-		for ( auto index : m_lightIndices ) {
-			if ( updatingIndex == index ) {
-				m_lightVertices[index].position = position;
+		if ( index >= m_lightVertices.size() ) {
+			return E_FAIL;
+		}
 
-				// set automatically if it's not change mid point
-				if ( updatingIndex )
-				{
-					Points points;
-					// exclude first value which is origin
-					std::transform( std::next( std::cbegin( m_lightVertices ) ), std::cend( m_lightVertices ), std::back_inserter( points ), []( auto& v ) { return v.position; } );
+		Bounds dirtyBounds{ position.x, position.y, position.x, position.y };
 
-					m_lightVertices[0].position = GetCenterPoint( points.begin(), points.end() );
-				}
+		// old triangles having the vertex. new ones are same if triangulation isn't changed
+		for ( size_t i{}; i + 2 < m_lightIndices.size(); i += 3 ) {
+			auto triangle = &m_lightIndices[i];
 
-				auto memorySize = static_cast<UINT>( m_lightVertices.size() * sizeof( Vertices::value_type ) );
-				CopyToMemory( m_pLightVertexBuffer, m_lightVertices.data(), memorySize );
+			if ( triangle[0] != index && triangle[1] != index && triangle[2] != index ) {
+				continue;
+			}
 
-				if ( FAILED( UpdateBlurMask( pDevice, m_lightVertices ) ) ) {
-					assert( FALSE );
+			for ( size_t j{}; j < 3; ++j ) {
+				auto& p = m_lightVertices[triangle[j]].position;
+				dirtyBounds.left = min( dirtyBounds.left, p.x );
+				dirtyBounds.top = min( dirtyBounds.top, p.y );
+				dirtyBounds.right = max( dirtyBounds.right, p.x );
+				dirtyBounds.bottom = max( dirtyBounds.bottom, p.y );
+			}
+		}
 
-					return E_FAIL;
-				}
+		m_lightVertices[index].position = position;
+		m_triangulator.Move( index, { position.x, position.y } );
 
-				m_linePointsCaches.clear();
-				return S_OK;
-			}
+		auto isTriangulationChanged = ( m_triangulator.GetIndices() != m_lightIndices );
+
+		if ( isTriangulationChanged && FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
+			ASSERT( FALSE );
+
+			return E_FAIL;
+		}
+
+		// center is set automatically after dragging. so only triangles having the vertex are changed while dragging
+		if ( index ) {
+			m_isCenterDirty = true;
 		}
 
-		return E_FAIL;
+		SetBlurMaskDirty( index && !isTriangulationChanged ? &dirtyBounds : nullptr );
+
+		m_isChanged = true;
+		return S_OK;
 	}
 
 
@@ -62,22 +76,107 @@ namespace FreeformLight
 	{
 		ASSERT( m_lightVertices.size() == points.size() );
 
+		// points are unprojected from screen. so there's small error
+		constexpr auto epsilon = 0.01f;
+		auto offset = points[0] - m_lightVertices[0].position;
+		auto isMoved = true;
+
 		for ( size_t i{}; i < points.size(); ++i ) {
+			auto difference = points[i] - m_lightVertices[i].position - offset;
+			isMoved = isMoved && fabs( difference.x ) < epsilon && fabs( difference.y ) < epsilon;
+
 			m_lightVertices[i].position = points[i];
 		}
 
-		auto memorySize = static_cast<UINT>( m_lightVertices.size() * sizeof( Vertices::value_type ) );
-		CopyToMemory( m_pLightVertexBuffer, m_lightVertices.data(), memorySize );
+		m_triangulator.Build( GetTriangulatorPoints( m_lightVertices ) );
+
+		if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
+			ASSERT( FALSE );
 
-		if ( FAILED( UpdateBlurMask( pDevice, m_lightVertices ) ) ) {
 			return E_FAIL;
 		}
 
-		m_linePointsCaches.clear();
+		// mask is same. it is moved only
+		if ( isMoved ) {
+			MoveBlurMask( offset.x, offset.y );
+
+			auto& bounds = m_blurMaskDirty.m_bounds;
+			bounds = { bounds.left + offset.x, bounds.top + offset.y, bounds.right + offset.x, bounds.bottom + offset.y };
+			m_isBlurMaskMoved = true;
+		}
+		else {
+			SetBlurMaskDirty( nullptr );
+		}
+
+		m_isChanged = true;
 
 		return S_OK;
 	}
 
+	void _MutableLightImpl::SetBlurMaskDirty( const Bounds* pDirtyBounds )
+	{
+		auto& dirty = m_blurMaskDirty;
+
+		if ( !pDirtyBounds ) {
+			dirty.m_isEntire = true;
+		}
+		else if ( !dirty.m_isDirty ) {
+			dirty.m_bounds = *pDirtyBounds;
+		}
+		else {
+			dirty.m_bounds.left = min( dirty.m_bounds.left, pDirtyBounds->left );
+			dirty.m_bounds.top = min( dirty.m_bounds.top, pDirtyBounds->top );
+			dirty.m_bounds.right = max( dirty.m_bounds.right, pDirtyBounds->right );
+			dirty.m_bounds.bottom = max( dirty.m_bounds.bottom, pDirtyBounds->bottom );
+		}
+
+		dirty.m_isDirty = true;
+	}
+
+	HRESULT _MutableLightImpl::UpdateDirtyBlurMask( LPDIRECT3DDEVICE9 pDevice, _RenderStateCache& stateCache )
+	{
+		auto isNoEditing = std::none_of( std::cbegin( m_vertexEditingStates ), std::cend( m_vertexEditingStates ), []( bool v ) { return v; } );
+
+		// dragging is finished
+		if ( isNoEditing ) {
+			if ( m_isCenterDirty ) {
+				Points points;
+				// exclude first value which is origin
+				std::transform( std::next( std::cbegin( m_lightVertices ) ), std::cend( m_lightVertices ), std::back_inserter( points ), []( auto& v ) { return v.position; } );
+
+				m_lightVertices[0].position = GetCenterPoint( points.begin(), points.end() );
+				m_triangulator.Move( 0, { m_lightVertices[0].position.x, m_lightVertices[0].position.y } );
+
+				if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
+					return E_FAIL;
+				}
+
+				SetBlurMaskDirty( nullptr );
+			}
+			else if ( m_isBlurMaskMoved ) {
+				SetBlurMaskDirty( nullptr );
+			}
+
+			m_isCenterDirty = false;
+			m_isBlurMaskMoved = false;
+		}
+
+		if ( !m_blurMaskDirty.m_isDirty ) {
+			return S_OK;
+		}
+
+		auto dirty = m_blurMaskDirty;
+		m_blurMaskDirty = {};
+
+		auto memorySize = static_cast<UINT>( m_lightVertices.size() * sizeof( Vertices::value_type ) );
+
+		if ( FAILED( CopyToMemory( m_pLightVertexBuffer, m_lightVertices.data(), memorySize ) ) ) {
+			return E_FAIL;
+		}
+
+		return UpdateBlurMask( stateCache, m_lightVertices, dirty.m_isEntire ? nullptr : &dirty.m_bounds );
+	}
+
 	HRESULT _MutableLightImpl::AddLightVertex( LPDIRECT3DDEVICE9 pDevice, size_t index, const D3DXVECTOR3& position )
 	{
 		if ( m_lightVertices.size() < index ) {
@@ -95,13 +194,23 @@ namespace FreeformLight
 
 			return E_FAIL;
 		}
-		else if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, points.size() ) ) ) {
+
+		// triangle having the edge is divided only if it is fan
+		m_triangulator.Insert( index, { position.x, position.y } );
+
+		if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
 			ASSERT( FALSE );
 
 			return E_FAIL;
 		}
 
+		// area is same. but other triangulation changes gradient
+		if ( !m_triangulator.IsFan() ) {
+			SetBlurMaskDirty( nullptr );
+		}
+
 		ClearEditingStates( points.size() );
+		m_isChanged = true;
 
 		return S_OK;
 	}
@@ -121,7 +230,11 @@ namespace FreeformLight
 
 			return E_FAIL;
 		}
-		else if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, points.size() ) ) ) {
+
+		m_triangulator.Remove( index );
+		m_triangulator.Move( 0, { points[0].x, points[0].y } );
+
+		if ( FAILED( UpdateLightIndexBuffer( &m_pLightIndexBuffer, m_lightIndices, pDevice, m_triangulator.GetIndices() ) ) ) {
 			ASSERT( FALSE );
 
 			return E_FAIL;
@@ -134,35 +247,45 @@ namespace FreeformLight
 
 		ClearEditingStates( points.size() );
 
-		m_linePointsCaches.clear();
+		m_isChanged = true;
 
 		return S_OK;
 	}
 
-	bool _MutableLightImpl::IsInsidePolygon( const Points& linePoints, const D3DXVECTOR3& point ) const
+	void _MutableLightImpl::UpdatePolygonGrid( const Points& projectedPoints )
 	{
-		// crosses is quantity of between point q and half line on the right and polygon
-		auto crosses = 0;
-		auto y = point.y;
-
-		for ( size_t index = 0; index < linePoints.size(); ++index ) {
-			auto nextIndex = ( index + 1 ) % linePoints.size();
-			auto& p0 = linePoints[index];
-			auto& p1 = linePoints[nextIndex];
-
-			// point B is between y coord of p[i] and one of p[j]
-			if ( ( p0.y > y ) != ( p1.y > y ) ) {
-				// atX is crossed point between vertical line that is over point B and line (p[i], p[j])
-				auto at = ( p1.x - p0.x ) * ( y - p0.y ) / ( p1.y - p0.y ) + p0.x;
-
-				// if atX is crossed with half line on the right-side, increase counter of it
-				if ( point.x < at ) {
-					++crosses;
-				}
+		// center isn't part of border
+		auto build = [this, &projectedPoints]() {
+			_PolygonGrid::Points points;
+			std::transform( std::cbegin( projectedPoints ), std::cend( projectedPoints ), std::back_inserter( points ), []( auto& p ) { return _PolygonGrid::Point{ p.x, p.y }; } );
+
+			m_polygonGrid.Build( points, 1 );
+		};
+
+		if ( m_polygonGrid.GetPointCount() != projectedPoints.size() ) {
+			build();
+			return;
+		}
+
+		std::vector<size_t> movedIndices;
+
+		for ( size_t i{}; i < projectedPoints.size(); ++i ) {
+			auto& point = m_polygonGrid.GetPoint( i );
+
+			if ( point.x != projectedPoints[i].x || point.y != projectedPoints[i].y ) {
+				movedIndices.push_back( i );
 			}
 		}
 
-		return crosses % 2 > 0;
+		// view is changed. building is cheaper than moving all
+		if ( movedIndices.size() * 2 > projectedPoints.size() ) {
+			build();
+			return;
+		}
+
+		for ( auto i : movedIndices ) {
+			m_polygonGrid.Move( i, { projectedPoints[i].x, projectedPoints[i].y } );
+		}
 	}
 
 	// get cross point between inputed two lines and y axis
@@ -248,30 +371,18 @@ namespace FreeformLight
 		return center;
 	}
 
-	HRESULT _MutableLightImpl::Draw( LPDIRECT3DDEVICE9 pDevice )
+	HRESULT _MutableLightImpl::Update( LPDIRECT3DDEVICE9 pDevice, _RenderStateCache& stateCache )
 	{
-#ifdef DEBUG_BLUR_MASK
-		DWORD oldBlendOp{};
-		pDevice->GetRenderState( D3DRS_BLENDOP, &oldBlendOp );
-		DWORD oldSrcBlend{};
-		pDevice->GetRenderState( D3DRS_SRCBLEND, &oldSrcBlend );
-		DWORD oldDestBlend{};
-		pDevice->GetRenderState( D3DRS_DESTBLEND, &oldDestBlend );
-
-		pDevice->SetRenderState( D3DRS_BLENDOP, D3DBLENDOP_ADD );
-		pDevice->SetRenderState( D3DRS_SRCBLEND, D3DBLEND_ONE );
-		pDevice->SetRenderState( D3DRS_DESTBLEND, D3DBLEND_ZERO );
-#endif
+		// edits of this frame are applied at once
+		if ( FAILED( UpdateDirtyBlurMask( pDevice, stateCache ) ) ) {
+			ASSERT( FALSE );
 
-		auto result = _ImmutableLightImpl::Draw( pDevice );
+			return E_FAIL;
+		}
 
-#ifdef DEBUG_BLUR_MASK
-		pDevice->SetRenderState( D3DRS_BLENDOP, oldBlendOp );
-		pDevice->SetRenderState( D3DRS_SRCBLEND, oldSrcBlend );
-		pDevice->SetRenderState( D3DRS_DESTBLEND, oldDestBlend );
-#endif
+		m_isChanged = false;
 
-		return result;
+		return S_OK;
 	}
 
 	HRESULT _MutableLightImpl::DrawHelper( LPDIRECT3DDEVICE9 pDevice, D3DDISPLAYMODE const& displayMode, char const* windowTitleName )
@@ -305,12 +416,33 @@ namespace FreeformLight
 		_MutableLightImpl::Points projectedPoints;
 		std::transform( std::begin( m_lightVertices ), std::end( m_lightVertices ), std::back_inserter( projectedPoints ), projectToScreen );
 
+		UpdatePolygonGrid( projectedPoints );
+
+		auto drawList = ImGui::GetBackgroundDrawList();
+		auto mousePos = ImGui::GetMousePos();
+
+		// window is made for the vertex under cursor or editing one. the others are drawn like window but they're not windows
+		constexpr auto vertexRadius = 32.f;
+		auto hoveredIndex = projectedPoints.size();
+		m_polygonGrid.FindPoint( { mousePos.x, mousePos.y }, vertexRadius, &hoveredIndex );
+
 		// draw movable buttons. they're floating windows originally
 		for ( size_t i = 0; i < projectedPoints.size(); ++i ) {
-			auto index = m_lightIndices[i];
+			auto index = static_cast<WORD>( i );
 			auto& projectedPoint = projectedPoints[index];
 			auto name = std::to_string( i );
 
+			if ( i != hoveredIndex && !m_vertexEditingStates[i] ) {
+				auto& style = ImGui::GetStyle();
+				auto textSize = ImGui::CalcTextSize( name.c_str() );
+				ImVec2 leftTop{ projectedPoint.x, projectedPoint.y };
+				ImVec2 rightBottom{ leftTop.x + textSize.x + style.FramePadding.x * 2, leftTop.y + ImGui::GetFrameHeight() };
+
+				drawList->AddRectFilled( leftTop, rightBottom, ImGui::GetColorU32( ImGuiCol_TitleBg ) );
+				drawList->AddText( { leftTop.x + style.FramePadding.x, leftTop.y + style.FramePadding.y }, ImGui::GetColorU32( ImGuiCol_Text ), name.c_str() );
+				continue;
+			}
+
 			// draw button
 			// create floating window then change it immovable. if it is selected, change it movable. if not it can move slightly with floating-error.
 			{
@@ -369,6 +501,8 @@ namespace FreeformLight
 
 				// remove the vertex
 				if ( noPointDeleted && !*noPointDeleted ) {
+					m_polygonGrid.Remove( i );
+
 					if ( FAILED( RemoveLightVertex( pDevice, i ) ) ) {
 						ASSERT( FALSE );
 
@@ -382,96 +516,74 @@ namespace FreeformLight
 
 		// draw lines
 		{
-			auto drawList = ImGui::GetBackgroundDrawList();
-			auto hasNoCrossPoint = true;
 			auto isNoEditing = std::none_of( std::cbegin( m_vertexEditingStates ), std::cend( m_vertexEditingStates ), []( bool v ) { return v == true; } );
 
-			D3DXMATRIX rotationMatrix{};
-			D3DXMatrixRotationZ( &rotationMatrix, D3DXToRadian( 90 ) );
+			// border goes back to first one
+			auto getNextIndex = [count = projectedPoints.size()]( size_t index ) { return index + 1 == count ? 1 : index + 1; };
 
-			for ( size_t lightIndex = 2; lightIndex < m_lightIndices.size(); ++lightIndex ) {
-				auto i0 = m_lightIndices[lightIndex - 1];
-				auto i1 = m_lightIndices[lightIndex];
-				auto& from = projectedPoints[i0];
-				auto& to = projectedPoints[i1];
+			for ( size_t i = 1; i < projectedPoints.size(); ++i ) {
+				auto& from = projectedPoints[i];
+				auto& to = projectedPoints[getNextIndex( i )];
 
 				drawList->AddLine( { from.x, from.y }, { to.x, to.y }, IM_COL32_WHITE, 2 );
+			}
 
-				// draw rectangle over the line. it uses for detecting of mouse cursor position
-				if ( isNoEditing && hasNoCrossPoint && mouseHoveringNoWindow )
-				{
-					const PointCacheKey cacheKey{ i0, i1 };
-					auto iterator = m_linePointsCaches.find( cacheKey );
-
-					if ( std::cend( m_linePointsCaches ) == iterator ) {
-						auto direction = to - from;
-						D3DXVec3Normalize( &direction, &direction );
-
-						D3DXVECTOR4 rotatedDirection{};
-						D3DXVec3Transform( &rotatedDirection, &direction, &rotationMatrix );
-
-						auto offset = 30.f;
-						auto directionOffset = direction * offset;
-						auto _from = from + directionOffset;
-						auto _to = to - directionOffset;
-
-						auto width = 10.f;
-						auto xBias = D3DXVECTOR3{ rotatedDirection.x, rotatedDirection.y,{} } * width;
-						auto p0 = _from + xBias;
-						auto p1 = _from - xBias;
-						auto p2 = _to - xBias;
-						auto p3 = _to + xBias;
-
-						auto cache = Cache{ { p0, p1, p2, p3 }, std::move( _from ), std::move( _to ) };
-						iterator = m_linePointsCaches.emplace_hint( iterator, cacheKey, std::move( cache ) );
-					}
+			// area over the line is used for detecting of mouse cursor position. it is cut by the offset at both ends
+			constexpr auto offset = 30.f;
+			constexpr auto width = 10.f;
+			size_t edgeIndex{};
+
+			if ( isNoEditing && mouseHoveringNoWindow && m_polygonGrid.FindEdge( { mousePos.x, mousePos.y }, width, offset, &edgeIndex ) ) {
+				// edge starts at the vertex. new vertex is put after it
+				auto lightIndex = edgeIndex + 1;
+				auto& from = projectedPoints[edgeIndex];
+				auto& to = projectedPoints[getNextIndex( edgeIndex )];
 
-					Cache const& cache{ iterator->second };
-					auto mousePos = ImGui::GetMousePos();
+				auto direction = to - from;
+				D3DXVec3Normalize( &direction, &direction );
 
-					if ( IsInsidePolygon( cache.m_points, { mousePos.x, mousePos.y,{} } ) ) {
-						hasNoCrossPoint = false;
+				auto directionOffset = direction * offset;
+				auto _from = from + directionOffset;
+				auto _to = to - directionOffset;
 
-						D3DXVECTOR3 crossPoint{};
-						auto const& _from = cache.m_from;
-						auto const& _to = cache.m_to;
+				D3DXVECTOR3 crossPoint{};
 
-						if ( GetCrossPoint( crossPoint, _from, _to, { mousePos.x, mousePos.y }, displayMode ) ) {
+				if ( GetCrossPoint( crossPoint, _from, _to, { mousePos.x, mousePos.y }, displayMode ) ) {
 #ifdef DEBUG_LINE
-							drawList->AddCircle( { crossPoint.x, crossPoint.y }, 50, IM_COL32( 0, 255, 0, 255 ) );
+					drawList->AddCircle( { crossPoint.x, crossPoint.y }, 50, IM_COL32( 0, 255, 0, 255 ) );
 #endif
-							constexpr auto controlOffset = -10.f;
+					constexpr auto controlOffset = -10.f;
 
-							ImGui::SetNextWindowPos( { mousePos.x + controlOffset, mousePos.y + controlOffset } );
-							ImGui::Begin( ".", nullptr, ImGuiWindowFlags_NoDecoration );
-							auto pushed = ImGui::Button( "o" );
-							ImGui::End();
+					ImGui::SetNextWindowPos( { mousePos.x + controlOffset, mousePos.y + controlOffset } );
+					ImGui::Begin( ".", nullptr, ImGuiWindowFlags_NoDecoration );
+					auto pushed = ImGui::Button( "o" );
+					ImGui::End();
 
-							if ( pushed ) {
-								D3DXVec3Unproject( &crossPoint, &crossPoint, &viewport, &projection, &view, &world );
-								AddLightVertex( pDevice, lightIndex, crossPoint );
-								return S_OK;
-							}
-						}
+					if ( pushed ) {
+						// grid is updated here because screen position is known
+						m_polygonGrid.Insert( lightIndex, { crossPoint.x, crossPoint.y } );
+
+						D3DXVec3Unproject( &crossPoint, &crossPoint, &viewport, &projection, &view, &world );
+						AddLightVertex( pDevice, lightIndex, crossPoint );
+						return S_OK;
 					}
+				}
 
 #ifdef DEBUG_LINE
-					// draw area
-					{
-						auto debugColor = IM_COL32( 0, 255, 0, 255 );
-						auto thickness = 1.f;
-						auto& points = cache.m_points;
-
-						for ( size_t pointIndex{}; pointIndex < points.size(); ++pointIndex ) {
-							auto& pp0 = points[pointIndex];
-							auto nextIndex = ( pointIndex + 1 ) % points.size();
-							auto& pp1 = points[nextIndex];
-
-							drawList->AddLine( { pp0.x, pp0.y }, { pp1.x, pp1.y }, debugColor, thickness );
-						}
+				// draw area
+				{
+					D3DXVECTOR3 normal{ -direction.y, direction.x, 0.f };
+					auto bias = normal * width;
+					const D3DXVECTOR3 points[] = { _from + bias, _from - bias, _to - bias, _to + bias };
+
+					for ( size_t pointIndex{}; pointIndex < _countof( points ); ++pointIndex ) {
+						auto& pp0 = points[pointIndex];
+						auto& pp1 = points[( pointIndex + 1 ) % _countof( points )];
+
+						drawList->AddLine( { pp0.x, pp0.y }, { pp1.x, pp1.y }, IM_COL32( 0, 255, 0, 255 ), 1.f );
 					}
-#endif
 				}
+#endif
 			}
 		}
 
@@ -482,13 +594,17 @@ namespace FreeformLight
 	{
 		bool blurMaskUpdating{};
 
-		// modify texture
+		// swap texture. mask is same if the texture is same
 		if ( m_pLightTexture && ( m_setting.lightColor != setting.lightColor || m_setting.intensity != setting.intensity ) ) {
-			SAFE_RELEASE( m_pLightTexture );
+			auto result = UpdateLightTexture( pDevice, setting );
+
+			if ( FAILED( result ) ) {
+				ASSERT( FALSE );
 
-			CreateLightTextureByLockRect( pDevice, &m_pLightTexture, setting );
+				return E_FAIL;
+			}
 
-			blurMaskUpdating = true;
+			blurMaskUpdating = ( result == S_OK );
 		}
 
 		// modify UV
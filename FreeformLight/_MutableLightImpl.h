@@ -1,6 +1,6 @@
 #pragma once
-#include <map>
 #include "_ImmutableLightImpl.h"
+#include "_PolygonGrid.h"
 
 
 namespace FreeformLight
@@ -19,24 +19,34 @@ namespace FreeformLight
 		};
 
 	public:
-		_MutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, Points const& );
+		_MutableLightImpl( LPDIRECT3DDEVICE9 pDevice, LPDIRECT3DPIXELSHADER9 pBlurShader, std::shared_ptr<_MaskAtlasTexture>, std::shared_ptr<_GradientTextureCache>, Points const& );
 		virtual ~_MutableLightImpl() {}
 
 		HRESULT SetSetting( LPDIRECT3DDEVICE9, const Setting& );
 		inline const Setting& GetSetting() const { return m_setting; }
 
-		virtual HRESULT Draw( LPDIRECT3DDEVICE9 ) override final;
+		// mask is drawn again if it is edited. it is called before quad of it is added to batch
+		HRESULT Update( LPDIRECT3DDEVICE9, _RenderStateCache& );
 		HRESULT DrawHelper( LPDIRECT3DDEVICE9, D3DDISPLAYMODE const&, char const* windowTitleName );
 
+		// it is true until it is drawn after editing
+		inline bool IsChanged() const { return m_isChanged || m_blurMaskDirty.m_isDirty || m_isCenterDirty || m_isBlurMaskMoved; }
+		// changed one is drawn always. mask is updated at Update()
+		inline bool IsVisible( const Bounds& viewBounds ) const { return IsChanged() || _ImmutableLightImpl::IsVisible( viewBounds ); }
+
 	private:
 		HRESULT UpdateLight( LPDIRECT3DDEVICE9, const Setting& );
 
+		// mask isn't drawn here. it is drawn once per frame at Update()
 		HRESULT UpdateLightVertex( LPDIRECT3DDEVICE9, WORD index, const D3DXVECTOR3& position );
 		HRESULT UpdateLightVertex( LPDIRECT3DDEVICE9, const Points& );
+		void SetBlurMaskDirty( const Bounds* pDirtyBounds );
+		HRESULT UpdateDirtyBlurMask( LPDIRECT3DDEVICE9, _RenderStateCache& );
 		HRESULT AddLightVertex( LPDIRECT3DDEVICE9, size_t index, const D3DXVECTOR3& position );
 		HRESULT RemoveLightVertex( LPDIRECT3DDEVICE9, size_t index );
 
-		bool IsInsidePolygon( const Points&, const D3DXVECTOR3& point ) const;
+		// grid follows projected vertices. moved ones are updated only
+		void UpdatePolygonGrid( const Points& projectedPoints );
 
 		static bool GetCrossPoint( D3DXVECTOR3& out, D3DXVECTOR3 p0, D3DXVECTOR3 p1, const D3DXVECTOR2& mousePosition, D3DDISPLAYMODE const& );
 
@@ -54,25 +64,21 @@ namespace FreeformLight
 
 		std::vector<bool> m_vertexEditingStates;
 
-		using PointCacheKey = std::pair<size_t, size_t>;
-
-		template<class POINTS, class VECTOR>
-		struct _Cache {
-			const POINTS m_points;
-			const VECTOR m_from{};
-			const VECTOR m_to{};
-
-			_Cache() = default;
-			_Cache( _Cache const& ) = delete;
-
-			_Cache( POINTS&& points, VECTOR&& from, VECTOR&& to ) : m_points{ std::forward<POINTS>( points ) }, m_from{ std::forward<VECTOR>( from ) }, m_to{ std::forward<VECTOR>( to ) }
-			{}
-
-			_Cache( _Cache&& c ) : m_points{ std::move( c.m_points ) }, m_from{ c.m_from }, m_to{ c.m_to }
-			{}
-		};
-		using Cache = _Cache<typename _MutableLightImpl::Points, D3DXVECTOR3>;
-		using LinePointsCaches = std::map<PointCacheKey, Cache>;
-		LinePointsCaches m_linePointsCaches;
+		// edits of a frame are gathered. mask is drawn for the dirty area only if it can
+		struct BlurMaskDirty
+		{
+			bool m_isDirty;
+			bool m_isEntire;
+			Bounds m_bounds;
+		}
+		m_blurMaskDirty{};
+
+		// they're deferred until dragging is finished. center follows border vertices and moved mask is drawn again to remove error
+		bool m_isCenterDirty{};
+		bool m_isBlurMaskMoved{};
+		bool m_isChanged = true;
+
+		// projected vertices in screen coordinate. border vertices are joined by edges
+		_PolygonGrid m_polygonGrid;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "_PolygonGrid.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+namespace FreeformLight
+{
+	_PolygonGrid::_PolygonGrid( float cellSize ) : m_cellSize{ cellSize }
+	{}
+
+	void _PolygonGrid::Build( const Points& points, size_t loopBegin )
+	{
+		m_loopBegin = loopBegin;
+		m_points = points;
+		m_order.resize( points.size() );
+		m_indices.resize( points.size() );
+		m_freeIds.clear();
+		m_pointCells.clear();
+		m_edgeCells.clear();
+
+		for ( size_t i{}; i < points.size(); ++i ) {
+			m_order[i] = static_cast<Id>( i );
+			m_indices[i] = i;
+
+			AddPoint( m_order[i] );
+		}
+
+		if ( HasEdge() ) {
+			for ( auto i = m_loopBegin; i < m_order.size(); ++i ) {
+				AddEdge( m_order[i], m_order[GetNextIndex( i )] );
+			}
+		}
+	}
+
+	void _PolygonGrid::Insert( size_t index, const Point& point )
+	{
+		if ( !IsLoop( index ) || index > m_order.size() ) {
+			return;
+		}
+
+		// polygon is made at third point. it is built again
+		if ( !HasEdge() ) {
+			Points points;
+
+			for ( auto id : m_order ) {
+				points.push_back( m_points[id] );
+			}
+
+			points.insert( points.begin() + index, point );
+			Build( points, m_loopBegin );
+			return;
+		}
+
+		auto prev = m_order[index == m_loopBegin ? m_order.size() - 1 : index - 1];
+		auto next = m_order[index == m_order.size() ? m_loopBegin : index];
+		Id id{};
+
+		if ( m_freeIds.empty() ) {
+			id = static_cast<Id>( m_points.size() );
+			m_points.push_back( point );
+			m_indices.push_back( index );
+		}
+		else {
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+			m_points[id] = point;
+		}
+
+		RemoveEdge( prev, next );
+
+		m_order.insert( m_order.begin() + index, id );
+		UpdateIndices( index );
+
+		AddPoint( id );
+		AddEdge( prev, id );
+		AddEdge( id, next );
+	}
+
+	void _PolygonGrid::Move( size_t index, const Point& point )
+	{
+		if ( index >= m_order.size() ) {
+			return;
+		}
+
+		auto id = m_order[index];
+		auto hasEdge = IsLoop( index ) && HasEdge();
+		Id prev{};
+		Id next{};
+
+		if ( hasEdge ) {
+			prev = m_order[GetPrevIndex( index )];
+			next = m_order[GetNextIndex( index )];
+
+			RemoveEdge( prev, id );
+			RemoveEdge( id, next );
+		}
+
+		RemovePoint( id );
+		m_points[id] = point;
+		AddPoint( id );
+
+		if ( hasEdge ) {
+			AddEdge( prev, id );
+			AddEdge( id, next );
+		}
+	}
+
+	void _PolygonGrid::Remove( size_t index )
+	{
+		if ( !IsLoop( index ) || index >= m_order.size() ) {
+			return;
+		}
+
+		// it isn't polygon anymore. it is built again
+		if ( m_order.size() <= m_loopBegin + 3 ) {
+			Points points;
+
+			for ( auto id : m_order ) {
+				points.push_back( m_points[id] );
+			}
+
+			points.erase( points.begin() + index );
+			Build( points, m_loopBegin );
+			return;
+		}
+
+		auto id = m_order[index];
+		auto prev = m_order[GetPrevIndex( index )];
+		auto next = m_order[GetNextIndex( index )];
+
+		RemoveEdge( prev, id );
+		RemoveEdge( id, next );
+		RemovePoint( id );
+
+		m_order.erase( m_order.begin() + index );
+		m_freeIds.push_back( id );
+		UpdateIndices( index );
+
+		AddEdge( prev, next );
+	}
+
+	bool _PolygonGrid::FindPoint( const Point& point, float radius, size_t* pIndex ) const
+	{
+		auto nearestDistance = radius * radius;
+		auto isFound = false;
+
+		ForEachCell( point, radius, [&]( uint64_t key ) {
+			auto iterator = m_pointCells.find( key );
+
+			if ( iterator == m_pointCells.end() ) {
+				return;
+			}
+
+			for ( auto id : iterator->second ) {
+				auto& p = m_points[id];
+				auto dx = p.x - point.x;
+				auto dy = p.y - point.y;
+				auto distance = dx * dx + dy * dy;
+
+				if ( distance <= nearestDistance ) {
+					nearestDistance = distance;
+					*pIndex = m_indices[id];
+					isFound = true;
+				}
+			}
+		} );
+
+		return isFound;
+	}
+
+	bool _PolygonGrid::FindEdge( const Point& point, float width, float endOffset, size_t* pIndex ) const
+	{
+		auto nearestDistance = width;
+		auto isFound = false;
+
+		ForEachCell( point, width, [&]( uint64_t key ) {
+			auto iterator = m_edgeCells.find( key );
+
+			if ( iterator == m_edgeCells.end() ) {
+				return;
+			}
+
+			for ( auto id : iterator->second ) {
+				auto index = m_indices[id];
+				auto& from = m_points[id];
+				auto& to = m_points[m_order[GetNextIndex( index )]];
+				auto dx = to.x - from.x;
+				auto dy = to.y - from.y;
+				auto length = std::sqrt( dx * dx + dy * dy );
+
+				if ( length <= endOffset * 2 ) {
+					continue;
+				}
+
+				// distance along the edge and across it
+				auto px = point.x - from.x;
+				auto py = point.y - from.y;
+				auto along = ( px * dx + py * dy ) / length;
+				auto across = std::fabs( px * dy - py * dx ) / length;
+
+				if ( along < endOffset || along > length - endOffset || across > nearestDistance ) {
+					continue;
+				}
+
+				nearestDistance = across;
+				*pIndex = index;
+				isFound = true;
+			}
+		} );
+
+		return isFound;
+	}
+
+	int _PolygonGrid::ToCell( float value ) const
+	{
+		return static_cast<int>( std::floor( value / m_cellSize ) );
+	}
+
+	// cells are visited along the line. step is made on the axis whose border is closer
+	template<typename FUNCTION>
+	void _PolygonGrid::ForEachCell( const Point& from, const Point& to, FUNCTION function ) const
+	{
+		auto x = ToCell( from.x );
+		auto y = ToCell( from.y );
+		auto endX = ToCell( to.x );
+		auto endY = ToCell( to.y );
+		auto dx = to.x - from.x;
+		auto dy = to.y - from.y;
+		auto stepX = ( endX > x ? 1 : -1 );
+		auto stepY = ( endY > y ? 1 : -1 );
+
+		auto tMaxX = ( dx ? ( ( stepX > 0 ? x + 1 : x ) * m_cellSize - from.x ) / dx : FLT_MAX );
+		auto tMaxY = ( dy ? ( ( stepY > 0 ? y + 1 : y ) * m_cellSize - from.y ) / dy : FLT_MAX );
+		auto tDeltaX = ( dx ? m_cellSize / std::fabs( dx ) : FLT_MAX );
+		auto tDeltaY = ( dy ? m_cellSize / std::fabs( dy ) : FLT_MAX );
+
+		function( GetCellKey( x, y ) );
+
+		// count of steps is fixed. so rounding error can't make it endless
+		for ( auto stepCount = std::abs( endX - x ) + std::abs( endY - y ); stepCount > 0; --stepCount ) {
+			if ( y == endY || ( x != endX && tMaxX < tMaxY ) ) {
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else {
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+
+			function( GetCellKey( x, y ) );
+		}
+	}
+
+	template<typename FUNCTION>
+	void _PolygonGrid::ForEachCell( const Point& point, float radius, FUNCTION function ) const
+	{
+		auto left = ToCell( point.x - radius );
+		auto top = ToCell( point.y - radius );
+		auto right = ToCell( point.x + radius );
+		auto bottom = ToCell( point.y + radius );
+
+		for ( auto y = top; y <= bottom; ++y ) {
+			for ( auto x = left; x <= right; ++x ) {
+				function( GetCellKey( x, y ) );
+			}
+		}
+	}
+
+	void _PolygonGrid::AddPoint( Id id )
+	{
+		auto& point = m_points[id];
+
+		m_pointCells[GetCellKey( ToCell( point.x ), ToCell( point.y ) )].push_back( id );
+	}
+
+	void _PolygonGrid::RemovePoint( Id id )
+	{
+		auto& point = m_points[id];
+
+		Erase( m_pointCells, GetCellKey( ToCell( point.x ), ToCell( point.y ) ), id );
+	}
+
+	void _PolygonGrid::AddEdge( Id id, Id next )
+	{
+		ForEachCell( m_points[id], m_points[next], [this, id]( uint64_t key ) {
+			m_edgeCells[key].push_back( id );
+		} );
+	}
+
+	void _PolygonGrid::RemoveEdge( Id id, Id next )
+	{
+		ForEachCell( m_points[id], m_points[next], [this, id]( uint64_t key ) {
+			Erase( m_edgeCells, key, id );
+		} );
+	}
+
+	size_t _PolygonGrid::GetPrevIndex( size_t index ) const
+	{
+		return index == m_loopBegin ? m_order.size() - 1 : index - 1;
+	}
+
+	size_t _PolygonGrid::GetNextIndex( size_t index ) const
+	{
+		return index + 1 == m_order.size() ? m_loopBegin : index + 1;
+	}
+
+	void _PolygonGrid::UpdateIndices( size_t begin )
+	{
+		for ( auto i = begin; i < m_order.size(); ++i ) {
+			m_indices[m_order[i]] = i;
+		}
+	}
+
+	void _PolygonGrid::Erase( Cells& cells, uint64_t key, Id id )
+	{
+		auto iterator = cells.find( key );
+
+		if ( iterator == cells.end() ) {
+			return;
+		}
+
+		auto& ids = iterator->second;
+		auto position = std::find( ids.begin(), ids.end(), id );
+
+		if ( position != ids.end() ) {
+			*position = ids.back();
+			ids.pop_back();
+		}
+
+		if ( ids.empty() ) {
+			cells.erase( iterator );
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+ * uniform grid of polygon for hit test of cursor. it is used by _MutableLightImpl::DrawHelper()
+ *
+ * points before loop begin are vertices only. the others are joined by edges in order and the last one is joined to the first
+ * each edge is kept in cells which it passes through. so a query visits cells around cursor only
+ * moving a point updates the point and its two edges only
+*/
+namespace FreeformLight
+{
+	class _PolygonGrid
+	{
+	public:
+		struct Point
+		{
+			float x;
+			float y;
+		};
+		using Points = std::vector<Point>;
+
+		explicit _PolygonGrid( float cellSize = 32.f );
+
+		void Build( const Points&, size_t loopBegin );
+		// point is added at index. it should be in loop
+		void Insert( size_t index, const Point& );
+		void Move( size_t index, const Point& );
+		void Remove( size_t index );
+
+		// nearest point in the radius
+		bool FindPoint( const Point&, float radius, size_t* pIndex ) const;
+		// nearest edge in the width. area of both ends by the offset is excluded. index is the one of the point where edge starts
+		bool FindEdge( const Point&, float width, float endOffset, size_t* pIndex ) const;
+
+		inline size_t GetPointCount() const { return m_order.size(); }
+		inline const Point& GetPoint( size_t index ) const { return m_points[m_order[index]]; }
+		inline size_t GetLoopBegin() const { return m_loopBegin; }
+		// cells which aren't empty
+		inline size_t GetCellCount() const { return m_pointCells.size() + m_edgeCells.size(); }
+
+	private:
+		// point is kept by id while its index is changed by insertion
+		using Id = uint32_t;
+		using Cells = std::unordered_map<uint64_t, std::vector<Id>>;
+
+		inline int ToCell( float value ) const;
+		inline uint64_t GetCellKey( int x, int y ) const { return static_cast<uint64_t>( static_cast<uint32_t>( x ) ) << 32 | static_cast<uint32_t>( y ); }
+
+		template<typename FUNCTION>
+		void ForEachCell( const Point& from, const Point& to, FUNCTION ) const;
+		template<typename FUNCTION>
+		void ForEachCell( const Point&, float radius, FUNCTION ) const;
+
+		void AddPoint( Id );
+		void RemovePoint( Id );
+		// edge of id goes to next one of the loop
+		void AddEdge( Id, Id next );
+		void RemoveEdge( Id, Id next );
+
+		size_t GetPrevIndex( size_t index ) const;
+		size_t GetNextIndex( size_t index ) const;
+		inline bool IsLoop( size_t index ) const { return index >= m_loopBegin; }
+		inline bool HasEdge() const { return m_order.size() >= m_loopBegin + 3; }
+		void UpdateIndices( size_t begin );
+
+		static void Erase( Cells&, uint64_t key, Id );
+
+	private:
+		float m_cellSize{};
+		size_t m_loopBegin{};
+
+		// position of id
+		Points m_points;
+		// ids in order of polygon
+		std::vector<Id> m_order;
+		// index of id
+		std::vector<size_t> m_indices;
+		std::vector<Id> m_freeIds;
+
+		Cells m_pointCells;
+		Cells m_edgeCells;
+	};
+}
@@ -0,0 +1,309 @@
+#include "_PolygonTriangulator.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		constexpr float pi = 3.14159265f;
+
+		inline uint32_t GetEdgeKey( uint32_t from, uint32_t to ) { return from << 16 | to; }
+	}
+
+	void _PolygonTriangulator::Build( const Points& points )
+	{
+		m_points = points;
+
+		Triangulate();
+	}
+
+	void _PolygonTriangulator::Insert( size_t index, const Point& point )
+	{
+		if ( !index || index > m_points.size() ) {
+			return;
+		}
+
+		m_points.insert( m_points.begin() + index, point );
+
+		// the triangle which the point is put on is divided only
+		if ( m_isFan && IsFanTriangle( GetPrev( index ) ) && IsFanTriangle( index ) ) {
+			MakeFan();
+		}
+		else {
+			Triangulate();
+		}
+	}
+
+	void _PolygonTriangulator::Remove( size_t index )
+	{
+		if ( !index || index >= m_points.size() ) {
+			return;
+		}
+
+		m_points.erase( m_points.begin() + index );
+
+		auto isFan = m_isFan && m_points.size() > 3;
+
+		if ( isFan ) {
+			auto prev = ( index == 1 ? m_points.size() - 1 : index - 1 );
+			isFan = IsFanTriangle( prev );
+		}
+
+		if ( isFan ) {
+			MakeFan();
+		}
+		else {
+			Triangulate();
+		}
+	}
+
+	void _PolygonTriangulator::Move( size_t index, const Point& point )
+	{
+		if ( index >= m_points.size() ) {
+			return;
+		}
+
+		m_points[index] = point;
+
+		// center changes all triangles
+		if ( index && m_isFan && IsFanTriangle( GetPrev( index ) ) && IsFanTriangle( index ) ) {
+			return;
+		}
+
+		Triangulate();
+	}
+
+	void _PolygonTriangulator::Triangulate()
+	{
+		m_indices.clear();
+		m_isFan = false;
+
+		if ( m_points.size() < 4 ) {
+			return;
+		}
+
+		m_sign = ( GetBorderArea() < 0 ? -1.f : 1.f );
+
+		if ( CanMakeFan() ) {
+			MakeFan();
+			return;
+		}
+
+		std::vector<Index> triangles;
+		ClipEars( triangles );
+
+		// gradient needs center. overlapped fan is drawn as before
+		if ( !InsertCenter( triangles ) ) {
+			MakeFan();
+			m_isFan = false;
+			return;
+		}
+
+		FlipToCenter( triangles );
+
+		m_indices = std::move( triangles );
+	}
+
+	void _PolygonTriangulator::MakeFan()
+	{
+		m_isFan = true;
+		m_indices.clear();
+		m_indices.reserve( ( m_points.size() - 1 ) * 3 );
+
+		for ( size_t i = 1; i < m_points.size(); ++i ) {
+			m_indices.push_back( 0 );
+			m_indices.push_back( static_cast<Index>( i ) );
+			m_indices.push_back( static_cast<Index>( GetNext( i ) ) );
+		}
+	}
+
+	void _PolygonTriangulator::ClipEars( std::vector<Index>& triangles ) const
+	{
+		std::vector<Index> border;
+
+		for ( size_t i = 1; i < m_points.size(); ++i ) {
+			border.push_back( static_cast<Index>( i ) );
+		}
+
+		auto isInside = [this]( size_t i0, size_t i1, size_t i2, size_t i ) {
+			return GetArea( i0, i1, i ) * m_sign >= 0 && GetArea( i1, i2, i ) * m_sign >= 0 && GetArea( i2, i0, i ) * m_sign >= 0;
+		};
+
+		size_t current{};
+		// it is reset when an ear is clipped. border crossing itself has no ear. then convex one is clipped at least
+		size_t missCount{};
+
+		while ( border.size() > 3 ) {
+			auto count = border.size();
+			auto prev = border[( current + count - 1 ) % count];
+			auto vertex = border[current];
+			auto next = border[( current + 1 ) % count];
+			auto isEar = GetArea( prev, vertex, next ) * m_sign > 0;
+
+			for ( size_t i{}; isEar && i < count; ++i ) {
+				auto other = border[i];
+
+				if ( other != prev && other != vertex && other != next && isInside( prev, vertex, next, other ) ) {
+					isEar = false;
+				}
+			}
+
+			if ( isEar || missCount > count * 2 ) {
+				triangles.insert( triangles.end(), { prev, vertex, next } );
+				border.erase( border.begin() + current );
+				current %= border.size();
+				missCount = 0;
+			}
+			else {
+				current = ( current + 1 ) % count;
+				++missCount;
+			}
+		}
+
+		triangles.insert( triangles.end(), { border[0], border[1], border[2] } );
+	}
+
+	bool _PolygonTriangulator::InsertCenter( std::vector<Index>& triangles ) const
+	{
+		for ( size_t i{}; i < triangles.size(); i += 3 ) {
+			auto i0 = triangles[i];
+			auto i1 = triangles[i + 1];
+			auto i2 = triangles[i + 2];
+
+			if ( GetArea( i0, i1, 0 ) * m_sign >= 0 && GetArea( i1, i2, 0 ) * m_sign >= 0 && GetArea( i2, i0, 0 ) * m_sign >= 0 ) {
+				triangles[i] = 0;
+				triangles.insert( triangles.end(), { 0, i1, i2, 0, i2, i0 } );
+				triangles[i + 1] = i0;
+				triangles[i + 2] = i1;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void _PolygonTriangulator::FlipToCenter( std::vector<Index>& triangles ) const
+	{
+		// triangle of directed edge
+		std::unordered_map<uint32_t, size_t> edges;
+
+		auto addEdges = [&edges, &triangles]( size_t triangle ) {
+			auto p = &triangles[triangle * 3];
+
+			edges[GetEdgeKey( p[0], p[1] )] = triangle;
+			edges[GetEdgeKey( p[1], p[2] )] = triangle;
+			edges[GetEdgeKey( p[2], p[0] )] = triangle;
+		};
+		auto removeEdges = [&edges, &triangles]( size_t triangle ) {
+			auto p = &triangles[triangle * 3];
+
+			edges.erase( GetEdgeKey( p[0], p[1] ) );
+			edges.erase( GetEdgeKey( p[1], p[2] ) );
+			edges.erase( GetEdgeKey( p[2], p[0] ) );
+		};
+
+		std::vector<size_t> stack;
+
+		for ( size_t i{}; i < triangles.size() / 3; ++i ) {
+			addEdges( i );
+
+			if ( !triangles[i * 3] ) {
+				stack.push_back( i );
+			}
+		}
+
+		// degree of center grows at each flip. so it ends
+		while ( !stack.empty() ) {
+			auto triangle = stack.back();
+			stack.pop_back();
+
+			auto p = &triangles[triangle * 3];
+			auto a = p[1];
+			auto b = p[2];
+
+			auto iterator = edges.find( GetEdgeKey( b, a ) );
+
+			if ( iterator == edges.end() ) {
+				continue;
+			}
+
+			auto other = iterator->second;
+			auto q = &triangles[other * 3];
+			auto d = static_cast<Index>( q[0] + q[1] + q[2] - a - b );
+
+			// quad isn't convex. or other has center already
+			if ( !d || GetArea( 0, a, d ) * m_sign <= 0 || GetArea( 0, d, b ) * m_sign <= 0 ) {
+				continue;
+			}
+
+			removeEdges( triangle );
+			removeEdges( other );
+
+			p[0] = 0;
+			p[1] = a;
+			p[2] = d;
+			q[0] = 0;
+			q[1] = d;
+			q[2] = b;
+
+			addEdges( triangle );
+			addEdges( other );
+
+			stack.push_back( triangle );
+			stack.push_back( other );
+		}
+	}
+
+	bool _PolygonTriangulator::IsFanTriangle( size_t index ) const
+	{
+		return GetArea( 0, index, GetNext( index ) ) * m_sign > 0;
+	}
+
+	// center sees border if all triangles have same winding and border goes round once
+	bool _PolygonTriangulator::CanMakeFan() const
+	{
+		float angle{};
+
+		for ( size_t i = 1; i < m_points.size(); ++i ) {
+			if ( !IsFanTriangle( i ) ) {
+				return false;
+			}
+
+			auto& center = m_points[0];
+			auto& p0 = m_points[i];
+			auto& p1 = m_points[GetNext( i )];
+			auto cross = ( p0.x - center.x ) * ( p1.y - center.y ) - ( p0.y - center.y ) * ( p1.x - center.x );
+			auto dot = ( p0.x - center.x ) * ( p1.x - center.x ) + ( p0.y - center.y ) * ( p1.y - center.y );
+
+			angle += std::fabs( std::atan2( cross, dot ) );
+		}
+
+		return angle < pi * 3;
+	}
+
+	float _PolygonTriangulator::GetArea( size_t i0, size_t i1, size_t i2 ) const
+	{
+		auto& p0 = m_points[i0];
+		auto& p1 = m_points[i1];
+		auto& p2 = m_points[i2];
+
+		return ( p1.x - p0.x ) * ( p2.y - p0.y ) - ( p1.y - p0.y ) * ( p2.x - p0.x );
+	}
+
+	float _PolygonTriangulator::GetBorderArea() const
+	{
+		float area{};
+
+		for ( size_t i = 1; i < m_points.size(); ++i ) {
+			auto& p0 = m_points[i];
+			auto& p1 = m_points[GetNext( i )];
+
+			area += p0.x * p1.y - p1.x * p0.y;
+		}
+
+		return area;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*
+ * triangle list of freeform light. first point is center and the others are border in order
+ *
+ * it is fan from center when center sees all border. so gradient from center is same as before
+ * or border is clipped by ears and center is inserted to the triangle having it. then edges are flipped to connect center as possible
+ * center out of border can't make gradient. then fan is used though it is overlapped
+ * fan is checked by triangles next to the changed point only. so editing of star shaped polygon doesn't make it again
+*/
+namespace FreeformLight
+{
+	class _PolygonTriangulator
+	{
+	public:
+		struct Point
+		{
+			float x;
+			float y;
+		};
+		using Points = std::vector<Point>;
+		using Index = uint16_t;
+		using Indices = std::vector<Index>;
+
+		void Build( const Points& );
+		void Insert( size_t index, const Point& );
+		void Remove( size_t index );
+		void Move( size_t index, const Point& );
+
+		// every triangle has winding of border
+		inline const Indices& GetIndices() const { return m_indices; }
+		inline const Points& GetPoints() const { return m_points; }
+		// it is true if fan covers border exactly
+		inline bool IsFan() const { return m_isFan; }
+
+	private:
+		void Triangulate();
+		void MakeFan();
+		void ClipEars( std::vector<Index>& triangles ) const;
+		// it is false if center is out of border
+		bool InsertCenter( std::vector<Index>& triangles ) const;
+		void FlipToCenter( std::vector<Index>& triangles ) const;
+
+		// triangle from center to the edge which starts at the index
+		bool IsFanTriangle( size_t index ) const;
+		bool CanMakeFan() const;
+		size_t GetPrev( size_t index ) const { return index == 1 ? m_points.size() - 1 : index - 1; }
+		size_t GetNext( size_t index ) const { return index + 1 == m_points.size() ? 1 : index + 1; }
+
+		// twice of signed area
+		inline float GetArea( size_t i0, size_t i1, size_t i2 ) const;
+		float GetBorderArea() const;
+
+	private:
+		Points m_points;
+		Indices m_indices;
+		// sign of border area
+		float m_sign = 1.f;
+		bool m_isFan{};
+	};
+}
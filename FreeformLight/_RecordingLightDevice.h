@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "_LightDevice.h"
+#include "_RenderStateCache.h"
+
+
+/*
+ * _LightDevice without device. it keeps calls, pages and vertices
+ *
+ * batch could be checked at a machine without d3d. states are set to the cache as _D3D9LightDevice does
+ * texture of a page is a fake pointer. the cache keeps it as value only
+*/
+namespace FreeformLight
+{
+	class _RecordingLightDevice : public _LightDevice
+	{
+	public:
+		enum class CallType
+		{
+			CreatePage,
+			UploadBlocks,
+			UploadVertices,
+			Begin,
+			DrawQuads,
+			End,
+			Invalidate,
+			RestoreDevice,
+		};
+
+		struct Call
+		{
+			CallType type;
+			size_t page{};
+			size_t first{};
+			size_t count{};
+		};
+
+		struct Page
+		{
+			uint32_t width;
+			uint32_t height;
+			std::vector<uint8_t> blocks;
+		};
+
+		virtual bool CreatePage( size_t& outPage, uint32_t width, uint32_t height ) override
+		{
+			if ( !width || !height || width % 4 || height % 4 ) {
+				return false;
+			}
+
+			outPage = m_pages.size();
+			m_pages.push_back( { width, height, std::vector<uint8_t>( static_cast<size_t>( width / 4 ) * ( height / 4 ) * blockSize ) } );
+			m_calls.push_back( { CallType::CreatePage, outPage, width, height } );
+
+			return true;
+		}
+
+		virtual bool UploadBlocks( size_t page, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pBlocks, uint32_t pitch ) override
+		{
+			if ( page >= m_pages.size() || x % 4 || y % 4 || width % 4 || height % 4 ) {
+				return false;
+			}
+
+			auto& target = m_pages[page];
+
+			if ( x + width > target.width || y + height > target.height ) {
+				return false;
+			}
+
+			auto targetPitch = static_cast<size_t>( target.width / 4 ) * blockSize;
+			auto rowSize = static_cast<size_t>( width / 4 ) * blockSize;
+
+			for ( uint32_t row = 0; row < height / 4; ++row ) {
+				auto* pDest = target.blocks.data() + ( y / 4 + row ) * targetPitch + ( x / 4 ) * blockSize;
+				std::copy( pBlocks + row * pitch, pBlocks + row * pitch + rowSize, pDest );
+			}
+
+			m_calls.push_back( { CallType::UploadBlocks, page, static_cast<size_t>( y ) * target.width + x, static_cast<size_t>( width ) * height } );
+
+			return true;
+		}
+
+		virtual bool UploadVertices( const Vertex* pVertices, size_t count ) override
+		{
+			m_vertices.assign( pVertices, pVertices + count );
+			m_calls.push_back( { CallType::UploadVertices, 0, 0, count } );
+
+			return true;
+		}
+
+		virtual bool Begin( _RenderStateCache& stateCache ) override
+		{
+			if ( m_pStateCache ) {
+				return false;
+			}
+
+			D3DMATRIX identity{};
+			identity._11 = identity._22 = identity._33 = identity._44 = 1.f;
+			stateCache.SetTransform( D3DTS_WORLD, identity );
+			stateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE );
+
+			m_pStateCache = &stateCache;
+			m_calls.push_back( { CallType::Begin } );
+
+			return true;
+		}
+
+		virtual bool DrawQuads( size_t page, size_t firstQuad, size_t quadCount ) override
+		{
+			if ( !m_pStateCache || page >= m_pages.size() || ( firstQuad + quadCount ) * verticesPerQuad > m_vertices.size() ) {
+				return false;
+			}
+
+			m_pStateCache->SetTexture( 0, GetTexture( page ) );
+			m_calls.push_back( { CallType::DrawQuads, page, firstQuad, quadCount } );
+
+			return true;
+		}
+
+		virtual void End() override
+		{
+			m_pStateCache = nullptr;
+			m_calls.push_back( { CallType::End } );
+		}
+
+		virtual void Invalidate() override
+		{
+			m_calls.push_back( { CallType::Invalidate } );
+		}
+
+		virtual bool RestoreDevice() override
+		{
+			m_calls.push_back( { CallType::RestoreDevice } );
+
+			return true;
+		}
+
+		inline size_t GetCallCount( CallType type ) const { return static_cast<size_t>( std::count_if( m_calls.cbegin(), m_calls.cend(), [type]( const Call& call ) { return call.type == type; } ) ); }
+		inline const std::vector<Call>& GetCalls() const { return m_calls; }
+		inline const std::vector<Page>& GetPages() const { return m_pages; }
+		inline const std::vector<Vertex>& GetVertices() const { return m_vertices; }
+		inline void ClearCalls() { m_calls.clear(); }
+
+		static inline LPDIRECT3DBASETEXTURE9 GetTexture( size_t page ) { return reinterpret_cast<LPDIRECT3DBASETEXTURE9>( ( page + 1 ) * 0x10 ); }
+
+	private:
+		static constexpr size_t blockSize = 16;
+
+		std::vector<Call> m_calls;
+		std::vector<Page> m_pages;
+		std::vector<Vertex> m_vertices;
+
+		_RenderStateCache* m_pStateCache{};
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstring>
+#include <map>
+#include <tuple>
+#include "_RenderStateDevice.h"
+
+
+/*
+ * _RenderStateDevice without device. it keeps states and counts calls
+ *
+ * cache could be checked at a machine without d3d. states which aren't set are 0, transforms are identity
+*/
+namespace FreeformLight
+{
+	class _RecordingRenderStateDevice : public _RenderStateDevice
+	{
+	public:
+		virtual Value GetState( Kind kind, DWORD stage, DWORD type ) override
+		{
+			++m_getCount;
+
+			return PeekState( kind, stage, type );
+		}
+
+		virtual void SetState( Kind kind, DWORD stage, DWORD type, Value value ) override
+		{
+			++m_setCount;
+			m_states[std::make_tuple( kind, stage, type )] = value;
+		}
+
+		virtual void GetTransform( D3DTRANSFORMSTATETYPE type, D3DMATRIX& matrix ) override
+		{
+			++m_getCount;
+			matrix = PeekTransform( type );
+		}
+
+		virtual void SetTransform( D3DTRANSFORMSTATETYPE type, const D3DMATRIX& matrix ) override
+		{
+			++m_setCount;
+			m_transforms[type] = matrix;
+		}
+
+		// states are read without count
+		inline Value PeekState( Kind kind, DWORD stage, DWORD type ) const
+		{
+			auto iterator = m_states.find( std::make_tuple( kind, stage, type ) );
+
+			return iterator == m_states.end() ? 0 : iterator->second;
+		}
+
+		inline D3DMATRIX PeekTransform( D3DTRANSFORMSTATETYPE type ) const
+		{
+			auto iterator = m_transforms.find( type );
+
+			return iterator == m_transforms.end() ? GetIdentity() : iterator->second;
+		}
+
+		static inline D3DMATRIX GetIdentity()
+		{
+			D3DMATRIX matrix{};
+			matrix._11 = matrix._22 = matrix._33 = matrix._44 = 1.f;
+
+			return matrix;
+		}
+
+		static inline bool IsEqual( const D3DMATRIX& lhs, const D3DMATRIX& rhs ) { return !memcmp( &lhs, &rhs, sizeof( lhs ) ); }
+
+		inline size_t GetGetCount() const { return m_getCount; }
+		inline size_t GetSetCount() const { return m_setCount; }
+		inline void ClearCounts() { m_getCount = m_setCount = 0; }
+
+	private:
+		std::map<std::tuple<Kind, DWORD, DWORD>, Value> m_states;
+		std::map<D3DTRANSFORMSTATETYPE, D3DMATRIX> m_transforms;
+
+		size_t m_getCount{};
+		size_t m_setCount{};
+	};
+}
@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include "_RenderStateCache.h"
+#include "_D3D9RenderStateDevice.h"
+
+
+namespace FreeformLight
+{
+	namespace
+	{
+		_RenderStateCache::Statistics statistics{};
+	}
+
+	_RenderStateCache::_RenderStateCache( LPDIRECT3DDEVICE9 pDevice ) : m_pDevice{ pDevice }, m_pRoot{ this }, m_pOwnedStateDevice{ std::make_unique<_D3D9RenderStateDevice>( pDevice ) }
+	{
+		ASSERT( pDevice );
+
+		m_pStateDevice = m_pOwnedStateDevice.get();
+	}
+
+	_RenderStateCache::_RenderStateCache( _RenderStateDevice& stateDevice ) : m_pStateDevice{ &stateDevice }, m_pRoot{ this }
+	{}
+
+	_RenderStateCache::_RenderStateCache( _RenderStateCache& parent ) : m_pDevice{ parent.m_pDevice }, m_pStateDevice{ parent.m_pStateDevice }, m_pRoot{ parent.m_pRoot }
+	{}
+
+	_RenderStateCache::~_RenderStateCache()
+	{
+		Restore();
+	}
+
+	void _RenderStateCache::SetRenderState( D3DRENDERSTATETYPE type, DWORD value )
+	{
+		Set( MakeKey( Kind::renderState, 0, type ), value );
+	}
+
+	void _RenderStateCache::SetSamplerState( DWORD sampler, D3DSAMPLERSTATETYPE type, DWORD value )
+	{
+		Set( MakeKey( Kind::samplerState, sampler, type ), value );
+	}
+
+	void _RenderStateCache::SetTextureStageState( DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value )
+	{
+		Set( MakeKey( Kind::textureStageState, stage, type ), value );
+	}
+
+	void _RenderStateCache::SetFVF( DWORD fvf )
+	{
+		Set( MakeKey( Kind::fvf, 0, 0 ), fvf );
+	}
+
+	void _RenderStateCache::SetTexture( DWORD stage, LPDIRECT3DBASETEXTURE9 pTexture )
+	{
+		Set( MakeKey( Kind::texture, stage, 0 ), reinterpret_cast<Value>( pTexture ) );
+	}
+
+	void _RenderStateCache::SetPixelShader( LPDIRECT3DPIXELSHADER9 pShader )
+	{
+		Set( MakeKey( Kind::pixelShader, 0, 0 ), reinterpret_cast<Value>( pShader ) );
+	}
+
+	void _RenderStateCache::SetTransform( D3DTRANSFORMSTATETYPE type, const D3DMATRIX& matrix )
+	{
+		if ( !m_oldTransforms.count( type ) ) {
+			m_oldTransforms.emplace( type, ReadTransform( type ) );
+		}
+
+		WriteTransform( type, matrix );
+	}
+
+	void _RenderStateCache::Restore()
+	{
+		for ( auto& pair : m_oldValues ) {
+			Write( pair.first, pair.second );
+		}
+
+		for ( auto& pair : m_oldTransforms ) {
+			WriteTransform( static_cast<D3DTRANSFORMSTATETYPE>( pair.first ), pair.second );
+		}
+
+		m_oldValues.clear();
+		m_oldTransforms.clear();
+	}
+
+	const _RenderStateCache::Statistics& _RenderStateCache::GetStatistics()
+	{
+		return statistics;
+	}
+
+	void _RenderStateCache::ResetStatistics()
+	{
+		statistics = {};
+	}
+
+	void _RenderStateCache::Set( Key key, Value value )
+	{
+		if ( !m_oldValues.count( key ) ) {
+			m_oldValues.emplace( key, Read( key ) );
+		}
+
+		Write( key, value );
+	}
+
+	_RenderStateCache::Value _RenderStateCache::Read( Key key )
+	{
+		auto& values = m_pRoot->m_values;
+		auto iterator = values.find( key );
+
+		if ( iterator != values.end() ) {
+			++statistics.avoidedGetCount;
+
+			return iterator->second;
+		}
+
+		auto kind = static_cast<Kind>( key >> 48 );
+		auto stage = static_cast<DWORD>( key >> 32 & 0xffff );
+		auto type = static_cast<DWORD>( key );
+		auto value = m_pStateDevice->GetState( kind, stage, type );
+
+		++statistics.getCount;
+		values.emplace( key, value );
+
+		return value;
+	}
+
+	void _RenderStateCache::Write( Key key, Value value )
+	{
+		auto& known = m_pRoot->m_values[key];
+
+		if ( known == value ) {
+			++statistics.avoidedSetCount;
+			return;
+		}
+
+		auto kind = static_cast<Kind>( key >> 48 );
+		auto stage = static_cast<DWORD>( key >> 32 & 0xffff );
+		auto type = static_cast<DWORD>( key );
+
+		m_pStateDevice->SetState( kind, stage, type, value );
+		++statistics.setCount;
+		known = value;
+	}
+
+	const D3DMATRIX& _RenderStateCache::ReadTransform( D3DTRANSFORMSTATETYPE type )
+	{
+		auto& transforms = m_pRoot->m_transforms;
+		auto iterator = transforms.find( type );
+
+		if ( iterator != transforms.end() ) {
+			++statistics.avoidedGetCount;
+
+			return iterator->second;
+		}
+
+		D3DMATRIX matrix{};
+		m_pStateDevice->GetTransform( type, matrix );
+		++statistics.getCount;
+
+		return transforms.emplace( type, matrix ).first->second;
+	}
+
+	void _RenderStateCache::WriteTransform( D3DTRANSFORMSTATETYPE type, const D3DMATRIX& matrix )
+	{
+		auto& transform = const_cast<D3DMATRIX&>( ReadTransform( type ) );
+
+		if ( !memcmp( &transform, &matrix, sizeof( matrix ) ) ) {
+			++statistics.avoidedSetCount;
+			return;
+		}
+
+		m_pStateDevice->SetTransform( type, matrix );
+		++statistics.setCount;
+		transform = matrix;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <d3dx9.h>
+#include "_RenderStateDevice.h"
+
+
+/*
+ * shadow copy of device states
+ *
+ * a state is read from device at first only. a value which is same as known one isn't set to device
+ * changed states are restored at once when it is destroyed. nested one shares known states of parent
+ * states changed by device directly aren't known. they should be set back before it is used again
+ * states are got and set through _RenderStateDevice. so it could be checked by _RecordingRenderStateDevice
+*/
+namespace FreeformLight
+{
+	class _RenderStateCache
+	{
+	public:
+		// calls of all caches. it is accumulated until ResetStatistics()
+		struct Statistics
+		{
+			size_t getCount;
+			size_t setCount;
+			size_t avoidedGetCount;
+			size_t avoidedSetCount;
+		};
+
+		explicit _RenderStateCache( LPDIRECT3DDEVICE9 );
+		// there's no d3d device. GetDevice() returns null
+		explicit _RenderStateCache( _RenderStateDevice& );
+		explicit _RenderStateCache( _RenderStateCache& parent );
+		_RenderStateCache( const _RenderStateCache& ) = delete;
+		_RenderStateCache& operator=( const _RenderStateCache& ) = delete;
+		~_RenderStateCache();
+
+		inline LPDIRECT3DDEVICE9 GetDevice() const { return m_pDevice; }
+
+		void SetRenderState( D3DRENDERSTATETYPE, DWORD );
+		void SetSamplerState( DWORD sampler, D3DSAMPLERSTATETYPE, DWORD );
+		void SetTextureStageState( DWORD stage, D3DTEXTURESTAGESTATETYPE, DWORD );
+		void SetFVF( DWORD );
+		void SetTexture( DWORD stage, LPDIRECT3DBASETEXTURE9 );
+		void SetPixelShader( LPDIRECT3DPIXELSHADER9 );
+		void SetTransform( D3DTRANSFORMSTATETYPE, const D3DMATRIX& );
+
+		// states changed in this scope are set back
+		void Restore();
+
+		static const Statistics& GetStatistics();
+		static void ResetStatistics();
+
+	private:
+		using Kind = _RenderStateDevice::Kind;
+		using Key = uint64_t;
+		using Value = _RenderStateDevice::Value;
+
+		static inline Key MakeKey( Kind kind, DWORD stage, DWORD type ) { return static_cast<uint64_t>( kind ) << 48 | static_cast<uint64_t>( stage ) << 32 | type; }
+
+		void Set( Key, Value );
+		Value Read( Key );
+		void Write( Key, Value );
+
+		const D3DMATRIX& ReadTransform( D3DTRANSFORMSTATETYPE );
+		void WriteTransform( D3DTRANSFORMSTATETYPE, const D3DMATRIX& );
+
+	private:
+		LPDIRECT3DDEVICE9 m_pDevice{};
+		_RenderStateDevice* m_pStateDevice{};
+		_RenderStateCache* m_pRoot{};
+
+		// root made of d3d device owns it
+		std::unique_ptr<_RenderStateDevice> m_pOwnedStateDevice;
+
+		// current states of device. root has them only
+		std::unordered_map<Key, Value> m_values;
+		std::unordered_map<DWORD, D3DMATRIX> m_transforms;
+
+		// states before they're changed in this scope
+		std::unordered_map<Key, Value> m_oldValues;
+		std::unordered_map<DWORD, D3DMATRIX> m_oldTransforms;
+	};
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <d3d9.h>
+
+
+/*
+ * states of device which are used by _RenderStateCache
+ *
+ * _D3D9RenderStateDevice gets and sets them by d3d9. _RecordingRenderStateDevice only keeps them. so cache could be checked without device
+*/
+namespace FreeformLight
+{
+	class _RenderStateDevice
+	{
+	public:
+		enum class Kind : uint64_t
+		{
+			renderState,
+			samplerState,
+			textureStageState,
+			fvf,
+			texture,
+			pixelShader,
+		};
+
+		// pointer of texture or shader is kept as value. it isn't referenced
+		using Value = uintptr_t;
+
+		virtual ~_RenderStateDevice() {}
+
+		// stage is of sampler or texture stage. type is D3DRENDERSTATETYPE, D3DSAMPLERSTATETYPE or D3DTEXTURESTAGESTATETYPE by kind
+		virtual Value GetState( Kind, DWORD stage, DWORD type ) = 0;
+		virtual void SetState( Kind, DWORD stage, DWORD type, Value ) = 0;
+		virtual void GetTransform( D3DTRANSFORMSTATETYPE, D3DMATRIX& ) = 0;
+		virtual void SetTransform( D3DTRANSFORMSTATETYPE, const D3DMATRIX& ) = 0;
+	};
+}
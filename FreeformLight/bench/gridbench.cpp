@@ -0,0 +1,128 @@
+/*
+ * time of cursor test of _PolygonGrid against linear scan of every edge. it is built as a separate program with _PolygonGrid
+ *
+ * polygons are stars with 100, 1000 and 10000 vertices in the screen. queries are random points of it
+ * result of both is checked by FreeformLightTest. this one counts hits only
+ *
+ * usage: gridbench [width] [height]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../_PolygonGrid.h"
+
+
+namespace
+{
+	using FreeformLight::_PolygonGrid;
+	using Point = _PolygonGrid::Point;
+
+	constexpr auto queryCount = 10000;
+	constexpr auto width = 10.f;
+	constexpr auto offset = 30.f;
+	constexpr auto pi = 3.14159265f;
+
+	// it is same test of _PolygonGrid::FindEdge()
+	size_t FindEdge( _PolygonGrid::Points const& points, Point const& point )
+	{
+		auto index = points.size();
+		auto nearestDistance = width;
+
+		for ( size_t i = 1; i < points.size(); ++i ) {
+			auto& from = points[i];
+			auto& to = points[i + 1 == points.size() ? 1 : i + 1];
+			auto dx = to.x - from.x;
+			auto dy = to.y - from.y;
+			auto length = std::sqrt( dx * dx + dy * dy );
+			auto px = point.x - from.x;
+			auto py = point.y - from.y;
+			auto along = ( px * dx + py * dy ) / length;
+			auto across = std::fabs( px * dy - py * dx ) / length;
+
+			if ( length > offset * 2 && along >= offset && along <= length - offset && across <= nearestDistance ) {
+				nearestDistance = across;
+				index = i;
+			}
+		}
+
+		return index;
+	}
+
+	double ToMicroseconds( std::chrono::high_resolution_clock::duration duration )
+	{
+		return std::chrono::duration<double, std::micro>( duration ).count() / queryCount;
+	}
+}
+
+int main( int argc, char** argv )
+{
+	auto screenWidth = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 1920;
+	auto screenHeight = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 1080;
+
+	if ( !screenWidth || !screenHeight ) {
+		fprintf( stderr, "usage: gridbench [width] [height]\n" );
+		return 1;
+	}
+
+	auto w = static_cast<float>( screenWidth );
+	auto h = static_cast<float>( screenHeight );
+	std::mt19937 random{ 5489u };
+
+	printf( "%lux%lu, %d queries\n", screenWidth, screenHeight, queryCount );
+
+	for ( auto vertexCount : { 100, 1000, 10000 } ) {
+		// center is a vertex out of loop
+		_PolygonGrid::Points points{ { w / 2, h / 2 } };
+
+		for ( auto i = 0; i < vertexCount; ++i ) {
+			auto angle = pi * 2 * i / vertexCount;
+			auto radius = ( w < h ? w : h ) * ( i % 2 ? 0.45f : 0.3f );
+
+			points.push_back( { w / 2 + std::cos( angle ) * radius, h / 2 + std::sin( angle ) * radius } );
+		}
+
+		std::vector<Point> queries;
+
+		for ( auto i = 0; i < queryCount; ++i ) {
+			queries.push_back( { static_cast<float>( random() % screenWidth ), static_cast<float>( random() % screenHeight ) } );
+		}
+
+		_PolygonGrid grid;
+		grid.Build( points, 1 );
+
+		size_t linearHitCount{};
+		size_t gridHitCount{};
+
+		auto begin = std::chrono::high_resolution_clock::now();
+
+		for ( auto& query : queries ) {
+			linearHitCount += ( FindEdge( points, query ) < points.size() );
+		}
+
+		auto middle = std::chrono::high_resolution_clock::now();
+
+		for ( auto& query : queries ) {
+			size_t index{};
+			gridHitCount += grid.FindEdge( query, width, offset, &index );
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		// dragging a vertex per frame
+		for ( auto i = 0; i < queryCount; ++i ) {
+			auto index = 1 + i % vertexCount;
+			auto point = grid.GetPoint( index );
+			grid.Move( index, { point.x + 1, point.y } );
+		}
+
+		auto moveEnd = std::chrono::high_resolution_clock::now();
+
+		printf( "%d vertices: linear %.3f us, grid %.3f us, move %.3f us per query. hits %zu/%zu\n",
+			vertexCount, ToMicroseconds( middle - begin ), ToMicroseconds( end - middle ), ToMicroseconds( moveEnd - end ), gridHitCount, linearHitCount );
+	}
+
+	return 0;
+}
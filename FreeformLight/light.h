@@ -21,7 +21,15 @@ _ImmutableLightImpl
 
 _MutableLightImpl
 	mutable freeform implementation. it uses for editor
+
+_RenderStateCache
+	shadow copy of device states. it skips redundant calls
+
+_PolygonGrid
+	uniform grid of projected vertices and edges. it is used for hit test of editor
 */
 
 using CImmutableFreeformLight = FreeformLight::_ImmutableFreeform;
-using CMutableFreeformLight = FreeformLight::_MutableFreeform;
\ No newline at end of file
+using CMutableFreeformLight = FreeformLight::_MutableFreeform;
+using CRenderStateCache = FreeformLight::_RenderStateCache;
+using CPolygonGrid = FreeformLight::_PolygonGrid;
\ No newline at end of file
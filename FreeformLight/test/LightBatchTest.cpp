@@ -0,0 +1,401 @@
+#include "Test.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "../_LightBatch.h"
+#include "../_LightSetFile.h"
+#include "../_RecordingLightDevice.h"
+#include "../_RecordingRenderStateDevice.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			using CallType = _RecordingLightDevice::CallType;
+			using Kind = _RenderStateDevice::Kind;
+
+			struct Placement
+			{
+				size_t page;
+				uint32_t x;
+				uint32_t y;
+			};
+
+			inline bool IsNear( float lhs, float rhs )
+			{
+				return std::fabs( lhs - rhs ) < 1e-4f;
+			}
+
+			// LT, LB, RB, RT
+			bool IsQuad( const _LightDevice::Vertex* pVertex, const _LightBatch::Quad& quad )
+			{
+				const _LightDevice::Vertex expected[] = {
+					{ quad.left, quad.top, 0, quad.u0, quad.v0 },
+					{ quad.left, quad.bottom, 0, quad.u0, quad.v1 },
+					{ quad.right, quad.bottom, 0, quad.u1, quad.v1 },
+					{ quad.right, quad.top, 0, quad.u1, quad.v0 },
+				};
+
+				for ( size_t i = 0; i < _LightDevice::verticesPerQuad; ++i ) {
+					auto& v = pVertex[i];
+					auto& e = expected[i];
+
+					if ( !IsNear( v.x, e.x ) || !IsNear( v.y, e.y ) || v.z != 0 || !IsNear( v.u, e.u ) || !IsNear( v.v, e.v ) ) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			/*
+			 * batch is built already. it checks calls which are recorded by device
+			 *
+			 * pages are made at first and masks are uploaded by order of items. items of a page are consecutive
+			*/
+			void CheckBuild( _LightBatch& batch, _RecordingLightDevice& device, const std::vector<_LightBatch::Item>& items )
+			{
+				auto& calls = device.GetCalls();
+				auto& pages = device.GetPages();
+
+				CHECK( pages.size() == batch.GetPageCount() );
+				CHECK( device.GetCallCount( CallType::CreatePage ) == batch.GetPageCount() );
+				CHECK( device.GetCallCount( CallType::UploadBlocks ) == items.size() );
+				CHECK( device.GetCallCount( CallType::UploadVertices ) == 0 );
+
+				// placement is recorded as offset of texel in page
+				std::vector<Placement> placements;
+
+				for ( auto& call : calls ) {
+					if ( call.type == CallType::UploadBlocks ) {
+						auto width = pages[call.page].width;
+						placements.push_back( { call.page, static_cast<uint32_t>( call.first % width ), static_cast<uint32_t>( call.first / width ) } );
+					}
+				}
+
+				if ( !CHECK( placements.size() == items.size() ) ) {
+					return;
+				}
+
+				for ( size_t i = 0; i < items.size(); ++i ) {
+					auto& item = items[i];
+					auto& placement = placements[i];
+					auto& page = pages[placement.page];
+
+					CHECK( batch.GetItemPage( i ) == placement.page );
+
+					// page doesn't go back. so lights of a page are drawn by a call
+					CHECK( !i || placements[i - 1].page <= placement.page );
+
+					// blocks are in page as they are
+					auto pagePitch = static_cast<size_t>( page.width / 4 ) * 16;
+					auto rowSize = static_cast<size_t>( item.maskWidth / 4 ) * 16;
+					auto isSame = placement.x + item.maskWidth <= page.width && placement.y + item.maskHeight <= page.height;
+
+					for ( uint32_t row = 0; isSame && row < item.maskHeight / 4; ++row ) {
+						auto* pPage = page.blocks.data() + ( placement.y / 4 + row ) * pagePitch + ( placement.x / 4 ) * 16;
+						isSame = !memcmp( pPage, item.pBlocks + row * item.pitch, rowSize );
+					}
+
+					CHECK( isSame );
+
+					// same quad of _ImmutableLightImpl::CreateMesh() which is transformed by mask
+					auto& quad = batch.GetItemQuad( i );
+					CHECK( IsNear( quad.left, item.cx - item.meshWidth / 2 ) && IsNear( quad.right, item.cx + item.meshWidth / 2 ) );
+					CHECK( IsNear( quad.top, item.cy - item.meshHeight / 2 ) && IsNear( quad.bottom, item.cy + item.meshHeight / 2 ) );
+					CHECK( IsNear( quad.u0, static_cast<float>( placement.x ) / page.width ) && IsNear( quad.v0, static_cast<float>( placement.y ) / page.height ) );
+					CHECK( IsNear( quad.u1, static_cast<float>( placement.x + item.maskWidth ) / page.width ) && IsNear( quad.v1, static_cast<float>( placement.y + item.maskHeight ) / page.height ) );
+
+					// masks in same page are apart by gutter at least
+					for ( size_t j = i + 1; j < items.size(); ++j ) {
+						auto& other = placements[j];
+
+						if ( other.page != placement.page ) {
+							continue;
+						}
+
+						auto isApart = placement.x + item.maskWidth + _LightBatch::gutter <= other.x || other.x + items[j].maskWidth + _LightBatch::gutter <= placement.x ||
+							placement.y + item.maskHeight + _LightBatch::gutter <= other.y || other.y + items[j].maskHeight + _LightBatch::gutter <= placement.y;
+
+						CHECK( isApart );
+					}
+				}
+			}
+
+			/*
+			 * all items are added by their order and drawn
+			 *
+			 * a draw per page. quads are drawn by order of items and states of device are set back after it
+			*/
+			void CheckDraw( _LightBatch& batch, _RecordingLightDevice& device, size_t itemCount )
+			{
+				_RecordingRenderStateDevice stateDevice;
+				auto* pOldTexture = _RecordingLightDevice::GetTexture( 100 );
+				auto atlasMapping = _RecordingRenderStateDevice::GetIdentity();
+				atlasMapping._11 = 0.5f;
+				atlasMapping._41 = 10.f;
+
+				_RenderStateCache stateCache{ stateDevice };
+				stateCache.SetTexture( 0, pOldTexture );
+				stateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2 );
+				stateCache.SetTransform( D3DTS_WORLD, atlasMapping );
+
+				device.ClearCalls();
+				batch.Clear();
+
+				for ( size_t i = 0; i < itemCount; ++i ) {
+					batch.Add( batch.GetItemPage( i ), batch.GetItemQuad( i ) );
+				}
+
+				CHECK( batch.GetQuadCount() == itemCount );
+				CHECK( batch.GetRunCount() == batch.GetPageCount() );
+
+				if ( !CHECK( batch.Draw( stateCache ) ) ) {
+					return;
+				}
+
+				auto& calls = device.GetCalls();
+
+				if ( !itemCount ) {
+					CHECK( calls.empty() );
+					return;
+				}
+
+				CHECK( calls.size() == batch.GetPageCount() + 3 );
+				CHECK( calls.front().type == CallType::UploadVertices );
+				CHECK( calls.back().type == CallType::End );
+				CHECK( device.GetCallCount( CallType::DrawQuads ) == batch.GetPageCount() );
+				CHECK( device.GetVertices().size() == itemCount * _LightDevice::verticesPerQuad );
+
+				size_t nextQuad{};
+
+				for ( auto& call : calls ) {
+					if ( call.type != CallType::DrawQuads ) {
+						continue;
+					}
+
+					CHECK( call.first == nextQuad );
+
+					for ( size_t quad = call.first; quad < call.first + call.count && quad < itemCount; ++quad ) {
+						CHECK( batch.GetItemPage( quad ) == call.page );
+						CHECK( IsQuad( &device.GetVertices()[quad * _LightDevice::verticesPerQuad], batch.GetItemQuad( quad ) ) );
+					}
+
+					nextQuad = call.first + call.count;
+				}
+
+				CHECK( nextQuad == itemCount );
+
+				// states of device are restored by batch
+				CHECK( stateDevice.PeekState( Kind::texture, 0, 0 ) == reinterpret_cast<uintptr_t>( pOldTexture ) );
+				CHECK( stateDevice.PeekState( Kind::textureStageState, 0, D3DTSS_TEXTURETRANSFORMFLAGS ) == D3DTTFF_COUNT2 );
+				CHECK( _RecordingRenderStateDevice::IsEqual( stateDevice.PeekTransform( D3DTS_WORLD ), atlasMapping ) );
+
+				// same quads aren't uploaded again
+				device.ClearCalls();
+				batch.Clear();
+
+				for ( size_t i = 0; i < itemCount; ++i ) {
+					batch.Add( batch.GetItemPage( i ), batch.GetItemQuad( i ) );
+				}
+
+				CHECK( batch.Draw( stateCache ) );
+				CHECK( device.GetCallCount( CallType::UploadVertices ) == 0 );
+				CHECK( device.GetCallCount( CallType::DrawQuads ) == batch.GetPageCount() );
+			}
+
+			// lights are baked, saved and opened by _LightSetFile
+			void TestBakedLights()
+			{
+				std::vector<_LightMaskBaker::Light> lights;
+
+				for ( auto i = 0; i < 4; ++i ) {
+					auto x = i * 300.f;
+					auto size = 30.f + i * 25.f;
+					lights.push_back( { { { x, 0 }, { x - size, -size }, { x + size, -size * 0.5f }, { x + size, size }, { x - size * 0.5f, size } }, 1.f, 0.8f, 0.6f, 1.f, 0.4f } );
+				}
+
+				const char* path = "FreeformLightTest.ffls";
+				_LightSetFile file;
+
+				if ( !CHECK( _LightSetFile::Save( path, lights, 2 ) ) || !CHECK( file.Open( path ) ) || !CHECK( file.GetLightCount() == lights.size() ) ) {
+					remove( path );
+					return;
+				}
+
+				// same items of _LightBatch::Build( _LightSetFile const& )
+				std::vector<_LightBatch::Item> items;
+
+				for ( size_t i = 0; i < file.GetLightCount(); ++i ) {
+					auto& light = file.GetLight( i );
+
+					items.push_back( { light.cx, light.cy, light.meshWidth, light.meshHeight, light.maskWidth, light.maskHeight, file.GetMask( i ), _LightSetFile::GetMaskPitch( light ) } );
+				}
+
+				_RecordingLightDevice device;
+				_LightBatch batch{ device };
+
+				if ( CHECK( batch.Build( file ) ) ) {
+					CHECK( batch.GetPageCount() == 1 );
+					CheckBuild( batch, device, items );
+					CheckDraw( batch, device, items.size() );
+
+					// pages are kept. vertices are uploaded again at next draw
+					_RecordingRenderStateDevice stateDevice;
+					_RenderStateCache stateCache{ stateDevice };
+
+					device.ClearCalls();
+					batch.Invalidate();
+					CHECK( batch.RestoreDevice() );
+					CHECK( device.GetCallCount( CallType::UploadVertices ) == 0 );
+					CHECK( batch.Draw( stateCache ) );
+					CHECK( device.GetCallCount( CallType::UploadVertices ) == 1 );
+					CHECK( device.GetCallCount( CallType::CreatePage ) == 0 );
+					CHECK( device.GetVertices().size() == items.size() * _LightDevice::verticesPerQuad );
+				}
+
+				file.Close();
+				remove( path );
+			}
+
+			// masks over a page go to next pages. too big one has its own page
+			void TestPages()
+			{
+				const uint32_t sizes[][2] = {
+					{ 1200, 800 },
+					{ 64, 32 },
+					{ 1200, 800 },
+					{ 2100, 100 },
+					{ 16, 16 },
+					{ 1200, 1200 },
+					{ 900, 600 },
+					{ 2044, 2044 },
+					{ 4, 4 },
+				};
+
+				std::vector<std::vector<uint8_t>> blocks;
+				std::vector<_LightBatch::Item> items;
+
+				for ( size_t i = 0; i < sizeof( sizes ) / sizeof( *sizes ); ++i ) {
+					auto width = sizes[i][0];
+					auto height = sizes[i][1];
+					auto pitch = ( width / 4 ) * 16;
+
+					blocks.emplace_back( static_cast<size_t>( pitch ) * ( height / 4 ) );
+
+					for ( size_t j = 0; j < blocks.back().size(); ++j ) {
+						blocks.back()[j] = static_cast<uint8_t>( j * 7 + i );
+					}
+
+					items.push_back( { i * 100.f, i * -50.f, width * 3.f, height * 3.f, width, height, nullptr, pitch } );
+				}
+
+				for ( size_t i = 0; i < items.size(); ++i ) {
+					items[i].pBlocks = blocks[i].data();
+				}
+
+				_RecordingLightDevice device;
+				_LightBatch batch{ device };
+
+				if ( CHECK( batch.Build( items ) ) ) {
+					CHECK( batch.GetPageCount() > 2 );
+					CheckBuild( batch, device, items );
+					CheckDraw( batch, device, items.size() );
+				}
+			}
+
+			// quads are drawn by order of Add(). only consecutive ones of same page are drawn together
+			void TestOrder()
+			{
+				_RecordingLightDevice device;
+				_LightBatch batch{ device };
+				size_t pages[2]{};
+
+				if ( !CHECK( device.CreatePage( pages[0], 64, 64 ) ) || !CHECK( device.CreatePage( pages[1], 64, 64 ) ) ) {
+					return;
+				}
+
+				const size_t order[] = { 0, 0, 1, 0, 1, 1, 0 };
+				std::vector<_LightBatch::Quad> quads;
+
+				for ( size_t i = 0; i < sizeof( order ) / sizeof( *order ); ++i ) {
+					auto x = static_cast<float>( i * 10 );
+					quads.push_back( { x, 0, x + 5, 5, 0, 0, 0.5f, 0.5f } );
+					batch.Add( pages[order[i]], quads.back() );
+				}
+
+				_RecordingRenderStateDevice stateDevice;
+				_RenderStateCache stateCache{ stateDevice };
+
+				CHECK( batch.GetRunCount() == 5 );
+
+				if ( !CHECK( batch.Draw( stateCache ) ) ) {
+					return;
+				}
+
+				// first, count of run
+				const size_t expected[][2] = { { 0, 2 }, { 2, 1 }, { 3, 1 }, { 4, 2 }, { 6, 1 } };
+				size_t run{};
+
+				for ( auto& call : device.GetCalls() ) {
+					if ( call.type != CallType::DrawQuads || !CHECK( run < sizeof( expected ) / sizeof( *expected ) ) ) {
+						continue;
+					}
+
+					CHECK( call.first == expected[run][0] && call.count == expected[run][1] );
+					CHECK( call.page == pages[order[call.first]] );
+					++run;
+				}
+
+				CHECK( run == sizeof( expected ) / sizeof( *expected ) );
+
+				for ( size_t i = 0; i < quads.size(); ++i ) {
+					CHECK( IsQuad( &device.GetVertices()[i * _LightDevice::verticesPerQuad], quads[i] ) );
+				}
+
+				// a moved quad is uploaded again. fewer quads are drawn from buffer as it is
+				device.ClearCalls();
+				batch.Clear();
+				quads[1].left -= 1;
+
+				for ( size_t i = 0; i < 3; ++i ) {
+					batch.Add( pages[order[i]], quads[i] );
+				}
+
+				CHECK( batch.Draw( stateCache ) );
+				CHECK( device.GetCallCount( CallType::UploadVertices ) == 1 );
+				CHECK( device.GetVertices().size() == 3 * _LightDevice::verticesPerQuad );
+				CHECK( IsQuad( &device.GetVertices()[_LightDevice::verticesPerQuad], quads[1] ) );
+
+				device.ClearCalls();
+				batch.Clear();
+				batch.Add( pages[order[0]], quads[0] );
+
+				CHECK( batch.Draw( stateCache ) );
+				CHECK( device.GetCallCount( CallType::UploadVertices ) == 0 );
+				CHECK( device.GetCallCount( CallType::DrawQuads ) == 1 );
+			}
+
+			void TestNoLight()
+			{
+				_RecordingLightDevice device;
+				_LightBatch batch{ device };
+
+				CHECK( batch.Build( std::vector<_LightBatch::Item>{} ) );
+				CheckBuild( batch, device, {} );
+				CheckDraw( batch, device, 0 );
+			}
+		}
+
+		void TestLightBatch()
+		{
+			TestBakedLights();
+			TestPages();
+			TestOrder();
+			TestNoLight();
+		}
+	}
+}
@@ -0,0 +1,352 @@
+#include "Test.h"
+#include <map>
+#include <random>
+#include "../_LightMaskAtlas.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			using Rect = _LightMaskAtlas::Rect;
+			using Handle = _LightMaskAtlas::Handle;
+
+			inline bool IsOverlapped( const Rect& lhs, const Rect& rhs )
+			{
+				return lhs.x < rhs.x + rhs.width && rhs.x < lhs.x + lhs.width && lhs.y < rhs.y + rhs.height && rhs.y < lhs.y + lhs.height;
+			}
+
+			inline bool IsSame( const Rect& lhs, const Rect& rhs )
+			{
+				return lhs.x == rhs.x && lhs.y == rhs.y && lhs.width == rhs.width && lhs.height == rhs.height;
+			}
+
+			// regions have requested size. they are in atlas and reserved rects with padding don't overlap
+			void CheckAtlas( const _LightMaskAtlas& atlas, const std::map<Handle, Rect>& sizes, uint32_t padding )
+			{
+				CHECK( atlas.GetRegionCount() == sizes.size() );
+
+				uint64_t area{};
+
+				for ( auto lhs = sizes.begin(); lhs != sizes.end(); ++lhs ) {
+					if ( !CHECK( atlas.Contains( lhs->first ) ) ) {
+						continue;
+					}
+
+					auto& rect = atlas.GetRect( lhs->first );
+					auto& reserved = atlas.GetReservedRect( lhs->first );
+
+					CHECK( rect.width == lhs->second.width && rect.height == lhs->second.height );
+					CHECK( reserved.x == rect.x && reserved.y == rect.y && reserved.width >= rect.width + padding && reserved.height >= rect.height + padding );
+					CHECK( reserved.x + reserved.width <= atlas.GetWidth() && reserved.y + reserved.height <= atlas.GetHeight() );
+
+					area += static_cast<uint64_t>( reserved.width ) * reserved.height;
+
+					for ( auto rhs = std::next( lhs ); rhs != sizes.end(); ++rhs ) {
+						if ( atlas.Contains( rhs->first ) ) {
+							CHECK( !IsOverlapped( reserved, atlas.GetReservedRect( rhs->first ) ) );
+						}
+					}
+				}
+
+				auto atlasArea = static_cast<uint64_t>( atlas.GetWidth() ) * atlas.GetHeight();
+
+				CHECK( area <= atlasArea );
+				CHECK( atlas.GetOccupancy() >= 0.f && atlas.GetOccupancy() <= 1.f );
+			}
+
+			// every free texel is reused. atlas which is filled with tiles gets a tile again after one is removed
+			void TestReuse()
+			{
+				constexpr uint32_t size = 256;
+				constexpr uint32_t tile = 60;
+				constexpr uint32_t padding = 4;
+
+				_LightMaskAtlas atlas{ size, size, padding };
+				std::map<Handle, Rect> sizes;
+
+				for ( auto i = 0; i < 16; ++i ) {
+					auto handle = atlas.Insert( tile, tile );
+
+					if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+						sizes[handle] = atlas.GetRect( handle );
+					}
+				}
+
+				CheckAtlas( atlas, sizes, padding );
+				CHECK( atlas.GetOccupancy() == 1.f );
+				CHECK( atlas.Insert( 1, 1 ) == _LightMaskAtlas::invalidHandle );
+
+				// removed region is given again
+				auto removed = std::next( sizes.begin(), 5 );
+				auto rect = removed->second;
+
+				CHECK( atlas.Remove( removed->first ) );
+				CHECK( !atlas.Remove( removed->first ) );
+				sizes.erase( removed );
+
+				auto handle = atlas.Insert( tile, tile );
+
+				if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+					CHECK( IsSame( atlas.GetRect( handle ), rect ) );
+					sizes[handle] = atlas.GetRect( handle );
+				}
+
+				// two neighbors are merged. so a bigger one fits there
+				auto first = sizes.begin();
+				auto second = std::next( first );
+				auto& r0 = first->second;
+				auto& r1 = second->second;
+				auto isNeighbor = ( r0.y == r1.y && ( r0.x + tile + padding == r1.x || r1.x + tile + padding == r0.x ) ) || ( r0.x == r1.x && ( r0.y + tile + padding == r1.y || r1.y + tile + padding == r0.y ) );
+
+				if ( CHECK( isNeighbor ) ) {
+					auto isHorizontal = r0.y == r1.y;
+
+					atlas.Remove( first->first );
+					atlas.Remove( second->first );
+					sizes.erase( first );
+					sizes.erase( second );
+
+					auto width = isHorizontal ? tile * 2 + padding : tile;
+					auto height = isHorizontal ? tile : tile * 2 + padding;
+					handle = atlas.Insert( width, height );
+
+					if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+						sizes[handle] = atlas.GetRect( handle );
+					}
+				}
+
+				CheckAtlas( atlas, sizes, padding );
+
+				// empty atlas has a free rect of whole
+				for ( auto& pair : sizes ) {
+					atlas.Remove( pair.first );
+				}
+
+				CHECK( atlas.GetRegionCount() == 0 );
+				CHECK( atlas.GetFreeRectCount() == 1 );
+				CHECK( atlas.Insert( size - padding, size - padding ) != _LightMaskAtlas::invalidHandle );
+			}
+
+			void TestInvalidInsert()
+			{
+				_LightMaskAtlas atlas{ 128, 64, 2 };
+
+				CHECK( atlas.Insert( 0, 10 ) == _LightMaskAtlas::invalidHandle );
+				CHECK( atlas.Insert( 10, 0 ) == _LightMaskAtlas::invalidHandle );
+				// padding is in atlas too
+				CHECK( atlas.Insert( 128, 10 ) == _LightMaskAtlas::invalidHandle );
+				CHECK( atlas.Insert( 126, 62 ) != _LightMaskAtlas::invalidHandle );
+				CHECK( !atlas.Remove( _LightMaskAtlas::invalidHandle ) );
+			}
+
+			// smaller one stays. bigger one moves if it can, else old region is kept
+			void TestResize()
+			{
+				constexpr uint32_t padding = 2;
+
+				_LightMaskAtlas atlas{ 128, 128, padding };
+				auto a = atlas.Insert( 62, 62 );
+				auto b = atlas.Insert( 30, 30 );
+				auto changed = true;
+
+				if ( !CHECK( a != _LightMaskAtlas::invalidHandle && b != _LightMaskAtlas::invalidHandle ) ) {
+					return;
+				}
+
+				auto old = atlas.GetRect( a );
+
+				CHECK( atlas.Resize( a, 62, 62, changed ) && !changed );
+
+				CHECK( atlas.Resize( a, 40, 20, changed ) && changed );
+				CHECK( atlas.GetRect( a ).x == old.x && atlas.GetRect( a ).y == old.y );
+				CheckAtlas( atlas, { { a, { 0, 0, 40, 20 } }, { b, { 0, 0, 30, 30 } } }, padding );
+
+				// rest of shrunk one is free again
+				auto c = atlas.Insert( 20, 38 );
+				CHECK( c != _LightMaskAtlas::invalidHandle );
+				CheckAtlas( atlas, { { a, { 0, 0, 40, 20 } }, { b, { 0, 0, 30, 30 } }, { c, { 0, 0, 20, 38 } } }, padding );
+
+				// there's no space of it
+				old = atlas.GetRect( a );
+				CHECK( !atlas.Resize( a, 126, 126, changed ) && !changed );
+				CHECK( IsSame( atlas.GetRect( a ), old ) );
+
+				CHECK( atlas.Resize( b, 60, 60, changed ) && changed );
+				CheckAtlas( atlas, { { a, { 0, 0, 40, 20 } }, { b, { 0, 0, 60, 60 } }, { c, { 0, 0, 20, 38 } } }, padding );
+
+				CHECK( !atlas.Resize( a, 0, 10, changed ) && !changed );
+				CHECK( !atlas.Resize( 1000, 10, 10, changed ) );
+			}
+
+			// fragmented atlas is compacted. moves have old and new rects
+			void TestDefragment()
+			{
+				constexpr uint32_t size = 256;
+				constexpr uint32_t padding = 4;
+
+				_LightMaskAtlas atlas{ size, size, padding };
+				std::map<Handle, Rect> sizes;
+				std::vector<Handle> handles;
+
+				for ( auto i = 0; i < 16; ++i ) {
+					handles.push_back( atlas.Insert( 60, 60 ) );
+				}
+
+				// holes on diagonal. there's no room of 2x2 tiles
+				for ( size_t i = 0; i < handles.size(); ++i ) {
+					auto& rect = atlas.GetRect( handles[i] );
+
+					if ( ( rect.x / 64 + rect.y / 64 ) % 2 ) {
+						atlas.Remove( handles[i] );
+					}
+					else {
+						sizes[handles[i]] = rect;
+					}
+				}
+
+				CHECK( sizes.size() == 8 );
+				CHECK( atlas.Insert( 124, 124 ) == _LightMaskAtlas::invalidHandle );
+
+				std::vector<_LightMaskAtlas::Move> moves;
+
+				if ( !CHECK( atlas.Defragment( moves ) ) ) {
+					return;
+				}
+
+				CHECK( moves.size() == sizes.size() );
+
+				for ( auto& move : moves ) {
+					auto iterator = sizes.find( move.handle );
+
+					if ( CHECK( iterator != sizes.end() ) ) {
+						CHECK( IsSame( move.from, iterator->second ) );
+						CHECK( IsSame( move.to, atlas.GetRect( move.handle ) ) );
+					}
+				}
+
+				CheckAtlas( atlas, sizes, padding );
+
+				auto handle = atlas.Insert( 124, 124 );
+
+				if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+					sizes[handle] = atlas.GetRect( handle );
+				}
+
+				CheckAtlas( atlas, sizes, padding );
+			}
+
+			// regions stay and new area is free
+			void TestGrow()
+			{
+				_LightMaskAtlas atlas{ 64, 64 };
+				auto a = atlas.Insert( 64, 64 );
+				auto old = atlas.GetRect( a );
+
+				CHECK( atlas.Insert( 64, 64 ) == _LightMaskAtlas::invalidHandle );
+				CHECK( !atlas.Grow( 32, 128 ) );
+				CHECK( atlas.Grow( 128, 128 ) );
+				CHECK( IsSame( atlas.GetRect( a ), old ) );
+
+				std::map<Handle, Rect> sizes{ { a, old } };
+
+				for ( auto i = 0; i < 3; ++i ) {
+					auto handle = atlas.Insert( 64, 64 );
+
+					if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+						sizes[handle] = atlas.GetRect( handle );
+					}
+				}
+
+				CheckAtlas( atlas, sizes, 0 );
+				CHECK( atlas.GetOccupancy() == 1.f );
+			}
+
+			// random edits of editor. regions never overlap and removed area is used again
+			void TestRandomEdits()
+			{
+				constexpr uint32_t padding = 2;
+
+				std::mt19937 random{ 7 };
+				std::uniform_int_distribution<uint32_t> sizeDistribution{ 1, 96 };
+				_LightMaskAtlas atlas{ 512, 512, padding };
+				std::map<Handle, Rect> sizes;
+				auto failureCountOfFull = 0;
+
+				for ( auto step = 0; step < 2000; ++step ) {
+					auto operation = random() % 4;
+					auto width = sizeDistribution( random );
+					auto height = sizeDistribution( random );
+
+					if ( operation < 2 || sizes.empty() ) {
+						auto handle = atlas.Insert( width, height );
+
+						// it is full. it is compacted as _MaskAtlasTexture does
+						if ( handle == _LightMaskAtlas::invalidHandle ) {
+							++failureCountOfFull;
+
+							std::vector<_LightMaskAtlas::Move> moves;
+
+							if ( atlas.Defragment( moves ) ) {
+								CHECK( moves.size() == sizes.size() );
+								CheckAtlas( atlas, sizes, padding );
+							}
+
+							handle = atlas.Insert( width, height );
+						}
+
+						if ( handle != _LightMaskAtlas::invalidHandle ) {
+							sizes[handle] = { 0, 0, width, height };
+						}
+						// space is made by remove
+						else {
+							auto iterator = std::next( sizes.begin(), random() % sizes.size() );
+							auto reserved = atlas.GetReservedRect( iterator->first );
+							atlas.Remove( iterator->first );
+							sizes.erase( iterator );
+
+							// same size fits in removed area at least
+							handle = atlas.Insert( reserved.width - padding, reserved.height - padding );
+
+							if ( CHECK( handle != _LightMaskAtlas::invalidHandle ) ) {
+								sizes[handle] = { 0, 0, reserved.width - padding, reserved.height - padding };
+							}
+						}
+					}
+					else if ( operation == 2 ) {
+						auto iterator = std::next( sizes.begin(), random() % sizes.size() );
+						CHECK( atlas.Remove( iterator->first ) );
+						sizes.erase( iterator );
+					}
+					else {
+						auto iterator = std::next( sizes.begin(), random() % sizes.size() );
+						auto changed = false;
+
+						if ( atlas.Resize( iterator->first, width, height, changed ) ) {
+							iterator->second = { 0, 0, width, height };
+						}
+					}
+
+					if ( step % 50 == 0 ) {
+						CheckAtlas( atlas, sizes, padding );
+					}
+				}
+
+				CheckAtlas( atlas, sizes, padding );
+				CHECK( failureCountOfFull > 0 );
+			}
+		}
+
+		void TestLightMaskAtlas()
+		{
+			TestReuse();
+			TestInvalidInsert();
+			TestResize();
+			TestDefragment();
+			TestGrow();
+			TestRandomEdits();
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#include "Test.h"
+#include <cmath>
+#include <cstdlib>
+#include "../_LightMaskBaker.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			// BlurWeights13 of ps_gaussianblur.fx is gaussian of sigma 2 at -6..6
+			void TestBlurWeights()
+			{
+				const double pi = 3.14159265358979323846;
+				const double sigma = 2;
+				double sum{};
+
+				for ( size_t tap = 0; tap < _LightMaskBaker::blurTapCount; ++tap ) {
+					auto x = static_cast<double>( tap ) - 6;
+					auto weight = std::exp( -x * x / ( 2 * sigma * sigma ) ) / ( sigma * std::sqrt( 2 * pi ) );
+
+					CHECK( std::fabs( _LightMaskBaker::blurWeights[tap] - weight ) < 1e-6 );
+					sum += _LightMaskBaker::blurWeights[tap];
+				}
+
+				// taps out of -6..6 are dropped. so it is a little less than 1
+				CHECK( sum > 0.998 && sum < 1 );
+			}
+
+			// channels could differ by rounding of float
+			bool IsNear( uint32_t color, uint32_t expected )
+			{
+				for ( auto shift = 0; shift < 32; shift += 8 ) {
+					auto lhs = static_cast<int>( color >> shift & 0xff );
+					auto rhs = static_cast<int>( expected >> shift & 0xff );
+
+					if ( std::abs( lhs - rhs ) > 1 ) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			/*
+			 * square light of 80x80 and center at origin. mask is 40x40 and border is at 20 -+ 40 / 3
+			 *
+			 * expected texels are computed by hand in the way of device: v of fan is interpolated, light texture is point sampled,
+			 * x blur keeps v and y blur samples v -+ tap / 80. both passes are blended by SRCALPHA and DESTALPHA onto cleared target
+			 * color is r 255, g 127, b 63 by intensity 1
+			*/
+			void TestSquareLight()
+			{
+				_LightMaskBaker::Light light{};
+				light.points = { { 0, 0 }, { -40, -40 }, { 40, -40 }, { 40, 40 }, { -40, 40 } };
+				light.r = 1.f;
+				light.g = 0.5f;
+				light.b = 0.25f;
+				light.intensity = 1.f;
+				light.falloff = 0.5f;
+
+				_LightMaskBaker::Mask mask;
+
+				if ( !CHECK( _LightMaskBaker::Bake( mask, light ) ) ) {
+					return;
+				}
+
+				CHECK( mask.width == 40 );
+				CHECK( mask.height == 40 );
+				CHECK( mask.cx == 0.f );
+				CHECK( mask.cy == 0.f );
+				CHECK( mask.meshWidth == 120.f );
+				CHECK( mask.meshHeight == 120.f );
+
+				if ( !CHECK( mask.texels.size() == 40 * 40 ) ) {
+					return;
+				}
+
+				auto texel = [&mask]( uint32_t x, uint32_t y ) { return mask.texels[static_cast<size_t>( y ) * mask.width + x]; };
+
+				// v = 0.5 at center
+				CHECK( IsNear( texel( 20, 20 ), 0x4e9e4e27 ) );
+				// v = 0.125 at middle of center and border
+				CHECK( IsNear( texel( 30, 20 ), 0x041f0f08 ) );
+				CHECK( IsNear( texel( 20, 10 ), 0x041f0f08 ) );
+				// v = 0.0125 next to border
+				CHECK( IsNear( texel( 7, 20 ), 0x00040201 ) );
+				// out of border is cleared
+				CHECK( texel( 0, 0 ) == 0 );
+				CHECK( texel( 39, 39 ) == 0 );
+				CHECK( texel( 6, 20 ) == 0 );
+			}
+
+			// threads bake same masks of one by one
+			void TestThreads()
+			{
+				std::vector<_LightMaskBaker::Light> lights;
+
+				for ( auto i = 0; i < 5; ++i ) {
+					auto size = 20.f + i * 10.f;
+					lights.push_back( { { { 0, 0 }, { -size, -size }, { size, -size }, { size, size }, { -size, size } }, 1.f, 1.f, 1.f, 1.f, 0.3f + i * 0.1f } );
+				}
+
+				std::vector<_LightMaskBaker::Mask> masks;
+
+				if ( !CHECK( _LightMaskBaker::Bake( masks, lights, 3 ) ) || !CHECK( masks.size() == lights.size() ) ) {
+					return;
+				}
+
+				for ( size_t i = 0; i < lights.size(); ++i ) {
+					_LightMaskBaker::Mask mask;
+					_LightMaskBaker::Bake( mask, lights[i] );
+
+					CHECK( masks[i].texels == mask.texels );
+				}
+			}
+		}
+
+		void TestLightMaskBaker()
+		{
+			TestBlurWeights();
+			TestSquareLight();
+			TestThreads();
+		}
+	}
+}
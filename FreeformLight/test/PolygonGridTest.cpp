@@ -0,0 +1,237 @@
+#include "Test.h"
+#include <cmath>
+#include <random>
+#include "../_PolygonGrid.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			using Point = _PolygonGrid::Point;
+			using Points = _PolygonGrid::Points;
+
+			const float radius = 10.f;
+			const float width = 10.f;
+			const float endOffset = 12.f;
+			// query closer than it to a border of test is skipped. rounding can decide it either way
+			const float margin = 1e-3f;
+
+			// squared distance of nearest point in the radius. it is negative if there's nothing
+			float FindPoint( const Points& points, const Point& point )
+			{
+				auto nearestDistance = -1.f;
+
+				for ( auto& p : points ) {
+					auto dx = p.x - point.x;
+					auto dy = p.y - point.y;
+					auto distance = dx * dx + dy * dy;
+
+					if ( distance <= radius * radius && ( nearestDistance < 0 || distance < nearestDistance ) ) {
+						nearestDistance = distance;
+					}
+				}
+
+				return nearestDistance;
+			}
+
+			// distance from edge which starts at index. it is negative if the edge isn't hit
+			float GetEdgeDistance( const Points& points, size_t loopBegin, size_t index, const Point& point, bool* pIsClear )
+			{
+				auto& from = points[index];
+				auto& to = points[index + 1 == points.size() ? loopBegin : index + 1];
+				auto dx = to.x - from.x;
+				auto dy = to.y - from.y;
+				auto length = std::sqrt( dx * dx + dy * dy );
+
+				if ( length <= endOffset * 2 ) {
+					return -1.f;
+				}
+
+				auto px = point.x - from.x;
+				auto py = point.y - from.y;
+				auto along = ( px * dx + py * dy ) / length;
+				auto across = std::fabs( px * dy - py * dx ) / length;
+
+				if ( std::fabs( along - endOffset ) < margin || std::fabs( along - length + endOffset ) < margin || std::fabs( across - width ) < margin ) {
+					*pIsClear = false;
+				}
+
+				return ( along < endOffset || along > length - endOffset || across > width ) ? -1.f : across;
+			}
+
+			// distance of nearest edge in the width. it is same test of _PolygonGrid::FindEdge() by linear scan
+			float FindEdge( const Points& points, size_t loopBegin, const Point& point, bool* pIsClear )
+			{
+				auto nearestDistance = -1.f;
+
+				if ( points.size() < loopBegin + 3 ) {
+					return nearestDistance;
+				}
+
+				for ( auto i = loopBegin; i < points.size(); ++i ) {
+					auto distance = GetEdgeDistance( points, loopBegin, i, point, pIsClear );
+
+					if ( distance >= 0 && ( nearestDistance < 0 || distance < nearestDistance ) ) {
+						nearestDistance = distance;
+					}
+				}
+
+				return nearestDistance;
+			}
+
+			// grid has same points as linear one. queries of both find same distance
+			void CheckGrid( const _PolygonGrid& grid, const Points& points, size_t loopBegin, std::mt19937& random )
+			{
+				if ( !CHECK( grid.GetPointCount() == points.size() ) ) {
+					return;
+				}
+
+				for ( size_t i{}; i < points.size(); ++i ) {
+					CHECK( grid.GetPoint( i ).x == points[i].x && grid.GetPoint( i ).y == points[i].y );
+				}
+
+				std::uniform_real_distribution<float> positionDistribution{ -64.f, 320.f };
+
+				for ( auto i = 0; i < 64; ++i ) {
+					// query is near a point or an edge at half of them
+					Point point{ positionDistribution( random ), positionDistribution( random ) };
+
+					if ( !points.empty() && i % 2 ) {
+						auto& from = points[random() % points.size()];
+						auto& to = points[random() % points.size()];
+						auto t = ( random() % 1000 ) / 1000.f;
+
+						point = { from.x + ( to.x - from.x ) * t + ( random() % 21 ) - 10.5f, from.y + ( to.y - from.y ) * t + ( random() % 21 ) - 10.5f };
+					}
+
+					size_t index = points.size();
+					auto pointDistance = FindPoint( points, point );
+
+					if ( CHECK( grid.FindPoint( point, radius, &index ) == ( pointDistance >= 0 ) ) && pointDistance >= 0 && CHECK( index < points.size() ) ) {
+						auto dx = points[index].x - point.x;
+						auto dy = points[index].y - point.y;
+
+						CHECK( dx * dx + dy * dy == pointDistance );
+					}
+
+					auto isClear = true;
+					auto edgeDistance = FindEdge( points, loopBegin, point, &isClear );
+
+					if ( !isClear ) {
+						continue;
+					}
+
+					index = points.size();
+
+					if ( CHECK( grid.FindEdge( point, width, endOffset, &index ) == ( edgeDistance >= 0 ) ) && edgeDistance >= 0 && CHECK( index >= loopBegin && index < points.size() ) ) {
+						CHECK( std::fabs( GetEdgeDistance( points, loopBegin, index, point, &isClear ) - edgeDistance ) < margin );
+					}
+				}
+			}
+
+			// points before loop begin have no edge. polygon is made at third point of loop
+			void TestLoopBegin()
+			{
+				_PolygonGrid grid{ 16.f };
+				Points points{ { 100.f, 100.f }, { 0.f, 0.f }, { 200.f, 0.f } };
+				size_t index{};
+
+				grid.Build( points, 1 );
+				CHECK( grid.GetLoopBegin() == 1 );
+				CHECK( grid.FindPoint( { 103.f, 104.f }, radius, &index ) && index == 0 );
+				CHECK( !grid.FindEdge( { 100.f, 2.f }, width, endOffset, &index ) );
+
+				grid.Insert( 3, { 100.f, 200.f } );
+				CHECK( grid.GetPointCount() == 4 );
+				CHECK( grid.FindEdge( { 100.f, 2.f }, width, endOffset, &index ) && index == 1 );
+				CHECK( grid.FindEdge( { 48.f, 104.f }, width, endOffset, &index ) && index == 3 );
+
+				// insertion out of loop and removal of vertex are ignored
+				grid.Insert( 0, { 0.f, 0.f } );
+				grid.Remove( 0 );
+				CHECK( grid.GetPointCount() == 4 );
+
+				grid.Remove( 2 );
+				CHECK( grid.GetPointCount() == 3 );
+				CHECK( !grid.FindEdge( { 48.f, 104.f }, width, endOffset, &index ) );
+				CHECK( grid.FindPoint( { 98.f, 198.f }, radius, &index ) && index == 2 );
+
+				grid.Build( {}, 0 );
+				CHECK( grid.GetPointCount() == 0 && grid.GetCellCount() == 0 );
+				CHECK( !grid.FindPoint( { 0.f, 0.f }, radius, &index ) );
+			}
+
+			// random edits of editor. every query is same as linear scan and empty cells are released
+			void TestRandomEdits()
+			{
+				std::mt19937 random{ 7 };
+				std::uniform_int_distribution<int> positionDistribution{ -32, 288 };
+				auto getPoint = [&]() { return Point{ static_cast<float>( positionDistribution( random ) ), static_cast<float>( positionDistribution( random ) ) }; };
+
+				for ( size_t loopBegin : { 0, 1, 3 } ) {
+					_PolygonGrid grid{ 16.f };
+					Points points;
+
+					for ( auto i = 0; i < 12; ++i ) {
+						points.push_back( getPoint() );
+					}
+
+					grid.Build( points, loopBegin );
+					CheckGrid( grid, points, loopBegin, random );
+
+					for ( auto step = 0; step < 400; ++step ) {
+						auto operation = random() % 3;
+						auto loopSize = points.size() - loopBegin;
+
+						if ( operation == 0 && points.size() < 64 ) {
+							auto index = loopBegin + random() % ( loopSize + 1 );
+							auto point = getPoint();
+
+							grid.Insert( index, point );
+							points.insert( points.begin() + index, point );
+						}
+						else if ( operation == 1 && loopSize ) {
+							auto index = loopBegin + random() % loopSize;
+
+							grid.Remove( index );
+							points.erase( points.begin() + index );
+						}
+						else if ( !points.empty() ) {
+							auto index = random() % points.size();
+							auto point = getPoint();
+
+							// dragging moves point by a few pixels
+							if ( random() % 2 ) {
+								point = { points[index].x + ( random() % 9 ) - 4.f, points[index].y + ( random() % 9 ) - 4.f };
+							}
+
+							grid.Move( index, point );
+							points[index] = point;
+						}
+
+						CheckGrid( grid, points, loopBegin, random );
+					}
+
+					// edges and points are in a cell at least
+					CHECK( grid.GetCellCount() > 0 );
+
+					while ( points.size() > loopBegin ) {
+						grid.Remove( loopBegin );
+						points.erase( points.begin() + loopBegin );
+					}
+
+					CheckGrid( grid, points, loopBegin, random );
+				}
+			}
+		}
+
+		void TestPolygonGrid()
+		{
+			TestLoopBegin();
+			TestRandomEdits();
+		}
+	}
+}
@@ -0,0 +1,221 @@
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "../_PolygonTriangulator.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			using Point = _PolygonTriangulator::Point;
+			using Points = _PolygonTriangulator::Points;
+
+			// twice of signed area
+			inline float GetArea( const Point& p0, const Point& p1, const Point& p2 )
+			{
+				return ( p1.x - p0.x ) * ( p2.y - p0.y ) - ( p1.y - p0.y ) * ( p2.x - p0.x );
+			}
+
+			// triangles have winding of border and cover it exactly. every border edge is in a triangle once
+			void CheckTriangles( const _PolygonTriangulator& triangulator, const Points& points )
+			{
+				auto& indices = triangulator.GetIndices();
+				auto borderCount = points.size() - 1;
+
+				if ( !CHECK( triangulator.GetPoints().size() == points.size() ) ) {
+					return;
+				}
+
+				// ear clipping makes border - 2 triangles. center divides one of them into three
+				if ( !CHECK( indices.size() == borderCount * 3 ) ) {
+					return;
+				}
+
+				float borderArea{};
+
+				for ( size_t i = 1; i < points.size(); ++i ) {
+					borderArea += GetArea( points[0], points[i], points[i + 1 == points.size() ? 1 : i + 1] );
+				}
+
+				float area{};
+				std::map<std::pair<size_t, size_t>, int> edges;
+
+				for ( size_t i{}; i < indices.size(); i += 3 ) {
+					if ( !CHECK( indices[i] < points.size() && indices[i + 1] < points.size() && indices[i + 2] < points.size() ) ) {
+						return;
+					}
+
+					auto triangleArea = GetArea( points[indices[i]], points[indices[i + 1]], points[indices[i + 2]] );
+
+					CHECK( triangleArea * borderArea > 0 );
+					area += triangleArea;
+
+					++edges[{ indices[i], indices[i + 1] }];
+					++edges[{ indices[i + 1], indices[i + 2] }];
+					++edges[{ indices[i + 2], indices[i] }];
+				}
+
+				CHECK( std::fabs( area - borderArea ) <= std::fabs( borderArea ) * 1e-4f );
+
+				for ( size_t i = 1; i < points.size(); ++i ) {
+					auto next = ( i + 1 == points.size() ? 1 : i + 1 );
+					CHECK( edges[std::make_pair( i, next )] == 1 );
+				}
+			}
+
+			Points Reverse( const Points& points )
+			{
+				Points reversed{ points[0] };
+				reversed.insert( reversed.end(), points.rbegin(), points.rend() - 1 );
+
+				return reversed;
+			}
+
+			// center sees all border. it stays fan while the border is star shaped
+			void TestConvex( bool isReversed )
+			{
+				Points points{ { 1.f, 2.f } };
+
+				for ( auto i = 0; i < 8; ++i ) {
+					auto angle = 3.14159265f * 2 * i / 8;
+					points.push_back( { std::cos( angle ) * 40.f, std::sin( angle ) * 40.f } );
+				}
+
+				if ( isReversed ) {
+					points = Reverse( points );
+				}
+
+				_PolygonTriangulator triangulator;
+				triangulator.Build( points );
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// point out of edge
+				Point point{ ( points[2].x + points[3].x ) * 0.6f, ( points[2].y + points[3].y ) * 0.6f };
+				triangulator.Insert( 3, point );
+				points.insert( points.begin() + 3, point );
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// star shaped but concave
+				point = { points[6].x * 0.3f, points[6].y * 0.3f };
+				triangulator.Move( 6, point );
+				points[6] = point;
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				triangulator.Remove( 1 );
+				points.erase( points.begin() + 1 );
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// point out of edge which closes border
+				point = { ( points.back().x + points[1].x ) * 0.55f, ( points.back().y + points[1].y ) * 0.55f };
+				triangulator.Insert( points.size(), point );
+				points.push_back( point );
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// center moves in the border
+				triangulator.Move( 0, { -3.f, 1.f } );
+				points[0] = { -3.f, 1.f };
+				CheckTriangles( triangulator, points );
+			}
+
+			// u shape. center in the bottom can't see inside of right arm. so ears are clipped
+			void TestConcave( bool isReversed )
+			{
+				Points points{ { 4.f, 6.f }, { 0.f, 0.f }, { 30.f, 0.f }, { 30.f, 30.f }, { 20.f, 30.f }, { 20.f, 10.f }, { 10.f, 10.f }, { 10.f, 30.f }, { 0.f, 30.f } };
+
+				if ( isReversed ) {
+					points = Reverse( points );
+				}
+
+				auto find = [&points]( float x, float y ) {
+					size_t index = 1;
+
+					while ( index < points.size() && ( points[index].x != x || points[index].y != y ) ) {
+						++index;
+					}
+
+					return index;
+				};
+
+				_PolygonTriangulator triangulator;
+				triangulator.Build( points );
+				CHECK( !triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// point is put on the edge between them. it doesn't depend on order
+				auto insert = [&]( const Point& from, const Point& to, const Point& point ) {
+					auto index = std::max( find( from.x, from.y ), find( to.x, to.y ) );
+
+					triangulator.Insert( index, point );
+					points.insert( points.begin() + index, point );
+				};
+
+				// point under bottom edge
+				insert( { 0.f, 0.f }, { 30.f, 0.f }, { 15.f, -3.f } );
+				CHECK( !triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				// corner in the notch goes up
+				auto index = find( 10.f, 10.f );
+				Point point{ 12.f, 14.f };
+				triangulator.Move( index, point );
+				points[index] = point;
+				CHECK( !triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				index = find( 20.f, 30.f );
+				triangulator.Remove( index );
+				points.erase( points.begin() + index );
+				CHECK( !triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+
+				insert( { 10.f, 30.f }, { 0.f, 30.f }, { 5.f, 35.f } );
+				CheckTriangles( triangulator, points );
+
+				// notch is closed. center sees all border again
+				index = find( 20.f, 10.f );
+				triangulator.Move( index, { 20.f, 29.f } );
+				points[index] = { 20.f, 29.f };
+				CheckTriangles( triangulator, points );
+
+				index = find( 12.f, 14.f );
+				triangulator.Move( index, { 10.f, 29.f } );
+				points[index] = { 10.f, 29.f };
+				CHECK( triangulator.IsFan() );
+				CheckTriangles( triangulator, points );
+			}
+
+			// center out of border is drawn by overlapped fan
+			void TestCenterOutside()
+			{
+				Points points{ { 100.f, 100.f }, { 0.f, 0.f }, { 30.f, 0.f }, { 30.f, 30.f }, { 15.f, 10.f }, { 0.f, 30.f } };
+
+				_PolygonTriangulator triangulator;
+				triangulator.Build( points );
+				CHECK( !triangulator.IsFan() );
+				CHECK( triangulator.GetIndices().size() == ( points.size() - 1 ) * 3 );
+
+				// too few points
+				triangulator.Build( { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f } } );
+				CHECK( triangulator.GetIndices().empty() );
+			}
+		}
+
+		void TestPolygonTriangulator()
+		{
+			TestConvex( false );
+			TestConvex( true );
+			TestConcave( false );
+			TestConcave( true );
+			TestCenterOutside();
+		}
+	}
+}
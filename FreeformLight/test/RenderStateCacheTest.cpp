@@ -0,0 +1,128 @@
+#include "Test.h"
+#include "../_RenderStateCache.h"
+#include "../_RecordingRenderStateDevice.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		namespace
+		{
+			using Kind = _RenderStateDevice::Kind;
+
+			// a value which is same as known one isn't set to device
+			void TestSkippedSet()
+			{
+				_RecordingRenderStateDevice device;
+				auto scaling = _RecordingRenderStateDevice::GetIdentity();
+				scaling._11 = 2.f;
+
+				_RenderStateCache::ResetStatistics();
+
+				{
+					_RenderStateCache stateCache{ device };
+
+					// same as device. it is read only
+					stateCache.SetRenderState( D3DRS_SCISSORTESTENABLE, FALSE );
+					CHECK( device.GetGetCount() == 1 );
+					CHECK( device.GetSetCount() == 0 );
+
+					stateCache.SetRenderState( D3DRS_SCISSORTESTENABLE, TRUE );
+					stateCache.SetRenderState( D3DRS_SCISSORTESTENABLE, TRUE );
+					CHECK( device.GetGetCount() == 1 );
+					CHECK( device.GetSetCount() == 1 );
+					CHECK( device.PeekState( Kind::renderState, 0, D3DRS_SCISSORTESTENABLE ) == TRUE );
+
+					stateCache.SetTransform( D3DTS_WORLD, scaling );
+					stateCache.SetTransform( D3DTS_WORLD, scaling );
+					CHECK( device.GetGetCount() == 2 );
+					CHECK( device.GetSetCount() == 2 );
+
+					// stages are different states
+					stateCache.SetSamplerState( 0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP );
+					stateCache.SetSamplerState( 1, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP );
+					CHECK( device.GetSetCount() == 4 );
+					CHECK( _RenderStateCache::GetStatistics().avoidedSetCount == 3 );
+				}
+
+				// states before it are set back
+				CHECK( device.PeekState( Kind::renderState, 0, D3DRS_SCISSORTESTENABLE ) == FALSE );
+				CHECK( device.PeekState( Kind::samplerState, 1, D3DSAMP_ADDRESSU ) == 0 );
+				CHECK( _RecordingRenderStateDevice::IsEqual( device.PeekTransform( D3DTS_WORLD ), _RecordingRenderStateDevice::GetIdentity() ) );
+				CHECK( device.GetSetCount() == 8 );
+			}
+
+			// blur mask of a light is updated in nested scope. texture transform of parent scope is set back after it
+			void TestNestedRestore()
+			{
+				_RecordingRenderStateDevice device;
+				auto identity = _RecordingRenderStateDevice::GetIdentity();
+				auto atlasMapping = identity;
+				atlasMapping._11 = 0.25f;
+				atlasMapping._22 = 0.5f;
+				atlasMapping._31 = 0.75f;
+
+				{
+					_RenderStateCache passStateCache{ device };
+					passStateCache.SetTransform( D3DTS_TEXTURE0, atlasMapping );
+					passStateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2 );
+
+					{
+						_RenderStateCache blurStateCache{ passStateCache };
+						blurStateCache.SetTransform( D3DTS_TEXTURE0, identity );
+						blurStateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE );
+
+						CHECK( device.PeekState( Kind::textureStageState, 0, D3DTSS_TEXTURETRANSFORMFLAGS ) == D3DTTFF_DISABLE );
+						CHECK( _RecordingRenderStateDevice::IsEqual( device.PeekTransform( D3DTS_TEXTURE0 ), identity ) );
+
+						device.ClearCounts();
+					}
+
+					// states of pass come back. nested one shares known states so nothing is read
+					CHECK( device.PeekState( Kind::textureStageState, 0, D3DTSS_TEXTURETRANSFORMFLAGS ) == D3DTTFF_COUNT2 );
+					CHECK( _RecordingRenderStateDevice::IsEqual( device.PeekTransform( D3DTS_TEXTURE0 ), atlasMapping ) );
+					CHECK( device.GetGetCount() == 0 );
+					CHECK( device.GetSetCount() == 2 );
+
+					// known states are restored ones. next light sets nothing
+					device.ClearCounts();
+					passStateCache.SetTransform( D3DTS_TEXTURE0, atlasMapping );
+					passStateCache.SetTextureStageState( 0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_COUNT2 );
+					CHECK( device.GetGetCount() == 0 );
+					CHECK( device.GetSetCount() == 0 );
+				}
+
+				CHECK( device.PeekState( Kind::textureStageState, 0, D3DTSS_TEXTURETRANSFORMFLAGS ) == D3DTTFF_DISABLE );
+				CHECK( _RecordingRenderStateDevice::IsEqual( device.PeekTransform( D3DTS_TEXTURE0 ), identity ) );
+			}
+
+			// state set in nested scope only is restored by the nested one. parent doesn't set it again
+			void TestNestedOnlyState()
+			{
+				_RecordingRenderStateDevice device;
+
+				{
+					_RenderStateCache passStateCache{ device };
+
+					{
+						_RenderStateCache blurStateCache{ passStateCache };
+						blurStateCache.SetRenderState( D3DRS_SCISSORTESTENABLE, TRUE );
+					}
+
+					CHECK( device.PeekState( Kind::renderState, 0, D3DRS_SCISSORTESTENABLE ) == FALSE );
+					device.ClearCounts();
+				}
+
+				CHECK( device.GetSetCount() == 0 );
+			}
+		}
+
+		void TestRenderStateCache()
+		{
+			TestSkippedSet();
+			TestNestedRestore();
+			TestNestedOnlyState();
+		}
+	}
+}
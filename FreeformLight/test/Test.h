@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdio>
+
+
+/*
+ * checks of FreeformLight which run without d3d device
+ *
+ * failed check is printed and counted. main() returns count of them
+*/
+namespace FreeformLight
+{
+	namespace Test
+	{
+		extern int failureCount;
+
+		inline bool Check( bool isPassed, const char* expression, const char* file, int line )
+		{
+			if ( !isPassed ) {
+				printf( "%s(%d): failed: %s\n", file, line, expression );
+				++failureCount;
+			}
+
+			return isPassed;
+		}
+
+		void TestLightMaskBaker();
+		void TestLightBatch();
+		void TestLightMaskAtlas();
+		void TestPolygonGrid();
+		void TestPolygonTriangulator();
+		void TestRenderStateCache();
+	}
+}
+
+#define CHECK( x ) ::FreeformLight::Test::Check( ( x ), #x, __FILE__, __LINE__ )
@@ -0,0 +1,37 @@
+#include "Test.h"
+
+
+namespace FreeformLight
+{
+	namespace Test
+	{
+		int failureCount{};
+	}
+}
+
+int main()
+{
+	using namespace FreeformLight::Test;
+
+	const struct
+	{
+		const char* name;
+		void ( *function )();
+	} tests[] = {
+		{ "light mask baker", TestLightMaskBaker },
+		{ "light batch", TestLightBatch },
+		{ "light mask atlas", TestLightMaskAtlas },
+		{ "polygon grid", TestPolygonGrid },
+		{ "polygon triangulator", TestPolygonTriangulator },
+		{ "render state cache", TestRenderStateCache },
+	};
+
+	for ( auto& test : tests ) {
+		auto oldFailureCount = failureCount;
+		test.function();
+
+		printf( "%s: %s\n", test.name, oldFailureCount == failureCount ? "ok" : "FAILED" );
+	}
+
+	return failureCount;
+}
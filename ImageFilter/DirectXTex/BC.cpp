@@ -372,6 +372,60 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Integer variant of DecodeBC1 for 8-bit unorm targets (RGBA byte order)
+    //-------------------------------------------------------------------------------------
+    inline void DecodeBC1UNorm8(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pColor,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        assert(pColor && pBC);
+
+        uint32_t r[4], g[4], b[4], a[4];
+        for (size_t j = 0; j < 2; ++j)
+        {
+            uint32_t w = pBC->rgb[j];
+            uint32_t r5 = (w >> 11) & 0x1f;
+            uint32_t g6 = (w >> 5) & 0x3f;
+            uint32_t b5 = w & 0x1f;
+
+            r[j] = (r5 << 3) | (r5 >> 2);
+            g[j] = (g6 << 2) | (g6 >> 4);
+            b[j] = (b5 << 3) | (b5 >> 2);
+            a[j] = 255;
+        }
+
+        if (isbc1 && (pBC->rgb[0] <= pBC->rgb[1]))
+        {
+            r[2] = (r[0] + r[1] + 1) >> 1;
+            g[2] = (g[0] + g[1] + 1) >> 1;
+            b[2] = (b[0] + b[1] + 1) >> 1;
+            a[2] = 255;
+            r[3] = g[3] = b[3] = a[3] = 0;
+        }
+        else
+        {
+            r[2] = (2 * r[0] + r[1] + 1) / 3;
+            g[2] = (2 * g[0] + g[1] + 1) / 3;
+            b[2] = (2 * b[0] + b[1] + 1) / 3;
+            a[2] = 255;
+            r[3] = (r[0] + 2 * r[1] + 1) / 3;
+            g[3] = (g[0] + 2 * g[1] + 1) / 3;
+            b[3] = (b[0] + 2 * b[1] + 1) / 3;
+            a[3] = 255;
+        }
+
+        uint32_t palette[4];
+        for (size_t j = 0; j < 4; ++j)
+            palette[j] = r[j] | (g[j] << 8) | (b[j] << 16) | (a[j] << 24);
+
+        uint32_t dw = pBC->bitmap;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
+            memcpy(pColor + i * 4, &palette[dw & 3], sizeof(uint32_t));
+    }
+
+
     //-------------------------------------------------------------------------------------
     void EncodeBC1(
         _Out_ D3DX_BC1 *pBC,
@@ -734,6 +788,13 @@ void DirectX::D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
     DecodeBC1(pColor, pBC1, true);
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC1UNorm8(uint8_t *pColor, const uint8_t *pBC)
+{
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+    DecodeBC1UNorm8(pColor, pBC1, true);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float threshold, DWORD flags)
 {
@@ -825,6 +886,23 @@ void DirectX::D3DXDecodeBC2(XMVECTOR *pColor, const uint8_t *pBC)
         pColor[i] = XMVectorSetW(pColor[i], (float)(dw & 0xf) * (1.0f / 15.0f));
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC2UNorm8(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert(pColor && pBC);
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // RGB part
+    DecodeBC1UNorm8(pColor, &pBC2->bc1, false);
+
+    // 4-bit alpha part
+    uint64_t dw = pBC2->bitmap[0] | (uint64_t(pBC2->bitmap[1]) << 32);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
+        pColor[i * 4 + 3] = uint8_t((dw & 0xf) * 17);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -944,6 +1022,20 @@ void DirectX::D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
         pColor[i] = XMVectorSetW(pColor[i], fAlpha[dw & 0x7]);
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC3UNorm8(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert(pColor && pBC);
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // RGB part
+    DecodeBC1UNorm8(pColor, &pBC3->bc1, false);
+
+    // Adaptive 3-bit alpha part
+    DecodeBC4UNorm8(pColor + 3, 4, pBC);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -305,6 +305,40 @@ template <bool bRange> void OptimizeAlpha(float *pX, float *pY, const float *pPo
 typedef void (*BC_DECODE)(XMVECTOR *pColor, const uint8_t *pBC);
 typedef void (*BC_ENCODE)(uint8_t *pDXT, const XMVECTOR *pColor, DWORD flags);
 
+typedef void (*BC_DECODE_UNORM8)(uint8_t *pColor, const uint8_t *pBC);
+    // Integer decoders for 8-bit unorm targets, texels are tightly packed (RGBA for BC1-3, R for BC4, RG for BC5)
+
+// Expands a BC3 alpha or BC4 unorm block (two endpoints and 3-bit indices) to 8-bit values
+inline void DecodeBC4UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK * stride) uint8_t *pValue, _In_ size_t stride, _In_reads_(8) const uint8_t *pBC)
+{
+    assert(pValue && pBC);
+
+    uint8_t palette[8];
+    palette[0] = pBC[0];
+    palette[1] = pBC[1];
+
+    if (pBC[0] > pBC[1])
+    {
+        for (unsigned i = 1; i < 7; ++i)
+            palette[i + 1] = uint8_t(((7 - i) * pBC[0] + i * pBC[1] + 3) / 7);
+    }
+    else
+    {
+        for (unsigned i = 1; i < 5; ++i)
+            palette[i + 1] = uint8_t(((5 - i) * pBC[0] + i * pBC[1] + 2) / 5);
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 6; ++i)
+        bits |= uint64_t(pBC[2 + i]) << (8 * i);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, bits >>= 3)
+        pValue[i * stride] = palette[bits & 0x7];
+}
+
 void D3DXDecodeBC1(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
 void D3DXDecodeBC2(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC3(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
@@ -316,6 +350,12 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+void D3DXDecodeBC1UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC2UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC3UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC4UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK) uint8_t *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC5UNorm8(_Out_writes_(NUM_PIXELS_PER_BLOCK * 2) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float threshold, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
 
@@ -404,6 +404,12 @@ void DirectX::D3DXDecodeBC4U(XMVECTOR *pColor, const uint8_t *pBC)
     }
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC4UNorm8(uint8_t *pColor, const uint8_t *pBC)
+{
+    DecodeBC4UNorm8(pColor, 1, pBC);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXDecodeBC4S(XMVECTOR *pColor, const uint8_t *pBC)
 {
@@ -481,6 +487,13 @@ void DirectX::D3DXDecodeBC5U(XMVECTOR *pColor, const uint8_t *pBC)
     }
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC5UNorm8(uint8_t *pColor, const uint8_t *pBC)
+{
+    DecodeBC4UNorm8(pColor, 2, pBC);
+    DecodeBC4UNorm8(pColor + 1, 2, pBC + sizeof(BC4_UNORM));
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXDecodeBC5S(XMVECTOR *pColor, const uint8_t *pBC)
 {
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 #if !defined(__d3d11_h__) && !defined(__d3d11_x_h__) && !defined(__d3d12_h__) && !defined(__d3d12_x_h__)
@@ -210,6 +211,14 @@ namespace DirectX
             // Filtering mode to use for any required image resizing (only needed when loading arrays of differently sized images; defaults to Fant)
     };
 
+    enum TGA_FLAGS
+    {
+        TGA_FLAGS_NONE                  = 0x0,
+
+        TGA_FLAGS_RLE                   = 0x1,
+            // TGA writer run-length encodes the pixel data (image types 10 and 11)
+    };
+
     HRESULT __cdecl GetMetadataFromDDSMemory( _In_reads_bytes_(size) const void* pSource, _In_ size_t size, _In_ DWORD flags,
                                               _Out_ TexMetadata& metadata );
     HRESULT __cdecl GetMetadataFromDDSFile( _In_z_ const wchar_t* szFile, _In_ DWORD flags,
@@ -245,13 +254,58 @@ namespace DirectX
         uint8_t*    pixels;
     };
 
+    //---------------------------------------------------------------------------------
+    // Size-class pool for ScratchImage pixel memory
+    //  Released blocks are kept per size class (four classes per power of two) and handed back to
+    //  later allocations of similar size. A pool must outlive every ScratchImage allocated from it.
+    class ScratchImagePool
+    {
+    public:
+        struct Stats
+        {
+            size_t requests;        // allocations asked of the pool
+            size_t hits;            // allocations served from a retained block
+            size_t retainedBytes;
+            size_t retainedBlocks;
+        };
+
+        explicit ScratchImagePool( _In_ size_t maxRetainedBytes = 256 * 1024 * 1024 );
+        ~ScratchImagePool();
+
+        ScratchImagePool(const ScratchImagePool&) = delete;
+        ScratchImagePool& operator=(const ScratchImagePool&) = delete;
+
+        uint8_t* __cdecl Allocate( _In_ size_t size, _Out_ size_t& capacity );
+        void __cdecl Free( _In_opt_ uint8_t* memory, _In_ size_t capacity );
+
+        void __cdecl Trim();
+            // Returns every retained block to the system allocator
+
+        Stats __cdecl GetStats() const;
+
+        static void __cdecl SetDefault( _In_opt_ ScratchImagePool* pool );
+            // Pool used by ScratchImages constructed without one
+        static void __cdecl SetThreadDefault( _In_opt_ ScratchImagePool* pool );
+            // Overrides SetDefault for ScratchImages constructed on the calling thread
+        static ScratchImagePool* __cdecl GetDefault();
+
+    private:
+        mutable std::mutex                  m_mutex;
+        std::vector<std::vector<uint8_t*>>  m_free;
+        size_t                              m_maxRetainedBytes;
+        Stats                               m_stats;
+    };
+
     class ScratchImage
     {
     public:
         ScratchImage()
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) {}
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr),
+              m_pool(ScratchImagePool::GetDefault()), m_capacity(0) {}
+        explicit ScratchImage(_In_opt_ ScratchImagePool* pool)
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_pool(pool), m_capacity(0) {}
         ScratchImage(ScratchImage&& moveFrom)
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) { *this = std::move(moveFrom); }
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_pool(nullptr), m_capacity(0) { *this = std::move(moveFrom); }
         ~ScratchImage() { Release(); }
 
         ScratchImage& __cdecl operator= (ScratchImage&& moveFrom);
@@ -286,12 +340,16 @@ namespace DirectX
 
         bool __cdecl IsAlphaAllOpaque() const;
 
+        ScratchImagePool* __cdecl GetPool() const { return m_pool; }
+
     private:
-        size_t      m_nimages;
-        size_t      m_size;
-        TexMetadata m_metadata;
-        Image*      m_image;
-        uint8_t*    m_memory;
+        size_t              m_nimages;
+        size_t              m_size;
+        TexMetadata         m_metadata;
+        Image*              m_image;
+        uint8_t*            m_memory;
+        ScratchImagePool*   m_pool;
+        size_t              m_capacity;
     };
 
     //---------------------------------------------------------------------------------
@@ -322,6 +380,57 @@ namespace DirectX
         size_t  m_size;
     };
 
+    //---------------------------------------------------------------------------------
+    // Read-only memory-mapped DDS file (Win32 file mapping, Windows only like the rest of the library)
+    //  When no conversion is required the images are views directly into the mapping, otherwise
+    //  GetImage converts a single mip/array slice on demand so large arrays can be streamed
+    class DDSFileMapping
+    {
+    public:
+        DDSFileMapping()
+            : m_base(nullptr), m_size(0), m_flags(0), m_cpFlags(0), m_convFlags(0), m_pal8(nullptr),
+              m_direct(false), m_nimages(0), m_metadata{}, m_image(nullptr) {}
+        DDSFileMapping(DDSFileMapping&& moveFrom)
+            : m_base(nullptr), m_size(0), m_flags(0), m_cpFlags(0), m_convFlags(0), m_pal8(nullptr),
+              m_direct(false), m_nimages(0), m_metadata{}, m_image(nullptr) { *this = std::move(moveFrom); }
+        ~DDSFileMapping() { Close(); }
+
+        DDSFileMapping& __cdecl operator= (DDSFileMapping&& moveFrom);
+
+        DDSFileMapping(const DDSFileMapping&) = delete;
+        DDSFileMapping& operator=(const DDSFileMapping&) = delete;
+
+        HRESULT __cdecl Open( _In_z_ const wchar_t* szFile, _In_ DWORD flags );
+
+        void __cdecl Close();
+
+        const TexMetadata& __cdecl GetMetadata() const { return m_metadata; }
+
+        bool __cdecl IsDirect() const { return m_direct; }
+            // Pixel data can be used in place (no legacy expansion, swizzle or DXTn tail fix-up is required)
+
+        const Image* __cdecl GetImages() const { return m_direct ? m_image : nullptr; }
+        size_t __cdecl GetImageCount() const { return m_direct ? m_nimages : 0; }
+
+        HRESULT __cdecl GetImage( _In_ size_t mip, _In_ size_t item, _In_ size_t slice, _Out_ ScratchImage& image ) const;
+            // Copies (converting if required) a single image out of the mapping
+
+        HRESULT __cdecl CopyTo( _Out_ ScratchImage& image ) const;
+            // Copies (converting if required) the whole file, same result as LoadFromDDSFile
+
+    private:
+        const uint8_t*  m_base;
+        size_t          m_size;
+        DWORD           m_flags;
+        DWORD           m_cpFlags;
+        DWORD           m_convFlags;
+        const uint32_t* m_pal8;
+        bool            m_direct;
+        size_t          m_nimages;
+        TexMetadata     m_metadata;
+        Image*          m_image;
+    };
+
     //---------------------------------------------------------------------------------
     // Image I/O
 
@@ -354,8 +463,15 @@ namespace DirectX
     HRESULT __cdecl LoadFromTGAFile( _In_z_ const wchar_t* szFile,
                                      _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
 
+    HRESULT __cdecl GetImageFromTGAMemory( _In_reads_bytes_(size) const void* pSource, _In_ size_t size,
+                                           _Out_opt_ TexMetadata* metadata, _Out_ Image& image );
+        // Returns a view into pSource without copying; only uncompressed, top-down files qualify.
+        // 32bpp data is reported as DXGI_FORMAT_B8G8R8A8_UNORM and alpha is returned as stored
+
     HRESULT __cdecl SaveToTGAMemory( _In_ const Image& image, _Out_ Blob& blob );
+    HRESULT __cdecl SaveToTGAMemory( _In_ const Image& image, _In_ DWORD flags, _Out_ Blob& blob );
     HRESULT __cdecl SaveToTGAFile( _In_ const Image& image, _In_z_ const wchar_t* szFile );
+    HRESULT __cdecl SaveToTGAFile( _In_ const Image& image, _In_ DWORD flags, _In_z_ const wchar_t* szFile );
 
     // Texture conversion, resizing, mipmap generation, and block compression
 
@@ -380,6 +380,60 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Picks an integer decoder when the target is the block format's own 8-bit unorm layout
+    //-------------------------------------------------------------------------------------
+    bool GetUNorm8Decoder(
+        _In_ DXGI_FORMAT cformat,
+        _In_ DXGI_FORMAT format,
+        _Out_ BC_DECODE_UNORM8& pfDecode,
+        _Out_ bool& swapRB)
+    {
+        pfDecode = nullptr;
+        swapRB = false;
+
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1UNorm8; break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2UNorm8; break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3UNorm8; break;
+
+        case DXGI_FORMAT_BC4_UNORM:
+            pfDecode = D3DXDecodeBC4UNorm8;
+            return (format == DXGI_FORMAT_R8_UNORM);
+
+        case DXGI_FORMAT_BC5_UNORM:
+            pfDecode = D3DXDecodeBC5UNorm8;
+            return (format == DXGI_FORMAT_R8G8_UNORM);
+
+        default:
+            return false;
+        }
+
+        // sRGB <-> linear needs the float path
+        if (IsSRGB(cformat) != IsSRGB(format))
+            return false;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return true;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            swapRB = true;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+
     //-------------------------------------------------------------------------------------
     HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result)
     {
@@ -444,53 +498,77 @@ namespace
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
         }
 
-        __declspec(align(16)) XMVECTOR temp[16];
-        const uint8_t *pSrc = cImage.pixels;
+        // 8-bit unorm targets of BC1-BC5 skip the float intermediate
+        BC_DECODE_UNORM8 pfDecode8;
+        bool swapRB;
+        if (!GetUNorm8Decoder(cformat, format, pfDecode8, swapRB))
+            pfDecode8 = nullptr;
+
+        // Block rows are independent, so bands of them are decoded in parallel
+        const size_t nBlockRows = (cImage.height + 3) / 4;
         const size_t rowPitch = result.rowPitch;
-        for (size_t h = 0; h < cImage.height; h += 4)
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (nBlockRows > 1)
+#endif
+        for (int by = 0; by < static_cast<int>(nBlockRows); ++by)
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
+            const size_t h = size_t(by) * 4;
+            const uint8_t *sptr = cImage.pixels + cImage.rowPitch * by;
+            uint8_t* dptr = pDest + rowPitch * h;
             size_t ph = std::min<size_t>(4, cImage.height - h);
             size_t w = 0;
             for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4)
             {
-                pfDecode(temp, sptr);
-                _ConvertScanline(temp, 16, format, cformat, 0);
-
                 size_t pw = std::min<size_t>(4, cImage.width - w);
                 assert(pw > 0 && ph > 0);
 
-                if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
-                    return E_FAIL;
-
-                if (ph > 1)
+                if (pfDecode8)
                 {
-                    if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
-                        return E_FAIL;
+                    __declspec(align(16)) uint8_t texels[NUM_PIXELS_PER_BLOCK * 4];
+                    pfDecode8(texels, sptr);
 
-                    if (ph > 2)
+                    for (size_t t = 0; t < ph; ++t)
                     {
-                        if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
-                            return E_FAIL;
-
-                        if (ph > 3)
+                        const uint8_t *tptr = texels + t * 4 * dbpp;
+                        uint8_t *rptr = dptr + rowPitch * t;
+                        if (swapRB)
                         {
-                            if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
-                                return E_FAIL;
+                            for (size_t s = 0; s < pw; ++s, tptr += 4, rptr += 4)
+                            {
+                                rptr[0] = tptr[2];
+                                rptr[1] = tptr[1];
+                                rptr[2] = tptr[0];
+                                rptr[3] = tptr[3];
+                            }
                         }
+                        else
+                        {
+                            memcpy(rptr, tptr, pw * dbpp);
+                        }
+                    }
+                }
+                else
+                {
+                    __declspec(align(16)) XMVECTOR temp[16];
+                    pfDecode(temp, sptr);
+                    _ConvertScanline(temp, 16, format, cformat, 0);
+
+                    for (size_t t = 0; t < ph; ++t)
+                    {
+                        if (!_StoreScanline(dptr + rowPitch * t, rowPitch, format, &temp[t * 4], pw))
+                            fail = true;
                     }
                 }
 
                 sptr += sbpp;
                 dptr += dbpp * 4;
             }
-
-            pSrc += cImage.rowPitch;
-            pDest += rowPitch * 4;
         }
 
-        return S_OK;
+        return (fail) ? E_FAIL : S_OK;
     }
 }
 
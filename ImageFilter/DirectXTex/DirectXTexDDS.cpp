@@ -1116,6 +1116,80 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Adds the source pitch flags required to read a legacy format before expansion
+    //-------------------------------------------------------------------------------------
+    DWORD GetSourceCPFlags(DWORD cpFlags, DWORD convFlags)
+    {
+        if (convFlags & CONV_FLAGS_EXPAND)
+        {
+            if (convFlags & CONV_FLAGS_888)
+                cpFlags |= CP_FLAGS_24BPP;
+            else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8))
+                cpFlags |= CP_FLAGS_16BPP;
+            else if (convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8))
+                cpFlags |= CP_FLAGS_8BPP;
+        }
+
+        return cpFlags;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Converts or copies the scanlines of a single non-compressed, non-planar image
+    //-------------------------------------------------------------------------------------
+    bool ConvertScanlines(
+        _Out_writes_bytes_(dpitch * height) uint8_t* pDest,
+        _In_ size_t dpitch,
+        _In_reads_bytes_(spitch * height) const uint8_t* pSrc,
+        _In_ size_t spitch,
+        _In_ size_t height,
+        _In_ DXGI_FORMAT format,
+        _In_ DWORD convFlags,
+        _In_reads_opt_(256) const uint32_t *pal8)
+    {
+        DWORD tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
+        if (convFlags & CONV_FLAGS_SWIZZLE)
+            tflags |= TEXP_SCANLINE_LEGACY;
+
+        for (size_t h = 0; h < height; ++h)
+        {
+            if (convFlags & CONV_FLAGS_EXPAND)
+            {
+                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
+                {
+                    if (!_ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
+                        pSrc, spitch,
+                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
+                        tflags))
+                        return false;
+                }
+                else
+                {
+                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
+                    if (!LegacyExpandScanline(pDest, dpitch, format,
+                        pSrc, spitch, lformat, pal8,
+                        tflags))
+                        return false;
+                }
+            }
+            else if (convFlags & CONV_FLAGS_SWIZZLE)
+            {
+                _SwizzleScanline(pDest, dpitch, pSrc, spitch, format, tflags);
+            }
+            else
+            {
+                _CopyScanline(pDest, dpitch, pSrc, spitch, format, tflags);
+            }
+
+            pSrc += spitch;
+            pDest += dpitch;
+        }
+
+        return true;
+    }
+
+
     //-------------------------------------------------------------------------------------
     // Converts or copies image data from pPixels into scratch image data
     //-------------------------------------------------------------------------------------
@@ -1134,15 +1208,7 @@ namespace
         if (!size)
             return E_FAIL;
 
-        if (convFlags & CONV_FLAGS_EXPAND)
-        {
-            if (convFlags & CONV_FLAGS_888)
-                cpFlags |= CP_FLAGS_24BPP;
-            else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8))
-                cpFlags |= CP_FLAGS_16BPP;
-            else if (convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8))
-                cpFlags |= CP_FLAGS_8BPP;
-        }
+        cpFlags = GetSourceCPFlags(cpFlags, convFlags);
 
         size_t pixelSize, nimages;
         _DetermineImageArray(metadata, cpFlags, nimages, pixelSize);
@@ -1178,10 +1244,6 @@ namespace
             return E_FAIL;
         }
 
-        DWORD tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
-        if (convFlags & CONV_FLAGS_SWIZZLE)
-            tflags |= TEXP_SCANLINE_LEGACY;
-
         switch (metadata.dimension)
         {
         case TEX_DIMENSION_TEXTURE1D:
@@ -1244,41 +1306,9 @@ namespace
                     }
                     else
                     {
-                        for (size_t h = 0; h < images[index].height; ++h)
-                        {
-                            if (convFlags & CONV_FLAGS_EXPAND)
-                            {
-                                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
-                                {
-                                    if (!_ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                        pSrc, spitch,
-                                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
-                                    if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, pal8,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                            }
-                            else if (convFlags & CONV_FLAGS_SWIZZLE)
-                            {
-                                _SwizzleScanline(pDest, dpitch, pSrc, spitch,
-                                    metadata.format, tflags);
-                            }
-                            else
-                            {
-                                _CopyScanline(pDest, dpitch, pSrc, spitch,
-                                    metadata.format, tflags);
-                            }
-
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
+                        if (!ConvertScanlines(pDest, dpitch, pSrc, spitch, images[index].height,
+                            metadata.format, convFlags, pal8))
+                            return E_FAIL;
                     }
                 }
             }
@@ -1337,39 +1367,9 @@ namespace
                     }
                     else
                     {
-                        for (size_t h = 0; h < images[index].height; ++h)
-                        {
-                            if (convFlags & CONV_FLAGS_EXPAND)
-                            {
-                                if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444))
-                                {
-                                    if (!_ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                        pSrc, spitch,
-                                        (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat(convFlags);
-                                    if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, pal8,
-                                        tflags))
-                                        return E_FAIL;
-                                }
-                            }
-                            else if (convFlags & CONV_FLAGS_SWIZZLE)
-                            {
-                                _SwizzleScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                            }
-                            else
-                            {
-                                _CopyScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                            }
-
-                            pSrc += spitch;
-                            pDest += dpitch;
-                        }
+                        if (!ConvertScanlines(pDest, dpitch, pSrc, spitch, images[index].height,
+                            metadata.format, convFlags, pal8))
+                            return E_FAIL;
                     }
                 }
 
@@ -1765,6 +1765,303 @@ HRESULT DirectX::LoadFromDDSFile(
 }
 
 
+//=====================================================================================
+// Memory-mapped DDS file
+//=====================================================================================
+
+namespace
+{
+    void UnmapFile(const uint8_t* base, size_t size)
+    {
+        if (!base)
+            return;
+
+        UNREFERENCED_PARAMETER(size);
+        (void)UnmapViewOfFile(base);
+    }
+}
+
+DDSFileMapping& DDSFileMapping::operator= (DDSFileMapping&& moveFrom)
+{
+    if (this != &moveFrom)
+    {
+        Close();
+
+        m_base = moveFrom.m_base;
+        m_size = moveFrom.m_size;
+        m_flags = moveFrom.m_flags;
+        m_cpFlags = moveFrom.m_cpFlags;
+        m_convFlags = moveFrom.m_convFlags;
+        m_pal8 = moveFrom.m_pal8;
+        m_direct = moveFrom.m_direct;
+        m_nimages = moveFrom.m_nimages;
+        m_metadata = moveFrom.m_metadata;
+        m_image = moveFrom.m_image;
+
+        moveFrom.m_base = nullptr;
+        moveFrom.m_size = 0;
+        moveFrom.m_pal8 = nullptr;
+        moveFrom.m_direct = false;
+        moveFrom.m_nimages = 0;
+        moveFrom.m_image = nullptr;
+    }
+    return *this;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Map a DDS file from disk
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileMapping::Open(const wchar_t* szFile, DWORD flags)
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    Close();
+
+    size_t size = 0;
+    const uint8_t* base = nullptr;
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr)));
+#endif
+
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Get the file size
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (fileInfo.EndOfFile.HighPart > 0)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    size = fileInfo.EndOfFile.LowPart;
+
+    // Need at least enough data to fill the standard header and magic number to be a valid DDS
+    if (size < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+    {
+        return E_FAIL;
+    }
+
+    // The view keeps the section alive, so neither handle is needed once it is mapped
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hMapping)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    base = reinterpret_cast<const uint8_t*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0));
+    if (!base)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_base = base;
+    m_size = size;
+
+    DWORD convFlags = 0;
+    HRESULT hr = DecodeDDSHeader(m_base, m_size, flags, m_metadata, convFlags);
+    if (FAILED(hr))
+    {
+        Close();
+        return hr;
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if (convFlags & CONV_FLAGS_DX10)
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    if (convFlags & CONV_FLAGS_PAL8)
+    {
+        m_pal8 = reinterpret_cast<const uint32_t*>(m_base + offset);
+        offset += (256 * sizeof(uint32_t));
+    }
+
+    if (m_size <= offset)
+    {
+        Close();
+        return E_FAIL;
+    }
+
+    DWORD cpFlags = CP_FLAGS_NONE;
+    if (flags & DDS_FLAGS_LEGACY_DWORD)
+    {
+        cpFlags |= CP_FLAGS_LEGACY_DWORD;
+    }
+    if (flags & DDS_FLAGS_BAD_DXTN_TAILS)
+    {
+        cpFlags |= CP_FLAGS_BAD_DXTN_TAILS;
+    }
+
+    cpFlags = GetSourceCPFlags(cpFlags, convFlags);
+
+    size_t pixelSize, nimages;
+    _DetermineImageArray(m_metadata, cpFlags, nimages, pixelSize);
+    if (!nimages)
+    {
+        Close();
+        return E_FAIL;
+    }
+
+    if (pixelSize > (m_size - offset))
+    {
+        Close();
+        return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+    }
+
+    m_image = new (std::nothrow) Image[nimages];
+    if (!m_image)
+    {
+        Close();
+        return E_OUTOFMEMORY;
+    }
+
+    // Views describe the source layout; they are only handed out when that matches the metadata
+    if (!_SetupImageArray(const_cast<uint8_t*>(m_base + offset), pixelSize, m_metadata, cpFlags, m_image, nimages))
+    {
+        Close();
+        return E_FAIL;
+    }
+
+    m_flags = flags;
+    m_cpFlags = cpFlags;
+    m_convFlags = convFlags;
+    m_nimages = nimages;
+    m_direct = !(convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_NOALPHA | CONV_FLAGS_SWIZZLE | CONV_FLAGS_PAL8))
+               && !(cpFlags & CP_FLAGS_BAD_DXTN_TAILS);
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Unmap the file
+//-------------------------------------------------------------------------------------
+void DDSFileMapping::Close()
+{
+    UnmapFile(m_base, m_size);
+
+    delete[] m_image;
+    m_image = nullptr;
+
+    m_base = nullptr;
+    m_size = 0;
+    m_flags = m_cpFlags = m_convFlags = 0;
+    m_pal8 = nullptr;
+    m_direct = false;
+    m_nimages = 0;
+    memset(&m_metadata, 0, sizeof(m_metadata));
+}
+
+
+//-------------------------------------------------------------------------------------
+// Copy (converting if required) one mip/array slice out of the mapping
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileMapping::GetImage(size_t mip, size_t item, size_t slice, ScratchImage& image) const
+{
+    image.Release();
+
+    if (!m_base || !m_image)
+        return E_UNEXPECTED;
+
+    size_t index = m_metadata.ComputeIndex(mip, item, slice);
+    if (index >= m_nimages)
+        return E_INVALIDARG;
+
+    const Image& src = m_image[index];
+
+    HRESULT hr = (m_metadata.dimension == TEX_DIMENSION_TEXTURE1D)
+        ? image.Initialize1D(m_metadata.format, src.width, 1, 1)
+        : image.Initialize2D(m_metadata.format, src.width, src.height, 1, 1);
+    if (FAILED(hr))
+        return hr;
+
+    const Image* dest = image.GetImages();
+    if (!dest || !dest->pixels || !src.pixels)
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    const uint8_t *pSrc = src.pixels;
+    uint8_t *pDest = dest->pixels;
+
+    if (IsCompressed(m_metadata.format))
+    {
+        if ((m_cpFlags & CP_FLAGS_BAD_DXTN_TAILS) && (src.width < 4 || src.height < 4))
+        {
+            // Use the last mip with full blocks, as CopyImage does
+            for (size_t level = mip; level > 0; --level)
+            {
+                size_t good = m_metadata.ComputeIndex(level - 1, item, slice);
+                if (good < m_nimages && m_image[good].width >= 4 && m_image[good].height >= 4)
+                {
+                    size_t csize = std::min<size_t>(dest->slicePitch, m_image[good].slicePitch);
+                    memcpy_s(pDest, dest->slicePitch, m_image[good].pixels, csize);
+                    return S_OK;
+                }
+            }
+        }
+
+        size_t csize = std::min<size_t>(dest->slicePitch, src.slicePitch);
+        memcpy_s(pDest, dest->slicePitch, pSrc, csize);
+    }
+    else if (IsPlanar(m_metadata.format))
+    {
+        size_t count = ComputeScanlines(m_metadata.format, src.height);
+        if (!count)
+        {
+            image.Release();
+            return E_UNEXPECTED;
+        }
+
+        size_t csize = std::min<size_t>(dest->rowPitch, src.rowPitch);
+        for (size_t h = 0; h < count; ++h)
+        {
+            memcpy_s(pDest, dest->rowPitch, pSrc, csize);
+            pSrc += src.rowPitch;
+            pDest += dest->rowPitch;
+        }
+    }
+    else if (!ConvertScanlines(pDest, dest->rowPitch, pSrc, src.rowPitch, src.height,
+        m_metadata.format, m_convFlags, m_pal8))
+    {
+        image.Release();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Copy (converting if required) the whole mapping
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DDSFileMapping::CopyTo(ScratchImage& image) const
+{
+    image.Release();
+
+    if (!m_base)
+        return E_UNEXPECTED;
+
+    return LoadFromDDSMemory(m_base, m_size, m_flags, nullptr, image);
+}
+
+
 //-------------------------------------------------------------------------------------
 // Save a DDS file to memory
 //-------------------------------------------------------------------------------------
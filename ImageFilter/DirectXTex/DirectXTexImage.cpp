@@ -15,6 +15,8 @@
 
 #include "directxtexp.h"
 
+#include <atomic>
+
 namespace DirectX
 {
     extern bool _CalculateMipLevels(_In_ size_t width, _In_ size_t height, _Inout_ size_t& mipLevels);
@@ -24,6 +26,171 @@ namespace DirectX
 
 using namespace DirectX;
 
+namespace
+{
+    const size_t POOL_MIN_SHIFT = 12;   // 4 KB
+    const size_t POOL_MAX_SHIFT = 30;   // 1 GB, larger blocks always go to the system allocator
+    const size_t POOL_CLASSES = 1 + (POOL_MAX_SHIFT - POOL_MIN_SHIFT) * 4;
+
+    std::atomic<ScratchImagePool*> s_defaultPool(nullptr);
+    thread_local ScratchImagePool* s_threadPool = nullptr;
+
+    //-------------------------------------------------------------------------------------
+    // Rounds size up to its pool class (four classes per power of two keep slack under 25%)
+    //-------------------------------------------------------------------------------------
+    bool GetSizeClass(size_t size, size_t& index, size_t& capacity)
+    {
+        if (size <= (size_t(1) << POOL_MIN_SHIFT))
+        {
+            index = 0;
+            capacity = size_t(1) << POOL_MIN_SHIFT;
+            return true;
+        }
+
+        if (size > (size_t(1) << POOL_MAX_SHIFT))
+            return false;
+
+        size_t shift = POOL_MIN_SHIFT;
+        while ((size_t(1) << (shift + 1)) < size)
+            ++shift;
+
+        size_t base = size_t(1) << shift;
+        size_t step = base >> 2;
+        size_t n = (size - base + step - 1) / step;
+        assert(n >= 1 && n <= 4);
+
+        index = 1 + (shift - POOL_MIN_SHIFT) * 4 + (n - 1);
+        capacity = base + n * step;
+        return true;
+    }
+
+    uint8_t* AllocatePixels(ScratchImagePool* pool, size_t size, size_t& capacity)
+    {
+        if (pool)
+            return pool->Allocate(size, capacity);
+
+        capacity = size;
+        return reinterpret_cast<uint8_t*>(_aligned_malloc(size, 16));
+    }
+}
+
+
+//=====================================================================================
+// ScratchImagePool - Size-class pool for pixel memory
+//=====================================================================================
+
+_Use_decl_annotations_
+ScratchImagePool::ScratchImagePool(size_t maxRetainedBytes) :
+    m_free(POOL_CLASSES),
+    m_maxRetainedBytes(maxRetainedBytes),
+    m_stats{}
+{
+}
+
+ScratchImagePool::~ScratchImagePool()
+{
+    Trim();
+}
+
+_Use_decl_annotations_
+uint8_t* ScratchImagePool::Allocate(size_t size, size_t& capacity)
+{
+    size_t index;
+    if (!GetSizeClass(size, index, capacity))
+    {
+        capacity = size;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.requests;
+        return reinterpret_cast<uint8_t*>(_aligned_malloc(size, 16));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.requests;
+
+        auto& blocks = m_free[index];
+        if (!blocks.empty())
+        {
+            uint8_t* memory = blocks.back();
+            blocks.pop_back();
+
+            ++m_stats.hits;
+            m_stats.retainedBytes -= capacity;
+            --m_stats.retainedBlocks;
+            return memory;
+        }
+    }
+
+    return reinterpret_cast<uint8_t*>(_aligned_malloc(capacity, 16));
+}
+
+_Use_decl_annotations_
+void ScratchImagePool::Free(uint8_t* memory, size_t capacity)
+{
+    if (!memory)
+        return;
+
+    size_t index, classCapacity;
+    if (GetSizeClass(capacity, index, classCapacity) && (classCapacity == capacity))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stats.retainedBytes + capacity <= m_maxRetainedBytes)
+        {
+            auto& blocks = m_free[index];
+            blocks.push_back(memory);
+
+            m_stats.retainedBytes += capacity;
+            ++m_stats.retainedBlocks;
+            return;
+        }
+    }
+
+    _aligned_free(memory);
+}
+
+void ScratchImagePool::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& blocks : m_free)
+    {
+        for (auto memory : blocks)
+        {
+            _aligned_free(memory);
+        }
+        blocks.clear();
+    }
+
+    m_stats.retainedBytes = 0;
+    m_stats.retainedBlocks = 0;
+}
+
+ScratchImagePool::Stats ScratchImagePool::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+_Use_decl_annotations_
+void ScratchImagePool::SetDefault(ScratchImagePool* pool)
+{
+    s_defaultPool = pool;
+}
+
+_Use_decl_annotations_
+void ScratchImagePool::SetThreadDefault(ScratchImagePool* pool)
+{
+    s_threadPool = pool;
+}
+
+ScratchImagePool* ScratchImagePool::GetDefault()
+{
+    return s_threadPool ? s_threadPool : s_defaultPool.load();
+}
+
+
 //-------------------------------------------------------------------------------------
 // Determines number of image array entries and pixel size
 //-------------------------------------------------------------------------------------
@@ -249,11 +416,14 @@ ScratchImage& ScratchImage::operator= (ScratchImage&& moveFrom)
         m_metadata = moveFrom.m_metadata;
         m_image = moveFrom.m_image;
         m_memory = moveFrom.m_memory;
+        m_pool = moveFrom.m_pool;
+        m_capacity = moveFrom.m_capacity;
 
         moveFrom.m_nimages = 0;
         moveFrom.m_size = 0;
         moveFrom.m_image = nullptr;
         moveFrom.m_memory = nullptr;
+        moveFrom.m_capacity = 0;
     }
     return *this;
 }
@@ -331,7 +501,7 @@ HRESULT ScratchImage::Initialize(const TexMetadata& mdata, DWORD flags)
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = reinterpret_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(m_pool, pixelSize, m_capacity);
     if (!m_memory)
     {
         Release();
@@ -397,7 +567,7 @@ HRESULT ScratchImage::Initialize2D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = reinterpret_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(m_pool, pixelSize, m_capacity);
     if (!m_memory)
     {
         Release();
@@ -449,7 +619,7 @@ HRESULT ScratchImage::Initialize3D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = reinterpret_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(m_pool, pixelSize, m_capacity);
     if (!m_memory)
     {
         Release();
@@ -668,9 +838,13 @@ void ScratchImage::Release()
 
     if (m_memory)
     {
-        _aligned_free(m_memory);
+        if (m_pool)
+            m_pool->Free(m_memory, m_capacity);
+        else
+            _aligned_free(m_memory);
         m_memory = nullptr;
     }
+    m_capacity = 0;
 
     memset(&m_metadata, 0, sizeof(m_metadata));
 }
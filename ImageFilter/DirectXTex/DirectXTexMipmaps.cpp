@@ -718,6 +718,117 @@ namespace
     }
 
 
+    //--- 2D Box Filter (tiled) ---
+    // Builds 'tileLevels' mips below 'baseLevel' in a single pass. Each tile of the source level is loaded
+    // once and reduced in linear space down to a single pixel, so intermediate levels never round-trip through
+    // _StoreScanline/_LoadScanline and the source tile stays in cache. Tiles are independent of each other.
+    const size_t MIPS_TILE_LEVELS = 6;
+
+    HRESULT Generate2DMipsBoxFilterTiled(size_t baseLevel, size_t tileLevels, DWORD filter, const ScratchImage& mipChain, size_t item)
+    {
+        assert(tileLevels > 0 && tileLevels <= MIPS_TILE_LEVELS);
+
+        const Image* src = mipChain.GetImage(baseLevel, item, 0);
+        if (!src)
+            return E_POINTER;
+
+        const Image* dest[MIPS_TILE_LEVELS] = {};
+        for (size_t level = 0; level < tileLevels; ++level)
+        {
+            dest[level] = mipChain.GetImage(baseLevel + level + 1, item, 0);
+            if (!dest[level])
+                return E_POINTER;
+        }
+
+        const DXGI_FORMAT format = src->format;
+        const size_t bpp = BitsPerPixel(format);
+        assert(bpp >= 8 && !IsPacked(format));
+
+        const size_t tileSize = size_t(1) << tileLevels;
+        assert((src->width % tileSize) == 0 && (src->height % tileSize) == 0);
+
+        const size_t tilesX = src->width / tileSize;
+        const size_t nTiles = tilesX * (src->height / tileSize);
+
+        bool fail = false;
+        bool oom = false;
+
+#ifdef _OPENMP
+#pragma omp parallel if (nTiles > 1)
+#endif
+        {
+            // Source tile, first reduced level, and a scanline for _StoreScanlineLinear which modifies its input
+            ScopedAlignedArrayXMVECTOR scratch(reinterpret_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * (tileSize * tileSize + (tileSize * tileSize) / 4 + tileSize), 16)));
+            if (!scratch)
+                oom = true;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int nt = 0; nt < static_cast<int>(nTiles); ++nt)
+            {
+                if (!scratch || fail)
+                    continue;
+
+                size_t ty = size_t(nt) / tilesX;
+                size_t tx = size_t(nt) - ty * tilesX;
+
+                XMVECTOR* pixels = scratch.get();
+                XMVECTOR* reduced = pixels + tileSize * tileSize;
+                XMVECTOR* row = reduced + (tileSize * tileSize) / 4;
+
+                const uint8_t* pSrc = src->pixels + (ty * tileSize * src->rowPitch) + (tx * tileSize * bpp) / 8;
+                const size_t srcBytes = (tileSize * bpp) / 8;
+                for (size_t y = 0; y < tileSize; ++y)
+                {
+                    if (!_LoadScanlineLinear(pixels + y * tileSize, tileSize, pSrc, srcBytes, format, filter))
+                        fail = true;
+                    pSrc += src->rowPitch;
+                }
+
+                size_t size = tileSize;
+                for (size_t level = 0; level < tileLevels; ++level)
+                {
+                    size_t nsize = size >> 1;
+
+                    for (size_t y = 0; y < nsize; ++y)
+                    {
+                        const XMVECTOR* urow0 = pixels + (y << 1) * size;
+                        const XMVECTOR* urow1 = urow0 + size;
+
+                        for (size_t x = 0; x < nsize; ++x)
+                        {
+                            size_t x2 = x << 1;
+
+                            AVERAGE4(reduced[y * nsize + x], urow0[x2], urow1[x2], urow0[x2 + 1], urow1[x2 + 1]);
+                        }
+                    }
+
+                    const Image& img = *dest[level];
+                    uint8_t* pDest = img.pixels + (ty * nsize * img.rowPitch) + (tx * nsize * bpp) / 8;
+                    const size_t destBytes = (nsize * bpp) / 8;
+                    for (size_t y = 0; y < nsize; ++y)
+                    {
+                        memcpy(row, reduced + y * nsize, sizeof(XMVECTOR) * nsize);
+                        if (!_StoreScanlineLinear(pDest, destBytes, img.format, row, nsize, filter))
+                            fail = true;
+                        pDest += img.rowPitch;
+                    }
+
+                    // The reduced level becomes the source of the next one
+                    std::swap(pixels, reduced);
+                    size = nsize;
+                }
+            }
+        }
+
+        if (oom)
+            return E_OUTOFMEMORY;
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
     //--- 2D Box Filter ---
     HRESULT Generate2DMipsBoxFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
     {
@@ -734,6 +845,39 @@ namespace
         if (!ispow2(width) || !ispow2(height))
             return E_FAIL;
 
+        size_t level = 1;
+
+        // Use the tiled single-pass filter while both dimensions are still halving
+        const DXGI_FORMAT format = mipChain.GetMetadata().format;
+        if (BitsPerPixel(format) >= 8 && !IsPacked(format))
+        {
+            while (level < levels)
+            {
+                size_t tileLevels = 0;
+                while (tileLevels < MIPS_TILE_LEVELS
+                    && (level + tileLevels) < levels
+                    && (width >> (tileLevels + 1)) > 0
+                    && (height >> (tileLevels + 1)) > 0)
+                {
+                    ++tileLevels;
+                }
+
+                if (!tileLevels)
+                    break;
+
+                HRESULT hr = Generate2DMipsBoxFilterTiled(level - 1, tileLevels, filter, mipChain, item);
+                if (FAILED(hr))
+                    return hr;
+
+                level += tileLevels;
+                width >>= tileLevels;
+                height >>= tileLevels;
+            }
+
+            if (level >= levels)
+                return S_OK;
+        }
+
         // Allocate temporary space (3 scanlines)
         ScopedAlignedArrayXMVECTOR scanline(reinterpret_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
         if (!scanline)
@@ -747,8 +891,8 @@ namespace
         const XMVECTOR* urow2 = urow0 + 1;
         const XMVECTOR* urow3 = urow1 + 1;
 
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
+        // Resize remaining levels one at a time
+        for (; level < levels; ++level)
         {
             if (height <= 1)
             {
@@ -20,7 +20,7 @@
 //      * Does not support files that contain color maps (these are rare in practice)
 //      * Interleaved files are not supported (deprecated aspect of TGA format)
 //      * Only supports 8-bit grayscale; 16-, 24-, and 32-bit truecolor images
-//      * Always writes uncompressed files (i.e. can read RLE compression, but does not write it)
+//      * Writes uncompressed files unless TGA_FLAGS_RLE is given
 //
 
 using namespace DirectX;
@@ -255,6 +255,40 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Reads one BGR(A) TGA pixel as RGBA
+    //-------------------------------------------------------------------------------------
+    inline uint32_t LoadTGAPixel(_In_reads_bytes_(bpp) const uint8_t* sPtr, size_t bpp)
+    {
+        uint32_t t = (uint32_t(sPtr[0]) << 16) | (uint32_t(sPtr[1]) << 8) | uint32_t(sPtr[2]);
+        return t | ((bpp == 4) ? (uint32_t(sPtr[3]) << 24) : 0xFF000000);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Converts a run of 32bpp BGRA pixels to RGBA a word at a time, returns the OR of all
+    // output pixels (so callers can test for any non-zero alpha)
+    //-------------------------------------------------------------------------------------
+    uint32_t SwizzleTGAPixels(
+        _Out_writes_(count) uint32_t* __restrict dPtr,
+        _In_reads_bytes_(count * 4) const uint8_t* __restrict sPtr,
+        size_t count)
+    {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < count; ++i, sPtr += 4)
+        {
+            uint32_t t;
+            memcpy(&t, sPtr, sizeof(uint32_t));
+
+            t = (t & 0xFF00FF00) | ((t >> 16) & 0xFF) | ((t & 0xFF) << 16);
+            bits |= t;
+            dPtr[i] = t;
+        }
+
+        return bits;
+    }
+
+
     //-------------------------------------------------------------------------------------
     // Uncompress pixel data from a TGA into the target image
     //-------------------------------------------------------------------------------------
@@ -437,10 +471,17 @@ namespace
         //----------------------------------------------------------------------- 24/32-bit
         case DXGI_FORMAT_R8G8B8A8_UNORM:
         {
-            bool nonzeroa = false;
+            // Header flags are resolved once so the packet loops only copy pixels
+            const size_t sbpp = (convFlags & CONV_FLAGS_EXPAND) ? 3 : 4;
+            const bool invertx = (convFlags & CONV_FLAGS_INVERTX) != 0;
+
+            // 24bpp sources are always opaque
+            uint32_t alphaBits = (sbpp == 3) ? 0xFF000000 : 0;
+
             for (size_t y = 0; y < image->height; ++y)
             {
-                size_t offset = ((convFlags & CONV_FLAGS_INVERTX) ? (image->width - 1) : 0);
+                size_t offset = (invertx ? (image->width - 1) : 0);
+                assert(offset * sbpp < rowPitch);
 
                 uint32_t* dPtr = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(image->pixels)
                     + (image->rowPitch * ((convFlags & CONV_FLAGS_INVERTY) ? y : (image->height - y - 1))))
@@ -451,117 +492,62 @@ namespace
                     if (sPtr >= endPtr)
                         return E_FAIL;
 
-                    if (*sPtr & 0x80)
-                    {
-                        // Repeat
-                        size_t j = (*sPtr & 0x7F) + 1;
-                        ++sPtr;
+                    const bool repeat = (*sPtr & 0x80) != 0;
+                    size_t j = (*sPtr & 0x7F) + 1;
+                    ++sPtr;
 
-                        DWORD t;
-                        if (convFlags & CONV_FLAGS_EXPAND)
-                        {
-                            assert(offset * 3 < rowPitch);
+                    if (j > image->width - x)
+                        return E_FAIL;
 
-                            if (sPtr + 2 >= endPtr)
-                                return E_FAIL;
+                    if (repeat)
+                    {
+                        if (sPtr + sbpp > endPtr)
+                            return E_FAIL;
 
-                            // BGR -> RGBA
-                            t = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | 0xFF000000;
-                            sPtr += 3;
+                        uint32_t t = LoadTGAPixel(sPtr, sbpp);
+                        alphaBits |= t;
+                        sPtr += sbpp;
 
-                            nonzeroa = true;
+                        if (invertx)
+                        {
+                            std::fill_n(dPtr - (j - 1), j, t);
+                            dPtr -= j;
                         }
                         else
                         {
-                            assert(offset * 4 < rowPitch);
-
-                            if (sPtr + 3 >= endPtr)
-                                return E_FAIL;
-
-                            // BGRA -> RGBA
-                            t = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | (*(sPtr + 3) << 24);
-
-                            if (*(sPtr + 3) > 0)
-                                nonzeroa = true;
-
-                            sPtr += 4;
-                        }
-
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
-
-                            *dPtr = t;
-
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
+                            std::fill_n(dPtr, j, t);
+                            dPtr += j;
                         }
                     }
                     else
                     {
-                        // Literal
-                        size_t j = (*sPtr & 0x7F) + 1;
-                        ++sPtr;
+                        if (sPtr + (j * sbpp) > endPtr)
+                            return E_FAIL;
 
-                        if (convFlags & CONV_FLAGS_EXPAND)
+                        if (!invertx && sbpp == 4)
                         {
-                            if (sPtr + (j * 3) > endPtr)
-                                return E_FAIL;
+                            alphaBits |= SwizzleTGAPixels(dPtr, sPtr, j);
+                            dPtr += j;
+                            sPtr += j * 4;
                         }
                         else
                         {
-                            if (sPtr + (j * 4) > endPtr)
-                                return E_FAIL;
-                        }
-
-                        for (; j > 0; --j, ++x)
-                        {
-                            if (x >= image->width)
-                                return E_FAIL;
-
-                            if (convFlags & CONV_FLAGS_EXPAND)
+                            for (size_t k = 0; k < j; ++k, sPtr += sbpp)
                             {
-                                assert(offset * 3 < rowPitch);
-
-                                if (sPtr + 2 >= endPtr)
-                                    return E_FAIL;
-
-                                // BGR -> RGBA
-                                *dPtr = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | 0xFF000000;
-                                sPtr += 3;
-
-                                nonzeroa = true;
+                                uint32_t t = LoadTGAPixel(sPtr, sbpp);
+                                alphaBits |= t;
+                                *dPtr = t;
+                                dPtr = invertx ? dPtr - 1 : dPtr + 1;
                             }
-                            else
-                            {
-                                assert(offset * 4 < rowPitch);
-
-                                if (sPtr + 3 >= endPtr)
-                                    return E_FAIL;
-
-                                // BGRA -> RGBA
-                                *dPtr = (*sPtr << 16) | (*(sPtr + 1) << 8) | (*(sPtr + 2)) | (*(sPtr + 3) << 24);
-
-                                if (*(sPtr + 3) > 0)
-                                    nonzeroa = true;
-
-                                sPtr += 4;
-                            }
-
-                            if (convFlags & CONV_FLAGS_INVERTX)
-                                --dPtr;
-                            else
-                                ++dPtr;
                         }
                     }
+
+                    x += j;
                 }
             }
 
             // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
-            if (!nonzeroa)
+            if (!(alphaBits & 0xFF000000))
             {
                 HRESULT hr = SetAlphaChannelToOpaque(image);
                 if (FAILED(hr))
@@ -844,6 +830,80 @@ namespace
             }
         }
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Switches an encoded header to the RLE image type, returns the worst-case size of an
+    // RLE scanline (one packet header per 128 pixels on top of the raw pixels)
+    //-------------------------------------------------------------------------------------
+    size_t SetRLEImageType(_Inout_ TGA_HEADER& header, size_t rowPitch, size_t width)
+    {
+        header.bImageType = (header.bImageType == TGA_BLACK_AND_WHITE) ? TGA_BLACK_AND_WHITE_RLE : TGA_TRUECOLOR_RLE;
+
+        return rowPitch + (width + 127) / 128;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Run-length encodes one TGA scanline (packets never cross scanlines), returns the
+    // number of bytes written or 0 if pDestination is too small
+    //-------------------------------------------------------------------------------------
+    size_t EncodeRLEScanline(
+        _Out_writes_bytes_(outSize) uint8_t* pDestination,
+        _In_ size_t outSize,
+        _In_reads_bytes_(width * bpp) const uint8_t* pSource,
+        _In_ size_t width,
+        _In_ size_t bpp)
+    {
+        assert(pDestination && outSize > 0);
+        assert(pSource && width > 0);
+        assert(bpp >= 1 && bpp <= 4);
+
+        uint8_t* dPtr = pDestination;
+        const uint8_t* endPtr = pDestination + outSize;
+
+        auto same = [&](size_t a, size_t b) { return memcmp(pSource + a * bpp, pSource + b * bpp, bpp) == 0; };
+
+        for (size_t x = 0; x < width; )
+        {
+            size_t run = 1;
+            while ((x + run < width) && (run < 128) && same(x, x + run))
+                ++run;
+
+            if (run > 1)
+            {
+                // Repeat
+                if (dPtr + 1 + bpp > endPtr)
+                    return 0;
+
+                *(dPtr++) = uint8_t(0x80 | (run - 1));
+                memcpy(dPtr, pSource + x * bpp, bpp);
+                dPtr += bpp;
+                x += run;
+            }
+            else
+            {
+                // Literal, ending where a run of three or more starts (shorter runs cost more than they save)
+                size_t count = 1;
+                while ((x + count < width) && (count < 128))
+                {
+                    if ((x + count + 2 < width) && same(x + count, x + count + 1) && same(x + count, x + count + 2))
+                        break;
+                    ++count;
+                }
+
+                if (dPtr + 1 + count * bpp > endPtr)
+                    return 0;
+
+                *(dPtr++) = uint8_t(count - 1);
+                memcpy(dPtr, pSource + x * bpp, count * bpp);
+                dPtr += count * bpp;
+                x += count;
+            }
+        }
+
+        return static_cast<size_t>(dPtr - pDestination);
+    }
 }
 
 
@@ -973,6 +1033,56 @@ HRESULT DirectX::LoadFromTGAMemory(
 }
 
 
+//-------------------------------------------------------------------------------------
+// View the pixels of a TGA file in memory without copying
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetImageFromTGAMemory(
+    const void* pSource,
+    size_t size,
+    TexMetadata* metadata,
+    Image& image)
+{
+    memset(&image, 0, sizeof(Image));
+
+    if (!pSource || size == 0)
+        return E_INVALIDARG;
+
+    size_t offset;
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    HRESULT hr = DecodeTGAHeader(pSource, size, mdata, offset, &convFlags);
+    if (FAILED(hr))
+        return hr;
+
+    // Only files whose stored layout already matches an Image can be used in place
+    if ((convFlags & (CONV_FLAGS_RLE | CONV_FLAGS_EXPAND | CONV_FLAGS_INVERTX)) || !(convFlags & CONV_FLAGS_INVERTY))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // TGA stores BGRA, so report the matching format instead of swizzling
+    if (mdata.format == DXGI_FORMAT_R8G8B8A8_UNORM)
+        mdata.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+
+    size_t rowPitch, slicePitch;
+    ComputePitch(mdata.format, mdata.width, mdata.height, rowPitch, slicePitch, CP_FLAGS_NONE);
+
+    if (offset > size || slicePitch > (size - offset))
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    image.width = mdata.width;
+    image.height = mdata.height;
+    image.format = mdata.format;
+    image.rowPitch = rowPitch;
+    image.slicePitch = slicePitch;
+    image.pixels = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(pSource) + offset);
+
+    if (metadata)
+        memcpy(metadata, &mdata, sizeof(TexMetadata));
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Load a TGA file from disk
 //-------------------------------------------------------------------------------------
@@ -1238,6 +1348,12 @@ HRESULT DirectX::LoadFromTGAFile(
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
+{
+    return SaveToTGAMemory(image, TGA_FLAGS_NONE, blob);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::SaveToTGAMemory(const Image& image, DWORD flags, Blob& blob)
 {
     if (!image.pixels)
         return E_POINTER;
@@ -1262,6 +1378,17 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
         ComputePitch(image.format, image.width, image.height, rowPitch, slicePitch, CP_FLAGS_NONE);
     }
 
+    // RLE scanlines are encoded from a temporary copy into worst-case space, then the blob is trimmed
+    std::unique_ptr<uint8_t[]> temp;
+    if (flags & TGA_FLAGS_RLE)
+    {
+        slicePitch = image.height * SetRLEImageType(tga_header, rowPitch, image.width);
+
+        temp.reset(new (std::nothrow) uint8_t[rowPitch]);
+        if (!temp)
+            return E_OUTOFMEMORY;
+    }
+
     hr = blob.Initialize(sizeof(TGA_HEADER) + slicePitch);
     if (FAILED(hr))
         return hr;
@@ -1269,6 +1396,7 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
     // Copy header
     auto dPtr = reinterpret_cast<uint8_t*>(blob.GetBufferPointer());
     assert(dPtr != 0);
+    const uint8_t* endPtr = dPtr + blob.GetBufferSize();
     memcpy_s(dPtr, blob.GetBufferSize(), &tga_header, sizeof(TGA_HEADER));
     dPtr += sizeof(TGA_HEADER);
 
@@ -1277,24 +1405,45 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
 
     for (size_t y = 0; y < image.height; ++y)
     {
+        uint8_t* rowPtr = temp ? temp.get() : dPtr;
+
         // Copy pixels
         if (convFlags & CONV_FLAGS_888)
         {
-            Copy24bppScanline(dPtr, rowPitch, pPixels, image.rowPitch);
+            Copy24bppScanline(rowPtr, rowPitch, pPixels, image.rowPitch);
         }
         else if (convFlags & CONV_FLAGS_SWIZZLE)
         {
-            _SwizzleScanline(dPtr, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
+            _SwizzleScanline(rowPtr, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
         }
         else
         {
-            _CopyScanline(dPtr, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
+            _CopyScanline(rowPtr, rowPitch, pPixels, image.rowPitch, image.format, TEXP_SCANLINE_NONE);
+        }
+
+        if (temp)
+        {
+            size_t bytes = EncodeRLEScanline(dPtr, static_cast<size_t>(endPtr - dPtr), rowPtr, image.width, rowPitch / image.width);
+            if (!bytes)
+                return E_FAIL;
+
+            dPtr += bytes;
+        }
+        else
+        {
+            dPtr += rowPitch;
         }
 
-        dPtr += rowPitch;
         pPixels += image.rowPitch;
     }
 
+    if (temp)
+    {
+        hr = blob.Trim(static_cast<size_t>(dPtr - reinterpret_cast<uint8_t*>(blob.GetBufferPointer())));
+        if (FAILED(hr))
+            return hr;
+    }
+
     return S_OK;
 }
 
@@ -1304,6 +1453,12 @@ HRESULT DirectX::SaveToTGAMemory(const Image& image, Blob& blob)
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
+{
+    return SaveToTGAFile(image, TGA_FLAGS_NONE, szFile);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::SaveToTGAFile(const Image& image, DWORD flags, const wchar_t* szFile)
 {
     if (!szFile)
         return E_INVALIDARG;
@@ -1347,7 +1502,7 @@ HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
         // For small images, it is better to create an in-memory file and write it out
         Blob blob;
 
-        hr = SaveToTGAMemory(image, blob);
+        hr = SaveToTGAMemory(image, flags, blob);
         if (FAILED(hr))
             return hr;
 
@@ -1371,6 +1526,17 @@ HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
         if (!temp)
             return E_OUTOFMEMORY;
 
+        size_t rlePitch = 0;
+        std::unique_ptr<uint8_t[]> rle;
+        if (flags & TGA_FLAGS_RLE)
+        {
+            rlePitch = SetRLEImageType(tga_header, rowPitch, image.width);
+
+            rle.reset(new (std::nothrow) uint8_t[rlePitch]);
+            if (!rle)
+                return E_OUTOFMEMORY;
+        }
+
         // Write header
         DWORD bytesWritten;
         if (!WriteFile(hFile.get(), &tga_header, sizeof(TGA_HEADER), &bytesWritten, nullptr))
@@ -1402,12 +1568,23 @@ HRESULT DirectX::SaveToTGAFile(const Image& image, const wchar_t* szFile)
 
             pPixels += image.rowPitch;
 
-            if (!WriteFile(hFile.get(), temp.get(), static_cast<DWORD>(rowPitch), &bytesWritten, nullptr))
+            const uint8_t* rowPtr = temp.get();
+            size_t bytesToWrite = rowPitch;
+            if (rle)
+            {
+                bytesToWrite = EncodeRLEScanline(rle.get(), rlePitch, temp.get(), image.width, rowPitch / image.width);
+                if (!bytesToWrite)
+                    return E_FAIL;
+
+                rowPtr = rle.get();
+            }
+
+            if (!WriteFile(hFile.get(), rowPtr, static_cast<DWORD>(bytesToWrite), &bytesWritten, nullptr))
             {
                 return HRESULT_FROM_WIN32(GetLastError());
             }
 
-            if (bytesWritten != rowPitch)
+            if (bytesWritten != bytesToWrite)
                 return E_FAIL;
         }
     }
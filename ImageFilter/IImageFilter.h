@@ -8,6 +8,7 @@
 
 struct IDirect3DTexture9;
 struct IDirect3DDevice9;
+struct tagRECT;
 
 
 namespace Flat
@@ -18,7 +19,7 @@ namespace Flat
 	struct IImageFilter
 	{
 		// ̹  ۾ ûѴ. ۾ ϷǸ Callback_type ޵ Լ ȴ.
-		// ȯ IToken ҸǸ callback ȣ ʴ´. ̹ ۵ ۾  ̷Ƿ ٸ     ްų  ʴ´. ̴ 带 ۾ ߰   ڿ    ֱ   ϱ ̴.
+		// ȯ IToken ҸǸ callback ȣ ʴ´. ̹ ۵ ۾  Ÿ̳ ̾ ̿ ߰ ۸ Ѵ. 带   ʰ ۾  Ƿ ڿ  ,    ۾  ۵ȴ.
 		//
 		// pTexture: ͸ ؽó. D3DFMT_A4R4G4B4, D3DFMT_A4R4G4B4   ϳ Ѵ
 		// denoise_level:     Ѵ.  1, 2, 3 ȴ. ȯ ʿ н  ű⿡ ѵǾ ֱ ̴.
@@ -27,6 +28,13 @@ namespace Flat
 		using Filter_callback_type = std::function<void(IDirect3DTexture9*)>;
 		virtual std::shared_ptr<IToken> filter_async(IDirect3DTexture9* pTexture, int denoise_level, float scale, Filter_callback_type callback) = 0;
 
+		//   ۾ ߰  partial_callback Ѵ. ū ̹ ٸ ʰ    .
+		// ۾ ۵Ǹ ť 2 Ȯ ؽó ü  Բ ޵ǰ,  waifu2x ȯ   ŵ  Բ ޵ȴ.
+		// ؽó Ź  D3DFMT_A8R8G8B8( İ  D3DFMT_X8R8G8B8) ؽó̸ ۾  ǹǷ   AddRef()ؾ Ѵ.
+		// ϼ ؽó filter_async()ó callback ޵ȴ
+		using Partial_callback_type = std::function<void(IDirect3DTexture9*, tagRECT const& dirty_rect)>;
+		virtual std::shared_ptr<IToken> filter_async(IDirect3DTexture9* pTexture, int denoise_level, float scale, Filter_callback_type callback, Partial_callback_type partial_callback) = 0;
+
 		//   ȣǾ Ѵ. ׷  filter_async() ޵ ݹ Լ   ʴ´
 		virtual void update(IDirect3DDevice9*) = 0;
 
@@ -36,6 +44,18 @@ namespace Flat
 		// α ߻  ȣ Լ Ѵ
 		using Log_callback_type = std::function<void(std::string const&)>;
 		virtual void bind_log_callback(Log_callback_type) = 0;
+
+		// ȯ ܰ躰 . ȯⰡ  ڷ  ̴. ۾ ϳ  Ϸ α׷ ޵ȴ
+		// ܰ task, color, tile, pack, filter, unpack, merge, copy back, uniform ̴. uniform   ä ܻ  tile   ߷̴
+		struct Stage_stats
+		{
+			std::string name;
+			unsigned long long count;
+			double milliseconds;
+			double megabytes;
+			double gflops;
+		};
+		virtual std::vector<Stage_stats> query_stats() const = 0;
 	};
 
 	struct ImageFilterFactory
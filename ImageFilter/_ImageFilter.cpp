@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -14,7 +15,12 @@ namespace Flat
 {
 	class _Waifu2xImpl
 	{
+		using Stage_stats_type = std::vector<W2XConvStageStats>;
+
 		std::vector<W2XConv*> _converters{ nullptr, nullptr, nullptr, nullptr };
+		// converters are made at worker thread and stats are queried at main thread
+		mutable std::mutex _converter_mutex;
+		Stage_stats_type _last_task_stats;
 
 	public:
 		_Waifu2xImpl() 
@@ -35,24 +41,107 @@ namespace Flat
 		_Waifu2xImpl& operator=(_Waifu2xImpl&) = delete;
 		_Waifu2xImpl& operator=(_Waifu2xImpl&&) = delete;
 
-		DirectX::ScratchImage filter(DirectX::ScratchImage&& sourceImage, bool has_alpha, int denoise_level, float scale)
+		// it returns empty image if cancelled is set while working. finished blocks are added to progress if it isn't null
+		DirectX::ScratchImage filter(DirectX::ScratchImage&& sourceImage, bool has_alpha, int denoise_level, float scale, std::atomic<bool>& cancelled, _Progress* progress)
 		{
 			int block_size{};
 			auto converter{ _get_converter(denoise_level) };
 			auto& metaData = sourceImage.GetMetadata();
-			DirectX::ScratchImage destImage;
+			DirectX::ScratchImage destImage(sourceImage.GetPool());
+			DirectX::ScratchImage previewImage(sourceImage.GetPool());
+
+			// blocks of waifu2x are shown over cubic preview. so the image is complete whenever it is shown
+			if (progress) {
+				if (FAILED(DirectX::Resize(*sourceImage.GetImage(0, 0, 0), metaData.width * 2, metaData.height * 2, DirectX::TEX_FILTER_FLAGS::TEX_FILTER_CUBIC | DirectX::TEX_FILTER_FLAGS::TEX_FILTER_FORCE_NON_WIC, previewImage))) {
+					throw std::runtime_error("preview resizing is failed");
+				}
+			}
+
 			destImage.Initialize2D(metaData.format, metaData.width * 2, metaData.height * 2, 1, 1);
 
-			if (auto error = w2xconv_convert_memory2(converter, metaData.width, metaData.height, destImage.GetPixels(), sourceImage.GetPixels(), denoise_level, scale, block_size, has_alpha, CV_8UC4)) {
+			auto stats_before = _get_stats(converter);
+			auto sourceView = sourceImage.GetImage(0, 0, 0);
+			auto destView = destImage.GetImage(0, 0, 0);
+
+			// converter polls the flag between tiles and layers. it is unset before the flag goes away
+			w2xconv_set_cancel_func(converter, [](void* data) -> int { return *static_cast<std::atomic<bool>*>(data); }, &cancelled);
+
+			if (progress) {
+				progress->start(std::move(previewImage), *destView);
+				w2xconv_set_progress_func(converter, [](void* data, int x, int y, int w, int h) { static_cast<_Progress*>(data)->add({ x, y, x + w, y + h }); }, progress);
+			}
+
+			// rows are read and written through their pitch. there's no float image nor copy of whole image
+			int error{};
+
+			try {
+				error = w2xconv_convert_bgra8(converter, destView->pixels, destView->rowPitch, sourceView->pixels, sourceView->rowPitch, static_cast<int>(metaData.width), static_cast<int>(metaData.height), denoise_level, scale, block_size, has_alpha);
+			}
+			catch (...) {
+				w2xconv_set_cancel_func(converter, nullptr, nullptr);
+				w2xconv_set_progress_func(converter, nullptr, nullptr);
+
+				// output is destroyed by unwinding
+				if (progress) {
+					progress->stop();
+				}
+
+				throw;
+			}
+
+			w2xconv_set_cancel_func(converter, nullptr, nullptr);
+			w2xconv_set_progress_func(converter, nullptr, nullptr);
+
+			// output is returned or destroyed from now. result is shown as whole when the task is done
+			if (progress) {
+				progress->stop();
+			}
+
+			if (error) {
+				// nobody waits for the result. images are released to the pool at once
+				if (W2XCONV_ERROR_CANCELLED == converter->last_error.code) {
+					return DirectX::ScratchImage(sourceImage.GetPool());
+				}
+
 				assert(false);
 
 				_check_for_errors(converter, error);
 				throw std::exception();
 			}
 
+			// it is read after future of the task is ready
+			_last_task_stats = _get_stats(converter);
+
+			for (size_t i{}; i < _last_task_stats.size(); ++i) {
+				_subtract_stats(_last_task_stats[i], stats_before[i]);
+			}
+
 			return destImage;
 		}
 
+		Stage_stats_type get_stats() const
+		{
+			Stage_stats_type total(W2XCONV_STAGE_COUNT);
+			std::lock_guard<std::mutex> lock(_converter_mutex);
+
+			for (auto converter : _converters) {
+				if (converter) {
+					auto stats = _get_stats(converter);
+
+					for (size_t i{}; i < total.size(); ++i) {
+						total[i].count += stats[i].count;
+						total[i].sec += stats[i].sec;
+						total[i].bytes += stats[i].bytes;
+						total[i].flop += stats[i].flop;
+					}
+				}
+			}
+
+			return total;
+		}
+
+		inline Stage_stats_type const& get_last_task_stats() const { return _last_task_stats; }
+
 	private:
 		W2XConv* _get_converter(int denoise_level)
 		{
@@ -63,7 +152,11 @@ namespace Flat
 			if (!converter) {
 				auto job_number = 1;
 				auto log_level = 0; // [0,4]
-				converter = w2xconv_init(W2XConvGPUMode::W2XCONV_GPU_AUTO, job_number, log_level);
+				auto new_converter = w2xconv_init(W2XConvGPUMode::W2XCONV_GPU_AUTO, job_number, log_level);
+				{
+					std::lock_guard<std::mutex> lock(_converter_mutex);
+					converter = new_converter;
+				}
 
 				TCHAR filePath[MAX_PATH]{};
 				GetModuleFileName(NULL, filePath, _countof(filePath));
@@ -77,11 +170,30 @@ namespace Flat
 					_check_for_errors(converter, error);
 					throw std::invalid_argument("invalid model path");
 				}
+
+				// block_size of filter() is 0. it benchmarks once per processor and reads saved one after that
+				w2xconv_tune_block_size(converter, filePath, 0);
 			}
 
 			return converter;
 		}
 
+		static Stage_stats_type _get_stats(W2XConv* converter)
+		{
+			Stage_stats_type stats(W2XCONV_STAGE_COUNT);
+			w2xconv_get_stage_stats(converter, stats.data());
+
+			return stats;
+		}
+
+		static void _subtract_stats(W2XConvStageStats& stats, W2XConvStageStats const& base)
+		{
+			stats.count -= base.count;
+			stats.sec -= base.sec;
+			stats.bytes -= base.bytes;
+			stats.flop -= base.flop;
+		}
+
 		void _check_for_errors(W2XConv* converter, int error) const
 		{
 			if (error)
@@ -95,10 +207,23 @@ namespace Flat
 	};
 
 
-	_ImageFilter::_ImageFilter() : _impl{ std::make_unique<_Waifu2xImpl>() }
+	_ImageFilter::_ImageFilter() : _image_pool{ std::make_unique<DirectX::ScratchImagePool>() }, _impl{ std::make_unique<_Waifu2xImpl>() }
 	{}
 
+	_ImageFilter::~_ImageFilter()
+	{
+		// futures wait for their work when tasks are destroyed. started work stops at next tile instead of running to end
+		for (auto& task : _tasks) {
+			task.second->_cancelled = true;
+		}
+	}
+
 	std::shared_ptr<IToken> _ImageFilter::filter_async(LPDIRECT3DTEXTURE9 pTexture, int denoise_level, float scale, Filter_callback_type callback)
+	{
+		return filter_async(pTexture, denoise_level, scale, callback, nullptr);
+	}
+
+	std::shared_ptr<IToken> _ImageFilter::filter_async(LPDIRECT3DTEXTURE9 pTexture, int denoise_level, float scale, Filter_callback_type callback, Partial_callback_type partial_callback)
 	{
 		D3DSURFACE_DESC surface_desc{};
 		
@@ -120,8 +245,8 @@ namespace Flat
 				_log_callback(log);
 			}
 
-			auto functor = std::bind(&_ImageFilter::__apply_waifu2x_async, this, has_alpha, denoise_level, scale, std::placeholders::_1);
-			auto task = std::make_shared<_Task>(pTexture, functor, callback);
+			auto functor = std::bind(&_ImageFilter::__apply_waifu2x_async, this, has_alpha, denoise_level, scale, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+			auto task = std::make_shared<_Task>(pTexture, functor, callback, partial_callback);
 			_tasks[task->_index] = task;
 			_task_indices.push(task->_index);
 
@@ -187,18 +312,35 @@ namespace Flat
 								if (_log_callback) {
 									auto elasped_time = std::chrono::system_clock::now() - task->_reserved_time;
 									auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elasped_time);
-									std::string log = "[" + std::to_string(width) + "x" + std::to_string(height) + "]" + "waifu2x done (" + std::to_string(elapsed_ms.count()) + "ms)";
+									auto pool_stats = _image_pool->GetStats();
+									auto hit_rate = pool_stats.requests ? pool_stats.hits * 100 / pool_stats.requests : 0;
+									std::string log = "[" + std::to_string(width) + "x" + std::to_string(height) + "]" + "waifu2x done (" + std::to_string(elapsed_ms.count()) + "ms, pool hit " + std::to_string(hit_rate) + "%, retained " + std::to_string(pool_stats.retainedBytes / 1024) + "KB)";
 
 									_log_callback(log);
+									_log_callback("[" + std::to_string(width) + "x" + std::to_string(height) + "]" + "waifu2x stages (" + __format_stats(_impl->get_last_task_stats()) + ")");
 								}
 							}
 						}
 					}
 				}
+				else if (_log_callback) {
+					D3DSURFACE_DESC surface_desc{};
+					task->_pTexture->GetLevelDesc(0, &surface_desc);
+
+					auto elapsed_time = std::chrono::system_clock::now() - task->_reserved_time;
+					auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed_time);
+					std::string log = "[" + std::to_string(surface_desc.Width) + "x" + std::to_string(surface_desc.Height) + "]" + "waifu2x cancelled (" + std::to_string(elapsed_ms.count()) + "ms)";
+
+					_log_callback(log);
+				}
 
 				_task_indices.pop();
 				_tasks.erase(task_index);
 			}
+			// finished blocks are shown before the task is done
+			else if (task->_progress && !task->_cancelled) {
+				__deliver_progress(pDevice, *task);
+			}
 		}
 		// if there is no running task, start reserved task at once
 		else {
@@ -211,7 +353,7 @@ namespace Flat
 
 				if (SUCCEEDED(task->_pTexture->LockRect(0, &locked_rect, NULL, 0))) {
 
-					DirectX::ScratchImage highColorImage;
+					DirectX::ScratchImage highColorImage(_image_pool.get());
 					{
 						auto imageFormat = DXGI_FORMAT_UNKNOWN;
 						auto bitPerPixel = 0u;
@@ -254,6 +396,21 @@ namespace Flat
 		}
 	}
 
+	std::vector<IImageFilter::Stage_stats> _ImageFilter::query_stats() const
+	{
+		std::vector<Stage_stats> result;
+		auto stats = _impl->get_stats();
+
+		for (size_t i{}; i < stats.size(); ++i) {
+			auto& s = stats[i];
+			auto gflops = s.sec > 0 ? s.flop / s.sec / 1e9 : 0;
+
+			result.push_back({ w2xconv_stage_name(static_cast<W2XConvStage>(i)), s.count, s.sec * 1000, s.bytes / (1024 * 1024), gflops });
+		}
+
+		return result;
+	}
+
 	void _ImageFilter::_remove_task(Token_index index)
 	{
 		auto task_iter = _tasks.find(index);
@@ -262,6 +419,7 @@ namespace Flat
 			auto& task = task_iter->second;
 
 			// during async working if you elimitate future then will be block process. moreover waiting result should be in the thread that created DirectX device. In conclusion such action will be called freezing. To avoid it started task don't touch until finish.
+			// worker stops at next tile or layer when the flag is set. then update() erases it and starts next task
 			if (task->_async_started) {
 				task_iter->second->_cancelled = true;
 			}
@@ -271,14 +429,18 @@ namespace Flat
 		}
 	}
 
-	DirectX::ScratchImage _ImageFilter::__apply_waifu2x_async(bool has_alpha, int denoise_level, float scale, DirectX::ScratchImage&& highColorImage)
+	DirectX::ScratchImage _ImageFilter::__apply_waifu2x_async(bool has_alpha, int denoise_level, float scale, DirectX::ScratchImage&& highColorImage, std::atomic<bool>& cancelled, _Progress* progress)
 	{
+		if (cancelled) {
+			return DirectX::ScratchImage(highColorImage.GetPool());
+		}
+
 		auto format = highColorImage.GetMetadata().format;
 
 		if (format != DXGI_FORMAT_B8G8R8A8_UNORM && format != DXGI_FORMAT_B8G8R8X8_UNORM)
 		{
 			auto changingFormat = (has_alpha ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_B8G8R8X8_UNORM);
-			DirectX::ScratchImage trueColorImage;
+			DirectX::ScratchImage trueColorImage(highColorImage.GetPool());
 
 			// change to true color image
 			if (FAILED(DirectX::Convert(highColorImage.GetImages(), highColorImage.GetImageCount(), highColorImage.GetMetadata(), changingFormat, DirectX::TEX_FILTER_FLAGS::TEX_FILTER_POINT, DirectX::TEX_THRESHOLD_DEFAULT, trueColorImage))) {
@@ -288,7 +450,100 @@ namespace Flat
 			highColorImage = std::move(trueColorImage);
 		}
 
-		return _impl->filter(std::move(highColorImage), has_alpha, denoise_level, scale);
+		return _impl->filter(std::move(highColorImage), has_alpha, denoise_level, scale, cancelled, progress);
+	}
+
+	void _ImageFilter::__deliver_progress(LPDIRECT3DDEVICE9 pDevice, _Task& task) const
+	{
+		// callback isn't called after token is gone
+		if (task._weak_token_ptr.expired()) {
+			return;
+		}
+
+		DirectX::ScratchImage preview;
+		DirectX::Image image{};
+		std::vector<RECT> dirty_rects;
+
+		auto lock = task._progress->take(preview, image, dirty_rects);
+
+		if (!preview.GetImageCount() && dirty_rects.empty()) {
+			return;
+		}
+
+		if (!task._pPreviewTexture) {
+			auto format = (DXGI_FORMAT_B8G8R8A8_UNORM == image.format ? D3DFMT_A8R8G8B8 : D3DFMT_X8R8G8B8);
+
+			if (FAILED(pDevice->CreateTexture(static_cast<UINT>(image.width), static_cast<UINT>(image.height), 1, 0, format, D3DPOOL_MANAGED, &task._pPreviewTexture, NULL))) {
+				throw std::runtime_error("preview texture failed to create");
+			}
+		}
+
+		std::vector<RECT> uploaded_rects;
+		auto upload = [&task, &uploaded_rects](DirectX::Image const& source, RECT const& rect) {
+			D3DLOCKED_RECT locked_rect{};
+
+			if (SUCCEEDED(task._pPreviewTexture->LockRect(0, &locked_rect, &rect, 0))) {
+				auto recordSize = (rect.right - rect.left) * 4;
+
+				for (LONG i{}; i < rect.bottom - rect.top; ++i) {
+					memcpy(static_cast<LPBYTE>(locked_rect.pBits) + locked_rect.Pitch * i, source.pixels + source.rowPitch * (rect.top + i) + rect.left * 4, recordSize);
+				}
+
+				task._pPreviewTexture->UnlockRect(0);
+				uploaded_rects.push_back(rect);
+			}
+		};
+
+		// preview is ours. it goes first because finished rects are put over it
+		if (preview.GetImageCount()) {
+			auto previewView = preview.GetImage(0, 0, 0);
+
+			upload(*previewView, { 0, 0, static_cast<LONG>(previewView->width), static_cast<LONG>(previewView->height) });
+		}
+
+		// worker doesn't write finished rects any more. it can't destroy the output while the lock is held
+		for (auto& rect : dirty_rects) {
+			upload(image, rect);
+		}
+
+		lock.unlock();
+
+		for (auto& rect : uploaded_rects) {
+			task._partial_callback(task._pPreviewTexture, rect);
+		}
+	}
+
+	std::string _ImageFilter::__format_stats(std::vector<W2XConvStageStats> const& stats) const
+	{
+		std::string text;
+
+		for (size_t i{}; i < stats.size(); ++i) {
+			auto& s = stats[i];
+
+			if (!s.count) {
+				continue;
+			}
+
+			if (!text.empty()) {
+				text += ", ";
+			}
+
+			text += std::string(w2xconv_stage_name(static_cast<W2XConvStage>(i))) + " " + std::to_string(s.count) + "x " + std::to_string(static_cast<long long>(s.sec * 1000)) + "ms";
+
+			if (s.flop > 0 && s.sec > 0) {
+				text += " " + std::to_string(static_cast<long long>(s.flop / s.sec / 1e9)) + "GFLOPS";
+			}
+			else if (s.bytes > 0) {
+				text += " " + std::to_string(static_cast<long long>(s.bytes / 1024)) + "KB";
+			}
+
+			// hit rate of uniform blocks which are filled without filters
+			if (i == W2XCONV_STAGE_UNIFORM && stats[W2XCONV_STAGE_TILE].count) {
+				text += " " + std::to_string(s.count * 100 / stats[W2XCONV_STAGE_TILE].count) + "% of tiles";
+			}
+		}
+
+		return text;
 	}
 
 	void _ImageFilter::__copy_from_surface_memory(LPVOID pDst, LPVOID pSrc, size_t width, size_t height, UINT pitch, UINT bitPerPixel) const
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <future>
 #include <queue>
@@ -11,11 +12,13 @@
 
 namespace DirectX {
 	class ScratchImage;
+	class ScratchImagePool;
 }
 
 namespace Flat
 {
 	struct _Task;
+	struct _Progress;
 
 	class _Waifu2xImpl;
 	class _ImageFilter;
@@ -27,6 +30,8 @@ namespace Flat
 
 		using Token_index = size_t;
 
+		// declared first so it outlives every image held by the tasks below
+		std::unique_ptr< DirectX::ScratchImagePool > _image_pool;
 		std::unique_ptr< _Waifu2xImpl > _impl;
 		std::queue<Token_index> _task_indices;
 		std::unordered_map<Token_index, std::shared_ptr<_Task>> _tasks;
@@ -34,8 +39,10 @@ namespace Flat
 
 	public:
 		_ImageFilter();
+		~_ImageFilter();
 
 		std::shared_ptr<IToken> filter_async(LPDIRECT3DTEXTURE9, int denoise_level, float scale, Filter_callback_type) override final;
+		std::shared_ptr<IToken> filter_async(LPDIRECT3DTEXTURE9, int denoise_level, float scale, Filter_callback_type, Partial_callback_type) override final;
 
 		void update(LPDIRECT3DDEVICE9) override final;
 
@@ -43,6 +50,8 @@ namespace Flat
 
 		inline void bind_log_callback(Log_callback_type callback) override final { _log_callback = callback; }
 
+		std::vector<Stage_stats> query_stats() const override final;
+
 	protected:
 		void _remove_task(Token_index index);
 
@@ -50,6 +59,8 @@ namespace Flat
 		void __copy_from_surface_memory(LPVOID pDst, LPVOID pSrc, size_t width, size_t height, UINT pitch, UINT bitPerPixel) const;
 		void __copy_to_surface_memory(LPVOID pDst, LPVOID pSrc, size_t width, size_t height, UINT pitch, UINT bitPerPixel) const;
 
-		DirectX::ScratchImage __apply_waifu2x_async(bool has_alpha, int denoise_level, float scale, DirectX::ScratchImage&&);
+		DirectX::ScratchImage __apply_waifu2x_async(bool has_alpha, int denoise_level, float scale, DirectX::ScratchImage&&, std::atomic<bool>& cancelled, _Progress* progress);
+		void __deliver_progress(LPDIRECT3DDEVICE9, _Task&) const;
+		std::string __format_stats(std::vector<W2XConvStageStats> const&) const;
 	};
 }
\ No newline at end of file
@@ -9,15 +9,60 @@ namespace Flat
 	size_t _Task::_unique_index{};
 
 
-	_Task::_Task(LPDIRECT3DTEXTURE9 pTexture, Function_type function, IImageFilter::Filter_callback_type callback) : _pTexture{ pTexture }, _function{ function }, _callback{ callback }, _index{ ++_unique_index }, _started_time{ std::chrono::system_clock::now() }
+	void _Progress::start(DirectX::ScratchImage&& preview, DirectX::Image const& image)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_preview = std::move(preview);
+		_image = image;
+	}
+
+	void _Progress::add(RECT const& rect)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_dirty_rects.push_back(rect);
+	}
+
+	void _Progress::stop()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_preview.Release();
+		_image = {};
+		_dirty_rects.clear();
+	}
+
+	std::unique_lock<std::mutex> _Progress::take(DirectX::ScratchImage& preview, DirectX::Image& image, std::vector<RECT>& rects)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		preview = std::move(_preview);
+		image = _image;
+		rects = std::move(_dirty_rects);
+		_dirty_rects.clear();
+
+		return lock;
+	}
+
+
+	_Task::_Task(LPDIRECT3DTEXTURE9 pTexture, Function_type function, IImageFilter::Filter_callback_type callback, IImageFilter::Partial_callback_type partial_callback) : _pTexture{ pTexture }, _function{ function }, _callback{ callback }, _partial_callback{ partial_callback }, _index{ ++_unique_index }, _started_time{ std::chrono::system_clock::now() }
 	{
 		_pTexture->AddRef();
+
+		if (_partial_callback) {
+			_progress = std::make_unique<_Progress>();
+		}
 	}
 
 	_Task::~_Task()
 	{
 		_pTexture->Release();
 
+		if (_pPreviewTexture) {
+			_pPreviewTexture->Release();
+		}
+
 		if (_token_issued) {
 			if (auto token_ptr = _weak_token_ptr.lock()) {
 				auto token = std::static_pointer_cast<_Token>(token_ptr);
@@ -46,7 +91,7 @@ namespace Flat
 			throw std::runtime_error("async job started already");
 		}
 		else {
-			_future = std::async(std::launch::async, _function, std::move(image));
+			_future = std::async(std::launch::async, _function, std::move(image), std::ref(_cancelled), _progress.get());
 			_async_started = true;
 		}
 	}
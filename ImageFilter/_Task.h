@@ -1,9 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <d3d9.h>
 #include "DirectXTex\DirectXTex.h"
 #include "IImageFilter.h"
@@ -13,27 +16,51 @@ namespace Flat
 {
 	class _ImageFilter;
 
+	// output of running task in progressive mode. worker adds finished rects of it and update() takes them in device thread
+	struct _Progress
+	{
+		std::mutex _mutex;
+		// cubic preview is separate image. worker is writing the output while it is read
+		DirectX::ScratchImage _preview;
+		DirectX::Image _image{};
+		std::vector<RECT> _dirty_rects;
+
+		// preview is handed over before conversion starts. it is taken once as whole image
+		void start(DirectX::ScratchImage&& preview, DirectX::Image const& image);
+		void add(RECT const& rect);
+		// worker calls it before the output goes away. nothing is taken after it
+		void stop();
+		// returned lock holds off stop() until rects of the output are copied
+		std::unique_lock<std::mutex> take(DirectX::ScratchImage& preview, DirectX::Image& image, std::vector<RECT>& rects);
+	};
+
 	struct _Task
 	{
-		using Function_type = std::function<DirectX::ScratchImage(DirectX::ScratchImage&&)>;
+		// flag is polled by the function and it gives up when the flag is set. progress is null if partial callback isn't set
+		using Function_type = std::function<DirectX::ScratchImage(DirectX::ScratchImage&&, std::atomic<bool>&, _Progress*)>;
 		Function_type _function;
 		IImageFilter::Filter_callback_type _callback;
+		IImageFilter::Partial_callback_type _partial_callback;
 
 		LPDIRECT3DTEXTURE9 _pTexture{};
 		size_t const _index;
 		static size_t _unique_index;
 
+		// they are used by worker of the future. so they are declared before the future that waits for the worker when destroyed
+		std::atomic<bool> _cancelled{};
+		std::unique_ptr<_Progress> _progress;
 		std::future<DirectX::ScratchImage> _future;
 		std::weak_ptr<_Token> _weak_token_ptr;
-		bool _cancelled{};
 		bool _token_issued{};
 		bool _async_started{};
+		// partial callback takes it every time
+		LPDIRECT3DTEXTURE9 _pPreviewTexture{};
 
 		std::chrono::system_clock::time_point _reserved_time;
 		std::chrono::system_clock::time_point _started_time;
 
 	public:
-		_Task(LPDIRECT3DTEXTURE9 pTexutre, Function_type function, IImageFilter::Filter_callback_type callback);
+		_Task(LPDIRECT3DTEXTURE9 pTexutre, Function_type function, IImageFilter::Filter_callback_type callback, IImageFilter::Partial_callback_type partial_callback);
 		~_Task();
 		_Task(const _Task&) = delete;
 		_Task(_Task&&) = delete;
@@ -0,0 +1,133 @@
+/*
+ * decompression throughput of block formats in DirectXTex. it is built as a separate program with DirectXTex
+ *
+ * blocks are random. so it needs no image file. 8-bit unorm targets take the integer decoders and float targets take the float path.
+ * Decompress() gets its image from ScratchImagePool. so time of a run is mostly decoding
+ *
+ * usage: bcbench [size] [iterations]
+*/
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "DirectXTex\DirectXTex.h"
+
+
+namespace
+{
+	struct Case
+	{
+		DXGI_FORMAT compressed;
+		DXGI_FORMAT target;
+		const char* name;
+	};
+
+	const Case cases[] = {
+		{ DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, "BC1 -> R8G8B8A8_UNORM" },
+		{ DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM, "BC1 -> B8G8R8A8_UNORM" },
+		{ DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT, "BC1 -> R32G32B32A32_FLOAT" },
+		{ DXGI_FORMAT_BC2_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, "BC2 -> R8G8B8A8_UNORM" },
+		{ DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, "BC3 -> R8G8B8A8_UNORM" },
+		{ DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT, "BC3 -> R32G32B32A32_FLOAT" },
+		{ DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_R8_UNORM, "BC4 -> R8_UNORM" },
+		{ DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_R32_FLOAT, "BC4 -> R32_FLOAT" },
+		{ DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_R8G8_UNORM, "BC5 -> R8G8_UNORM" },
+		{ DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, "BC7 -> R8G8B8A8_UNORM" },
+	};
+
+	const int run_count = 3;
+
+	// MPix/s of the best run. a run decodes image for the given times
+	HRESULT measure(DirectX::Image const& image, DXGI_FORMAT format, size_t iterations, double& mega_pixels_per_second)
+	{
+		mega_pixels_per_second = 0;
+
+		// memory of pool is filled at first
+		{
+			DirectX::ScratchImage warm_up;
+			auto hr = DirectX::Decompress(image, format, warm_up);
+
+			if (FAILED(hr)) {
+				return hr;
+			}
+		}
+
+		auto best = 0.0;
+
+		for (auto run = 0; run < run_count; ++run) {
+			auto start = std::chrono::high_resolution_clock::now();
+
+			for (size_t i = 0; i < iterations; ++i) {
+				DirectX::ScratchImage decompressed;
+				auto hr = DirectX::Decompress(image, format, decompressed);
+
+				if (FAILED(hr)) {
+					return hr;
+				}
+			}
+
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			if (elapsed.count() > 0) {
+				best = std::max(best, static_cast<double>(image.width) * image.height * iterations / elapsed.count() / 1000000.0);
+			}
+		}
+
+		mega_pixels_per_second = best;
+
+		return S_OK;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t size = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2048;
+	size_t iterations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 10;
+
+	if (!size || size % 4 || !iterations) {
+		fprintf(stderr, "usage: bcbench [size which is multiple of 4] [iterations]\n");
+		return 1;
+	}
+
+	DirectX::ScratchImagePool pool;
+	DirectX::ScratchImagePool::SetDefault(&pool);
+
+	printf("%ux%u, %u iterations, best of %d runs\n", static_cast<unsigned>(size), static_cast<unsigned>(size), static_cast<unsigned>(iterations), run_count);
+	printf("%-28s %10s\n", "format", "MPix/s");
+
+	std::mt19937 random{ 5489u };
+	auto result = 0;
+
+	for (auto& c : cases) {
+		DirectX::ScratchImage compressed;
+
+		if (FAILED(compressed.Initialize2D(c.compressed, size, size, 1, 1))) {
+			fprintf(stderr, "%s: failed to allocate\n", c.name);
+			result = 1;
+			continue;
+		}
+
+		auto& image = *compressed.GetImage(0, 0, 0);
+
+		for (size_t i = 0; i < image.slicePitch; ++i) {
+			image.pixels[i] = static_cast<uint8_t>(random());
+		}
+
+		double mega_pixels_per_second{};
+		auto hr = measure(image, c.target, iterations, mega_pixels_per_second);
+
+		if (FAILED(hr)) {
+			fprintf(stderr, "%s: failed (0x%08x)\n", c.name, static_cast<unsigned>(hr));
+			result = 1;
+			continue;
+		}
+
+		printf("%-28s %10.1f\n", c.name, mega_pixels_per_second);
+	}
+
+	DirectX::ScratchImagePool::SetDefault(nullptr);
+
+	return result;
+}
@@ -0,0 +1,228 @@
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "Test.h"
+#include "DirectXTex\DirectXTex.h"
+#include "DirectXTex\DDS.h"
+
+
+namespace Flat
+{
+	namespace Test
+	{
+		namespace
+		{
+			std::wstring get_temp_path(const wchar_t* name)
+			{
+				wchar_t directory[MAX_PATH]{};
+				GetTempPathW(MAX_PATH, directory);
+
+				return std::wstring(directory) + name;
+			}
+
+			// rows are compared. pitch of view and copy could differ
+			bool is_same(DirectX::Image const& lhs, DirectX::Image const& rhs)
+			{
+				if (lhs.width != rhs.width || lhs.height != rhs.height || lhs.format != rhs.format || !lhs.pixels || !rhs.pixels) {
+					return false;
+				}
+
+				auto row_size = std::min(lhs.rowPitch, rhs.rowPitch);
+				auto row_count = DirectX::ComputeScanlines(lhs.format, lhs.height);
+
+				for (size_t y = 0; y < row_count; ++y) {
+					if (memcmp(lhs.pixels + y * lhs.rowPitch, rhs.pixels + y * rhs.rowPitch, row_size)) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			bool is_same(DirectX::ScratchImage const& lhs, DirectX::ScratchImage const& rhs)
+			{
+				if (lhs.GetImageCount() != rhs.GetImageCount()) {
+					return false;
+				}
+
+				for (size_t i = 0; i < lhs.GetImageCount(); ++i) {
+					if (!is_same(lhs.GetImages()[i], rhs.GetImages()[i])) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			// streamed images are same of LoadFromDDSFile. index out of file is refused
+			void check_streaming(DirectX::DDSFileMapping const& mapping, DirectX::ScratchImage const& loaded)
+			{
+				auto& metadata = mapping.GetMetadata();
+
+				for (size_t item = 0; item < metadata.arraySize; ++item) {
+					for (size_t mip = 0; mip < metadata.mipLevels; ++mip) {
+						DirectX::ScratchImage image;
+						auto* expected = loaded.GetImage(mip, item, 0);
+
+						CHECK(SUCCEEDED(mapping.GetImage(mip, item, 0, image)) && expected && is_same(*image.GetImages(), *expected));
+					}
+				}
+
+				DirectX::ScratchImage image;
+				CHECK(mapping.GetImage(metadata.mipLevels, 0, 0, image) == E_INVALIDARG);
+				CHECK(mapping.GetImage(0, metadata.arraySize, 0, image) == E_INVALIDARG);
+
+				DirectX::ScratchImage copy;
+				CHECK(SUCCEEDED(mapping.CopyTo(copy)) && is_same(copy, loaded));
+			}
+
+			// dxgi format needs no conversion. images of mapping are views into the file
+			void test_direct()
+			{
+				DirectX::ScratchImage source;
+
+				if (!CHECK(SUCCEEDED(source.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 32, 3, 4)))) {
+					return;
+				}
+
+				for (size_t i = 0; i < source.GetImageCount(); ++i) {
+					auto& image = source.GetImages()[i];
+
+					for (size_t j = 0; j < image.slicePitch; ++j) {
+						image.pixels[j] = static_cast<uint8_t>(j * 7 + i);
+					}
+				}
+
+				auto path = get_temp_path(L"ImageFilterTest_direct.dds");
+
+				if (!CHECK(SUCCEEDED(DirectX::SaveToDDSFile(source.GetImages(), source.GetImageCount(), source.GetMetadata(), DirectX::DDS_FLAGS_NONE, path.c_str())))) {
+					return;
+				}
+
+				DirectX::ScratchImage loaded;
+
+				if (CHECK(SUCCEEDED(DirectX::LoadFromDDSFile(path.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, loaded)))) {
+					DirectX::DDSFileMapping mapping;
+
+					if (CHECK(SUCCEEDED(mapping.Open(path.c_str(), DirectX::DDS_FLAGS_NONE)))) {
+						auto& metadata = mapping.GetMetadata();
+
+						CHECK(metadata.width == 64 && metadata.height == 32 && metadata.arraySize == 3 && metadata.mipLevels == 4);
+						CHECK(metadata.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+						CHECK(mapping.IsDirect());
+
+						if (CHECK(mapping.GetImages() && mapping.GetImageCount() == loaded.GetImageCount())) {
+							for (size_t i = 0; i < mapping.GetImageCount(); ++i) {
+								CHECK(is_same(mapping.GetImages()[i], loaded.GetImages()[i]));
+							}
+						}
+
+						check_streaming(mapping, loaded);
+
+						// mapping is moved. closed one has no image
+						DirectX::DDSFileMapping moved(std::move(mapping));
+						DirectX::ScratchImage image;
+
+						CHECK(moved.IsDirect() && moved.GetImageCount() == loaded.GetImageCount());
+						CHECK(!mapping.GetImages() && mapping.GetImage(0, 0, 0, image) == E_UNEXPECTED);
+
+						moved.Close();
+						CHECK(!moved.GetImages() && moved.GetImage(0, 0, 0, image) == E_UNEXPECTED);
+						CHECK(moved.CopyTo(image) == E_UNEXPECTED);
+					}
+				}
+
+				DeleteFileW(path.c_str());
+			}
+
+			// 24bpp file of d3d9 is expanded to R8G8B8A8. so nothing is given as view and images are converted
+			void test_converted()
+			{
+				const uint32_t width = 8;
+				const uint32_t height = 4;
+
+				DirectX::DDS_HEADER header{};
+				header.dwSize = sizeof(header);
+				header.dwFlags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_PITCH;
+				header.dwWidth = width;
+				header.dwHeight = height;
+				header.dwPitchOrLinearSize = width * 3;
+				header.ddspf = DirectX::DDSPF_R8G8B8;
+				header.dwCaps = DDS_SURFACE_FLAGS_TEXTURE;
+
+				uint8_t pixels[width * height * 3]{};
+
+				for (size_t i = 0; i < sizeof(pixels); ++i) {
+					pixels[i] = static_cast<uint8_t>(i * 11 + 3);
+				}
+
+				auto path = get_temp_path(L"ImageFilterTest_converted.dds");
+				FILE* file{};
+
+				if (!CHECK(!_wfopen_s(&file, path.c_str(), L"wb") && file)) {
+					return;
+				}
+
+				fwrite(&DirectX::DDS_MAGIC, sizeof(DirectX::DDS_MAGIC), 1, file);
+				fwrite(&header, sizeof(header), 1, file);
+				fwrite(pixels, sizeof(pixels), 1, file);
+				fclose(file);
+
+				DirectX::ScratchImage loaded;
+
+				if (CHECK(SUCCEEDED(DirectX::LoadFromDDSFile(path.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, loaded)))) {
+					DirectX::DDSFileMapping mapping;
+
+					if (CHECK(SUCCEEDED(mapping.Open(path.c_str(), DirectX::DDS_FLAGS_NONE)))) {
+						CHECK(mapping.GetMetadata().format == DXGI_FORMAT_R8G8B8A8_UNORM);
+						CHECK(!mapping.IsDirect());
+						CHECK(!mapping.GetImages() && !mapping.GetImageCount());
+
+						check_streaming(mapping, loaded);
+
+						// BGR of file is swizzled and alpha is opaque
+						DirectX::ScratchImage image;
+
+						if (CHECK(SUCCEEDED(mapping.GetImage(0, 0, 0, image)))) {
+							auto* texel = image.GetImages()->pixels;
+
+							CHECK(texel[0] == pixels[2] && texel[1] == pixels[1] && texel[2] == pixels[0] && texel[3] == 0xff);
+						}
+					}
+				}
+
+				DeleteFileW(path.c_str());
+			}
+
+			void test_open_failure()
+			{
+				DirectX::DDSFileMapping mapping;
+
+				CHECK(mapping.Open(nullptr, DirectX::DDS_FLAGS_NONE) == E_INVALIDARG);
+				CHECK(FAILED(mapping.Open(get_temp_path(L"ImageFilterTest_missing.dds").c_str(), DirectX::DDS_FLAGS_NONE)));
+
+				// file shorter than header
+				auto path = get_temp_path(L"ImageFilterTest_short.dds");
+				FILE* file{};
+
+				if (CHECK(!_wfopen_s(&file, path.c_str(), L"wb") && file)) {
+					fwrite(&DirectX::DDS_MAGIC, sizeof(DirectX::DDS_MAGIC), 1, file);
+					fclose(file);
+
+					CHECK(FAILED(mapping.Open(path.c_str(), DirectX::DDS_FLAGS_NONE)));
+					CHECK(!mapping.GetImages() && !mapping.GetImageCount());
+
+					DeleteFileW(path.c_str());
+				}
+			}
+		}
+
+		void test_dds_file_mapping()
+		{
+			test_direct();
+			test_converted();
+			test_open_failure();
+		}
+	}
+}
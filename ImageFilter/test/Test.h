@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdio>
+
+
+/*
+ * checks of ImageFilter which run without window and device
+ *
+ * failed check is printed and counted. main() returns count of them
+*/
+namespace Flat
+{
+	namespace Test
+	{
+		extern int failure_count;
+
+		inline bool check(bool is_passed, const char* expression, const char* file, int line)
+		{
+			if (!is_passed) {
+				printf("%s(%d): failed: %s\n", file, line, expression);
+				++failure_count;
+			}
+
+			return is_passed;
+		}
+
+		void test_dds_file_mapping();
+	}
+}
+
+#define CHECK(x) ::Flat::Test::check((x), #x, __FILE__, __LINE__)
@@ -0,0 +1,32 @@
+#include "Test.h"
+
+
+namespace Flat
+{
+	namespace Test
+	{
+		int failure_count{};
+	}
+}
+
+int main()
+{
+	using namespace Flat::Test;
+
+	const struct
+	{
+		const char* name;
+		void(*function)();
+	} tests[] = {
+		{ "dds file mapping", test_dds_file_mapping },
+	};
+
+	for (auto& test : tests) {
+		auto old_failure_count = failure_count;
+		test.function();
+
+		printf("%s: %s\n", test.name, old_failure_count == failure_count ? "ok" : "FAILED");
+	}
+
+	return failure_count;
+}
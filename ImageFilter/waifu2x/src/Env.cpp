@@ -37,7 +37,12 @@ ComputeEnv::ComputeEnv()
 	num_cuda_dev(0),
 	cl_dev_list(nullptr),
 	cuda_dev_list(nullptr),
-	transfer_wait(0)
+	transfer_wait(0),
+	profiler(nullptr),
+	cancel_func(nullptr),
+	cancel_data(nullptr),
+	progress_func(nullptr),
+	progress_data(nullptr)
 {
 	this->pref_block_size = 512;
 }
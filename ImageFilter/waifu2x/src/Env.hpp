@@ -31,6 +31,7 @@ struct CUDADev;
 
 namespace w2xc {
 	struct ThreadPool;
+	struct Profiler;
 }
 
 struct ComputeEnv
@@ -43,6 +44,15 @@ struct ComputeEnv
 
     unsigned int pref_block_size;
 
+    // null if stages are not recorded
+    w2xc::Profiler *profiler;
+    // null if conversion is not cancelled
+    W2XConvCancelFunc cancel_func;
+    void *cancel_data;
+    // null if finished blocks are not reported
+    W2XConvProgressFunc progress_func;
+    void *progress_data;
+
 #if defined(_WIN32) || defined(__linux)
     w2xc::ThreadPool *tpool;
 #endif
@@ -51,4 +61,9 @@ struct ComputeEnv
 
 extern void clearError(W2XConv *conv);
 
+static inline bool isCancelled(ComputeEnv *env)
+{
+    return env->cancel_func && env->cancel_func(env->cancel_data);
+}
+
 #endif
@@ -22,10 +22,12 @@
 */
 
 #include <limits.h>
+#include <string.h>
 #include "convertRoutine.hpp"
 #include "common.hpp"
 #include "Buffer.hpp"
 #include "sec.hpp"
+#include "profiler.hpp"
 
 namespace w2xc
 {
@@ -52,9 +54,35 @@ namespace w2xc
 		W2XConvFlopsCounter *flops,
 		int blockSize,
 		enum image_format fmt,
+		int log_level,
+		bool tta_mode
+	);
+
+	// result is in packed_input_buf after it
+	static bool applyModels
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		Buffer *&packed_input_buf,
+		Buffer *&packed_output_buf,
+		std::vector<std::unique_ptr<Model> > &models,
+		W2XConvFlopsCounter *flops,
+		W2Size filterSize,
 		int log_level
 	);
 
+	static int allocBlockBuffers
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		std::vector<std::unique_ptr<Model> > &models,
+		int inputWidth,
+		int inputHeight,
+		int blockSize,
+		Buffer **input_buf,
+		Buffer **output_buf
+	);
+
 	bool convertWithModels
 	(
 		W2XConv *conv,
@@ -64,9 +92,96 @@ namespace w2xc
 		W2XConvFlopsCounter *flops,
 		int blockSize,
 		enum image_format fmt,
-		int log_level)
+		int log_level,
+		bool tta_mode)
+	{
+		return convertWithModelsBlockSplit(conv, env, inputPlane, outputPlane, models, flops, blockSize, fmt, log_level, tta_mode);
+	}
+
+	bool convertWithModelsStrided
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		BlockSource &source,
+		BlockSink &sink,
+		std::vector<std::unique_ptr<Model> > &models,
+		W2XConvFlopsCounter *flops,
+		int blockSize,
+		int log_level
+	)
 	{
-		return convertWithModelsBlockSplit(conv, env, inputPlane, outputPlane, models, flops, blockSize, fmt, log_level);
+		int nModel = (int) models.size();
+		int width = source.width;
+		int height = source.height;
+
+		if (blockSize == 0)
+		{
+			blockSize = env->pref_block_size;
+		}
+
+		Buffer *input_buf, *output_buf;
+		blockSize = allocBlockBuffers(conv, env, models, width, height, blockSize, &input_buf, &output_buf);
+
+		// output of a block is smaller than its input by halo of each side
+		int clipWidth = (std::min)(blockSize, width + nModel*2) - nModel*2;
+		int clipHeight = (std::min)(blockSize, height + nModel*2) - nModel*2;
+		unsigned int splitColumns = (width + (clipWidth-1)) / clipWidth;
+		unsigned int splitRows = (height + (clipHeight-1)) / clipHeight;
+
+		for (unsigned int r = 0; r < splitRows; r++)
+		{
+			for (unsigned int c = 0; c < splitColumns; c++)
+			{
+				int x = c * clipWidth;
+				int y = r * clipHeight;
+				int w = (std::min)(clipWidth, width - x);
+				int h = (std::min)(clipHeight, height - y);
+				int blockWidth = w + nModel*2;
+				int blockHeight = h + nModel*2;
+				int index = r * splitColumns + c;
+
+				if (isCancelled(env))
+				{
+					delete input_buf;
+					delete output_buf;
+
+					return false;
+				}
+
+				ProfileSpan tile_span(env->profiler, W2XCONV_STAGE_TILE, index);
+
+				if (log_level >= 3)
+				{
+					printf("Processing block, column (%02d/%02d), row (%02d/%02d) ...\n", (c+1), splitColumns, (r+1), splitRows);
+				}
+
+				ProfileSpan pack_span(env->profiler, W2XCONV_STAGE_PACK, index, (double) blockWidth * blockHeight * sizeof(float) * 3);
+				source.pack((float*)input_buf->get_write_ptr_host(env), x - nModel, y - nModel, blockWidth, blockHeight);
+				pack_span.finish();
+
+				Buffer *packed_input_buf = input_buf;
+				Buffer *packed_output_buf = output_buf;
+
+				if (!applyModels(conv, env, packed_input_buf, packed_output_buf, models, flops, W2Size(blockWidth, blockHeight), log_level))
+				{
+					delete input_buf;
+					delete output_buf;
+
+					return false;
+				}
+
+				ProfileSpan unpack_span(env->profiler, W2XCONV_STAGE_UNPACK, index, (double) w * h * sizeof(float) * 3 * 2);
+				const float *packed = (const float*)packed_input_buf->get_read_ptr_host(env, sizeof(float) * blockWidth * blockHeight * 3);
+
+				// halo of output is not valid
+				sink.unpack(packed + (nModel * blockWidth + nModel) * 3, blockWidth, x, y, w, h);
+			}
+		}
+
+		delete input_buf;
+		delete output_buf;
+
+		return true;
 	}
 
 	static bool convertWithModelsBasic
@@ -91,6 +206,9 @@ namespace w2xc
 		int filterHeight = filterSize.height;
 
 		float *packed_input = (float*)packed_input_buf->get_write_ptr_host(env);
+		int nPackedPlanes = IS_3CHANNEL(fmt) ? 3 : 1;
+
+		ProfileSpan pack_span(env->profiler, W2XCONV_STAGE_PACK, -1, (double) filterWidth * filterHeight * (CV_ELEM_SIZE(inputPlane.type) + sizeof(float) * nPackedPlanes));
 
 		switch (fmt) {
 			case IMAGE_BGR:
@@ -115,46 +233,14 @@ namespace w2xc
 			}
 		}
 
-		double t00 = getsec();
-		double ops_sum = 0;
+		pack_span.finish();
 
-		for (int index = 0; index < (int)models.size(); index++)
+		if (!applyModels(conv, env, packed_input_buf, packed_output_buf, models, flops, filterSize, log_level))
 		{
-			int nOutputPlanes = models[index]->getNOutputPlanes();
-			int nInputPlanes = models[index]->getNInputPlanes();
-
-			if (log_level >= 4)
-			{
-				printf("Iteration #%d(%3d->%3d)...", (index + 1), nInputPlanes, nOutputPlanes);
-			}
-			
-			double t0 = getsec();
-
-			if (!models[index]->filter(conv, env, packed_input_buf, packed_output_buf, filterSize))
-			{
-				std::exit(-1);
-			}
-			
-			double t1 = getsec();
-			double ops = filterSize.width * filterSize.height * 9.0 * 2.0 * nOutputPlanes * nInputPlanes;
-			
-			if (log_level >= 4)
-			{
-				double gflops = (ops/(1000.0*1000.0*1000.0)) / (t1-t0);
-				double bytes = (double) filterSize.width * filterSize.height * sizeof(float) * (nOutputPlanes + nInputPlanes);
-				double gigabytesPerSec = (bytes/(1000.0*1000.0*1000.0)) / (t1-t0);
-
-				printf("(%.5f[s], %7.2f[GFLOPS], %8.3f[GB/s])\n", t1-t0, gflops, gigabytesPerSec);
-			}
-			
-			ops_sum += ops;
-
-			flops->flop += ops;
-			flops->filter_sec += t1-t0;
-
-			std::swap(packed_input_buf, packed_output_buf);
+			return false;
 		}
-		double t01 = getsec();
+
+		ProfileSpan unpack_span(env->profiler, W2XCONV_STAGE_UNPACK, -1, (double) filterWidth * filterHeight * sizeof(float) * nPackedPlanes * 2);
 
 		if (IS_3CHANNEL(fmt))
 		{
@@ -192,171 +278,188 @@ namespace w2xc
 			}
 		}
 
-		if (log_level >= 3)
+		unpack_span.finish();
+
+		return true;
+	}
+
+	// variant of test-time augmentation. src_x = ax*x + bx*y + cx, src_y = ay*x + by*y + cy for pixel of transformed image
+	struct TTATransform
+	{
+		int width;
+		int height;
+		int ax, bx, cx;
+		int ay, by, cy;
+	};
+
+	// rotates clockwise (index%4) times and flips horizontally if index >= 4
+	static TTATransform getTTATransform(int index, int width, int height)
+	{
+		TTATransform t = { width, height, 1, 0, 0, 0, 1, 0 };
+
+		for (int i = 0; i < index % 4; i++)
 		{
-			double gflops = ops_sum/(1000.0*1000.0*1000.0) / (t01-t00);
-			printf("total : %.3f[sec], %07.2f[GFLOPS]\n", t01-t00, gflops);
+			// rotated(x, y) = image(y, h-1-x)
+			t = { t.height, t.width, -t.bx, t.ax, t.cx + t.bx * (t.height - 1), -t.by, t.ay, t.cy + t.by * (t.height - 1) };
 		}
 
-		return true;
+		if (index >= 4)
+		{
+			// flipped(x, y) = image(w-1-x, y)
+			t = { t.width, t.height, -t.ax, t.bx, t.cx + t.ax * (t.width - 1), -t.ay, t.by, t.cy + t.ay * (t.width - 1) };
+		}
+
+		return t;
 	}
 
-	static bool convertWithModelsBlockSplit
+	/*
+	 * transparent area of sprite is filled by one color, and so is flat background.
+	 * if every pixel of block including halo is same, every output pixel is same too.
+	 * it is propagated through layers as one pixel instead of convolution of whole block
+	 */
+	static bool fillUniformBlock
 	(
-		W2XConv *conv,
 		ComputeEnv *env,
-		W2Mat &inputPlane_2,
-		W2Mat &outputPlane_2,
+		Buffer *packed_input_buf,
 		std::vector<std::unique_ptr<Model> > &models,
-		W2XConvFlopsCounter *flops,
-		int blockSize,
-		enum image_format fmt,
-		int log_level
+		W2Size filterSize
 	)
 	{
-		// padding is not required before calling this function
-		// initialize local variables
-		int nModel = (int) models.size();
+		int nPlanes = models[0]->getNInputPlanes();
+		size_t nPixels = (size_t) filterSize.width * filterSize.height;
+		float *packed = (float*)packed_input_buf->get_read_ptr_host(env, sizeof(float) * nPixels * nPlanes);
 
-		//insert padding to inputPlane
-		int tempWidth = (int) inputPlane_2.view_width + nModel*2;
-		int tempHeight = (int) inputPlane_2.view_height + nModel*2;
-		int inputWidth = inputPlane_2.view_width;
-		int inputHeight = inputPlane_2.view_height;
+		for (size_t i = 1; i < nPixels; i++)
+		{
+			if (memcmp(packed + i * nPlanes, packed, sizeof(float) * nPlanes) != 0)
+			{
+				return false;
+			}
+		}
 
-		W2Mat tempMat_2(tempWidth, tempHeight, inputPlane_2.type);
-		int elem_size = CV_ELEM_SIZE(inputPlane_2.type);
+		ProfileSpan uniform_span(env->profiler, W2XCONV_STAGE_UNIFORM);
+		std::vector<float> value(packed, packed + nPlanes);
 
-		/* y border */
-		for (int bi=0; bi<nModel; bi++)
+		for (auto&& m : models)
 		{
-			char *dst;
-			char *src;
-
-			/* top */
-			dst = tempMat_2.ptr<char>(bi) + elem_size * nModel;
-			src = inputPlane_2.ptr<char>(0);
-			memcpy(dst, src, inputWidth * elem_size);
-
-			/* bottom */
-			dst = tempMat_2.ptr<char>(inputHeight + nModel + bi) + elem_size * nModel;
-			src = inputPlane_2.ptr<char>(inputHeight - 1);
-			memcpy(dst, src, inputWidth * elem_size);
+			std::vector<float> next(m->getNOutputPlanes());
+			m->filterConstant(value.data(), next.data());
+			value.swap(next);
 		}
 
-		/* body */
-		for (int bi=0; bi<inputHeight; bi++)
+		nPlanes = (int) value.size();
+		packed = (float*)packed_input_buf->get_write_ptr_host(env);
+
+		for (size_t i = 0; i < nPixels; i++)
 		{
-			char *dst;
-			char *src;
-			dst = tempMat_2.ptr<char>(bi + nModel) + elem_size * nModel;
-			src = inputPlane_2.ptr<char>(bi);
-			memcpy(dst, src, inputWidth * elem_size);
+			memcpy(packed + i * nPlanes, value.data(), sizeof(float) * nPlanes);
 		}
 
-		/* x border */
-		for (int bi=0; bi<tempHeight; bi++)
+		return true;
+	}
+
+	static bool applyModels
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		Buffer *&packed_input_buf,
+		Buffer *&packed_output_buf,
+		std::vector<std::unique_ptr<Model> > &models,
+		W2XConvFlopsCounter *flops,
+		W2Size filterSize,
+		int log_level
+	)
+	{
+		if (fillUniformBlock(env, packed_input_buf, models, filterSize))
 		{
-			char *left = tempMat_2.ptr<char>(bi);
-			char *right = left + elem_size * (nModel + inputWidth);
-			uint32_t v32;
-			uint32_t v_0, v_1, v_2;
+			if (log_level >= 3)
+			{
+				printf("uniform block is filled without filters\n");
+			}
+
+			return true;
+		}
 
-			switch (elem_size)
+		double t00 = getsec();
+		double ops_sum = 0;
+
+		for (int index = 0; index < (int)models.size(); index++)
+		{
+			int nOutputPlanes = models[index]->getNOutputPlanes();
+			int nInputPlanes = models[index]->getNInputPlanes();
+
+			// a layer of big block takes a while. so it is checked per layer rather than per block
+			if (isCancelled(env))
 			{
-				case 1:
-				{
-					memset(left, left[nModel], nModel);
-					memset(right, right[-1], nModel);
-					break;
-				}
-				case 3:
-				{
-					v_0 = ((unsigned char*)left)[nModel*3+0];
-					v_1 = ((unsigned char*)left)[nModel*3+1];
-					v_2 = ((unsigned char*)left)[nModel*3+2];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						left[xi*3+0] = v_0;
-						left[xi*3+1] = v_1;
-						left[xi*3+2] = v_2;
-					}
+				return false;
+			}
 
-					v_0 = ((unsigned char*)right)[-3+0];
-					v_1 = ((unsigned char*)right)[-3+1];
-					v_2 = ((unsigned char*)right)[-3+2];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						right[xi*3+0] = v_0;
-						right[xi*3+1] = v_1;
-						right[xi*3+2] = v_2;
-					}
-					
-					break;
-				}
-				case 4:
-				{
-					v32 = ((uint32_t*)left)[nModel];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						((uint32_t*)left)[xi] = v32;
-					}
-					
-					v32 = ((uint32_t*)right)[-1];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						((uint32_t*)right)[xi] = v32;
-					}
-					
-					break;
-				}
-				case 12:
-				{
-					v_0 = ((uint32_t*)left)[nModel*3+0];
-					v_1 = ((uint32_t*)left)[nModel*3+1];
-					v_2 = ((uint32_t*)left)[nModel*3+2];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						((uint32_t*)left)[xi*3+0] = v_0;
-						((uint32_t*)left)[xi*3+1] = v_1;
-						((uint32_t*)left)[xi*3+2] = v_2;
-					}
+			if (log_level >= 4)
+			{
+				printf("Iteration #%d(%3d->%3d)...", (index + 1), nInputPlanes, nOutputPlanes);
+			}
+			
+			double ops = filterSize.width * filterSize.height * 9.0 * 2.0 * nOutputPlanes * nInputPlanes;
+			double bytes = (double) filterSize.width * filterSize.height * sizeof(float) * (nOutputPlanes + nInputPlanes);
+			double t0 = getsec();
+			ProfileSpan filter_span(env->profiler, W2XCONV_STAGE_FILTER, index, bytes, ops);
 
-					v_0 = ((uint32_t*)right)[-3+0];
-					v_1 = ((uint32_t*)right)[-3+1];
-					v_2 = ((uint32_t*)right)[-3+2];
-					
-					for (int xi=0; xi<nModel; xi++)
-					{
-						((uint32_t*)right)[xi*3+0] = v_0;
-						((uint32_t*)right)[xi*3+1] = v_1;
-						((uint32_t*)right)[xi*3+2] = v_2;
-					}
-					
-					break;
-				}
+			if (!models[index]->filter(conv, env, packed_input_buf, packed_output_buf, filterSize))
+			{
+				std::exit(-1);
+			}
+			
+			filter_span.finish();
+			double t1 = getsec();
+			
+			if (log_level >= 4)
+			{
+				double gflops = (ops/(1000.0*1000.0*1000.0)) / (t1-t0);
+				double gigabytesPerSec = (bytes/(1000.0*1000.0*1000.0)) / (t1-t0);
+
+				printf("(%.5f[s], %7.2f[GFLOPS], %8.3f[GB/s])\n", t1-t0, gflops, gigabytesPerSec);
 			}
+			
+			ops_sum += ops;
+
+			flops->flop += ops;
+			flops->filter_sec += t1-t0;
+
+			std::swap(packed_input_buf, packed_output_buf);
 		}
+		double t01 = getsec();
 
-		if (blockSize == 0)
+		if (log_level >= 3)
 		{
-			blockSize = env->pref_block_size;
+			double gflops = ops_sum/(1000.0*1000.0*1000.0) / (t01-t00);
+			printf("total : %.3f[sec], %07.2f[GFLOPS]\n", t01-t00, gflops);
 		}
 
-		Buffer *input_buf, *output_buf;
-		int ok_count = 0;
+		return true;
+	}
+
+	// halves blockSize until buffers of a block are allocated
+	static int allocBlockBuffers
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		std::vector<std::unique_ptr<Model> > &models,
+		int inputWidth,
+		int inputHeight,
+		int blockSize,
+		Buffer **input_buf,
+		Buffer **output_buf
+	)
+	{
+		int nModel = (int) models.size();
 
 		while (true)
 		{
 			long long max_size = 0;
 
-			int width = (std::min)(tempMat_2.view_width, blockSize);
-			int height = (std::min)(tempMat_2.view_height, blockSize);
+			// it is same for transposed variant of tta
+			int width = (std::min)(inputWidth + nModel*2, blockSize);
+			int height = (std::min)(inputHeight + nModel*2, blockSize);
 
 			for (int index = 0; index < (int)models.size(); index++)
 			{
@@ -375,16 +478,16 @@ namespace w2xc
 			}
 			else
 			{
-				input_buf = new Buffer(env, max_size);
-				output_buf = new Buffer(env, max_size);
+				*input_buf = new Buffer(env, max_size);
+				*output_buf = new Buffer(env, max_size);
 
-				if (input_buf->prealloc(conv, env) && output_buf->prealloc(conv, env))
+				if ((*input_buf)->prealloc(conv, env) && (*output_buf)->prealloc(conv, env))
 				{
-					break;
+					return blockSize;
 				}
 
-				delete input_buf;
-				delete output_buf;
+				delete *input_buf;
+				delete *output_buf;
 			}
 
 			blockSize /= 2;
@@ -396,17 +499,44 @@ namespace w2xc
 				abort();
 			}
 		}
+	}
 
-		int blockWidth = (std::min)(blockSize, tempMat_2.view_width);
-		int blockHeight = (std::min)(blockSize, tempMat_2.view_height);
-		int clipWidth = blockWidth - 2*nModel;
-		int clipHeight = blockHeight - 2*nModel;
+	static bool convertWithModelsBlockSplit
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		W2Mat &inputPlane_2,
+		W2Mat &outputPlane_2,
+		std::vector<std::unique_ptr<Model> > &models,
+		W2XConvFlopsCounter *flops,
+		int blockSize,
+		enum image_format fmt,
+		int log_level,
+		bool tta_mode
+	)
+	{
+		// padding is not required before calling this function
+		// initialize local variables
+		int nModel = (int) models.size();
+		int inputWidth = inputPlane_2.view_width;
+		int inputHeight = inputPlane_2.view_height;
+		int elem_size = CV_ELEM_SIZE(inputPlane_2.type);
+
+		// every variant is accumulated to output. so it should be float
+		int nTransform = 1;
+
+		if (tta_mode && (fmt == IMAGE_RGB_F32 || fmt == IMAGE_Y))
+		{
+			nTransform = 8;
+		}
 
-		//DEBUG printf("blockSize = %d\n", blockSize);
+		if (blockSize == 0)
+		{
+			blockSize = env->pref_block_size;
+		}
 
-		// calcurate split rows/cols
-		unsigned int splitColumns = (inputWidth + (clipWidth-1)) / clipWidth;
-		unsigned int splitRows = (inputHeight + (clipHeight-1)) / clipHeight;
+		Buffer *input_buf, *output_buf;
+		blockSize = allocBlockBuffers(conv, env, models, inputWidth, inputHeight, blockSize, &input_buf, &output_buf);
 
 		switch (fmt)
 		{
@@ -432,113 +562,323 @@ namespace w2xc
 			}
 		}
 
-		for (unsigned int r = 0; r < splitRows; r++)
+		for (int ti = 0; ti < nTransform; ti++)
 		{
-			int clipStartY = r * clipHeight;
-			int clipEndY = 0;
+			// transform is applied while padding and copying back. so variant doesn't need image of its own
+			TTATransform transform = getTTATransform(ti, inputWidth, inputHeight);
 
-			if (r == splitRows - 1)
-			{
-				clipEndY = tempMat_2.view_height;
-			}
-			else
+			if (nTransform > 1 && log_level >= 2)
 			{
-				clipEndY = r * clipHeight + blockHeight;
+				printf("Working on TTA mode... step%d/%d\n", ti+1, nTransform);
 			}
 
-			for (unsigned int c = 0; c < splitColumns; c++)
-			{
-				// start to convert
-				W2Mat processBlockOutput;
+			//insert padding to inputPlane
+			int tempWidth = transform.width + nModel*2;
+			int tempHeight = transform.height + nModel*2;
 
-				int clipStartX = c * clipWidth;
-				int clipEndX = 0;
+			W2Mat tempMat_2(tempWidth, tempHeight, inputPlane_2.type);
+			ProfileSpan padding_span(env->profiler, W2XCONV_STAGE_PACK, -1, (double) inputWidth * inputHeight * elem_size + (double) tempWidth * tempHeight * elem_size);
 
-				if (c == splitColumns - 1)
-				{
-					clipEndX = tempMat_2.view_width;
-				}
-				else 
+			/* body */
+			for (int bi=0; bi<transform.height; bi++)
+			{
+				char *dst = tempMat_2.ptr<char>(bi + nModel) + elem_size * nModel;
+
+				if (ti == 0)
 				{
-					clipEndX = c * (blockWidth - 2 * nModel) + blockWidth;
+					char *src = inputPlane_2.ptr<char>(bi);
+					memcpy(dst, src, transform.width * elem_size);
+					continue;
 				}
 
-				int curBlockWidth = clipEndX - clipStartX;
-				int curBlockHeight = clipEndY - clipStartY;
-				
-				W2Mat processBlock(tempMat_2, clipStartX, clipStartY, curBlockWidth, curBlockHeight);
-
-				if (log_level >= 3)
+				for (int xi=0; xi<transform.width; xi++)
 				{
-					printf("Processing block, column (%02d/%02d), row (%02d/%02d) ...\n", (c+1), splitColumns, (r+1), splitRows);
+					int src_x = transform.ax * xi + transform.bx * bi + transform.cx;
+					int src_y = transform.ay * xi + transform.by * bi + transform.cy;
+
+					memcpy(dst + xi * elem_size, inputPlane_2.ptr<char>(src_y) + src_x * elem_size, elem_size);
 				}
+			}
 
-				int elemSize = 0;
+			/* y border */
+			for (int bi=0; bi<nModel; bi++)
+			{
+				char *dst;
+				char *src;
+
+				/* top */
+				dst = tempMat_2.ptr<char>(bi) + elem_size * nModel;
+				src = tempMat_2.ptr<char>(nModel) + elem_size * nModel;
+				memcpy(dst, src, transform.width * elem_size);
+
+				/* bottom */
+				dst = tempMat_2.ptr<char>(transform.height + nModel + bi) + elem_size * nModel;
+				src = tempMat_2.ptr<char>(transform.height + nModel - 1) + elem_size * nModel;
+				memcpy(dst, src, transform.width * elem_size);
+			}
 
-				switch (fmt)
+			/* x border */
+			for (int bi=0; bi<tempHeight; bi++)
+			{
+				char *left = tempMat_2.ptr<char>(bi);
+				char *right = left + elem_size * (nModel + transform.width);
+				uint32_t v32;
+				uint32_t v_0, v_1, v_2;
+
+				switch (elem_size)
 				{
-					case IMAGE_BGR:
-					case IMAGE_RGB:
+					case 1:
+					{
+						memset(left, left[nModel], nModel);
+						memset(right, right[-1], nModel);
+						break;
+					}
+					case 3:
 					{
-						elemSize = 3;
+						v_0 = ((unsigned char*)left)[nModel*3+0];
+						v_1 = ((unsigned char*)left)[nModel*3+1];
+						v_2 = ((unsigned char*)left)[nModel*3+2];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							left[xi*3+0] = v_0;
+							left[xi*3+1] = v_1;
+							left[xi*3+2] = v_2;
+						}
+
+						v_0 = ((unsigned char*)right)[-3+0];
+						v_1 = ((unsigned char*)right)[-3+1];
+						v_2 = ((unsigned char*)right)[-3+2];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							right[xi*3+0] = v_0;
+							right[xi*3+1] = v_1;
+							right[xi*3+2] = v_2;
+						}
+						
 						break;
 					}
-					case IMAGE_RGB_F32:
+					case 4:
 					{
-						elemSize = 12;
+						v32 = ((uint32_t*)left)[nModel];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							((uint32_t*)left)[xi] = v32;
+						}
+						
+						v32 = ((uint32_t*)right)[-1];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							((uint32_t*)right)[xi] = v32;
+						}
+						
 						break;
 					}
-					case IMAGE_Y:
+					case 12:
 					{
-						elemSize = 4;
+						v_0 = ((uint32_t*)left)[nModel*3+0];
+						v_1 = ((uint32_t*)left)[nModel*3+1];
+						v_2 = ((uint32_t*)left)[nModel*3+2];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							((uint32_t*)left)[xi*3+0] = v_0;
+							((uint32_t*)left)[xi*3+1] = v_1;
+							((uint32_t*)left)[xi*3+2] = v_2;
+						}
+
+						v_0 = ((uint32_t*)right)[-3+0];
+						v_1 = ((uint32_t*)right)[-3+1];
+						v_2 = ((uint32_t*)right)[-3+2];
+						
+						for (int xi=0; xi<nModel; xi++)
+						{
+							((uint32_t*)right)[xi*3+0] = v_0;
+							((uint32_t*)right)[xi*3+1] = v_1;
+							((uint32_t*)right)[xi*3+2] = v_2;
+						}
+						
 						break;
 					}
-					//FutureNote: no default(-break) ?
 				}
+			}
 
-				if (!convertWithModelsBasic
-					(
-						conv,
-						env,
-						processBlock,
-						processBlockOutput,
-						input_buf,
-						output_buf,
-						models,
-						flops,
-						fmt,
-						log_level
-					)
-				)
+			padding_span.finish();
+
+			int blockWidth = (std::min)(blockSize, tempMat_2.view_width);
+			int blockHeight = (std::min)(blockSize, tempMat_2.view_height);
+			int clipWidth = blockWidth - 2*nModel;
+			int clipHeight = blockHeight - 2*nModel;
+
+			//DEBUG printf("blockSize = %d\n", blockSize);
+
+			// calcurate split rows/cols
+			unsigned int splitColumns = (transform.width + (clipWidth-1)) / clipWidth;
+			unsigned int splitRows = (transform.height + (clipHeight-1)) / clipHeight;
+
+			for (unsigned int r = 0; r < splitRows; r++)
+			{
+				int clipStartY = r * clipHeight;
+				int clipEndY = 0;
+
+				if (r == splitRows - 1)
 				{
-					std::cerr <<
-						"w2xc::convertWithModelsBasic()\nin w2xc::convertWithModelsBlockSplit() : \n something error has occured. stop."
-						<< std::endl;
-						
-					return false;
+					clipEndY = tempMat_2.view_height;
+				}
+				else
+				{
+					clipEndY = r * clipHeight + blockHeight;
 				}
 
-				int srcStartY = nModel;
-				int srcStartX = nModel;
+				for (unsigned int c = 0; c < splitColumns; c++)
+				{
+					if (isCancelled(env))
+					{
+						delete input_buf;
+						delete output_buf;
 
-				int dstStartY = r * (blockHeight - 2*nModel);
-				int dstStartX = c * (blockWidth - 2*nModel);
-				int copyWidth = curBlockWidth - (nModel * 2);
-				int copyHeight = curBlockHeight - (nModel * 2);
+						return false;
+					}
 
-				for (int yi=0; yi<copyHeight; yi++)
-				{
-					char *src = processBlockOutput.ptr<char>(yi + srcStartY);
-					char *dst = outputPlane_2.ptr<char>(yi + dstStartY);
+					// start to convert
+					W2Mat processBlockOutput;
 
-					src += srcStartX * elemSize;
-					dst += dstStartX * elemSize;
+					int clipStartX = c * clipWidth;
+					int clipEndX = 0;
 
-					memcpy(dst, src, copyWidth * elemSize);
-				}
-			} // end process 1 column
+					if (c == splitColumns - 1)
+					{
+						clipEndX = tempMat_2.view_width;
+					}
+					else 
+					{
+						clipEndX = c * (blockWidth - 2 * nModel) + blockWidth;
+					}
+
+					int curBlockWidth = clipEndX - clipStartX;
+					int curBlockHeight = clipEndY - clipStartY;
+					
+					W2Mat processBlock(tempMat_2, clipStartX, clipStartY, curBlockWidth, curBlockHeight);
+					ProfileSpan tile_span(env->profiler, W2XCONV_STAGE_TILE, r * splitColumns + c);
+
+					if (log_level >= 3)
+					{
+						printf("Processing block, column (%02d/%02d), row (%02d/%02d) ...\n", (c+1), splitColumns, (r+1), splitRows);
+					}
 
-		} // end process all blocks
+					int elemSize = 0;
+
+					switch (fmt)
+					{
+						case IMAGE_BGR:
+						case IMAGE_RGB:
+						{
+							elemSize = 3;
+							break;
+						}
+						case IMAGE_RGB_F32:
+						{
+							elemSize = 12;
+							break;
+						}
+						case IMAGE_Y:
+						{
+							elemSize = 4;
+							break;
+						}
+						//FutureNote: no default(-break) ?
+					}
+
+					if (!convertWithModelsBasic
+						(
+							conv,
+							env,
+							processBlock,
+							processBlockOutput,
+							input_buf,
+							output_buf,
+							models,
+							flops,
+							fmt,
+							log_level
+						)
+					)
+					{
+						if (!isCancelled(env))
+						{
+							std::cerr <<
+								"w2xc::convertWithModelsBasic()\nin w2xc::convertWithModelsBlockSplit() : \n something error has occured. stop."
+								<< std::endl;
+						}
+						
+						delete input_buf;
+						delete output_buf;
+
+						return false;
+					}
+
+					int srcStartY = nModel;
+					int srcStartX = nModel;
+
+					int dstStartY = r * (blockHeight - 2*nModel);
+					int dstStartX = c * (blockWidth - 2*nModel);
+					int copyWidth = curBlockWidth - (nModel * 2);
+					int copyHeight = curBlockHeight - (nModel * 2);
+
+					ProfileSpan copy_span(env->profiler, W2XCONV_STAGE_COPY_BACK, r * splitColumns + c, (double) copyWidth * copyHeight * elemSize * 2);
+
+					for (int yi=0; yi<copyHeight; yi++)
+					{
+						char *src = processBlockOutput.ptr<char>(yi + srcStartY);
+						src += srcStartX * elemSize;
+
+						if (ti == 0)
+						{
+							char *dst = outputPlane_2.ptr<char>(yi + dstStartY);
+							dst += dstStartX * elemSize;
+
+							memcpy(dst, src, copyWidth * elemSize);
+							continue;
+						}
+
+						// inverse transform of variant and running sum
+						for (int xi=0; xi<copyWidth; xi++)
+						{
+							int x = dstStartX + xi;
+							int y = dstStartY + yi;
+							int dst_x = transform.ax * x + transform.bx * y + transform.cx;
+							int dst_y = transform.ay * x + transform.by * y + transform.cy;
+							float *dst = outputPlane_2.ptr<float>(dst_y) + dst_x * (elemSize / sizeof(float));
+							const float *src_pixel = (const float*)(src + xi * elemSize);
+
+							for (int ci=0; ci<elemSize / (int)sizeof(float); ci++)
+							{
+								dst[ci] += src_pixel[ci];
+							}
+						}
+					}
+				} // end process 1 column
+
+			} // end process all blocks
+		} // end process all variants
+
+		if (nTransform > 1)
+		{
+			int nElem = inputWidth * (CV_ELEM_SIZE(outputPlane_2.type) / (int)sizeof(float));
+
+			for (int yi=0; yi<inputHeight; yi++)
+			{
+				float *dst = outputPlane_2.ptr<float>(yi);
+
+				for (int xi=0; xi<nElem; xi++)
+				{
+					dst[xi] /= nTransform;
+				}
+			}
+		}
 
 		delete input_buf;
 		delete output_buf;
@@ -546,4 +886,3 @@ namespace w2xc
 		return true;
 	}
 }
-
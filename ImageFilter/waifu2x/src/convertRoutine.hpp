@@ -46,6 +46,7 @@ namespace w2xc
 
 /**
  * convert inputPlane to outputPlane by convoluting with models.
+ * tta_mode averages 8 rotated/flipped variants. it is applied to float formats only.
  */
 	bool convertWithModels
 	(
@@ -57,6 +58,45 @@ namespace w2xc
 		W2XConvFlopsCounter *flops,
 		int blockSize,
 		enum image_format fmt,
+		int log_level,
+		bool tta_mode = false
+	);
+
+	/*
+	 * image which is read and written by blocks of convertWithModelsStrided.
+	 * pixels are interleaved float rgb of packed buffer. so format conversion is done while packing and unpacking
+	 */
+	struct BlockSource
+	{
+		int width;
+		int height;
+
+		// [x, x+w) x [y, y+h) could be out of image by halo. edge pixels are repeated there
+		virtual void pack(float *packed, int x, int y, int w, int h) = 0;
+		virtual ~BlockSource() { }
+	};
+
+	struct BlockSink
+	{
+		// packed has packed_w floats x3 per row. it is written to [x, x+w) x [y, y+h) of image
+		virtual void unpack(const float *packed, int packed_w, int x, int y, int w, int h) = 0;
+		virtual ~BlockSink() { }
+	};
+
+/**
+ * convert source to sink of same size by rgb models.
+ * each block is packed from source into input buffer of first layer and last layer is unpacked into sink.
+ * so there's no padded copy nor float image of whole size
+ */
+	bool convertWithModelsStrided
+	(
+		W2XConv *conv,
+		ComputeEnv *env,
+		BlockSource &source,
+		BlockSink &sink,
+		std::vector<std::unique_ptr<Model> > &models,
+		W2XConvFlopsCounter *flops,
+		int blockSize,
 		int log_level
 	);
 }
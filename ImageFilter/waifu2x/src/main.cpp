@@ -30,6 +30,12 @@
 #include <cmath>
 #include <deque>
 #include <map>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <stdio.h>
 #include <stdlib.h>
 #include <algorithm>
@@ -575,6 +581,314 @@ void convert_file(ConvInfo info, fs::path inputName, _tstring outputName)
 	check_for_errors(info.converter, error);
 }
 
+// pipelined batch mode: decode pool -> convert (one thread, converter is not reentrant) -> encode pool
+template <typename T>
+class BoundedQueue
+{
+	public:
+		explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+		// false if queue is closed
+		bool push(T value)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			not_full.wait(lock, [this] { return closed || queue.size() < capacity; });
+
+			if (closed)
+			{
+				return false;
+			}
+
+			queue.push_back(std::move(value));
+			not_empty.notify_one();
+			return true;
+		}
+
+		// false if queue is closed and empty
+		bool pop(T &value)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			not_empty.wait(lock, [this] { return closed || !queue.empty(); });
+
+			if (queue.empty())
+			{
+				return false;
+			}
+
+			value = std::move(queue.front());
+			queue.pop_front();
+			not_full.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			not_full.notify_all();
+			not_empty.notify_all();
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable not_full;
+		std::condition_variable not_empty;
+		std::deque<T> queue;
+		size_t capacity;
+		bool closed = false;
+};
+
+struct PipelineJob
+{
+	int index;
+	fs::path input;
+	_tstring outputName;
+	W2XConvFile *file = nullptr;
+	// time when it was put into queue of next stage
+	double queued_sec = 0;
+
+	~PipelineJob()
+	{
+		w2xconv_free_file(file);
+	}
+};
+
+struct PipelineStageStats
+{
+	const char *name;
+	int threads;
+	int count = 0;
+	int errors = 0;
+	double busy_sec = 0;
+	double max_sec = 0;
+	double wait_sec = 0;
+	double first_sec = 0;
+	double last_sec = 0;
+	std::mutex mutex;
+
+	PipelineStageStats(const char *name, int threads) : name(name), threads(threads) {}
+
+	void add(double queued_sec, double start_sec, double end_sec, bool failed)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (count + errors == 0)
+		{
+			first_sec = start_sec;
+		}
+
+		if (failed)
+		{
+			errors++;
+		}
+		else
+		{
+			count++;
+		}
+
+		busy_sec += end_sec - start_sec;
+		max_sec = std::max(max_sec, end_sec - start_sec);
+		wait_sec += start_sec - queued_sec;
+		last_sec = std::max(last_sec, end_sec);
+	}
+
+	void print()
+	{
+		int total = std::max(count + errors, 1);
+		double wall = last_sec - first_sec;
+
+		printf("  %-8s %2d thread(s): %d files, %d errored, %.2f files/s, latency avg: %.3fs max: %.3fs, queue wait avg: %.3fs, busy: %.0f%%\n",
+			name,
+			threads,
+			count,
+			errors,
+			(wall > 0 ? count / wall : 0.0),
+			busy_sec / total,
+			max_sec,
+			wait_sec / total,
+			(wall > 0 ? busy_sec / (wall * threads) * 100 : 0.0)
+		);
+	}
+};
+
+std::string get_display_path(const fs::path &input, const fs::path &fn, const _tstring &origPath)
+{
+	std::string file_path = fs::absolute(fn).string();
+
+	if (fs::is_directory(input))
+	{
+		std::string orig_path = fs::absolute(input).string();
+
+		if (file_path.find(orig_path) != _tstring::npos)
+		{
+			file_path = file_path.substr(origPath.length()+1);
+		}
+	}
+
+	return file_path;
+}
+
+// decode and encode of other files run while one is converted. returns errored file count
+int convert_files_pipelined(ConvInfo info, const fs::path &input, std::vector<std::unique_ptr<PipelineJob>> jobs, int files_count, int depth, int log_level)
+{
+	int _nrLevel = -1;
+	if (info.convMode & CONV_NOISE)
+	{
+		_nrLevel = info.NRLevel;
+	}
+
+	double _scaleRatio = 1;
+	if (info.convMode & CONV_SCALE)
+	{
+		_scaleRatio = info.scaleRatio;
+	}
+
+	// decoded and converted files are bounded by depth. so memory is bounded as well
+	int io_threads = std::max(1, std::min(depth, static_cast<int>(std::thread::hardware_concurrency())));
+	BoundedQueue<std::unique_ptr<PipelineJob>> convert_queue(depth);
+	BoundedQueue<std::unique_ptr<PipelineJob>> encode_queue(depth);
+	PipelineStageStats decode_stats("decode", io_threads);
+	PipelineStageStats convert_stats("convert", 1);
+	PipelineStageStats encode_stats("encode", io_threads);
+	std::mutex print_mutex;
+	std::atomic<size_t> next_job(0);
+	std::atomic<int> running_decoders(io_threads);
+
+	auto report_error = [&](const PipelineJob &job, W2XConvError *error)
+	{
+		char *err = w2xconv_strerror(error);
+		{
+			std::lock_guard<std::mutex> lock(print_mutex);
+			printf("Failed file [%d/%d] \"%s\": %s\n", job.index, files_count, fs::absolute(job.input).string().c_str(), err);
+		}
+		w2xconv_free(err);
+		w2xconv_clear_error(error);
+	};
+
+	double time_start = getsec();
+
+	auto decode = [&]()
+	{
+		W2XConvError error;
+		error.code = W2XCONV_NOERROR;
+
+		for (size_t i = next_job++; i < jobs.size(); i = next_job++)
+		{
+			std::unique_ptr<PipelineJob> job = std::move(jobs[i]);
+			double start = getsec();
+			int r = w2xconv_read_file(info.converter, &error, &job->file, job->outputName.c_str(), fs::absolute(job->input).TSTRING_METHOD().c_str(), _scaleRatio, info.imwrite_params);
+			double end = getsec();
+
+			decode_stats.add(time_start, start, end, r < 0);
+
+			if (r < 0)
+			{
+				report_error(*job, &error);
+				continue;
+			}
+
+			job->queued_sec = end;
+
+			if (!convert_queue.push(std::move(job)))
+			{
+				break;
+			}
+		}
+
+		if (--running_decoders == 0)
+		{
+			convert_queue.close();
+		}
+	};
+
+	auto encode = [&]()
+	{
+		W2XConvError error;
+		error.code = W2XCONV_NOERROR;
+		std::unique_ptr<PipelineJob> job;
+
+		while (encode_queue.pop(job))
+		{
+			double start = getsec();
+			int r = w2xconv_write_file(info.converter, &error, job->file);
+			double end = getsec();
+
+			encode_stats.add(job->queued_sec, start, end, r < 0);
+
+			if (r < 0)
+			{
+				report_error(*job, &error);
+			}
+
+			job.reset();
+		}
+	};
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < io_threads; i++)
+	{
+		threads.emplace_back(decode);
+		threads.emplace_back(encode);
+	}
+
+	std::unique_ptr<PipelineJob> job;
+
+	while (convert_queue.pop(job))
+	{
+		double start = getsec();
+		bool failed = false;
+
+		if (log_level >= 1)
+		{
+			std::lock_guard<std::mutex> lock(print_mutex);
+			printf("Processing file [%d/%d] \"%s\"\n", job->index, files_count, get_display_path(input, job->input, info.origPath).c_str());
+		}
+
+		try
+		{
+			check_for_errors(info.converter, w2xconv_convert_read_file(info.converter, job->file, _nrLevel, _scaleRatio, info.blockSize));
+		}
+		catch (const std::exception& e)
+		{
+			failed = true;
+			std::lock_guard<std::mutex> lock(print_mutex);
+			std::cout << e.what() << std::endl;
+		}
+
+		double end = getsec();
+		convert_stats.add(job->queued_sec, start, end, failed);
+
+		if (failed)
+		{
+			job.reset();
+			continue;
+		}
+
+		job->queued_sec = end;
+		encode_queue.push(std::move(job));
+	}
+
+	encode_queue.close();
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	info.converter->flops.process_sec += getsec() - time_start;
+
+	if (log_level >= 1)
+	{
+		printf("Pipeline stats (depth %d):\n", depth);
+		decode_stats.print();
+		convert_stats.print();
+		encode_stats.print();
+	}
+
+	return decode_stats.errors + convert_stats.errors + encode_stats.errors;
+}
+
 
 
 #if defined(_WIN32) && defined(_UNICODE)
@@ -823,6 +1137,12 @@ int main(int argc, char** argv)
 	TCLAP::ValueArg<int> cmdBlockSize("", "block-size", "block size",
 		false, 0, "integer", cmd
 	);
+	TCLAP::SwitchArg cmdTuneBlockSize("", "tune-block-size", "benchmark block sizes for the processor again and save the best one to block_size.txt of model directory.\nsaved one is used when block size is 0",
+		cmd, false
+	);
+	TCLAP::ValueArg<int> cmdPipelineDepth("", "pipeline-depth", "Decode and encode files on other threads while converting in directory mode.\nIt is count of files waiting for each stage. 0 converts files one by one",
+		false, 0, "integer", cmd
+	);
 	TCLAP::ValueArg<int> cmdImgQuality("q", "image-quality", "JPEG & WebP Compression quality (0-101, 0 being smallest size and lowest quality), use 101 for lossless WebP",
 		false, -1, "0-101", cmd
 	);
@@ -868,6 +1188,11 @@ int main(int argc, char** argv)
 		std::cout << "Error: PNG Compression level range is 0-9, 9 being the slowest and resulting in the smallest file size." << std::endl;
 		std::exit(-1);
 	}
+	if (cmdPipelineDepth.getValue() < 0)
+	{
+		std::cout << "Error: Pipeline depth should not be negative" << std::endl;
+		std::exit(-1);
+	}
 	if (cmdImgQuality.getValue() < -1 || cmdImgQuality.getValue() > 101)
 	{
 		std::cout << "Error: JPEG & WebP Compression quality range is 0-101! (0 being smallest size and lowest quality), use 101 for lossless WebP" << std::endl;
@@ -1011,6 +1336,11 @@ int main(int argc, char** argv)
 	int error = w2xconv_load_model(cmdNRLevel.getValue(), converter, modelDir.c_str());
 	check_for_errors(converter, error);
 
+	if (cmdBlockSize.getValue() == 0 || cmdTuneBlockSize.getValue())
+	{
+		w2xconv_tune_block_size(converter, modelDir.c_str(), cmdTuneBlockSize.getValue());
+	}
+
 	//This includes errored files.
 	int numFilesProcessed = 0;
 	int numErrors = 0;
@@ -1082,103 +1412,125 @@ int main(int argc, char** argv)
 	//Proceed by list
 	double timeAvg = 0.0;
 	int files_count = static_cast<int>(files_list.size());
-	for (auto &fn : files_list)
+
+	if (cmdPipelineDepth.getValue() > 0 && files_list.size() > 1)
 	{
-		++numFilesProcessed;
-		_tstring outputName = generate_output_location(convInfo.origPath, fs::absolute(fn).TSTRING_METHOD(), output.TSTRING_METHOD(), convInfo.postfix, convInfo.outputFormat, convInfo.outputOption);
-		if(cmdResume.getValue() && fs::exists(outputName)){
-			if (log_level >= 1) {
-				_tprintf(_T("Skipped %s, existing output with --resume flag\n"), fn.TSTRING_METHOD().c_str());
-			}
-			numIgnored++;
-			continue;
-		}
-		double time_file_start = getsec();
-			
-		if (log_level >= 1)
+		std::vector<std::unique_ptr<PipelineJob>> jobs;
+
+		for (auto &fn : files_list)
 		{
-			std::string file_path = fs::absolute(fn).string();
-			if(fs::is_directory(input)){
-				std::string orig_path = fs::absolute(input).string();
-				if (file_path.find(orig_path) != _tstring::npos)
-				{
-					file_path = file_path.substr(origPath.length()+1);
+			++numFilesProcessed;
+			_tstring outputName = generate_output_location(convInfo.origPath, fs::absolute(fn).TSTRING_METHOD(), output.TSTRING_METHOD(), convInfo.postfix, convInfo.outputFormat, convInfo.outputOption);
+			if(cmdResume.getValue() && fs::exists(outputName)){
+				if (log_level >= 1) {
+					_tprintf(_T("Skipped %s, existing output with --resume flag\n"), fn.TSTRING_METHOD().c_str());
 				}
+				numIgnored++;
+				continue;
 			}
-			
-			printf("Processing file [%d/%d] \"%s\":%s",
-				numFilesProcessed,
-				files_count,
-				file_path.c_str(),
-				(log_level >= 2 ? "\n" : " ")
-			);
-		}
 
-		try
-		{
-			convert_file(convInfo, fn, outputName);
-		}
-		catch (const std::exception& e)
-		{
-			numErrors++;
-			std::cout << e.what() << std::endl;
+			std::unique_ptr<PipelineJob> job(new PipelineJob);
+			job->index = numFilesProcessed;
+			job->input = fn;
+			job->outputName = outputName;
+			jobs.push_back(std::move(job));
 		}
 
-		if (log_level >= 1)
+		numErrors += convert_files_pipelined(convInfo, input, std::move(jobs), files_count, cmdPipelineDepth.getValue(), log_level);
+	}
+	else
+	{
+		for (auto &fn : files_list)
 		{
-			//Calculate and out elapsed time
-			double time_end = getsec();
-			double time_file = time_end - time_file_start;
-			double time_all = time_end - time_start;
-			if (timeAvg > 0.0)
-			{
-				timeAvg = time_all / (numFilesProcessed - numIgnored);
-			}
-			else
-			{
-				timeAvg = time_all;
-			}
-		
-			double elapsed = time_all;
-			int el_D = (int) elapsed / (24 *60 * 60);
-			int el_h = (int) (elapsed - el_D * 24 * 60 * 60) / (60 * 60);
-			int el_m = (int) (elapsed - el_D * 24 * 60 * 60 - el_h * 60 * 60) / 60;
-			double el_s = (double) (elapsed - el_D * 24 * 60 * 60 - el_h * 60 * 60 - el_m * 60);
-
-			double eta = (files_count - numFilesProcessed) * timeAvg;
-			int eta_D = (int) eta / (24 * 60 * 60);
-			int eta_h = (int) (eta - eta_D * 24 * 60 * 60) / (60 * 60);
-			int eta_m = (int) (eta - eta_D * 24 * 60 * 60 - eta_h * 60 * 60) / 60;
-			double eta_s = (double) (eta - eta_D * 24 * 60 * 60 - eta_h * 60 * 60 - eta_m * 60);
-
-			printf("Done, took: ");
-			if (el_D)
-			{
-				printf("%dD ", el_D);
-			}
-			if (el_h)
-			{
-				printf("%dh ", el_h);
+			++numFilesProcessed;
+			_tstring outputName = generate_output_location(convInfo.origPath, fs::absolute(fn).TSTRING_METHOD(), output.TSTRING_METHOD(), convInfo.postfix, convInfo.outputFormat, convInfo.outputOption);
+			if(cmdResume.getValue() && fs::exists(outputName)){
+				if (log_level >= 1) {
+					_tprintf(_T("Skipped %s, existing output with --resume flag\n"), fn.TSTRING_METHOD().c_str());
+				}
+				numIgnored++;
+				continue;
 			}
-			if (el_m)
+			double time_file_start = getsec();
+			
+			if (log_level >= 1)
 			{
-				printf("%dm ", el_m);
+				std::string file_path = get_display_path(input, fn, origPath);
+			
+				printf("Processing file [%d/%d] \"%s\":%s",
+					numFilesProcessed,
+					files_count,
+					file_path.c_str(),
+					(log_level >= 2 ? "\n" : " ")
+				);
 			}
-			printf("%.3lfs total, ", el_s);
-			printf("ETA: ");
-			if (eta_D)
+
+			try
 			{
-				printf("%dD ", eta_D);
+				convert_file(convInfo, fn, outputName);
 			}
-			if (eta_h)
+			catch (const std::exception& e)
 			{
-				printf("%dh ", eta_h);
+				numErrors++;
+				std::cout << e.what() << std::endl;
 			}
-			if (eta_m)
+
+			if (log_level >= 1)
 			{
-				printf("%dm ", eta_m);
+				//Calculate and out elapsed time
+				double time_end = getsec();
+				double time_file = time_end - time_file_start;
+				double time_all = time_end - time_start;
+				if (timeAvg > 0.0)
+				{
+					timeAvg = time_all / (numFilesProcessed - numIgnored);
+				}
+				else
+				{
+					timeAvg = time_all;
+				}
+		
+				double elapsed = time_all;
+				int el_D = (int) elapsed / (24 *60 * 60);
+				int el_h = (int) (elapsed - el_D * 24 * 60 * 60) / (60 * 60);
+				int el_m = (int) (elapsed - el_D * 24 * 60 * 60 - el_h * 60 * 60) / 60;
+				double el_s = (double) (elapsed - el_D * 24 * 60 * 60 - el_h * 60 * 60 - el_m * 60);
+
+				double eta = (files_count - numFilesProcessed) * timeAvg;
+				int eta_D = (int) eta / (24 * 60 * 60);
+				int eta_h = (int) (eta - eta_D * 24 * 60 * 60) / (60 * 60);
+				int eta_m = (int) (eta - eta_D * 24 * 60 * 60 - eta_h * 60 * 60) / 60;
+				double eta_s = (double) (eta - eta_D * 24 * 60 * 60 - eta_h * 60 * 60 - eta_m * 60);
+
+				printf("Done, took: ");
+				if (el_D)
+				{
+					printf("%dD ", el_D);
+				}
+				if (el_h)
+				{
+					printf("%dh ", el_h);
+				}
+				if (el_m)
+				{
+					printf("%dm ", el_m);
+				}
+				printf("%.3lfs total, ", el_s);
+				printf("ETA: ");
+				if (eta_D)
+				{
+					printf("%dD ", eta_D);
+				}
+				if (eta_h)
+				{
+					printf("%dh ", eta_h);
+				}
+				if (eta_m)
+				{
+					printf("%dm ", eta_m);
+				}
+				printf("%.3lfs, file: %.3fs avg: %.3fs\n", eta_s, time_file, timeAvg);
 			}
-			printf("%.3lfs, file: %.3fs avg: %.3fs\n", eta_s, time_file, timeAvg);
 		}
 	}
 
@@ -46,6 +46,32 @@ namespace w2xc
 		return nOutputPlanes;
 	}
 
+	void Model::filterConstant(const float *input, float *output)
+	{
+		for (int oi = 0; oi < nOutputPlanes; oi++)
+		{
+			double v = biases[oi];
+
+			for (int ii = 0; ii < nInputPlanes; ii++)
+			{
+				W2Mat &w = weights[oi * nInputPlanes + ii];
+				double sum = 0;
+
+				for (int yi = 0; yi < kernelSize; yi++)
+				{
+					for (int xi = 0; xi < kernelSize; xi++)
+					{
+						sum += w.at<float>(yi, xi);
+					}
+				}
+
+				v += sum * input[ii];
+			}
+
+			output[oi] = (float) (v < 0 ? v * 0.1 : v);
+		}
+	}
+
 	bool Model::filter_CV
 	(
 		ComputeEnv *env,
@@ -1272,22 +1298,26 @@ namespace w2xc
 		int layer_depth,
 		int num_input_plane,
 		const int *num_map, // num_map[layer_depth]
-		const float *coef_list, // coef_list[layer_depth][num_map][3x3]
+		const float *coef_list, // coef_list[layer_depth][num_map][num_input][3x3]
 		const float *bias, // bias[layer_depth][num_map]
 		std::vector<std::unique_ptr<Model> > &models
 	)
 	{
 		int cur = 0;
+		size_t cur_coef = 0;
 		models.resize(layer_depth);
 
 		models[0] = std::unique_ptr<Model>(new Model(num_input_plane, num_map[0], &coef_list[0], &bias[0]));
 
 		cur += num_map[0];
+		cur_coef += (size_t) num_input_plane * num_map[0] * 3 * 3;
 
+		// each layer has num_map[li] x num_map[li - 1] kernels
 		for (int li = 1; li < layer_depth; li++)
 		{
-			models[li] = std::unique_ptr<Model>(new Model(num_map[li - 1], num_map[li], &coef_list[cur * 3 * 3], &bias[cur]));
+			models[li] = std::unique_ptr<Model>(new Model(num_map[li - 1], num_map[li], &coef_list[cur_coef], &bias[cur]));
 			cur += num_map[li];
+			cur_coef += (size_t) num_map[li - 1] * num_map[li] * 3 * 3;
 		}
 	}
 
@@ -130,6 +130,9 @@ namespace w2xc
 			{
 				return biases;
 			}
+
+			// output of a pixel when every input pixel around it is input[nInputPlanes]
+			void filterConstant(const float *input, float *output);
 			// setter function
 
 			// public operation function
@@ -160,7 +163,7 @@ namespace w2xc
 				int layer_depth,
 				int num_input_plane,
 				const int *num_map, // num_map[layer_depth]
-				const float *coef_list, // coef_list[layer_depth][num_map][3x3]
+				const float *coef_list, // coef_list[layer_depth][num_map][num_input][3x3]
 				const float *bias, // bias[layer_depth][num_map]
 				std::vector<std::unique_ptr<Model> > &models
 			);
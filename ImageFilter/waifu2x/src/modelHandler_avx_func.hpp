@@ -595,22 +595,12 @@ namespace
 
 		unsigned int total_block = num_block_hor * num_block_ver;
 
-		std::atomic<unsigned int> block_counter(0U);
-
-		auto func = [&]()
+		auto filter_blocks = [&](unsigned int block_begin, unsigned int block_end)
 		{
 			float *intermediate = (float*)w2xc_aligned_malloc(sizeof(float)*nOutputPlanes*2, 64);
 
-			while (true)
+			for (unsigned int bi=block_begin; bi<block_end; bi++)
 			{
-				unsigned int bi = block_counter++;
-
-				if (bi >= total_block)
-				{
-					w2xc_aligned_free(intermediate);
-					return;
-				}
-
 				unsigned int block_x = bi % num_block_hor;
 				unsigned int block_y = bi / num_block_hor;
 
@@ -745,9 +735,28 @@ namespace
 					}
 				}
 			}
+
+			w2xc_aligned_free(intermediate);
 		};
 
 #if !defined(_WIN32) && !defined(__linux)
+		std::atomic<unsigned int> block_counter(0U);
+
+		auto func = [&]()
+		{
+			while (true)
+			{
+				unsigned int bi = block_counter++;
+
+				if (bi >= total_block)
+				{
+					return;
+				}
+
+				filter_blocks(bi, bi + 1);
+			}
+		};
+
 		std::vector<std::thread> workerThreads;
 		for (int ji=0; ji<nJob; ji++)
 		{
@@ -758,7 +767,7 @@ namespace
 			th.join();
 		}
 #else
-		startFunc(env->tpool, func);
+		startRange(env->tpool, total_block, 1, filter_blocks);
 #endif
 	}
 }
@@ -245,19 +245,10 @@ namespace
 		unsigned int num_block_ver = CEIL_DIV(hsz, block_size_ver);
 		unsigned int total_block = num_block_hor * num_block_ver;
 
-		std::atomic<unsigned int> block_counter(0U);
-
-		auto func = [&]()
+		auto filter_blocks = [&](unsigned int block_begin, unsigned int block_end)
 		{
-			while (true)
+			for (unsigned int bi=block_begin; bi<block_end; bi++)
 			{
-				unsigned int bi = block_counter++;
-
-				if (bi >= total_block)
-				{
-					return;
-				}
-
 				unsigned int block_x = bi % num_block_hor;
 				unsigned int block_y = bi / num_block_hor;
 
@@ -290,6 +281,23 @@ namespace
 			}
 		};
 #if !defined(_WIN32) && !defined(__linux)
+		std::atomic<unsigned int> block_counter(0U);
+
+		auto func = [&]()
+		{
+			while (true)
+			{
+				unsigned int bi = block_counter++;
+
+				if (bi >= total_block)
+				{
+					return;
+				}
+
+				filter_blocks(bi, bi + 1);
+			}
+		};
+
 		std::vector<std::thread> workerThreads;
 		for (int ji=0; ji<nJob; ji++) {
 			workerThreads.emplace_back(std::thread(func));
@@ -298,7 +306,7 @@ namespace
 			th.join();
 		}
 #else
-		w2xc::startFunc(env->tpool, func);
+		w2xc::startRange(env->tpool, total_block, 1, filter_blocks);
 #endif
 	}
 }
@@ -0,0 +1,110 @@
+/*
+* The MIT License (MIT)
+* This file is part of waifu2x-converter-cpp
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string.h>
+#include <functional>
+#include <thread>
+#include "profiler.hpp"
+
+namespace w2xc
+{
+	Profiler::Profiler()
+		: trace(false),
+		origin(getsec())
+	{
+		memset(stats, 0, sizeof(stats));
+	}
+
+	void Profiler::add(enum W2XConvStage stage, int index, double begin, double end, double bytes, double flop)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		W2XConvStageStats &s = stats[stage];
+		s.count++;
+		s.sec += end - begin;
+		s.bytes += bytes;
+		s.flop += flop;
+
+		if (trace && events.size() < max_event)
+		{
+			unsigned int tid = (unsigned int) std::hash<std::thread::id>()(std::this_thread::get_id());
+			TraceEvent ev = { stage, index, tid, begin, end, bytes, flop };
+			events.push_back(ev);
+		}
+	}
+
+	void Profiler::get_stats(W2XConvStageStats *stats)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		memcpy(stats, this->stats, sizeof(this->stats));
+	}
+
+	void Profiler::reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		memset(stats, 0, sizeof(stats));
+		events.clear();
+		origin = getsec();
+	}
+
+	void Profiler::set_trace(bool enable)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		trace = enable;
+	}
+
+	// chrome://tracing and perfetto read it. ts and dur are microseconds
+	bool Profiler::write_trace(FILE *fp)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		fputs("{\"traceEvents\":[\n", fp);
+
+		for (size_t i=0; i<events.size(); i++)
+		{
+			TraceEvent &ev = events[i];
+
+			fprintf
+			(
+				fp,
+				"{\"name\":\"%s\",\"cat\":\"w2xc\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+				"\"args\":{\"index\":%d,\"bytes\":%.0f,\"flop\":%.0f}}%s\n",
+				w2xconv_stage_name(ev.stage),
+				ev.tid,
+				(ev.begin - origin) * 1000000.0,
+				(ev.end - ev.begin) * 1000000.0,
+				ev.index,
+				ev.bytes,
+				ev.flop,
+				(i + 1 < events.size()) ? "," : ""
+			);
+		}
+
+		fputs("],\"displayTimeUnit\":\"ms\"}\n", fp);
+
+		return !ferror(fp);
+	}
+}
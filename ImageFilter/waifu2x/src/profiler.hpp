@@ -0,0 +1,106 @@
+/*
+* The MIT License (MIT)
+* This file is part of waifu2x-converter-cpp
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef W2XC_PROFILER_HPP
+#define W2XC_PROFILER_HPP
+
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+#include "w2xconv.h"
+#include "sec.hpp"
+
+namespace w2xc
+{
+	struct TraceEvent
+	{
+		enum W2XConvStage stage;
+		int index;
+		unsigned int tid;
+		double begin;
+		double end;
+		double bytes;
+		double flop;
+	};
+
+	/*
+	 * stats of every stage are always counted. spans are kept for chrome trace only when trace is set.
+	 * it is shared by the converter and callers which query stats. so it is locked
+	 */
+	struct Profiler
+	{
+		static const size_t max_event = 1 << 20;
+
+		std::mutex mutex;
+		W2XConvStageStats stats[W2XCONV_STAGE_COUNT];
+		bool trace;
+		double origin;
+		std::vector<TraceEvent> events;
+
+		Profiler();
+
+		void add(enum W2XConvStage stage, int index, double begin, double end, double bytes, double flop);
+		void get_stats(W2XConvStageStats *stats);
+		void reset();
+		void set_trace(bool enable);
+		bool write_trace(FILE *fp);
+	};
+
+	// records time from construction to destruction. profiler could be null
+	class ProfileSpan
+	{
+		Profiler *profiler;
+		enum W2XConvStage stage;
+		int index;
+		double begin;
+
+	public:
+		double bytes;
+		double flop;
+
+		ProfileSpan(Profiler *profiler, enum W2XConvStage stage, int index = -1, double bytes = 0, double flop = 0)
+			: profiler(profiler), stage(stage), index(index), begin(profiler ? getsec() : 0), bytes(bytes), flop(flop)
+		{
+		}
+
+		~ProfileSpan()
+		{
+			finish();
+		}
+
+		// ends span before destruction
+		void finish()
+		{
+			if (profiler)
+			{
+				profiler->add(stage, index, begin, getsec(), bytes, flop);
+				profiler = nullptr;
+			}
+		}
+
+		ProfileSpan(const ProfileSpan&) = delete;
+		ProfileSpan& operator=(const ProfileSpan&) = delete;
+	};
+}
+
+#endif
@@ -26,7 +26,9 @@
 #endif
 #include <thread>
 #include <atomic>
+#include <algorithm>
 #include "threadPool.hpp"
+#include "sec.hpp"
 
 #if defined(_WIN32) || defined(__linux)
 
@@ -38,6 +40,7 @@ namespace w2xc
 #include <cpuid.h>
 #define rmb() __asm__ __volatile__ ("":::"memory")
 #define wmb() __asm__ __volatile__ ("":::"memory")
+#define cpu_relax() __builtin_ia32_pause()
 
 #elif defined _MSC_VER
 	#if _MSC_VER >= 1911
@@ -47,11 +50,13 @@ namespace w2xc
 		#define rmb() _ReadBarrier()
 		#define wmb() _WriteBarrier()
 	#endif
+	#define cpu_relax() YieldProcessor()
 
 #elif defined __GNUC__
 
 #define rmb() __sync_synchronize()
 #define wmb() __sync_synchronize()
+#define cpu_relax() std::this_thread::yield()
 
 #endif
 
@@ -124,57 +129,283 @@ namespace w2xc
 
 #endif
 
+	/*
+	 * spins until ready() for spin_usec and sleeps on ev after that.
+	 * the other side makes ready() true at first and signals ev only if it takes parked
+	 */
+	template <typename ReadyT> static void
+	spin_then_park(int spin_usec, std::atomic<bool> &parked, event_t ev, ReadyT const &ready)
+	{
+		if (spin_usec > 0)
+		{
+			double limit = getsec() + spin_usec / 1000000.0;
+
+			while (true)
+			{
+				for (int i=0; i<64; i++)
+				{
+					if (ready())
+					{
+						return;
+					}
+
+					cpu_relax();
+				}
+
+				if (getsec() > limit)
+				{
+					break;
+				}
+
+				// lets others run if cores are shared
+				std::this_thread::yield();
+			}
+		}
+
+		while (true)
+		{
+			parked = true;
+
+			if (ready())
+			{
+				if (!parked.exchange(false))
+				{
+					// signal is already sent
+					wait_event(ev);
+				}
+
+				return;
+			}
+
+			wait_event(ev);
+
+			// signal of former job could wake it before ready
+			if (ready())
+			{
+				return;
+			}
+		}
+	}
+
+	static void unpark(std::atomic<bool> &parked, event_t ev)
+	{
+		if (parked.exchange(false))
+		{
+			notify_event(ev);
+		}
+	}
+
+	static inline uint64_t pack_range(unsigned int begin, unsigned int end)
+	{
+		return (uint64_t) begin | ((uint64_t) end << 32);
+	}
+
+	static inline unsigned int range_begin(uint64_t range)
+	{
+		return (unsigned int) range;
+	}
+
+	static inline unsigned int range_end(uint64_t range)
+	{
+		return (unsigned int) (range >> 32);
+	}
+
+	// owner takes from front
+	static bool pop_range(WorkDeque *d, unsigned int grain, unsigned int *begin, unsigned int *end)
+	{
+		uint64_t range = d->range.load();
+
+		while (true)
+		{
+			unsigned int b = range_begin(range);
+			unsigned int e = range_end(range);
+
+			if (b >= e)
+			{
+				return false;
+			}
+
+			unsigned int chunk = (std::max)(grain, (e - b) / 4);
+			unsigned int next = (std::min)(e, b + chunk);
+
+			if (d->range.compare_exchange_weak(range, pack_range(next, e)))
+			{
+				*begin = b;
+				*end = next;
+				return true;
+			}
+		}
+	}
+
+	// thief takes back half of others and makes it as its own
+	static bool steal_range(ThreadPool *p, int self)
+	{
+		int num_deque = p->num_thread + 1;
+
+		for (int i=1; i<num_deque; i++)
+		{
+			WorkDeque *victim = &p->deques[(self + i) % num_deque];
+			uint64_t range = victim->range.load();
+
+			while (true)
+			{
+				unsigned int b = range_begin(range);
+				unsigned int e = range_end(range);
+
+				if (b >= e)
+				{
+					break;
+				}
+
+				unsigned int half = (e - b + 1) / 2;
+
+				if (victim->range.compare_exchange_weak(range, pack_range(b, e - half)))
+				{
+					p->deques[self].range = pack_range(e - half, e);
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	static void run_range(ThreadPool *p, int self)
+	{
+		RangeFuncBase &f = *p->range_func;
+		WorkDeque *d = &p->deques[self];
+		unsigned int begin, end;
+
+		do
+		{
+			while (pop_range(d, p->range_grain, &begin, &end))
+			{
+				f(begin, end);
+			}
+		} while (steal_range(p, self));
+	}
+
+	static void run_job(ThreadPool *p, int self)
+	{
+		if (p->range_func)
+		{
+			run_range(p, self);
+		}
+		else
+		{
+			(*p->func)();
+		}
+	}
+
 	void Thread::func()
 	{
+		unsigned int generation = 0;
+
 		while (true)
 		{
-			wait_event(to_client);
-			rmb();
+			if (this->p->fork_join)
+			{
+				wait_event(to_client);
+				rmb();
+			}
+			else
+			{
+				spin_then_park
+				(
+					p->spin_usec,
+					parked,
+					to_client,
+					[&]() { return p->generation.load() != generation; }
+				);
+
+				generation = p->generation;
+			}
 
 			if (this->p->fini_all)
 			{
 				return;
 			}
 
-			(*p->func)();
+			run_job(p, index);
 
 			int count = ++p->fini_count;
 			if (count == p->num_thread)
 			{
-				notify_event(p->to_master);
+				if (p->fork_join)
+				{
+					notify_event(p->to_master);
+				}
+				else
+				{
+					unpark(p->master_parked, p->to_master);
+				}
 			}
 		}
 	}
-	void Thread::start(ThreadPool *p)
+	void Thread::start(ThreadPool *p, int index)
 	{
 		this->p = p;
+		this->index = index;
 		wmb();
 		t = std::thread(&Thread::func, this);
 	}
 
-	struct ThreadPool * initThreadPool(int cpu)
+	struct ThreadPool * initThreadPool(int cpu, bool fork_join, int spin_usec)
 	{
+		// master works as one of them
+		int num_thread = fork_join ? cpu : (std::max)(cpu - 1, 0);
+
+		// spinning threads steal time of working ones if cores are fewer
+		if (cpu > (int) std::thread::hardware_concurrency())
+		{
+			spin_usec = 0;
+		}
+
 		ThreadPool *ret = new ThreadPool;
+		ret->fork_join = fork_join;
+		ret->spin_usec = spin_usec;
+		ret->num_thread = num_thread;
+		ret->generation = 0;
+		ret->fini_count = 0;
+		ret->fini_all = false;
+		ret->master_parked = false;
+		ret->func = nullptr;
+		ret->range_func = nullptr;
+		ret->range_total = 0;
+		ret->range_grain = 1;
+		ret->range_counter = 0;
 		ret->to_master = create_event();
-		ret->threads = new Thread[cpu];
+		ret->deques = new WorkDeque[num_thread + 1];
+		ret->threads = new Thread[num_thread];
 
-		for (int i=0; i<cpu; i++)
+		for (int i=0; i<=num_thread; i++)
 		{
-			ret->threads[i].start(ret);
+			ret->deques[i].range = 0;
+		}
+
+		for (int i=0; i<num_thread; i++)
+		{
+			ret->threads[i].start(ret, i + 1);
 		}
 
-		ret->num_thread = cpu;
-		ret->fini_all = false;
 		return ret;
 	}
 
 	void finiThreadPool(struct ThreadPool *p)
 	{
 		p->fini_all = true;
+		p->generation++;
 
 		for (int i=0; i<p->num_thread; i++)
 		{
-			notify_event(p->threads[i].to_client);
+			if (p->fork_join)
+			{
+				notify_event(p->threads[i].to_client);
+			}
+			else
+			{
+				unpark(p->threads[i].parked, p->threads[i].to_client);
+			}
 		}
 
 		for (int i=0; i<p->num_thread; i++)
@@ -183,23 +414,151 @@ namespace w2xc
 		}
 
 		delete [] p->threads;
+		delete [] p->deques;
 
 		delete_event(p->to_master);
+		delete p;
 	}
 
-	void startFuncBody(struct ThreadPool *p, ThreadFuncBase *f)
+	static void dispatch(struct ThreadPool *p)
 	{
 		p->fini_count = 0;
-		p->func = f;
+
+		if (p->fork_join)
+		{
+			for (int i=0; i<p->num_thread; i++)
+			{
+				notify_event(p->threads[i].to_client);
+			}
+
+			wait_event(p->to_master);
+			return;
+		}
+
+		p->generation++;
 
 		for (int i=0; i<p->num_thread; i++)
 		{
-			notify_event(p->threads[i].to_client);
+			unpark(p->threads[i].parked, p->threads[i].to_client);
 		}
 
-		wait_event(p->to_master);
+		run_job(p, 0);
+
+		spin_then_park
+		(
+			p->spin_usec,
+			p->master_parked,
+			p->to_master,
+			[p]() { return p->fini_count.load() == p->num_thread; }
+		);
+	}
 
-		return;
+	void startFuncBody(struct ThreadPool *p, ThreadFuncBase *f)
+	{
+		p->func = f;
+		p->range_func = nullptr;
+
+		dispatch(p);
+	}
+
+	void startRangeBody(struct ThreadPool *p, unsigned int total, unsigned int grain, RangeFuncBase *f)
+	{
+		grain = (std::max)(grain, 1U);
+
+		if (p->fork_join)
+		{
+			// former kernels took items by one shared counter
+			p->range_counter = 0;
+
+			startFunc
+			(
+				p,
+				[p, total, grain, f]()
+				{
+					while (true)
+					{
+						unsigned int begin = p->range_counter.fetch_add(grain);
+
+						if (begin >= total)
+						{
+							return;
+						}
+
+						(*f)(begin, (std::min)(begin + grain, total));
+					}
+				}
+			);
+			return;
+		}
+
+		int num_deque = p->num_thread + 1;
+
+		for (int i=0; i<num_deque; i++)
+		{
+			unsigned int begin = (unsigned int) ((uint64_t) total * i / num_deque);
+			unsigned int end = (unsigned int) ((uint64_t) total * (i + 1) / num_deque);
+			p->deques[i].range = pack_range(begin, end);
+		}
+
+		p->func = nullptr;
+		p->range_func = f;
+		p->range_total = total;
+		p->range_grain = grain;
+
+		dispatch(p);
+
+		p->range_func = nullptr;
+	}
+
+	void benchThreadPool(int cpu, int num_iteration)
+	{
+		static const char *pool_names[] = { "fork/join", "work stealing" };
+
+		for (int pi=0; pi<2; pi++)
+		{
+			ThreadPool *p = initThreadPool(cpu, pi == 0);
+
+			// first dispatch starts threads
+			startFunc(p, [](){});
+
+			double t0 = getsec();
+
+			for (int i=0; i<num_iteration; i++)
+			{
+				startFunc(p, [](){});
+			}
+
+			double t1 = getsec();
+			std::atomic<unsigned int> sum(0U);
+
+			for (int i=0; i<num_iteration; i++)
+			{
+				startRange
+				(
+					p,
+					256,
+					1,
+					[&sum](unsigned int begin, unsigned int end)
+					{
+						sum += end - begin;
+					}
+				);
+			}
+
+			double t2 = getsec();
+
+			printf
+			(
+				"%s(%d threads): startFunc %f[us], startRange(256) %f[us]%s\n",
+				pool_names[pi],
+				cpu,
+				(t1 - t0) * 1000000.0 / num_iteration,
+				(t2 - t1) * 1000000.0 / num_iteration,
+				sum == 256U * num_iteration ? "" : " (missing items)"
+			);
+
+			finiThreadPool(p);
+		}
 	}
 }
 
@@ -28,6 +28,7 @@
 
 #include <thread>
 #include <atomic>
+#include <stdint.h>
 
 #ifdef __linux
 
@@ -70,7 +71,28 @@ namespace w2xc
 		virtual ~ThreadFunc(){}
 	};
 
+	/* called with [begin, end) of items. it is called several times per thread */
+	struct RangeFuncBase
+	{
+		virtual void operator() (unsigned int begin, unsigned int end) = 0;
+		virtual ~RangeFuncBase() { }
+	};
+	template<typename FuncT>
+	struct RangeFunc : public RangeFuncBase
+	{
+		FuncT f;
+		RangeFunc(FuncT const &f) : f(f) {}
+
+		virtual void operator()(unsigned int begin, unsigned int end)
+		{
+			f(begin, end);
+		}
+
+		virtual ~RangeFunc(){}
+	};
+
 	extern void startFuncBody(ThreadPool *p, ThreadFuncBase *f);
+	extern void startRangeBody(ThreadPool *p, unsigned int total, unsigned int grain, RangeFuncBase *f);
 
 	template <typename FuncT> void
 	startFunc(ThreadPool *p, FuncT const &f)
@@ -80,16 +102,30 @@ namespace w2xc
 		delete fb;
 	}
 
+	/*
+	 * runs f over [0, total) and returns when every item is done.
+	 * items are split to the threads first and idle threads steal the half of others.
+	 * chunk size starts at quarter of the rest of the thread and shrinks to grain
+	 */
+	template <typename FuncT> void
+	startRange(ThreadPool *p, unsigned int total, unsigned int grain, FuncT const &f)
+	{
+		RangeFunc<FuncT> fb(f);
+		startRangeBody(p, total, grain, &fb);
+	}
+
 	struct Thread
 	{
 		ThreadPool *p;
+		int index;
 		event_t to_client;
+		std::atomic<bool> parked;
 		std::thread t;
 
 		void func();
-		Thread() : to_client(create_event()) {}
+		Thread() : to_client(create_event()), parked(false) {}
 
-		void start(ThreadPool *p);
+		void start(ThreadPool *p, int index);
 
 		~Thread()
 		{
@@ -101,19 +137,47 @@ namespace w2xc
 		Thread&	operator=(Thread&&) = delete;
 	};
 
+	/* [begin, end) of a thread. both are packed into one word to be taken by CAS */
+	struct WorkDeque
+	{
+		std::atomic<uint64_t> range;
+		char pad[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
 	struct ThreadPool
 	{
+		/*
+		 * fork_join is the former pool. every start wakes all threads by event and master sleeps until they finish.
+		 * otherwise master works as deque 0, threads spin for spin_usec before they sleep
+		 */
+		bool fork_join;
+		int spin_usec;
+
 		int num_thread;
+		std::atomic<unsigned int> generation;
 		std::atomic<int> fini_count;
 		std::atomic<bool> fini_all;
+		std::atomic<bool> master_parked;
 
 		Thread *threads;
+		WorkDeque *deques;
 		event_t to_master;
 		ThreadFuncBase *func;
+
+		RangeFuncBase *range_func;
+		unsigned int range_total;
+		unsigned int range_grain;
+		std::atomic<unsigned int> range_counter;
 	};
 
-	struct ThreadPool * initThreadPool(int cpu);
+	static const int default_spin_usec = 100;
+
+	/* cpu is number of threads including master */
+	struct ThreadPool * initThreadPool(int cpu, bool fork_join = false, int spin_usec = default_spin_usec);
 	void finiThreadPool(struct ThreadPool *p);
+
+	/* prints wall time of startFunc() with empty function and startRange() with tiny items, for both of pools */
+	void benchThreadPool(int cpu, int num_iteration);
 }
 
 #endif // __APPLE__
@@ -0,0 +1,703 @@
+/*
+* The MIT License (MIT)
+* This file is part of waifu2x-converter-cpp
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/*
+ * benchmark of the filter on every processor. it is built as a separate program with w2xc. see BUILDING.md
+ *
+ * networks have layer shapes of vgg_7 models and random weights. so it needs no model directory.
+ * host processor is run with every sub type it supports, and every output is compared with OpenCV(filter_CV) one.
+ * results are compared with baseline file. lines whose processor, jobs, network and size are same are compared
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include "tclap/CmdLine.h"
+#include "sec.hpp"
+#include "w2xconv.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+struct BenchNet
+{
+	const char *name;
+	int num_plane;
+};
+
+// vgg_7 of models and models_rgb
+static const BenchNet bench_nets[] =
+{
+	{ "vgg7_y", 1 },
+#ifdef HAVE_OPENCV
+	{ "vgg7_rgb", 3 },
+#endif
+};
+
+static const int vgg7_hidden_maps[] = { 32, 32, 64, 64, 128, 128 };
+
+struct BenchTarget
+{
+	int proc_index;
+	W2XConvProcessor proc;
+	std::string name;
+	bool is_reference;
+};
+
+struct BenchResult
+{
+	int type;
+	int sub_type;
+	int jobs;
+	std::string net;
+	int size;
+	double images_per_sec;
+	double gflops;
+	std::string dev_name;
+};
+
+static const char *sub_type_name(const W2XConvProcessor *p)
+{
+	switch (p->type)
+	{
+		case W2XCONV_PROC_HOST:
+		{
+			switch (p->sub_type)
+			{
+				case W2XCONV_PROC_HOST_SSE3:
+				{
+					return "SSE3";
+				}
+				case W2XCONV_PROC_HOST_AVX:
+				{
+					return "AVX";
+				}
+				case W2XCONV_PROC_HOST_FMA:
+				{
+					return "FMA";
+				}
+				case W2XCONV_PROC_HOST_NEON:
+				{
+					return "NEON";
+				}
+				case W2XCONV_PROC_HOST_ALTIVEC:
+				{
+					return "AltiVec";
+				}
+				default:
+				{
+					return "OpenCV";
+				}
+			}
+		}
+		case W2XCONV_PROC_CUDA:
+		{
+			return "CUDA";
+		}
+		case W2XCONV_PROC_OPENCL:
+		{
+			return "OpenCL";
+		}
+	}
+
+	return "??";
+}
+
+// resident size now. peak of OS is for whole process, so it can not tell one run from earlier bigger ones
+static double current_rss_mb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+	{
+		return pmc.WorkingSetSize / (1024.0 * 1024.0);
+	}
+
+	return 0;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS)
+	{
+		return info.resident_size / (1024.0 * 1024.0);
+	}
+
+	return 0;
+#else
+	long pages = 0;
+	long resident = 0;
+	FILE *fp = fopen("/proc/self/statm", "r");
+
+	if (fp == NULL)
+	{
+		return 0;
+	}
+
+	int n = fscanf(fp, "%ld %ld", &pages, &resident);
+	fclose(fp);
+
+	if (n != 2)
+	{
+		return 0;
+	}
+
+	return resident * (double) sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+}
+
+// samples resident size while it lives. buffers are freed after every run, so it must be sampled during the run
+class RssSampler
+{
+public:
+	RssSampler() : peak(current_rss_mb()), done(false), thread(&RssSampler::run, this)
+	{
+	}
+
+	~RssSampler()
+	{
+		stop();
+	}
+
+	double stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+
+		cond.notify_one();
+
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+
+		return (std::max)(peak, current_rss_mb());
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (!cond.wait_for(lock, std::chrono::milliseconds(5), [this] { return done; }))
+		{
+			peak = (std::max)(peak, current_rss_mb());
+		}
+	}
+
+	double peak;
+	bool done;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::thread thread;
+};
+
+// same weights on every platform and run
+static float bench_random(uint32_t *state)
+{
+	*state = *state * 1664525U + 1013904223U;
+	return (*state >> 8) / (float) (1U << 24) * 2.0f - 1.0f;
+}
+
+static void set_bench_model(W2XConv *conv, const BenchNet *net)
+{
+	std::vector<int> num_map(vgg7_hidden_maps, vgg7_hidden_maps + sizeof(vgg7_hidden_maps) / sizeof(vgg7_hidden_maps[0]));
+	num_map.push_back(net->num_plane);
+
+	std::vector<float> coef;
+	std::vector<float> bias;
+	uint32_t state = 1;
+	int num_input = net->num_plane;
+
+	for (size_t li=0; li<num_map.size(); li++)
+	{
+		// keeps outputs around input range through layers. last bias moves them to middle of pixel range
+		float scale = sqrtf(6.0f / (num_input * 9));
+		bool last = li + 1 == num_map.size();
+
+		for (int i=0; i<num_map[li] * num_input * 9; i++)
+		{
+			coef.push_back(bench_random(&state) * scale);
+		}
+
+		for (int i=0; i<num_map[li]; i++)
+		{
+			bias.push_back(last ? 0.5f : bench_random(&state) * 0.01f);
+		}
+
+		num_input = num_map[li];
+	}
+
+	w2xconv_set_model_3x3(conv, W2XCONV_FILTER_SCALE2x, (int) num_map.size(), net->num_plane, num_map.data(), coef.data(), bias.data());
+}
+
+static void make_bench_image(std::vector<float> &image, int size, int num_plane)
+{
+	image.resize((size_t) size * size * num_plane);
+
+	for (int yi=0; yi<size; yi++)
+	{
+		for (int xi=0; xi<size; xi++)
+		{
+			for (int pi=0; pi<num_plane; pi++)
+			{
+				// smooth gradients and a few edges
+				float v = 0.5f + 0.25f * sinf(xi * 0.05f + pi) * cosf(yi * 0.07f);
+				v += ((xi / 16 + yi / 16) & 1) ? 0.2f : 0.0f;
+				image[((size_t) yi * size + xi) * num_plane + pi] = v;
+			}
+		}
+	}
+}
+
+static int run_bench_net(W2XConv *conv, const BenchNet *net, std::vector<float> &dst, std::vector<float> &src, int size, int block_size)
+{
+	if (net->num_plane == 1)
+	{
+		return w2xconv_apply_filter_y
+		(
+			conv,
+			W2XCONV_FILTER_SCALE2x,
+			(unsigned char*) dst.data(),
+			size * sizeof(float),
+			(unsigned char*) src.data(),
+			size * sizeof(float),
+			size,
+			size,
+			block_size
+		);
+	}
+
+#ifdef HAVE_OPENCV
+	// filter runs over 2x image. source is half of size to filter size x size
+	int half = size / 2;
+
+	return w2xconv_convert_rgb_f32
+	(
+		conv,
+		(unsigned char*) dst.data(),
+		size * 3 * sizeof(float),
+		(unsigned char*) src.data(),
+		half * 3 * sizeof(float),
+		half,
+		half,
+		-1,
+		2.0,
+		block_size
+	);
+#else
+	return -1;
+#endif
+}
+
+static void print_error(W2XConv *conv)
+{
+	char *e = w2xconv_strerror(&conv->last_error);
+	fprintf(stderr, "%s\n", e);
+	w2xconv_free(e);
+}
+
+static bool read_baseline(const std::string &path, std::vector<BenchResult> &baseline)
+{
+	FILE *fp = fopen(path.c_str(), "r");
+
+	if (fp == nullptr)
+	{
+		return false;
+	}
+
+	// each line is "type sub_type jobs network size images/sec gflops device name"
+	char line[2048];
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		BenchResult r;
+		char net[64];
+		char dev_name[1024];
+
+		if (sscanf(line, "%d %d %d %63s %d %lf %lf %1023[^\n]", &r.type, &r.sub_type, &r.jobs, net, &r.size, &r.images_per_sec, &r.gflops, dev_name) != 8)
+		{
+			continue;
+		}
+
+		r.net = net;
+		r.dev_name = dev_name;
+		baseline.push_back(r);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+static bool write_baseline(const std::string &path, const std::vector<BenchResult> &results)
+{
+	FILE *fp = fopen(path.c_str(), "w");
+
+	if (fp == nullptr)
+	{
+		return false;
+	}
+
+	for (size_t i=0; i<results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		fprintf(fp, "%d %d %d %s %d %f %f %s\n", r.type, r.sub_type, r.jobs, r.net.c_str(), r.size, r.images_per_sec, r.gflops, r.dev_name.c_str());
+	}
+
+	return fclose(fp) == 0;
+}
+
+static const BenchResult *find_baseline(const std::vector<BenchResult> &baseline, const BenchResult &r)
+{
+	for (size_t i=0; i<baseline.size(); i++)
+	{
+		const BenchResult &b = baseline[i];
+
+		if (b.type == r.type && b.sub_type == r.sub_type && b.jobs == r.jobs && b.net == r.net && b.size == r.size && b.dev_name == r.dev_name)
+		{
+			return &b;
+		}
+	}
+
+	return nullptr;
+}
+
+static void list_targets(std::vector<BenchTarget> &targets)
+{
+	size_t num_proc;
+	const W2XConvProcessor *procs = w2xconv_get_processor_list(&num_proc);
+
+	for (size_t i=0; i<num_proc; i++)
+	{
+		const W2XConvProcessor *p = &procs[i];
+
+		if (p->type == W2XCONV_PROC_HOST)
+		{
+			std::vector<int> sub_types;
+			sub_types.push_back(W2XCONV_PROC_HOST_OPENCV);
+
+			if (p->sub_type >= W2XCONV_PROC_HOST_SSE3 && p->sub_type <= W2XCONV_PROC_HOST_FMA)
+			{
+				for (int st=W2XCONV_PROC_HOST_SSE3; st<=p->sub_type; st++)
+				{
+					sub_types.push_back(st);
+				}
+			}
+			else if (p->sub_type != W2XCONV_PROC_HOST_OPENCV)
+			{
+				sub_types.push_back(p->sub_type);
+			}
+
+			for (size_t si=0; si<sub_types.size(); si++)
+			{
+				BenchTarget t;
+				t.proc_index = (int) i;
+				t.proc = *p;
+				t.proc.sub_type = sub_types[si];
+				t.name = sub_type_name(&t.proc);
+				t.is_reference = sub_types[si] == W2XCONV_PROC_HOST_OPENCV;
+				targets.push_back(t);
+			}
+		}
+		else
+		{
+			BenchTarget t;
+			t.proc_index = (int) i;
+			t.proc = *p;
+			t.name = std::string(sub_type_name(p)) + ":" + p->dev_name;
+			t.is_reference = false;
+			targets.push_back(t);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	TCLAP::CmdLine cmd("waifu2x filter benchmark", ' ', "1.0");
+
+	TCLAP::ValueArg<int> cmdMinSize("", "min-size", "smallest image size. sizes are doubled up to max size",
+		false, 64, "integer", cmd);
+	TCLAP::ValueArg<int> cmdMaxSize("", "max-size", "largest image size",
+		false, 4096, "integer", cmd);
+	TCLAP::ValueArg<double> cmdMinTime("", "min-time", "seconds to repeat each size after warm up",
+		false, 1.0, "double", cmd);
+	TCLAP::ValueArg<int> cmdNumberOfJobs("j", "jobs", "number of threads. 0 is auto",
+		false, 0, "integer", cmd);
+	TCLAP::ValueArg<int> cmdBlockSize("", "block-size", "block size. 0 is default of processor",
+		false, 0, "integer", cmd);
+	TCLAP::ValueArg<int> cmdCheckSize("", "check-size", "image size which every processor is compared with OpenCV",
+		false, 128, "integer", cmd);
+	TCLAP::ValueArg<double> cmdMaxError("", "max-error", "largest difference to OpenCV output",
+		false, 1e-3, "double", cmd);
+	TCLAP::SwitchArg cmdSkipOpenCV("", "skip-opencv", "run OpenCV for the check only. it is slow for large images",
+		cmd, false);
+	TCLAP::ValueArg<std::string> cmdBaseline("", "baseline", "compare images/sec with this file",
+		false, "", "string", cmd);
+	TCLAP::ValueArg<double> cmdTolerance("", "tolerance", "percent of images/sec which could be lost against baseline",
+		false, 10.0, "double", cmd);
+	TCLAP::ValueArg<std::string> cmdWriteBaseline("", "write-baseline", "save results to this file",
+		false, "", "string", cmd);
+
+	try
+	{
+		cmd.parse(argc, argv);
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	int min_size = (std::max)(cmdMinSize.getValue(), 16);
+	int max_size = cmdMaxSize.getValue();
+	int check_size = cmdCheckSize.getValue();
+	int block_size = cmdBlockSize.getValue();
+	double min_time = cmdMinTime.getValue();
+	double max_error = cmdMaxError.getValue();
+
+	std::vector<BenchTarget> targets;
+	list_targets(targets);
+
+	std::vector<W2XConv*> convs(targets.size(), nullptr);
+
+	for (size_t ti=0; ti<targets.size(); ti++)
+	{
+		convs[ti] = w2xconv_init_with_processor(targets[ti].proc_index, cmdNumberOfJobs.getValue(), 0);
+	}
+
+	int ret = 0;
+	std::vector<BenchResult> results;
+	std::vector<BenchResult> baseline;
+
+	if (!cmdBaseline.getValue().empty() && !read_baseline(cmdBaseline.getValue(), baseline))
+	{
+		fprintf(stderr, "could not read %s\n", cmdBaseline.getValue().c_str());
+		ret = 1;
+	}
+
+	for (size_t ni=0; ni<sizeof(bench_nets)/sizeof(bench_nets[0]); ni++)
+	{
+		const BenchNet *net = &bench_nets[ni];
+
+		for (size_t ti=0; ti<targets.size(); ti++)
+		{
+			set_bench_model(convs[ti], net);
+		}
+
+		// every sub type against filter_CV
+		{
+			std::vector<float> src, ref, dst;
+			int src_size = net->num_plane == 1 ? check_size : check_size / 2;
+			make_bench_image(src, src_size, net->num_plane);
+			ref.resize((size_t) check_size * check_size * net->num_plane);
+			dst.resize(ref.size());
+
+			for (size_t ti=0; ti<targets.size(); ti++)
+			{
+				if (!targets[ti].is_reference)
+				{
+					continue;
+				}
+
+				const W2XConvProcessor *orig = convs[ti]->target_processor;
+				convs[ti]->target_processor = &targets[ti].proc;
+
+				if (run_bench_net(convs[ti], net, ref, src, check_size, block_size) < 0)
+				{
+					print_error(convs[ti]);
+					ret = 1;
+				}
+
+				convs[ti]->target_processor = orig;
+				break;
+			}
+
+			for (size_t ti=0; ti<targets.size(); ti++)
+			{
+				if (targets[ti].is_reference)
+				{
+					continue;
+				}
+
+				const W2XConvProcessor *orig = convs[ti]->target_processor;
+				convs[ti]->target_processor = &targets[ti].proc;
+				int r = run_bench_net(convs[ti], net, dst, src, check_size, block_size);
+				convs[ti]->target_processor = orig;
+
+				if (r < 0)
+				{
+					print_error(convs[ti]);
+					ret = 1;
+					continue;
+				}
+
+				double diff = 0;
+
+				for (size_t i=0; i<ref.size(); i++)
+				{
+					diff = (std::max)(diff, (double) fabsf(dst[i] - ref[i]));
+				}
+
+				bool ok = diff <= max_error;
+				printf("check %-8s %-30s max diff %g %s\n", net->name, targets[ti].name.c_str(), diff, ok ? "ok" : "FAILED");
+
+				if (!ok)
+				{
+					ret = 1;
+				}
+			}
+		}
+
+		printf("%-8s %-30s %6s %12s %10s %12s %s\n", "network", "processor", "size", "images/sec", "GFLOPS", "peak RSS", "baseline");
+
+		for (int size=min_size; size<=max_size; size*=2)
+		{
+			std::vector<float> src, dst;
+			int src_size = net->num_plane == 1 ? size : size / 2;
+			make_bench_image(src, src_size, net->num_plane);
+			dst.resize((size_t) size * size * net->num_plane);
+
+			for (size_t ti=0; ti<targets.size(); ti++)
+			{
+				if (targets[ti].is_reference && cmdSkipOpenCV.getValue())
+				{
+					continue;
+				}
+
+				W2XConv *conv = convs[ti];
+				const W2XConvProcessor *orig = conv->target_processor;
+				conv->target_processor = &targets[ti].proc;
+
+				// peak RSS is of this processor and size only
+				RssSampler rss;
+
+				// warm up. it allocates buffers and compiles kernels
+				int r = run_bench_net(conv, net, dst, src, size, block_size);
+
+				double flop0 = conv->flops.flop;
+				double filter_sec0 = conv->flops.filter_sec;
+				double t0 = getsec();
+				double t1 = t0;
+				int count = 0;
+
+				while (r >= 0 && (count == 0 || t1 - t0 < min_time))
+				{
+					r = run_bench_net(conv, net, dst, src, size, block_size);
+					count++;
+					t1 = getsec();
+				}
+
+				conv->target_processor = orig;
+				double peak_rss = rss.stop();
+
+				if (r < 0)
+				{
+					print_error(conv);
+					ret = 1;
+					continue;
+				}
+
+				double filter_sec = conv->flops.filter_sec - filter_sec0;
+
+				BenchResult br;
+				br.type = targets[ti].proc.type;
+				br.sub_type = targets[ti].proc.sub_type;
+				br.jobs = cmdNumberOfJobs.getValue();
+				br.net = net->name;
+				br.size = size;
+				br.images_per_sec = count / (t1 - t0);
+				br.gflops = filter_sec > 0 ? (conv->flops.flop - flop0) / filter_sec / 1e9 : 0;
+				br.dev_name = targets[ti].proc.dev_name;
+				results.push_back(br);
+
+				std::string compared = "-";
+
+				const BenchResult *b = find_baseline(baseline, br);
+
+				if (b)
+				{
+					double ratio = br.images_per_sec / b->images_per_sec;
+					bool regressed = ratio < 1.0 - cmdTolerance.getValue() / 100.0;
+					char buf[64];
+					sprintf(buf, "%+.1f%%%s", (ratio - 1.0) * 100.0, regressed ? " REGRESSED" : "");
+					compared = buf;
+
+					if (regressed)
+					{
+						ret = 1;
+					}
+				}
+
+				printf
+				(
+					"%-8s %-30s %6d %12.3f %10.2f %9.1f MB %s\n",
+					net->name,
+					targets[ti].name.c_str(),
+					size,
+					br.images_per_sec,
+					br.gflops,
+					peak_rss,
+					compared.c_str()
+				);
+				fflush(stdout);
+			}
+		}
+	}
+
+	for (size_t ti=0; ti<targets.size(); ti++)
+	{
+		w2xconv_fini(convs[ti]);
+	}
+
+	if (!cmdWriteBaseline.getValue().empty())
+	{
+		if (!write_baseline(cmdWriteBaseline.getValue(), results))
+		{
+			fprintf(stderr, "could not write %s\n", cmdWriteBaseline.getValue().c_str());
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -41,6 +41,7 @@
 #include "filters.hpp"
 #include "cvwrap.hpp"
 #include "tstring.hpp"
+#include "profiler.hpp"
 
 struct W2XConvImpl
 {
@@ -471,6 +472,8 @@ struct W2XConv * w2xconv_init_with_processor_and_tta(int processor_idx, int nJob
 
 	w2xc::modelUtility::getInstance().setNumberOfJobs(nJob);
 
+	impl->env.profiler = new w2xc::Profiler;
+
 	c->impl = impl;
 	c->log_level = log_level;
 	c->tta_mode = tta_mode;
@@ -483,9 +486,9 @@ struct W2XConv * w2xconv_init_with_processor_and_tta(int processor_idx, int nJob
 	return c;
 }
 
-void clearError(W2XConv *conv)
+static void clearError(W2XConvError *error)
 {
-	switch (conv->last_error.code)
+	switch (error->code)
 	{
 		case W2XCONV_NOERROR:
 		case W2XCONV_ERROR_Y_MODEL_MISMATCH_TO_RGB_F32:
@@ -497,19 +500,19 @@ void clearError(W2XConv *conv)
 		}
 		case W2XCONV_ERROR_WIN32_ERROR_PATH:
 		{
-			free(conv->last_error.u.win32_path.path);
+			free(error->u.win32_path.path);
 			break;
 		}
 		case W2XCONV_ERROR_LIBC_ERROR_PATH:
 		{
-			free(conv->last_error.u.libc_path.path);
+			free(error->u.libc_path.path);
 			break;
 		}
 		case W2XCONV_ERROR_MODEL_LOAD_FAILED:
 		case W2XCONV_ERROR_IMREAD_FAILED:
 		case W2XCONV_ERROR_IMWRITE_FAILED:
 		{
-			free(conv->last_error.u.path);
+			free(error->u.path);
 			break;
 		}
 		default:
@@ -517,6 +520,18 @@ void clearError(W2XConv *conv)
 			break;
 		}
 	}
+
+	error->code = W2XCONV_NOERROR;
+}
+
+void clearError(W2XConv *conv)
+{
+	clearError(&conv->last_error);
+}
+
+void w2xconv_clear_error(W2XConvError *error)
+{
+	clearError(error);
 }
 
 char * w2xconv_strerror(W2XConvError *e)
@@ -602,6 +617,11 @@ char * w2xconv_strerror(W2XConvError *e)
 			oss << "output size too big for lossy webp format. use -q 101 for lossless webp instead."; 
 			break;
 		}
+		case W2XCONV_ERROR_CANCELLED:
+		{
+			oss << "conversion is cancelled";
+			break;
+		}
 	}
 
 	return strdup(oss.str().c_str());
@@ -612,19 +632,38 @@ void w2xconv_free(void *p)
 	free(p);
 }
 
-static void setPathError(W2XConv *conv, enum W2XConvErrorCode code, _tstring const &path)
+static void setPathError(W2XConvError *error, enum W2XConvErrorCode code, _tstring const &path)
 {
 	std::string strpath = _tstr2str(path);
-	clearError(conv);
+	clearError(error);
+
+	error->code = code;
+	error->u.path = strdup(strpath.c_str());
+}
+
+static void setPathError(W2XConv *conv, enum W2XConvErrorCode code, _tstring const &path)
+{
+	setPathError(&conv->last_error, code, path);
+}
 
-	conv->last_error.code = code;
-	conv->last_error.u.path = strdup(strpath.c_str());
+static void setError(W2XConvError *error, enum W2XConvErrorCode code)
+{
+	clearError(error);
+	error->code = code;
 }
 
 static void setError(W2XConv *conv, enum W2XConvErrorCode code)
 {
-	clearError(conv);
-	conv->last_error.code = code;
+	setError(&conv->last_error, code);
+}
+
+// filters fail by cancel or by error of their own. only the former is reported as cancel
+static void setCancelError(W2XConv *conv)
+{
+	if (isCancelled(&conv->impl->env))
+	{
+		setError(conv, W2XCONV_ERROR_CANCELLED);
+	}
 }
 
 int w2xconv_load_model(const int denoise_level, W2XConv *conv, const TCHAR *model_dir)
@@ -719,6 +758,160 @@ int w2xconv_load_models(W2XConv *conv, const TCHAR *model_dir)
 	return 0;
 }
 
+static bool block_size_entry_matches(W2XConv *conv, int type, int sub_type, int nJob, const char *dev_name)
+{
+	const W2XConvProcessor *proc = conv->target_processor;
+
+	return type == proc->type && sub_type == proc->sub_type && nJob == w2xc::modelUtility::getInstance().getNumberOfJobs() && strcmp(dev_name, proc->dev_name) == 0;
+}
+
+static int bench_block_size(W2XConv *conv)
+{
+	struct W2XConvImpl *impl = conv->impl;
+	ComputeEnv *env = &impl->env;
+	std::vector<std::unique_ptr<w2xc::Model> > &models = impl->scale2_models;
+
+	static const int host_candidates[] = { 64, 128, 256, 512 };
+	static const int gpu_candidates[] = { 128, 256, 512, 1024 };
+	const int *candidates = (conv->target_processor->type == W2XCONV_PROC_HOST) ? host_candidates : gpu_candidates;
+	const int num_candidate = 4;
+
+	// every candidate splits same image which is as big as the largest one
+	bool is_rgb = (models[0]->getNInputPlanes() == 3);
+	int size = candidates[num_candidate - 1];
+	W2Mat src(size, size, is_rgb ? CV_32FC3 : CV_32FC1);
+
+	for (int yi=0; yi<size; yi++)
+	{
+		float *row = src.ptr<float>(yi);
+
+		for (int xi=0; xi<size*(is_rgb ? 3 : 1); xi++)
+		{
+			row[xi] = ((xi * 7 + yi * 13) % 256) / 255.0f;
+		}
+	}
+
+	W2XConvFlopsCounter flops = {};
+	int best_block_size = 0;
+	double best_sec = 0;
+
+	// warm up buffers and caches so the first candidate is not charged for them
+	{
+		W2Mat result;
+		w2xc::convertWithModels(conv, env, src, result, models, &flops, candidates[0], is_rgb ? w2xc::IMAGE_RGB_F32 : w2xc::IMAGE_Y, 0);
+	}
+
+	// best of some runs per candidate to suppress noise of scheduler
+	const int num_run = 2;
+
+	for (int ci=0; ci<num_candidate; ci++)
+	{
+		double sec = 0;
+
+		for (int ri=0; ri<num_run; ri++)
+		{
+			W2Mat result;
+			double t0 = getsec();
+
+			w2xc::convertWithModels(conv, env, src, result, models, &flops, candidates[ci], is_rgb ? w2xc::IMAGE_RGB_F32 : w2xc::IMAGE_Y, 0);
+
+			double t = getsec() - t0;
+
+			if (ri == 0 || t < sec)
+			{
+				sec = t;
+			}
+		}
+
+		if (conv->log_level >= 2)
+		{
+			printf("block size %d: %f[sec]\n", candidates[ci], sec);
+		}
+
+		if (best_block_size == 0 || sec < best_sec)
+		{
+			best_block_size = candidates[ci];
+			best_sec = sec;
+		}
+	}
+
+	return best_block_size;
+}
+
+int w2xconv_tune_block_size(struct W2XConv *conv, const W2XCONV_TCHAR *model_dir, int force)
+{
+	struct W2XConvImpl *impl = conv->impl;
+
+	if (impl->scale2_models.empty())
+	{
+		return -1;
+	}
+
+	_tstring path = _tstring(model_dir) + _T("/block_size.txt");
+	const W2XConvProcessor *proc = conv->target_processor;
+	int nJob = w2xc::modelUtility::getInstance().getNumberOfJobs();
+
+	// each line is "type sub_type jobs block_size device name"
+	std::vector<std::string> lines;
+	int block_size = 0;
+	FILE *fp = _tfopen(path.c_str(), _T("r"));
+
+	if (fp)
+	{
+		char line[1024];
+
+		while (fgets(line, sizeof(line), fp))
+		{
+			int type, sub_type, jobs, saved_block_size;
+			char dev_name[1024];
+
+			if (sscanf(line, "%d %d %d %d %1023[^\n]", &type, &sub_type, &jobs, &saved_block_size, dev_name) != 5)
+			{
+				continue;
+			}
+
+			if (block_size_entry_matches(conv, type, sub_type, jobs, dev_name))
+			{
+				block_size = saved_block_size;
+			}
+			else
+			{
+				lines.push_back(line);
+			}
+		}
+
+		fclose(fp);
+	}
+
+	if (block_size <= 0 || force)
+	{
+		block_size = bench_block_size(conv);
+
+		if (conv->log_level >= 1)
+		{
+			printf("block size for %s: %d\n", proc->dev_name, block_size);
+		}
+
+		fp = _tfopen(path.c_str(), _T("w"));
+
+		// it is tuned again next time if model directory is read only
+		if (fp)
+		{
+			for (auto &l : lines)
+			{
+				fputs(l.c_str(), fp);
+			}
+
+			fprintf(fp, "%d %d %d %d %s\n", (int) proc->type, proc->sub_type, nJob, block_size, proc->dev_name);
+			fclose(fp);
+		}
+	}
+
+	impl->env.pref_block_size = block_size;
+
+	return block_size;
+}
+
 void w2xconv_set_model_3x3
 (
 	struct W2XConv *conv,
@@ -726,7 +919,7 @@ void w2xconv_set_model_3x3
 	int layer_depth,
 	int num_input_plane,
 	const int *num_map, // num_map[layer_depth]
-	const float *coef_list, // coef_list[layer_depth][num_map][3x3]
+	const float *coef_list, // coef_list[layer_depth][num_map][num_input][3x3]
 	const float *bias // bias[layer_depth][num_map]
 )
 {
@@ -786,18 +979,96 @@ void w2xconv_fini(struct W2XConv *conv)
 	w2xc::finiThreadPool(impl->env.tpool);
 #endif
 
+	delete impl->env.profiler;
 	delete impl;
 	delete conv;
 }
 
+void w2xconv_get_stage_stats(struct W2XConv *conv, struct W2XConvStageStats *stats)
+{
+	conv->impl->env.profiler->get_stats(stats);
+}
+
+void w2xconv_reset_stage_stats(struct W2XConv *conv)
+{
+	conv->impl->env.profiler->reset();
+}
+
+const char *w2xconv_stage_name(enum W2XConvStage stage)
+{
+	static const char *names[W2XCONV_STAGE_COUNT] =
+	{
+		"task",
+		"color",
+		"tile",
+		"pack",
+		"filter",
+		"unpack",
+		"merge",
+		"copy back",
+		"uniform",
+	};
+
+	if (stage < 0 || stage >= W2XCONV_STAGE_COUNT)
+	{
+		return "unknown";
+	}
+
+	return names[stage];
+}
+
+void w2xconv_set_trace(struct W2XConv *conv, int enable)
+{
+	conv->impl->env.profiler->set_trace(enable != 0);
+}
+
+void w2xconv_set_cancel_func(struct W2XConv *conv, W2XConvCancelFunc func, void *data)
+{
+	conv->impl->env.cancel_func = func;
+	conv->impl->env.cancel_data = data;
+}
+
+void w2xconv_set_progress_func(struct W2XConv *conv, W2XConvProgressFunc func, void *data)
+{
+	conv->impl->env.progress_func = func;
+	conv->impl->env.progress_data = data;
+}
+
+int w2xconv_write_trace(struct W2XConv *conv, const W2XCONV_TCHAR *path)
+{
+	FILE *fp = _tfopen(path, _T("w"));
+
+	if (fp)
+	{
+		bool ok = conv->impl->env.profiler->write_trace(fp);
+		fclose(fp);
+
+		if (ok)
+		{
+			return 0;
+		}
+	}
+
+	std::string strpath = _tstr2str(path);
+	clearError(conv);
+
+	conv->last_error.code = W2XCONV_ERROR_LIBC_ERROR_PATH;
+	conv->last_error.u.libc_path.errno_ = errno;
+	conv->last_error.u.libc_path.path = strdup(strpath.c_str());
+
+	return -1;
+}
+
 #ifdef HAVE_OPENCV
-static void apply_denoise
+// returns false if it is cancelled
+static bool apply_denoise
 (
 	struct W2XConv *conv,
 	cv::Mat &image,
 	int denoise_level,
 	int blockSize,
-	enum w2xc::image_format fmt
+	enum w2xc::image_format fmt,
+	bool tta_mode = false
 )
 {
 	struct W2XConvImpl *impl = conv->impl;
@@ -823,39 +1094,56 @@ static void apply_denoise
 
 	W2Mat output_2;
 	W2Mat input_2(*input);
+	bool ok = true;
 
 	if (denoise_level == 0)
 	{
-		w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise0_models, &conv->flops, blockSize, fmt, conv->log_level);
+		ok = w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise0_models, &conv->flops, blockSize, fmt, conv->log_level, tta_mode);
 	}
 	else if (denoise_level == 1)
 	{
-		w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise1_models, &conv->flops, blockSize, fmt, conv->log_level);
+		ok = w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise1_models, &conv->flops, blockSize, fmt, conv->log_level, tta_mode);
 	}
 	else if (denoise_level == 2)
 	{
-		w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise2_models, &conv->flops, blockSize, fmt, conv->log_level);
+		ok = w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise2_models, &conv->flops, blockSize, fmt, conv->log_level, tta_mode);
 	}
 	else if (denoise_level == 3)
 	{
-		w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise3_models, &conv->flops, blockSize, fmt, conv->log_level);
+		ok = w2xc::convertWithModels(conv, env, input_2, output_2, impl->noise3_models, &conv->flops, blockSize, fmt, conv->log_level, tta_mode);
+	}
+
+	if (!ok)
+	{
+		if (isCancelled(env))
+		{
+			return false;
+		}
+
+		std::cerr << "w2xc::convertWithModels : something error has occured.\nstop." << std::endl;
+		std::exit(1);
 	}
 
 	output_2.to_cvmat(output);
 
 	if (! IS_3CHANNEL(fmt))
 	{
+		w2xc::ProfileSpan merge_span(env->profiler, W2XCONV_STAGE_MERGE, -1, (double) image.total() * image.elemSize() * 2);
 		cv::merge(imageSplit, image);
 	}
+
+	return true;
 }
 
-static void apply_scale
+// returns false if it is cancelled
+static bool apply_scale
 (
 	struct W2XConv *conv,
 	cv::Mat &image,
 	int iterTimesTwiceScaling,
 	int blockSize,
-	enum w2xc::image_format fmt
+	enum w2xc::image_format fmt,
+	bool tta_mode = false
 )
 {
 	struct W2XConvImpl *impl = conv->impl;
@@ -907,9 +1195,15 @@ static void apply_scale
 			output_2,
 			impl->scale2_models,
 			&conv->flops, blockSize, fmt,
-			conv->log_level
+			conv->log_level,
+			tta_mode
 		))
 		{
+			if (isCancelled(env))
+			{
+				return false;
+			}
+
 			std::cerr << "w2xc::convertWithModels : something error has occured.\nstop." << std::endl;
 			std::exit(1);
 		}
@@ -918,9 +1212,12 @@ static void apply_scale
 
 		if (!IS_3CHANNEL(fmt))
 		{
+			w2xc::ProfileSpan merge_span(env->profiler, W2XCONV_STAGE_MERGE, -1, (double) imageSize.area() * image.elemSize() * 2);
 			cv::merge(imageSplit, image);
 		}
 	} // 2x scaling : end
+
+	return true;
 }
 
 static inline float clipf(float min, float v, float max)
@@ -1786,7 +2083,8 @@ void merge_slices(cv::Mat *image, std::vector<cv::Mat> &pieces, const int max_sc
 	*image = pieces[0].clone();
 }
 
-void w2xconv_convert_mat
+// returns false with W2XCONV_ERROR_CANCELLED if it is cancelled. images of the middle are released at once
+bool w2xconv_convert_mat
 (
 	struct W2XConv *conv,
 	cv::Mat* image_dst, 
@@ -1803,10 +2101,14 @@ void w2xconv_convert_mat
 	enum w2xc::image_format fmt;
 	//char name[70]="";	// for imwrite test
 
+	w2xc::Profiler *profiler = conv->impl->env.profiler;
+	w2xc::ProfileSpan task_span(profiler, W2XCONV_STAGE_TASK, -1, (double) image_src->total() * image_src->elemSize());
+
 	int src_depth = CV_MAT_DEPTH(image_src->type());
 	int src_cn = CV_MAT_CN(image_src->type());
 	cv::Mat image = cv::Mat(image_src->size(), CV_32FC3);
 	cv::Mat alpha;
+	w2xc::ProfileSpan preproc_span(profiler, W2XCONV_STAGE_COLOR, -1, (double) image_src->total() * (image_src->elemSize() + image.elemSize()));
 
 	if (is_rgb)
 	{
@@ -1866,6 +2168,7 @@ void w2xconv_convert_mat
 		fmt = w2xc::IMAGE_Y;
 	}
 
+	preproc_span.finish();
 	image_src->release();
 	
 	int w2x_total_steps = 0;
@@ -1897,57 +2200,11 @@ void w2xconv_convert_mat
 				printf("Proccessing [%d/%zu] slices\n", i+1, pieces.size());
 			}
 			
-			if(conv->tta_mode)
-			{
-				cv::Mat tta_mat;
-				for(int ti=0; ti<8; ti++)
-				{
-					cv::Mat tmp=pieces[i].clone();
-					
-					if (conv->log_level >= 2)
-					{
-						printf("Working on TTA mode... step%d/8\n", ti+1);
-					}
-					
-					for(int tj=0; tj < ti%4; tj++)
-					{
-						cv::transpose(tmp, tmp);
-						cv::flip(tmp, tmp, 1);
-					}
-					
-					if(ti >= 4)
-					{
-						cv::flip(tmp, tmp, 1);
-					}
-					
-					apply_denoise(conv, tmp, denoise_level, blockSize, fmt);
-					
-					if(ti >= 4)
-					{
-						cv::flip(tmp, tmp, 1);
-					}
-					
-					for(int tj=0; tj < ti%4; tj++)
-					{
-						cv::transpose(tmp, tmp);
-						cv::flip(tmp, tmp, 0);
-					}
-					
-					if(ti==0)
-					{
-						tta_mat=tmp.clone();
-					}
-					else
-					{
-						tta_mat+=tmp;
-					}
-				}
-				tta_mat /= 8.0;
-				pieces[i] = tta_mat.clone();
-			}
-			else
+			// variants of tta are transformed while packing and averaged while unpacking
+			if (!apply_denoise(conv, pieces[i], denoise_level, blockSize, fmt, conv->tta_mode))
 			{
-				apply_denoise(conv, pieces[i], denoise_level, blockSize, fmt);
+				setCancelError(conv);
+				return false;
 			}
 		}
 		
@@ -1955,6 +2212,8 @@ void w2xconv_convert_mat
 		{
 			printf("Merging slices back to one image... in queue: %zu slices\n", pieces.size());
 		}
+
+		w2xc::ProfileSpan merge_span(profiler, W2XCONV_STAGE_MERGE, -1, (double) image.total() * image.elemSize() * 2);
 		merge_slices(&image, pieces, 1);
 	}
 
@@ -1986,57 +2245,10 @@ void w2xconv_convert_mat
 					printf("Proccessing [%d/%zu] slices\n", i+1, pieces.size());
 				}
 				
-				if(conv->tta_mode)
-				{
-					cv::Mat tta_mat;
-					for(int ti=0; ti<8; ti++)
-					{
-						cv::Mat tmp=pieces[i].clone();
-						
-						if (conv->log_level >= 2)
-						{
-							printf("Working on TTA mode... step%d/8\n", ti+1);
-						}
-						
-						for(int tj=0; tj < ti%4; tj++)
-						{
-							cv::transpose(tmp, tmp);
-							cv::flip(tmp, tmp, 1);
-						}
-						
-						if(ti >= 4)
-						{
-							cv::flip(tmp, tmp, 1);
-						}
-						
-						apply_scale(conv, tmp, 1, blockSize, fmt);
-						
-						if(ti >= 4)
-						{
-							cv::flip(tmp, tmp, 1);
-						}
-						
-						for(int j=0; j < ti%4; j++)
-						{
-							cv::transpose(tmp, tmp);
-							cv::flip(tmp, tmp, 0);
-						}
-						
-						if(ti==0)
-						{
-							tta_mat=tmp.clone();
-						}
-						else
-						{
-							tta_mat+=tmp;
-						}
-					}
-					tta_mat /= 8.0;
-					pieces[i] = tta_mat.clone();
-				}
-				else
+				if (!apply_scale(conv, pieces[i], 1, blockSize, fmt, conv->tta_mode))
 				{
-					apply_scale(conv, pieces[i], 1, blockSize, fmt);
+					setCancelError(conv);
+					return false;
 				}
 				
 				/*
@@ -2052,6 +2264,8 @@ void w2xconv_convert_mat
 			{
 				printf("Merging slices back to one image... in queue: %zu slices\n", pieces.size());
 			}
+
+			w2xc::ProfileSpan merge_span(profiler, W2XCONV_STAGE_MERGE, -1, (double) image.total() * image.elemSize() * 8);
 			merge_slices(&image, pieces);
 		}
 
@@ -2064,6 +2278,8 @@ void w2xconv_convert_mat
 		}
 	}
 
+	w2xc::ProfileSpan postproc_span(profiler, W2XCONV_STAGE_COLOR, -1, (double) image.total() * image.elemSize() * 2);
+
 	if (alpha.empty() || !dst_alpha)
 	{
 		*image_dst = cv::Mat(image.size(), CV_MAKETYPE(src_depth,3));
@@ -2128,6 +2344,8 @@ void w2xconv_convert_mat
 	sprintf(name, "[test] final_conv_mat.webp");
 	
 	cv::imwrite(name, *image_dst);*/
+
+	return true;
 }
 
 #if defined(_WIN32) && defined(_UNICODE)
@@ -2199,18 +2417,29 @@ void w2xconv_convert_mat
 	#define write_image cv::imwrite
 #endif
 
-int w2xconv_convert_file
+struct W2XConvFile
+{
+	_tstring dst_path;
+	cv::Mat image_src;
+	cv::Mat image_dst;
+	w2xconv_rgb_float3 background;
+	bool has_alpha;
+	bool dst_alpha;
+	std::vector<int> imwrite_params;
+};
+
+int w2xconv_read_file
 (
-	struct W2XConv *conv,
+	const struct W2XConv *conv,
+	struct W2XConvError *error,
+	struct W2XConvFile **ret,
 	const TCHAR *dst_path,
 	const TCHAR *src_path,
-	int denoise_level,
 	double scale,
-	int blockSize,
 	int* imwrite_params
 )
 {
-	double time_start = getsec();
+	*ret = nullptr;
 
 	FILE *png_fp = nullptr;
 	
@@ -2218,10 +2447,13 @@ int w2xconv_convert_file
 
 	if (png_fp == nullptr)
 	{
-		setPathError(conv, W2XCONV_ERROR_IMREAD_FAILED, src_path);
+		setPathError(error, W2XCONV_ERROR_IMREAD_FAILED, src_path);
 		return -1;
 	}
 
+	std::unique_ptr<W2XConvFile> file(new W2XConvFile);
+	file->dst_path = dst_path;
+
 	bool has_alpha;
 	//Background colour
 	//float3 background(1.0f, 1.0f, 1.0f);
@@ -2235,7 +2467,7 @@ int w2xconv_convert_file
 		png_fp = nullptr;
 	}
 
-	cv::Mat image_src, image_dst;
+	cv::Mat &image_src = file->image_src;
 
 	/*
 	 * IMREAD_COLOR                 : always BGR
@@ -2296,18 +2528,18 @@ int w2xconv_convert_file
 	{
 		if (max_scale >= 512)
 		{
-			setError(conv, W2XCONV_ERROR_SCALE_LIMIT);
+			setError(error, W2XCONV_ERROR_SCALE_LIMIT);
 			return -1;
 		}
 	}
 	
 	// for webp limit
 	if(dst_webp && (image_src.rows > WEBP_MAX_WIDTH / scale || image_src.cols > WEBP_MAX_WIDTH / scale)){
-		setError(conv, W2XCONV_ERROR_WEBP_SIZE_LIMIT);
+		setError(error, W2XCONV_ERROR_WEBP_SIZE_LIMIT);
 		return -1;
 	}
 	else if (dst_webp && imwrite_params[2] <= 100 && scale > 1.0 && image_src.rows * image_src.cols > WEBP_LOSSY_OUTPUT_MAX / scale / scale){
-		setError(conv, W2XCONV_ERROR_WEBP_LOSSY_SIZE_LIMIT);
+		setError(error, W2XCONV_ERROR_WEBP_LOSSY_SIZE_LIMIT);
 		return -1;
 	}
 	
@@ -2315,50 +2547,124 @@ int w2xconv_convert_file
 	{
 		printf("Scaling image from %dx%d to %dx%d\n", image_src.cols, image_src.rows, (int) (image_src.cols * scale), (int) (image_src.rows * scale));
 	}
-	
-	w2xconv_convert_mat(conv, &image_dst, &image_src, denoise_level, scale, blockSize, background, has_alpha, dst_alpha);
-	
-	if (conv->log_level >= 2)
-	{
-		printf("Writing image to file...\n\n");
-	}
-	
-	std::vector<int> vec_imwrite_params;
+
+	file->background = background;
+	file->has_alpha = has_alpha;
+	file->dst_alpha = dst_alpha;
+
 	for (int i = 0; i < 6; i++)
 	{
-		vec_imwrite_params.push_back(imwrite_params[i]);
-	}
-	
-	if (!write_image(dst_path, image_dst, vec_imwrite_params))
-	{
-		setPathError(conv, W2XCONV_ERROR_IMWRITE_FAILED, dst_path);
-		return -1;
+		file->imwrite_params.push_back(imwrite_params[i]);
 	}
 
-	double time_end = getsec();
-
-	conv->flops.process_sec += time_end - time_start;
-
-	//printf("== %f == \n", conv->impl->env.transfer_wait);
+	*ret = file.release();
 
 	return 0;
 }
 
-
-static void convert_mat
+int w2xconv_convert_read_file
 (
 	struct W2XConv *conv,
-	cv::Mat &image,
+	struct W2XConvFile *file,
 	int denoise_level,
 	double scale,
-	int dst_w, int dst_h,
-	int blockSize,
-	enum w2xc::image_format fmt
+	int blockSize
 )
 {
-	int w2x_total_steps = 0;
-	int w2x_current_step = 1;
-	int iterTimesTwiceScaling;
+	if (!w2xconv_convert_mat(conv, &file->image_dst, &file->image_src, denoise_level, scale, blockSize, file->background, file->has_alpha, file->dst_alpha))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int w2xconv_write_file
+(
+	const struct W2XConv *conv,
+	struct W2XConvError *error,
+	struct W2XConvFile *file
+)
+{
+	if (conv->log_level >= 2)
+	{
+		printf("Writing image to file...\n\n");
+	}
+	
+	if (!write_image(file->dst_path.c_str(), file->image_dst, file->imwrite_params))
+	{
+		setPathError(error, W2XCONV_ERROR_IMWRITE_FAILED, file->dst_path);
+		return -1;
+	}
+
+	// output is not needed any more. file could be kept by caller until it is freed
+	file->image_dst.release();
+
+	return 0;
+}
+
+void w2xconv_free_file(struct W2XConvFile *file)
+{
+	delete file;
+}
+
+int w2xconv_convert_file
+(
+	struct W2XConv *conv,
+	const TCHAR *dst_path,
+	const TCHAR *src_path,
+	int denoise_level,
+	double scale,
+	int blockSize,
+	int* imwrite_params
+)
+{
+	double time_start = getsec();
+
+	W2XConvFile *file = nullptr;
+
+	if (w2xconv_read_file(conv, &conv->last_error, &file, dst_path, src_path, scale, imwrite_params) < 0)
+	{
+		return -1;
+	}
+
+	std::unique_ptr<W2XConvFile> file_holder(file);
+
+	if (w2xconv_convert_read_file(conv, file, denoise_level, scale, blockSize) < 0)
+	{
+		return -1;
+	}
+
+	if (w2xconv_write_file(conv, &conv->last_error, file) < 0)
+	{
+		return -1;
+	}
+
+	double time_end = getsec();
+
+	conv->flops.process_sec += time_end - time_start;
+
+	//printf("== %f == \n", conv->impl->env.transfer_wait);
+
+	return 0;
+}
+
+
+// returns false with W2XCONV_ERROR_CANCELLED if it is cancelled
+static bool convert_mat
+(
+	struct W2XConv *conv,
+	cv::Mat &image,
+	int denoise_level,
+	double scale,
+	int dst_w, int dst_h,
+	int blockSize,
+	enum w2xc::image_format fmt
+)
+{
+	int w2x_total_steps = 0;
+	int w2x_current_step = 1;
+	int iterTimesTwiceScaling;
 	
 	if (scale != 1.0)
 	{
@@ -2371,7 +2677,11 @@ static void convert_mat
 		{
 			printf("Step %02d/%02d: Denoising\n", w2x_current_step++, ++w2x_total_steps);
 		}
-		apply_denoise(conv, image, denoise_level, blockSize, fmt);
+		if (!apply_denoise(conv, image, denoise_level, blockSize, fmt))
+		{
+			setCancelError(conv);
+			return false;
+		}
 	}
 
 	if (scale != 1.0)
@@ -2382,7 +2692,11 @@ static void convert_mat
 		{
 			shrinkRatio = scale / std::pow(2.0, static_cast<double>(iterTimesTwiceScaling));
 		}
-		apply_scale(conv, image, iterTimesTwiceScaling, blockSize, fmt);
+		if (!apply_scale(conv, image, iterTimesTwiceScaling, blockSize, fmt))
+		{
+			setCancelError(conv);
+			return false;
+		}
 
 		if (shrinkRatio != 0.0)
 		{
@@ -2392,6 +2706,8 @@ static void convert_mat
 			cv::resize(image, image, lastImageSize, 0, 0, cv::INTER_LINEAR);
 		}
 	}
+
+	return true;
 }
 
 
@@ -2418,14 +2734,23 @@ int w2xconv_convert_rgb
 	if (is_rgb)
 	{
 		srci.copyTo(image);
-		convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_RGB);
+
+		if (!convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_RGB))
+		{
+			return -1;
+		}
+
 		image.copyTo(dsti);
 	}
 	else
 	{
 		srci.convertTo(image, CV_32F, 1.0 / 255.0);
 		cv::cvtColor(image, image, cv::COLOR_RGB2YUV);
-		convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_Y);
+
+		if (!convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_Y))
+		{
+			return -1;
+		}
 
 		cv::cvtColor(image, image, cv::COLOR_YUV2RGB);
 		image.convertTo(dsti, CV_8U, 255.0);
@@ -2461,7 +2786,12 @@ int w2xconv_convert_rgb_f32
 	cv::Mat image;
 
 	srci.copyTo(image);
-	convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_RGB_F32);
+
+	if (!convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_RGB_F32))
+	{
+		return -1;
+	}
+
 	image.copyTo(dsti);
 
 	return 0;
@@ -2494,7 +2824,10 @@ int w2xconv_convert_yuv
 	cv::Mat dsti(dst_h, dst_w, CV_32FC3, dst, dst_step_byte);
 	cv::Mat image = srci.clone();
 
-	convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_Y);
+	if (!convert_mat(conv, image, denoise_level, scale, dst_w, dst_h, block_size, w2xc::IMAGE_Y))
+	{
+		return -1;
+	}
 
 	image.copyTo(dsti);
 
@@ -2523,7 +2856,6 @@ int w2xconv_apply_filter_y
 	struct W2XConvImpl *impl = conv->impl;
 	ComputeEnv *env = &impl->env;
 
-	W2Mat dsti(src_w, src_h, CV_32FC1, dst, (int) dst_step_byte);
 	W2Mat srci(src_w, src_h, CV_32FC1, src, (int) src_step_byte);
 
 	std::vector<std::unique_ptr<w2xc::Model> > *mp = NULL;
@@ -2564,15 +2896,454 @@ int w2xconv_apply_filter_y
 	W2Mat result;
 	w2xc::convertWithModels(conv, env, srci, result, *mp, &conv->flops, blockSize, w2xc::IMAGE_Y, conv->log_level);
 
+	// W2Mat with data has a copy of it. so result is written to dst directly
 	for (int yi=0; yi<src_h; yi++)
 	{
-		char *d0 = dsti.ptr<char>(yi);
+		char *d0 = (char*) dst + yi * dst_step_byte;
 		char *s0 = result.ptr<char>(yi);
 		memcpy(d0, s0, src_w * sizeof(float));
 	}
 	return 0;
 }
 
+static inline int clampi(int v, int max)
+{
+	return (std::min)((std::max)(v, 0), max);
+}
+
+static inline float clip255(float v)
+{
+	return (std::min)((std::max)(0.0f, v), 255.0f);
+}
+
+/*
+ * B8G8R8A8 rows of caller. pixels are blended to background by alpha as preproc_rgba2rgb does.
+ * shift 1 reads it as nearest 2x image which is input of scale2 models
+ */
+struct BGRA8Source : public w2xc::BlockSource
+{
+	const unsigned char *src;
+	size_t step;
+	int shift;
+	bool has_alpha;
+	w2xconv_rgb_float3 bkgd;
+
+	BGRA8Source(const unsigned char *src, size_t step, int src_w, int src_h, int shift, bool has_alpha, w2xconv_rgb_float3 bkgd)
+		: src(src), step(step), shift(shift), has_alpha(has_alpha), bkgd(bkgd)
+	{
+		width = src_w << shift;
+		height = src_h << shift;
+	}
+
+	virtual void pack(float *packed, int x, int y, int w, int h)
+	{
+		float div = 1.0f / 255;
+
+		for (int yi=0; yi<h; yi++)
+		{
+			const unsigned char *src_line = src + (clampi(y + yi, height - 1) >> shift) * step;
+			float *packed_line = packed + yi * w * 3;
+
+			for (int xi=0; xi<w; xi++)
+			{
+				const unsigned char *p = src_line + (clampi(x + xi, width - 1) >> shift) * 4;
+				float r = p[2] * div;
+				float g = p[1] * div;
+				float b = p[0] * div;
+
+				if (has_alpha)
+				{
+					unsigned char a = p[3];
+
+					if (a == 0)
+					{
+						r = bkgd.r;
+						g = bkgd.g;
+						b = bkgd.b;
+					}
+					else
+					{
+						unsigned char ra = 255 - a;
+						r = (std::min)(1.0f, r * (a * div) + bkgd.r * (ra * div));
+						g = (std::min)(1.0f, g * (a * div) + bkgd.g * (ra * div));
+						b = (std::min)(1.0f, b * (a * div) + bkgd.b * (ra * div));
+					}
+				}
+
+				packed_line[xi*3 + 0] = r;
+				packed_line[xi*3 + 1] = g;
+				packed_line[xi*3 + 2] = b;
+			}
+		}
+	}
+};
+
+// float rgb image between denoise and scale2
+struct FloatRGBSource : public w2xc::BlockSource
+{
+	W2Mat &image;
+	int shift;
+
+	FloatRGBSource(W2Mat &image, int shift)
+		: image(image), shift(shift)
+	{
+		width = image.view_width << shift;
+		height = image.view_height << shift;
+	}
+
+	virtual void pack(float *packed, int x, int y, int w, int h)
+	{
+		for (int yi=0; yi<h; yi++)
+		{
+			const float *src_line = image.ptr<float>(clampi(y + yi, height - 1) >> shift);
+			float *packed_line = packed + yi * w * 3;
+
+			for (int xi=0; xi<w; xi++)
+			{
+				const float *p = src_line + (clampi(x + xi, width - 1) >> shift) * 3;
+
+				packed_line[xi*3 + 0] = p[0];
+				packed_line[xi*3 + 1] = p[1];
+				packed_line[xi*3 + 2] = p[2];
+			}
+		}
+	}
+};
+
+struct FloatRGBSink : public w2xc::BlockSink
+{
+	W2Mat &image;
+
+	FloatRGBSink(W2Mat &image) : image(image) { }
+
+	virtual void unpack(const float *packed, int packed_w, int x, int y, int w, int h)
+	{
+		for (int yi=0; yi<h; yi++)
+		{
+			const float *packed_line = packed + yi * packed_w * 3;
+			float *dst_line = image.ptr<float>(y + yi) + x * 3;
+
+			for (int xi=0; xi<w*3; xi++)
+			{
+				dst_line[xi] = (std::max)(0.0f, (std::min)(1.0f, packed_line[xi]));
+			}
+		}
+	}
+};
+
+/*
+ * B8G8R8A8 rows of caller. alpha is taken from source and removed from color as postproc_rgb2rgba does.
+ * alpha of 2x image is interpolated linearly as cv::resize
+ */
+struct BGRA8Sink : public w2xc::BlockSink
+{
+	ComputeEnv *env;
+	unsigned char *dst;
+	size_t dst_step;
+	const unsigned char *src;
+	size_t src_step;
+	int src_w;
+	int src_h;
+	int shift;
+	bool has_alpha;
+	w2xconv_rgb_float3 bkgd;
+
+	BGRA8Sink(ComputeEnv *env, unsigned char *dst, size_t dst_step, const unsigned char *src, size_t src_step, int src_w, int src_h, int shift, bool has_alpha, w2xconv_rgb_float3 bkgd)
+		: env(env), dst(dst), dst_step(dst_step), src(src), src_step(src_step), src_w(src_w), src_h(src_h), shift(shift), has_alpha(has_alpha), bkgd(bkgd)
+	{
+	}
+
+	// source position and weight of next one for 2x
+	static void linear_coef(int d, int size, int *s, float *weight)
+	{
+		float f = (d + 0.5f) * 0.5f - 0.5f;
+		int i = (int) floorf(f);
+
+		if (i < 0)
+		{
+			*s = 0;
+			*weight = 0;
+		}
+		else if (i >= size - 1)
+		{
+			*s = size - 1;
+			*weight = 0;
+		}
+		else
+		{
+			*s = i;
+			*weight = f - i;
+		}
+	}
+
+	float alpha(int x, int y)
+	{
+		float div = 1.0f / 255;
+
+		if (shift == 0)
+		{
+			return src[y * src_step + x * 4 + 3] * div;
+		}
+
+		int sx, sy;
+		float wx, wy;
+		linear_coef(x, src_w, &sx, &wx);
+		linear_coef(y, src_h, &sy, &wy);
+
+		int sx1 = (std::min)(sx + 1, src_w - 1);
+		int sy1 = (std::min)(sy + 1, src_h - 1);
+		const unsigned char *line0 = src + sy * src_step;
+		const unsigned char *line1 = src + sy1 * src_step;
+
+		float a0 = line0[sx*4 + 3] * div * (1.0f - wx) + line0[sx1*4 + 3] * div * wx;
+		float a1 = line1[sx*4 + 3] * div * (1.0f - wx) + line1[sx1*4 + 3] * div * wx;
+
+		return a0 * (1.0f - wy) + a1 * wy;
+	}
+
+	virtual void unpack(const float *packed, int packed_w, int x, int y, int w, int h)
+	{
+		for (int yi=0; yi<h; yi++)
+		{
+			const float *packed_line = packed + yi * packed_w * 3;
+			unsigned char *dst_line = dst + (y + yi) * dst_step + x * 4;
+
+			for (int xi=0; xi<w; xi++)
+			{
+				float r = (std::max)(0.0f, (std::min)(1.0f, packed_line[xi*3 + 0]));
+				float g = (std::max)(0.0f, (std::min)(1.0f, packed_line[xi*3 + 1]));
+				float b = (std::max)(0.0f, (std::min)(1.0f, packed_line[xi*3 + 2]));
+				float a = 1.0f;
+
+				if (has_alpha)
+				{
+					a = alpha(x + xi, y + yi);
+					r = (r - bkgd.r)/a + bkgd.r;
+					g = (g - bkgd.g)/a + bkgd.g;
+					b = (b - bkgd.b)/a + bkgd.b;
+				}
+
+				dst_line[xi*4 + 2] = (unsigned char) clip255(r * 255);
+				dst_line[xi*4 + 1] = (unsigned char) clip255(g * 255);
+				dst_line[xi*4 + 0] = (unsigned char) clip255(b * 255);
+				dst_line[xi*4 + 3] = (unsigned char) clip255(a * 255);
+			}
+		}
+
+		// caller could show finished blocks before whole image is done
+		if (env->progress_func)
+		{
+			env->progress_func(env->progress_data, x, y, w, h);
+		}
+	}
+};
+
+static std::vector<std::unique_ptr<w2xc::Model> > *get_noise_models(struct W2XConvImpl *impl, int denoise_level)
+{
+	switch (denoise_level)
+	{
+		case 0:
+		{
+			return &impl->noise0_models;
+		}
+		case 1:
+		{
+			return &impl->noise1_models;
+		}
+		case 2:
+		{
+			return &impl->noise2_models;
+		}
+		default:
+		{
+			return &impl->noise3_models;
+		}
+	}
+}
+
+int w2xconv_convert_bgra8
+(
+	struct W2XConv *conv,
+	unsigned char *dst, size_t dst_step_byte,
+	const unsigned char *src, size_t src_step_byte,
+	int src_w, int src_h,
+	int denoise_level,
+	double scale,
+	int block_size,
+	bool has_alpha
+)
+{
+	struct W2XConvImpl *impl = conv->impl;
+	ComputeEnv *env = &impl->env;
+	bool is_rgb = (impl->scale2_models[0]->getNInputPlanes() == 3);
+
+	if (!is_rgb || conv->tta_mode || (scale != 1.0 && scale != 2.0))
+	{
+#ifdef HAVE_OPENCV
+		cv::Mat src_mat(src_h, src_w, CV_8UC4, (void*) src, src_step_byte);
+		cv::Mat dst_mat;
+
+		// preprocess without alpha takes 3 channels
+		if (!has_alpha)
+		{
+			cv::cvtColor(src_mat, src_mat, cv::COLOR_BGRA2BGR);
+		}
+
+		if (!w2xconv_convert_mat(conv, &dst_mat, &src_mat, denoise_level, scale, block_size, { 1, 1, 1 }, has_alpha, has_alpha))
+		{
+			return -1;
+		}
+
+		w2xc::ProfileSpan copy_span(env->profiler, W2XCONV_STAGE_COPY_BACK, -1, (double) dst_mat.total() * dst_mat.elemSize() * 2);
+		int cn = dst_mat.channels();
+
+		for (int yi=0; yi<dst_mat.rows; yi++)
+		{
+			const unsigned char *s = dst_mat.ptr<unsigned char>(yi);
+			unsigned char *d = dst + yi * dst_step_byte;
+
+			for (int xi=0; xi<dst_mat.cols; xi++)
+			{
+				d[xi*4 + 0] = s[xi*cn + 0];
+				d[xi*4 + 1] = s[xi*cn + 1];
+				d[xi*4 + 2] = s[xi*cn + 2];
+				d[xi*4 + 3] = (cn == 4) ? s[xi*cn + 3] : 255;
+			}
+		}
+
+		return 0;
+#else
+		setError(conv, W2XCONV_ERROR_Y_MODEL_MISMATCH_TO_RGB_F32);
+		return -1;
+#endif
+	}
+
+	w2xc::ProfileSpan task_span(env->profiler, W2XCONV_STAGE_TASK, -1, (double) src_w * src_h * 4);
+
+	w2xconv_rgb_float3 bkgd = { 1, 1, 1 };
+	int shift = (scale == 2.0) ? 1 : 0;
+	BGRA8Sink dst_image(env, dst, dst_step_byte, src, src_step_byte, src_w, src_h, shift, has_alpha, bkgd);
+	bool ok = true;
+
+	if (denoise_level != -1 && shift)
+	{
+		// only this one is a float image of whole size
+		W2Mat denoised(src_w, src_h, CV_32FC3);
+		BGRA8Source src_image(src, src_step_byte, src_w, src_h, 0, has_alpha, bkgd);
+		FloatRGBSink denoised_sink(denoised);
+		FloatRGBSource denoised_source(denoised, 1);
+
+		ok = w2xc::convertWithModelsStrided(conv, env, src_image, denoised_sink, *get_noise_models(impl, denoise_level), &conv->flops, block_size, conv->log_level)
+			&& w2xc::convertWithModelsStrided(conv, env, denoised_source, dst_image, impl->scale2_models, &conv->flops, block_size, conv->log_level);
+	}
+	else if (denoise_level != -1)
+	{
+		BGRA8Source src_image(src, src_step_byte, src_w, src_h, 0, has_alpha, bkgd);
+		ok = w2xc::convertWithModelsStrided(conv, env, src_image, dst_image, *get_noise_models(impl, denoise_level), &conv->flops, block_size, conv->log_level);
+	}
+	else if (shift)
+	{
+		BGRA8Source src_image(src, src_step_byte, src_w, src_h, 1, has_alpha, bkgd);
+		ok = w2xc::convertWithModelsStrided(conv, env, src_image, dst_image, impl->scale2_models, &conv->flops, block_size, conv->log_level);
+	}
+	else
+	{
+		for (int yi=0; yi<src_h; yi++)
+		{
+			memcpy(dst + yi * dst_step_byte, src + yi * src_step_byte, src_w * 4);
+		}
+	}
+
+	// buffers are released already
+	if (!ok)
+	{
+		setCancelError(conv);
+		return -1;
+	}
+
+	return 0;
+}
+
+int w2xconv_test_thread_pool(struct W2XConv *conv, int block_size)
+{
+#if defined(_WIN32) || defined(__linux)
+	struct W2XConvImpl *impl = conv->impl;
+	ComputeEnv *env = &impl->env;
+	int nJob = w2xc::modelUtility::getInstance().getNumberOfJobs();
+
+	w2xc::benchThreadPool(nJob, 10000);
+
+	if (conv->target_processor->type != W2XCONV_PROC_HOST || impl->scale2_models.empty())
+	{
+		return 0;
+	}
+
+	std::vector<std::unique_ptr<w2xc::Model> > &models = impl->scale2_models;
+	bool is_rgb = (models[0]->getNInputPlanes() == 3);
+	int w = 512;
+	int h = 512;
+
+	W2Mat src(w, h, is_rgb ? CV_32FC3 : CV_32FC1);
+
+	for (int yi=0; yi<h; yi++)
+	{
+		float *row = src.ptr<float>(yi);
+
+		for (int xi=0; xi<w*(is_rgb ? 3 : 1); xi++)
+		{
+			row[xi] = ((xi * 7 + yi * 13) % 256) / 255.0f;
+		}
+	}
+
+	w2xc::ThreadPool *tpool = env->tpool;
+	static const char *pool_names[] = { "fork/join", "work stealing" };
+
+	// warm up buffers and caches
+	{
+		W2Mat result;
+		w2xc::convertWithModels(conv, env, src, result, models, &conv->flops, block_size, is_rgb ? w2xc::IMAGE_RGB_F32 : w2xc::IMAGE_Y, 0);
+	}
+
+	for (int pi=0; pi<2; pi++)
+	{
+		env->tpool = w2xc::initThreadPool(nJob, pi == 0);
+
+		W2Mat result;
+		double t0 = getsec();
+
+		w2xc::convertWithModels
+		(
+			conv,
+			env,
+			src,
+			result,
+			models,
+			&conv->flops,
+			block_size,
+			is_rgb ? w2xc::IMAGE_RGB_F32 : w2xc::IMAGE_Y,
+			0
+		);
+
+		double t1 = getsec();
+
+		w2xc::finiThreadPool(env->tpool);
+
+		printf
+		(
+			"%s: %dx%d %f[sec], %f[ms] per layer\n",
+			pool_names[pi],
+			w,
+			h,
+			t1 - t0,
+			(t1 - t0) * 1000.0 / models.size()
+		);
+	}
+
+	env->tpool = tpool;
+#endif
+	return 0;
+}
+
 #ifdef HAVE_OPENCV
 int w2xconv_test(struct W2XConv *conv, int block_size)
 {
@@ -2743,7 +3514,11 @@ int w2xconv_convert_memory
 	cv::Mat src_mat( height, width, mat_type, pBits );
 	cv::Mat dst_mat;
 
-	w2xconv_convert_mat( conv, &dst_mat, &src_mat, denoise_level, scale, block_size, { 1, 1, 1 }, has_alpha, has_alpha );
+	if (!w2xconv_convert_mat( conv, &dst_mat, &src_mat, denoise_level, scale, block_size, { 1, 1, 1 }, has_alpha, has_alpha ))
+	{
+		return -1;
+	}
+
 	memcpy( pBits, dst_mat.data, dst_mat.total() * dst_mat.elemSize());
 
 	return 0;
@@ -2763,7 +3538,12 @@ int w2xconv_convert_memory2
 	cv::Mat src_mat(height, width, mat_type, pSrcBits);
 	cv::Mat dst_mat;
 
-	w2xconv_convert_mat(conv, &dst_mat, &src_mat, denoise_level, scale, block_size, { 1, 1, 1 }, has_alpha, has_alpha);
+	if (!w2xconv_convert_mat(conv, &dst_mat, &src_mat, denoise_level, scale, block_size, { 1, 1, 1 }, has_alpha, has_alpha))
+	{
+		return -1;
+	}
+
+	w2xc::ProfileSpan copy_span(conv->impl->env.profiler, W2XCONV_STAGE_COPY_BACK, -1, (double) dst_mat.total() * dst_mat.elemSize() * 2);
 	memcpy(pDstBits, dst_mat.data, dst_mat.total() * dst_mat.elemSize());
 	
 	return 0;}
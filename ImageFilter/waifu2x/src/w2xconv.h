@@ -87,6 +87,8 @@ enum W2XConvErrorCode
 	W2XCONV_ERROR_SIZE_LIMIT,
 	W2XCONV_ERROR_WEBP_SIZE_LIMIT,
 	W2XCONV_ERROR_WEBP_LOSSY_SIZE_LIMIT,
+
+	W2XCONV_ERROR_CANCELLED,
 };
 
 struct W2XConvError
@@ -120,6 +122,7 @@ struct W2XConvError
 
 W2XCONV_EXPORT char *w2xconv_strerror(struct W2XConvError *e); /* should be free by w2xcvonv_free() */
 W2XCONV_EXPORT void w2xconv_free(void *p);
+W2XCONV_EXPORT void w2xconv_clear_error(struct W2XConvError *e); /* error which is not last_error of W2XConv */
 
 struct W2XConvFlopsCounter
 {
@@ -128,6 +131,29 @@ struct W2XConvFlopsCounter
 	double process_sec;
 };
 
+enum W2XConvStage
+{
+	W2XCONV_STAGE_TASK,		/* one conversion of image */
+	W2XCONV_STAGE_COLOR,	/* conversion between source pixel and float rgb/yuv */
+	W2XCONV_STAGE_TILE,		/* one block */
+	W2XCONV_STAGE_PACK,		/* padding and packing of block */
+	W2XCONV_STAGE_FILTER,	/* one layer of block */
+	W2XCONV_STAGE_UNPACK,
+	W2XCONV_STAGE_MERGE,	/* merge of slices and planes */
+	W2XCONV_STAGE_COPY_BACK,	/* block to image and image to caller */
+	W2XCONV_STAGE_UNIFORM,	/* block of one color which is filled without filters. hit rate is count of it per tile */
+
+	W2XCONV_STAGE_COUNT
+};
+
+struct W2XConvStageStats
+{
+	unsigned long long count;
+	double sec;
+	double bytes;
+	double flop;
+};
+
 enum W2XConvProcessorType
 {
 	W2XCONV_PROC_HOST,
@@ -224,6 +250,14 @@ W2XCONV_EXPORT struct W2XConv *w2xconv_init_with_processor_and_tta(int processor
 W2XCONV_EXPORT int w2xconv_load_model(const int denoise_level, struct W2XConv *conv, const W2XCONV_TCHAR *model_dir);
 W2XCONV_EXPORT int w2xconv_load_models(struct W2XConv *conv, const W2XCONV_TCHAR *model_dir);
 
+/*
+ * sets block size which is used when 0 is passed as block size. call it after loading models.
+ * it is read from block_size.txt of model_dir for the processor and jobs.
+ * if there's no entry or force is not 0, block sizes are benchmarked with scale2 model and best one is saved.
+ * returns block size or -1
+ */
+W2XCONV_EXPORT int w2xconv_tune_block_size(struct W2XConv *conv, const W2XCONV_TCHAR *model_dir, int force);
+
 W2XCONV_EXPORT void w2xconv_set_model_3x3
 (
 	struct W2XConv *conv,
@@ -231,7 +265,7 @@ W2XCONV_EXPORT void w2xconv_set_model_3x3
 	int layer_depth,
 	int num_input_plane,
 	const int *num_map, // num_map[layer_depth]
-	const float *coef_list, // coef_list[layer_depth][num_map][3x3]
+	const float *coef_list, // coef_list[layer_depth][num_map][num_input][3x3]
 	const float *bias // bias[layer_depth][num_map]
 );
 
@@ -250,6 +284,42 @@ W2XCONV_EXPORT int w2xconv_convert_file
 	int* imwrite_params
 );
 
+/*
+ * w2xconv_convert_file() in three stages
+ * read and write don't modify conv. so they could run on other threads while another file is converted
+ * convert should be called by one thread at a time like the others
+ */
+struct W2XConvFile;
+
+W2XCONV_EXPORT int w2xconv_read_file
+(
+	const struct W2XConv *conv,
+	struct W2XConvError *error, /* should be initialized to W2XCONV_NOERROR */
+	struct W2XConvFile **ret, /* should be free by w2xconv_free_file() */
+	const W2XCONV_TCHAR *dst_path,
+	const W2XCONV_TCHAR *src_path,
+	double scale,
+	int* imwrite_params
+);
+
+W2XCONV_EXPORT int w2xconv_convert_read_file
+(
+	struct W2XConv *conv,
+	struct W2XConvFile *file,
+	int denoise_level, /* -1:none, 0:L0 denoise, 1:L1 denoise, 2:L2 denoise, 3:L3 denoise  */
+	double scale,
+	int block_size
+);
+
+W2XCONV_EXPORT int w2xconv_write_file
+(
+	const struct W2XConv *conv,
+	struct W2XConvError *error,
+	struct W2XConvFile *file
+);
+
+W2XCONV_EXPORT void w2xconv_free_file(struct W2XConvFile *file);
+
 W2XCONV_EXPORT int w2xconv_convert_rgb
 (
 	struct W2XConv *conv,
@@ -293,8 +363,52 @@ W2XCONV_EXPORT int w2xconv_apply_filter_y
 	int block_size
 );
 
+/*
+ * converts bgra8 rows to bgra8 rows through their steps without float image of whole size.
+ * blocks are packed from src into first layer and last layer is unpacked into dst.
+ * alpha is blended with white as w2xconv_convert_memory2. it is 255 when has_alpha is false.
+ * it goes through w2xconv_convert_memory2 way for y models, tta and scale other than 1 or 2
+ */
+W2XCONV_EXPORT int w2xconv_convert_bgra8
+(
+	struct W2XConv *conv,
+	unsigned char *dst, size_t dst_step_byte, /* bgra8 (src_w*scale, src_h*scale) */
+	const unsigned char *src, size_t src_step_byte, /* bgra8 (src_w, src_h) */
+	int src_w, int src_h,
+	int denoise_level, /* -1:none, 0:L0 denoise, 1:L1 denoise, 2:L2 denoise, 3:L3 denoise  */
+	double scale,
+	int block_size,
+	bool has_alpha
+);
+
 W2XCONV_EXPORT int w2xconv_test(struct W2XConv *conv, int block_size);
 
+/* stats of each stage since init or reset. stats should have W2XCONV_STAGE_COUNT elements */
+W2XCONV_EXPORT void w2xconv_get_stage_stats(struct W2XConv *conv, struct W2XConvStageStats *stats);
+W2XCONV_EXPORT void w2xconv_reset_stage_stats(struct W2XConv *conv);
+W2XCONV_EXPORT const char *w2xconv_stage_name(enum W2XConvStage stage);
+
+/* spans of stages are recorded while trace is enabled. they are written as chrome trace json */
+W2XCONV_EXPORT void w2xconv_set_trace(struct W2XConv *conv, int enable);
+W2XCONV_EXPORT int w2xconv_write_trace(struct W2XConv *conv, const W2XCONV_TCHAR *path);
+
+/*
+ * func is polled between tiles and layers by the converting thread. if it returns not 0,
+ * conversion releases its buffers and returns -1 with W2XCONV_ERROR_CANCELLED. null func disables it
+ */
+typedef int (*W2XConvCancelFunc)(void *data);
+W2XCONV_EXPORT void w2xconv_set_cancel_func(struct W2XConv *conv, W2XConvCancelFunc func, void *data);
+
+/*
+ * func is called by the converting thread when a block of dst of w2xconv_convert_bgra8() is written.
+ * x, y, w, h are the rect in dst pixels and it isn't written again. null func disables it
+ */
+typedef void (*W2XConvProgressFunc)(void *data, int x, int y, int w, int h);
+W2XCONV_EXPORT void w2xconv_set_progress_func(struct W2XConv *conv, W2XConvProgressFunc func, void *data);
+
+/* prints dispatch overhead of thread pools and wall time of scale2 model on host */
+W2XCONV_EXPORT int w2xconv_test_thread_pool(struct W2XConv *conv, int block_size);
+
 W2XCONV_EXPORT int w2xconv_convert_memory
 (
 	struct W2XConv *conv,